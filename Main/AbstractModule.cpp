@@ -4,82 +4,142 @@
 #include "PHModule.h"
 #endif
 
+void PublishStruct::BeginStream(AbstractModule* module, const Command& command)
+{
+  OutStream = command.GetIncomingStream();
+  OutModule = module;
+  HeaderSent = false;
+}
+void PublishStruct::WriteHeader(Stream* s, AbstractModule* module)
+{
+  s->print(Status ? OK_ANSWER : ERR_ANSWER);
+  s->print(COMMAND_DELIMITER);
+
+  if(AddModuleIDToAnswer && module) // надо добавить имя модуля в ответ
+  {
+     s->print(module->GetID());
+     s->print(PARAM_DELIMITER);
+  }
+
+  HeaderSent = true;
+}
+void PublishStruct::CheckStream()
+{
+  if(!OutStream || !Status || Text.length() < PUBLISH_STREAM_CHUNK)
+    return;
+
+  if(!HeaderSent)
+    WriteHeader(OutStream,OutModule);
+
+  OutStream->print(Text);
+  Text = F("");
+}
+void PublishStruct::RestartAnswer()
+{
+  if(!OutStream || !HeaderSent)
+    return;
+
+  OutStream->println();
+  HeaderSent = false;
+}
 PublishStruct& PublishStruct::operator=(const String& src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;
 }
 PublishStruct& PublishStruct::operator=(const char* src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;
 }
 PublishStruct& PublishStruct::operator=(char src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;  
 }
 PublishStruct& PublishStruct::operator=(const __FlashStringHelper *src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;    
 }
 PublishStruct& PublishStruct::operator=(unsigned long src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;    
   
 }
 PublishStruct& PublishStruct::operator=(int src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;      
 }
 PublishStruct& PublishStruct::operator=(long src)
 {
+  RestartAnswer();
   this->Text = src;
+  CheckStream();
   return *this;      
   
 }
 PublishStruct& PublishStruct::operator<<(const String& src)
 {
   this->Text += src;
+  CheckStream();
   return *this;
 }
 PublishStruct& PublishStruct::operator<<(const char* src)
 {
   this->Text += src;
+  CheckStream();
   return *this;
 }
 PublishStruct& PublishStruct::operator<<(char src)
 {
   this->Text += src;
+  CheckStream();
   return *this;  
 }
 PublishStruct& PublishStruct::operator<<(const __FlashStringHelper *src)
 {
   this->Text += src;
+  CheckStream();
   return *this;    
 }
 PublishStruct& PublishStruct::operator<<(unsigned long src)
 {
   this->Text += src;
+  CheckStream();
   return *this;    
   
 }
 PublishStruct& PublishStruct::operator<<(int src)
 {
   this->Text += src;
+  CheckStream();
   return *this;      
 }
 PublishStruct& PublishStruct::operator<<(unsigned int src)
 {
   this->Text += src;
+  CheckStream();
   return *this;        
 }
 PublishStruct& PublishStruct::operator<<(long src)
 {
   this->Text += src;
+  CheckStream();
   return *this;      
 }
 
@@ -287,8 +347,63 @@ void WorkStatus::WriteStatus(Stream* pStream, bool bAsTextHex)
 
 WorkStatus WORK_STATUS; // экземпляр класса состояний
 
+StateChangeBus StateChanges; // рассылка изменений показаний датчиков
+
+bool StateChangeBus::Subscribe(StateChangeListener* listener)
+{
+  if(!listener || listenersCount >= MAX_STATE_LISTENERS)
+    return false;
+
+  listeners[listenersCount++] = listener;
+  return true;
+}
+void StateChangeBus::Notify(OneState* state)
+{
+  for(uint8_t i=0;i<listenersCount;i++)
+    listeners[i]->OnStateChanged(state);
+}
+void StateChangeBus::NotifyRemoved(OneState* state)
+{
+  for(uint8_t i=0;i<listenersCount;i++)
+    listeners[i]->OnStateRemoved(state);
+}
+
+Temperature OneState::ReadTemperature(const StateData& d)
+{
+  return Temperature(d.Temp.Value,d.Temp.Fract);
+}
+void OneState::WriteTemperature(StateData& d, const Temperature& t)
+{
+  d.Temp.Value = t.Value;
+  d.Temp.Fract = t.Fract;
+}
+bool OneState::IsSameData(const StateData& a, const StateData& b) const
+{
+    switch(Type)
+    {
+      case StateTemperature:
+      case StateHumidity: // и для влажности используем структуру температуры
+      case StateSoilMoisture: // и для влажности почвы используем структуру температуры
+      case StatePH: // и для pH  используем структуру температуры
+        return a.Temp.Value == b.Temp.Value && a.Temp.Fract == b.Temp.Fract;
+
+      case StateLuminosity:
+        return a.Luminosity == b.Luminosity;
+
+      case StateWaterFlowInstant:
+      case StateWaterFlowIncremental:
+        return a.WaterFlow == b.WaterFlow;
+
+      case StateUnknown:
+        return true;
+    } // switch
+
+    return true;
+}
 void OneState::Update(void* newData) // обновляем внутреннее состояние
 {
+     StateData oldData = data;
+
      switch(Type)
     {
       
@@ -297,10 +412,7 @@ void OneState::Update(void* newData) // обновляем внутреннее
       case StateSoilMoisture: // и для влажности почвы используем структуру температуры
       case StatePH: // и для pH  используем структуру температуры
       {
-        Temperature* t1 = (Temperature*) Data;
-        Temperature* t2 = (Temperature*) PreviousData;
-
-        *t2 = *t1; // сохраняем предыдущую температуру
+        previousData.Temp = data.Temp; // сохраняем предыдущую температуру
 
         Temperature* tNew = (Temperature*) newData;
 
@@ -313,33 +425,22 @@ void OneState::Update(void* newData) // обновляем внутреннее
           }
         #endif // USE_PH_MODULE
         
-        *t1 = *tNew; // пишем новую
+        WriteTemperature(data,*tNew); // пишем новую
       } 
       break;
 
       case StateLuminosity:
       {
-        long*  ui1 = (long*) Data;
-        long*  ui2 = (long*) PreviousData;
-
-        *ui2 = *ui1; // сохраняем предыдущее состояние освещенности
-
-        long* newState = (long*) newData;
-        *ui1 = *newState; // пишем новое состояние освещенности
+        previousData.Luminosity = data.Luminosity; // сохраняем предыдущее состояние освещенности
+        data.Luminosity = *((long*) newData); // пишем новое состояние освещенности
       } 
       break;
 
       case StateWaterFlowInstant: // работаем с датчиками расхода воды
       case StateWaterFlowIncremental:
       {
-        unsigned long*  ui1 = (unsigned long*) Data;
-        unsigned long*  ui2 = (unsigned long*) PreviousData;
-
-        *ui2 = *ui1; // сохраняем предыдущее состояние расхода воды
-
-        unsigned long* newState = (unsigned long*) newData;
-        *ui1 = *newState; // пишем новое состояние расхода воды
-        
+        previousData.WaterFlow = data.WaterFlow; // сохраняем предыдущее состояние расхода воды
+        data.WaterFlow = *((unsigned long*) newData); // пишем новое состояние расхода воды
       }
       break;
 
@@ -347,6 +448,9 @@ void OneState::Update(void* newData) // обновляем внутреннее
       break;
       
     } // switch
+
+    if(!IsSameData(data,oldData))
+      StateChanges.Notify(this);
  
 }
 void OneState::Init(ModuleStates state, uint8_t idx)
@@ -361,46 +465,28 @@ void OneState::Init(ModuleStates state, uint8_t idx)
       case StateSoilMoisture: // и для влажности почвы используем структуру температуры
       case StatePH: // и для pH  используем структуру температуры
       {
-      
-        Temperature* t1 = new Temperature;
-        Temperature* t2 = new Temperature;
-        
-        Data = t1;
-        PreviousData = t2;
+        // нет данных с датчика
+        WriteTemperature(data,Temperature());
+        WriteTemperature(previousData,Temperature());
       }
         
       break;
 
       case StateLuminosity:
       {
-        long*  ui1 = new long;
-        long*  ui2 = new long;
-
-        *ui1 = NO_LUMINOSITY_DATA; // нет данных об освещенности
-        *ui2 = NO_LUMINOSITY_DATA;
-        
-        Data = ui1;
-        PreviousData = ui2;
+        data.Luminosity = NO_LUMINOSITY_DATA; // нет данных об освещенности
+        previousData.Luminosity = NO_LUMINOSITY_DATA;
       }
       break;
 
       case StateWaterFlowInstant:
       case StateWaterFlowIncremental:
+      case StateUnknown:
       {
-        unsigned long*  ui1 = new unsigned long;
-        unsigned long*  ui2 = new unsigned long;
-
-        *ui1 = 0; // нет данных о расходе воды
-        *ui2 = 0;
-        
-        Data = ui1;
-        PreviousData = ui2;
-        
+        data.WaterFlow = 0; // нет данных о расходе воды
+        previousData.WaterFlow = 0;
       }
       break;
-
-      case StateUnknown:
-      break;
     } // switch
   
 }
@@ -412,24 +498,14 @@ OneState::operator String() // выводим текущие значения к
       case StateHumidity: // и для влажности используем структуру температуры
       case StateSoilMoisture: // и для влажности почвы используем структуру температуры
       case StatePH: // и для pH  используем структуру температуры
-      {
-      
-        Temperature* t1 = (Temperature*) Data;
-        return *t1;
-      }
+        return ReadTemperature(data);
         
       case StateLuminosity:
-      {
-        long*  ul1 = (long*) Data;
-        return String(*ul1);
-      }
+        return String(data.Luminosity);
 
       case StateWaterFlowInstant:
       case StateWaterFlowIncremental:
-      {
-        unsigned long*  ul1 = (unsigned long*) Data;
-        return String(*ul1);        
-      }
+        return String(data.WaterFlow);
 
       case StateUnknown:
         return String();
@@ -451,107 +527,20 @@ OneState& OneState::operator=(const OneState& rhs)
     return *this;
   }
 
-      switch(Type)
-      {
-        case StateTemperature:
-        case StateHumidity: // и для влажности используем структуру температуры
-        case StateSoilMoisture: // и для влажности почвы используем структуру температуры
-        case StatePH: // и для pH  используем структуру температуры
-        {
-          Temperature* rhs_t1 = (Temperature*) rhs.Data;
-          Temperature* rhs_t2 = (Temperature*) rhs.PreviousData;
-
-          Temperature* this_t1 = (Temperature*) Data;
-          Temperature* this_t2 = (Temperature*) PreviousData;
-
-          *this_t1 = *rhs_t1;
-          *this_t2 = *rhs_t2;
-          
-        }
-        break;
-
-        case StateLuminosity:
-        {
-          long*  rhs_ui1 = (long*) rhs.Data;
-          long*  rhs_ui2 = (long*) rhs.PreviousData;
-  
-          long*  this_ui1 = (long*) Data;
-          long*  this_ui2 = (long*) PreviousData;
+  StateData oldData = data;
 
-          *this_ui1 = *rhs_ui1;
-          *this_ui2 = *rhs_ui2;
-        }  
-        break;
+  // виды совпадают - значит, у обоих состояний заполнено одно и то же поле
+  data = rhs.data;
+  previousData = rhs.previousData;
 
-        case StateWaterFlowInstant:
-        case StateWaterFlowIncremental:
-        {
-          unsigned long*  rhs_ui1 = (unsigned long*) rhs.Data;
-          unsigned long*  rhs_ui2 = (unsigned long*) rhs.PreviousData;
-  
-          unsigned long*  this_ui1 = (unsigned long*) Data;
-          unsigned long*  this_ui2 = (unsigned long*) PreviousData;
-
-          *this_ui1 = *rhs_ui1;
-          *this_ui2 = *rhs_ui2;
-        }  
-        break;
-
-        case StateUnknown:
-        break;
-      
-      } // switch
-  
+  if(!IsSameData(data,oldData))
+    StateChanges.Notify(this);
 
   return *this;
 }
 bool OneState::IsChanged()
 {
-      switch(Type)
-      {
-        case StateTemperature:
-        case StateHumidity: // и для влажности используем структуру температуры
-        case StateSoilMoisture: // и для влажности почвы используем структуру температуры
-        case StatePH: // и для pH  используем структуру температуры
-        {
-          Temperature* t1 = (Temperature*) Data;
-          Temperature* t2 = (Temperature*) PreviousData;
-
-          if(*t1 != *t2)
-            return true; // температура изменилась
-        }
-        break;
-
-
-        case StateLuminosity:
-        {
-          long*  ui1 = (long*) Data;
-          long*  ui2 = (long*) PreviousData;
-  
-         if(*ui1 != *ui2)
-          return true; // состояние освещенности изменилось
-        }  
-        break;
-
-        case StateWaterFlowInstant:
-        case StateWaterFlowIncremental:
-        {
-          unsigned long*  ui1 = (unsigned long*) Data;
-          unsigned long*  ui2 = (unsigned long*) PreviousData;
-  
-         if(*ui1 != *ui2)
-          return true; // состояние освещенности изменилось
-        }  
-        break;
-
-        case StateUnknown:
-          return false;
-
-      
-      } // switch
-
- return false;
-  
+  return !IsSameData(data,previousData);
 }
 
 ModuleStates OneState::GetType(const String& stringType)
@@ -598,16 +587,10 @@ bool OneState::HasData()
     case StateHumidity:
     case StatePH:
     case StateSoilMoisture:
-    {
-      Temperature* t = (Temperature*) Data;
-      return t->HasData();
-    }
+      return ReadTemperature(data).HasData();
 
     case StateLuminosity:
-    {
-      long*  ui1 = (long*) Data;
-      return *ui1 != NO_LUMINOSITY_DATA;
-    }
+      return data.Luminosity != NO_LUMINOSITY_DATA;
 
     // для датчиков расхода воды считаем,
     // что показания есть всегда.
@@ -630,25 +613,22 @@ uint8_t OneState::GetRawData(byte* outBuffer)
     case StateSoilMoisture:
     case StatePH:
     {
-        Temperature* t = (Temperature*) Data;
-        *outBuffer++ = t->Fract;
-        *outBuffer = t->Value;
+        *outBuffer++ = data.Temp.Fract;
+        *outBuffer = data.Temp.Value;
       return 2;
     }
 
     // для освещённости пишем два байта в сырые данные
     case StateLuminosity:
     {
-      long* lum = (long*) Data;
-      memcpy(outBuffer,lum,2);
+      memcpy(outBuffer,&data.Luminosity,2);
       return 2;
     }
 
     case StateWaterFlowInstant:
     case StateWaterFlowIncremental:
     {
-      unsigned long* flow = (unsigned long*) Data;
-      memcpy(outBuffer,flow,sizeof(unsigned long));
+      memcpy(outBuffer,&data.WaterFlow,sizeof(unsigned long));
       return sizeof(unsigned long);
     }
     
@@ -715,50 +695,65 @@ ModuleStates OneState::GetType(const char* stringType)
 }
 OneState::~OneState()
 {
-  // подчищаем за собой
-  
-       switch(Type)
-      {
-        case StateTemperature:
-        case StateHumidity: // и для влажности используем структуру температуры
-        case StateSoilMoisture: // и для влажности почвы используем структуру температуры
-        case StatePH: // и для pH  используем структуру температуры
-        {
-          Temperature* t1 = (Temperature*) Data;
-          Temperature* t2 = (Temperature*) PreviousData;
-
-          delete t1;
-          delete t2;
-        }
-        break;
+  // показания хранятся внутри состояния, подчищать нечего
+}
 
-        case StateLuminosity:
-        {
-          long*  ui1 = (long*) Data;
-          long*  ui2 = (long*) PreviousData;
-  
-          delete ui1;
-          delete ui2;
-        }  
-        break;
+// пул под состояния датчиков. Состояния добавляются при старте и при регистрации
+// универсальных датчиков на лету - держим их в статическом массиве, чтобы не дробить кучу.
+static uint8_t statePool[STATE_POOL_SIZE][sizeof(OneState)];
+static uint8_t statePoolUsedMask[(STATE_POOL_SIZE + 7)/8]; // битовая маска занятых мест
+static uint8_t statePoolUsed = 0;
+static uint8_t statePoolPeak = 0;
+static uint8_t statePoolFailed = 0;
 
-        case StateWaterFlowInstant:
-        case StateWaterFlowIncremental:
-        {
-          unsigned long*  ui1 = (unsigned long*) Data;
-          unsigned long*  ui2 = (unsigned long*) PreviousData;
+void* OneState::operator new(size_t sz) throw()
+{
+  UNUSED(sz);
   
-          delete ui1;
-          delete ui2;
-        }  
-        break;
+  for(uint8_t i=0;i<STATE_POOL_SIZE;i++)
+  {
+    if(statePoolUsedMask[i/8] & (1 << (i%8)))
+      continue;
 
-        case StateUnknown:
-        break;
+    statePoolUsedMask[i/8] |= (1 << (i%8));
+    statePoolUsed++;
+    
+    if(statePoolUsed > statePoolPeak)
+      statePoolPeak = statePoolUsed;
       
-      } // switch
- 
-  
+    return statePool[i];
+  } // for
+
+  // места нет - увеличьте STATE_POOL_UNI_RESERVE
+  if(statePoolFailed < 0xFF)
+    statePoolFailed++;
+
+  #ifdef _DEBUG
+  Serial.println(F("[ERR] OneState pool is full!"));
+  #endif
+    
+  return NULL;
+}
+void OneState::operator delete(void* p)
+{
+  if(!p)
+    return;
+    
+  uint8_t i = ((uint8_t*) p - &statePool[0][0])/sizeof(OneState);
+  statePoolUsedMask[i/8] &= ~(1 << (i%8));
+  statePoolUsed--;
+}
+uint8_t OneState::GetPoolUsed()
+{
+  return statePoolUsed;
+}
+uint8_t OneState::GetPoolPeak()
+{
+  return statePoolPeak;
+}
+uint8_t OneState::GetPoolFailed()
+{
+  return statePoolFailed;
 }
 OneState::operator HumidityPair()
 {
@@ -770,7 +765,7 @@ OneState::operator HumidityPair()
   return HumidityPair(Humidity(),Humidity()); // undefined behaviour
   }
 
-    return HumidityPair(*((Humidity*)PreviousData),*((Humidity*)Data));  
+    return HumidityPair(ReadTemperature(previousData),ReadTemperature(data));  
 }
 OneState::operator TemperaturePair()
 {
@@ -782,7 +777,7 @@ OneState::operator TemperaturePair()
   return TemperaturePair(Temperature(),Temperature()); // undefined behaviour
   }
 
-    return TemperaturePair(*((Temperature*)PreviousData),*((Temperature*)Data));
+    return TemperaturePair(ReadTemperature(previousData),ReadTemperature(data));
 }
 OneState::operator LuminosityPair()
 {
@@ -793,7 +788,7 @@ OneState::operator LuminosityPair()
   #endif
   return LuminosityPair(0,0); // undefined behaviour
   }
-  return LuminosityPair(*((long*)PreviousData),*((long*)Data));   
+  return LuminosityPair(previousData.Luminosity,data.Luminosity);   
 }
 OneState::operator WaterFlowPair()
 {
@@ -804,7 +799,7 @@ OneState::operator WaterFlowPair()
   #endif
   return WaterFlowPair(0,0); // undefined behaviour
   }
-  return WaterFlowPair(*((unsigned long*)PreviousData),*((unsigned long*)Data));   
+  return WaterFlowPair(previousData.WaterFlow,data.WaterFlow);   
 }
 
 OneState operator-(const OneState& left, const OneState& right)
@@ -826,65 +821,41 @@ OneState operator-(const OneState& left, const OneState& right)
         case StateSoilMoisture: // и для влажности почвы используем структуру температуры
         case StatePH: // и для pH  используем структуру температуры
         {
-          Temperature* t1 = (Temperature*) left.Data;
-          Temperature* t2 = (Temperature*) right.Data;
+          Temperature t1 = OneState::ReadTemperature(left.data);
+          Temperature t2 = OneState::ReadTemperature(right.data);
 
-
-          Temperature* thisT = (Temperature*) result.Data;
-          if(t1->Value != NO_TEMPERATURE_DATA && t2->Value != NO_TEMPERATURE_DATA) // только если есть показания с датчиков
-              *thisT = (*t1 - *t2); // получаем дельту текущих изменений
+          if(t1.HasData() && t2.HasData()) // только если есть показания с датчиков
+              OneState::WriteTemperature(result.data,t1 - t2); // получаем дельту текущих изменений
           
-          t1 = (Temperature*) left.PreviousData;
-          t2 = (Temperature*) right.PreviousData;
+          t1 = OneState::ReadTemperature(left.previousData);
+          t2 = OneState::ReadTemperature(right.previousData);
 
-          thisT = (Temperature*) result.PreviousData;
-          if(t1->Value != NO_TEMPERATURE_DATA && t2->Value != NO_TEMPERATURE_DATA) // только если есть показания с датчиков
-              *thisT = (*t1 - *t2); // получаем дельту предыдущих изменений
+          if(t1.HasData() && t2.HasData()) // только если есть показания с датчиков
+              OneState::WriteTemperature(result.previousData,t1 - t2); // получаем дельту предыдущих изменений
         
         }
         break;
 
         case StateLuminosity:
         {
-          long*  ui1 = (long*) left.Data;
-          long*  ui2 = (long*) right.Data;
-
-          long* thisLong = (long*) result.Data;
-
           // получаем дельту текущих изменений
-          if(*ui1 != NO_LUMINOSITY_DATA && *ui2 != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
-            *thisLong = abs((*ui1 - *ui2));
-
-          ui1 = (long*) left.PreviousData;
-          ui2 = (long*) right.PreviousData;
-
-          thisLong = (long*) result.PreviousData;
+          if(left.data.Luminosity != NO_LUMINOSITY_DATA && right.data.Luminosity != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
+            result.data.Luminosity = abs((left.data.Luminosity - right.data.Luminosity));
 
           // получаем дельту предыдущих изменений
-          if(*ui1 != NO_LUMINOSITY_DATA && *ui2 != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
-            *thisLong = abs((*ui1 - *ui2));   
+          if(left.previousData.Luminosity != NO_LUMINOSITY_DATA && right.previousData.Luminosity != NO_LUMINOSITY_DATA) // только если есть показания с датчиков
+            result.previousData.Luminosity = abs((left.previousData.Luminosity - right.previousData.Luminosity));
         }  
         break;
 
         case StateWaterFlowInstant:
         case StateWaterFlowIncremental:
         {
-          unsigned long*  ui1 = (unsigned long*) left.Data;
-          unsigned long*  ui2 = (unsigned long*) right.Data;
-
-          unsigned long* thisUi = (unsigned long*) result.Data;
-
           // получаем дельту текущих изменений
-          *thisUi = abs((*ui1 - *ui2));
-
-          ui1 = (unsigned long*) left.PreviousData;
-          ui2 = (unsigned long*) right.PreviousData;
-
-          thisUi = (unsigned long*) result.PreviousData;
+          result.data.WaterFlow = abs((left.data.WaterFlow - right.data.WaterFlow));
 
           // получаем дельту предыдущих изменений
-          *thisUi = abs((*ui1 - *ui2));
-  
+          result.previousData.WaterFlow = abs((left.previousData.WaterFlow - right.previousData.WaterFlow));
         }  
         break;
 
@@ -940,7 +911,44 @@ Temperature operator-(const Temperature& left, const Temperature& right)
 }
 ModuleState::ModuleState() : supportedStates(0)
 {
-  
+  memset(typeStart,0,sizeof(typeStart));
+}
+uint8_t ModuleState::GetTypeSlot(ModuleStates state)
+{
+  for(uint8_t i=0;i<STATE_TYPES_COUNT;i++)
+  {
+    if(state == (1 << i))
+      return i;
+  }
+  return STATE_TYPES_COUNT;
+}
+int16_t ModuleState::FindState(uint8_t slot, uint8_t idx)
+{
+  if(slot >= STATE_TYPES_COUNT)
+    return -1;
+
+  int16_t low = typeStart[slot];
+  int16_t high = typeStart[slot+1] - 1;
+
+  // обычно индексы датчиков идут подряд с нуля - тогда состояние лежит прямо на своём месте
+  if(low + idx <= high && states[low + idx]->GetIndex() == idx)
+    return low + idx;
+
+  while(low <= high)
+  {
+    int16_t mid = (low + high)/2;
+    uint8_t midIdx = states[mid]->GetIndex();
+    
+    if(midIdx == idx)
+      return mid;
+
+    if(idx < midIdx)
+      high = mid - 1;
+    else
+      low = mid + 1;
+  } // while
+
+  return -1;
 }
 bool ModuleState::HasState(ModuleStates state)
 {
@@ -948,38 +956,54 @@ bool ModuleState::HasState(ModuleStates state)
 }
 void ModuleState::RemoveState(ModuleStates state, uint8_t idx)
 {
+  uint8_t slot = GetTypeSlot(state);
+  int16_t pos = FindState(slot,idx);
+  if(pos < 0)
+    return;
+
+  // нашли нужное состояние, удаляем его - подписчики не должны остаться с указателем на удалённое
+  StateChanges.NotifyRemoved(states[pos]);
+  delete states[pos];
+  
+  // теперь сдвигаем на пустое место
   size_t cnt = states.size();
-  for(size_t i=0;i<cnt;i++)
-  {
-    OneState* os = states[i];
-    if(os->GetType() == state && os->GetIndex() == idx)
-    {
-      // нашли нужное состояние, удаляем его
-      delete os;
-      // теперь сдвигаем на пустое место
-      size_t wIdx = i;
-      while(wIdx < cnt-1)
-      {
-       states[wIdx] = states[wIdx+1]; 
-       wIdx++;
-      } // while
-      // удаляем последний элемент (по сути, внутри вектора просто сдвинется указатель записи, и всё).
-      states.pop();
-
-      break; // выходим из цикла
-    } // if
-  } // for
+  for(size_t wIdx = pos; wIdx < cnt-1; wIdx++)
+    states[wIdx] = states[wIdx+1]; 
 
-  // теперь проверяем - если больше нет такого состояния - обнуляем его флаг.
-  if(!HasState(state)) // нет такого состояния
-    supportedStates &= ~state; // инвертируем все биты в state, кроме выставленного, и применяем эту маску к supportedStates. 
-    // В результате в supportedStates очистятся только те биты, которые были выставлены в state.
+  // удаляем последний элемент (по сути, внутри вектора просто сдвинется указатель записи, и всё).
+  states.pop();
+
+  for(uint8_t i=slot+1;i<=STATE_TYPES_COUNT;i++)
+    typeStart[i]--;
+
+  // если больше нет такого состояния - обнуляем его флаг
+  if(typeStart[slot] == typeStart[slot+1])
+    supportedStates &= ~state;
 }
 OneState* ModuleState::AddState(ModuleStates state, uint8_t idx)
 {
-    supportedStates |= state;
+    uint8_t slot = GetTypeSlot(state);
+    if(slot >= STATE_TYPES_COUNT) // неизвестный вид состояния
+      return NULL;
+    
     OneState* s = new OneState(state,idx);
+    if(!s) // пул состояний исчерпан
+      return NULL;
+      
+    supportedStates |= state;
+
+    // ищем место внутри своего вида, сохраняя порядок индексов
+    size_t pos = typeStart[slot+1];
+    while(pos > typeStart[slot] && states[pos-1]->GetIndex() > idx)
+      pos--;
+
     states.push_back(s); // сохраняем состояние
+    for(size_t i=states.size()-1;i>pos;i--)
+      states[i] = states[i-1];
+    states[pos] = s;
+
+    for(uint8_t i=slot+1;i<=STATE_TYPES_COUNT;i++)
+      typeStart[i]++;
     
     return s;
 }
@@ -1000,16 +1024,12 @@ bool ModuleState::HasChanges()
 }
 void ModuleState::UpdateState(ModuleStates state, uint8_t idx, void* newData)
 {
-  size_t sz = states.size();
-  for(size_t i=0;i<sz;i++)
+  int16_t pos = FindState(GetTypeSlot(state),idx);
+  if(pos >= 0)
   {
-      OneState* s = states[i];
-      if(s->GetType() == state && s->GetIndex() == idx)
-      {
-        s->Update(newData);
-        return;
-      } // if
-  } // for
+    states[pos]->Update(newData);
+    return;
+  }
 
 #ifdef _DEBUG
 Serial.println(F("[ERR] - UpdateState FAILED!"));
@@ -1017,47 +1037,26 @@ Serial.println(F("[ERR] - UpdateState FAILED!"));
 }
 uint8_t ModuleState::GetStateCount(ModuleStates state)
 {
-  uint8_t result = 0;
-  size_t sz = states.size();
-  
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state)
-        result++;
-  }
+  uint8_t slot = GetTypeSlot(state);
+  if(slot >= STATE_TYPES_COUNT)
+    return 0;
   
-  return result;
+  return typeStart[slot+1] - typeStart[slot];
 }
 OneState* ModuleState::GetStateByOrder(ModuleStates state, uint8_t orderNum)
 {
-  size_t sz = states.size();
-  uint8_t cntr = 0;
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state)
-      {
-        if(cntr == orderNum)
-          return s;
-
-          cntr++;
-      }
-  }
+  if(orderNum >= GetStateCount(state))
+    return NULL;
 
-    return NULL;  
+  return states[typeStart[GetTypeSlot(state)] + orderNum];
 }
 OneState* ModuleState::GetState(ModuleStates state, uint8_t idx)
 {
-  size_t sz = states.size();
-  for(size_t i=0;i<sz;i++)
-  {
-      OneState* s = states[i];
-      if(s->GetType() == state && s->GetIndex() == idx)
-        return s;
-  }
-
+  int16_t pos = FindState(GetTypeSlot(state),idx);
+  if(pos < 0)
     return NULL;
+
+  return states[pos];
 }
 
 char SD_BUFFER[SD_BUFFER_LENGTH] = {0};
@@ -4,6 +4,7 @@
 #include <WString.h>
 
 class ModuleController; // forward declaration
+class AbstractModule; // forward declaration
 
 #include "Globals.h"
 #include "CommandParser.h"
@@ -18,6 +19,16 @@ struct PublishStruct
   void* Data; // любая информация, в зависимости от типа модуля
   bool Busy; // флаг, что структура занята для записи
 
+  // потоковый режим (модуль включает его сам через BeginStream для длинных списков, остальные ответы
+  // копятся целиком и уходят одной строкой): как только в Text набирается PUBLISH_STREAM_CHUNK байт
+  // успешного ответа - заголовок OK= и накопленное уходят прямо в поток команды, в Text остаётся только
+  // неотправленный хвост. Пока Status не выставлен, ответ копится целиком. Если после отправки начала
+  // ответа модуль всё же сообщает об ошибке - отправленная строка завершается, и ошибка уходит
+  // отдельной строкой со своим заголовком ER=, поэтому включать поток стоит только там, где ошибок после вывода нет.
+  Stream* OutStream; // поток команды, NULL - ответ целиком копится в Text до публикации
+  AbstractModule* OutModule; // модуль, чей ID добавляется в заголовок
+  bool HeaderSent; // заголовок уже ушёл в поток
+
   void Reset()
   {
     Status = false;
@@ -25,8 +36,16 @@ struct PublishStruct
     AddModuleIDToAnswer = true;
     Data = NULL;
     Busy = false;
+    OutStream = NULL;
+    OutModule = NULL;
+    HeaderSent = false;
   }
 
+  void BeginStream(AbstractModule* module, const Command& command); // включает потоковый режим для ответа на команду
+  void WriteHeader(Stream* s, AbstractModule* module); // пишет в поток заголовок OK=/ER= с ID модуля
+  void CheckStream(); // в потоковом режиме отдаёт накопленный ответ в поток
+  void RestartAnswer(); // ответ начинается заново - уже отправленное начало завершаем отдельной строкой
+
   PublishStruct& operator=(const String& src);
   PublishStruct& operator=(const char* src);
   PublishStruct& operator=(char src);
@@ -156,16 +175,46 @@ struct WaterFlowPair
     WaterFlowPair& operator=(const WaterFlowPair&);
 };
 
+// показания состояния. Поле выбирается видом состояния: состояние читает и пишет только поле
+// своего вида, одно поле через другое не читается.
+union StateData
+{
+  struct
+  {
+    int8_t Value;
+    uint8_t Fract;
+  } Temp; // температура, влажность, влажность почвы, pH - как в Temperature
+  
+  long Luminosity; // освещённость
+  unsigned long WaterFlow; // расход воды
+};
+
 class OneState
 {
     ModuleStates Type; // тип состояния (температура, освещенность, каналы реле)
     
     uint8_t Index; // индекс (например, датчика температуры)
-    void* Data; // данные с датчика
-    void* PreviousData; // предыдущие данные с датчика
+
+    // показания хранятся прямо в состоянии, без выделения памяти в куче. Указателей на себя
+    // состояние не хранит, поэтому копия состояния ни на что чужое не ссылается.
+    StateData data;
+    StateData previousData;
+
+    static Temperature ReadTemperature(const StateData& d);
+    static void WriteTemperature(StateData& d, const Temperature& t);
+    bool IsSameData(const StateData& a, const StateData& b) const; // сравнивает показания по полю вида состояния
 
     public:
 
+    // состояния, добавляемые модулями, берутся из статического пула размером STATE_POOL_SIZE,
+    // а не из кучи. Если пул исчерпан - new возвращает NULL.
+    static void* operator new(size_t sz) throw();
+    static void operator delete(void* p);
+
+    static uint8_t GetPoolUsed(); // сколько мест в пуле занято
+    static uint8_t GetPoolPeak(); // максимальное кол-во занятых мест за всё время работы
+    static uint8_t GetPoolFailed(); // сколько раз не хватило места в пуле
+
     static ModuleStates GetType(const String& stringType);
     static ModuleStates GetType(const char* stringType);
     static String GetStringType(ModuleStates type);
@@ -174,6 +223,11 @@ class OneState
 
     uint8_t GetIndex() {return Index;}
     ModuleStates GetType() {return Type;}
+
+    // прямой доступ к текущим показаниям, без копирования пар предыдущее/текущее. Вызывающий сам следит за видом состояния.
+    Temperature GetTemperature() const {return ReadTemperature(data);} // температура, влажность, влажность почвы, pH
+    long GetLuminosity() const {return data.Luminosity;} // освещённость
+    unsigned long GetWaterFlow() const {return data.WaterFlow;} // расход воды
     
     void Update(void* newData); // обновляет состояние
     bool IsChanged(); // тестирует, есть ли изменения
@@ -206,10 +260,47 @@ class OneState
 
 typedef Vector<OneState*> StateVec;
 
+class StateChangeListener // подписчик на изменение показаний датчиков
+{
+  public:
+    virtual void OnStateChanged(OneState* state) = 0; // показания датчика изменились, вызывается сразу при записи показаний
+    virtual void OnStateRemoved(OneState* state) = 0; // состояние удаляется, указатели на него надо забыть - вызывается до удаления
+};
+
+// рассылает подписчикам изменения показаний: состояние сообщает об изменении, только если
+// новые показания отличаются от старых, поэтому подписчикам не надо опрашивать все датчики
+// подряд - достаточно пересчитать то, что зависит от изменившихся.
+class StateChangeBus
+{
+  private:
+    StateChangeListener* listeners[MAX_STATE_LISTENERS];
+    uint8_t listenersCount;
+
+  public:
+    StateChangeBus() : listenersCount(0) {}
+
+    bool Subscribe(StateChangeListener* listener); // добавляет подписчика, false - если мест нет
+    void Notify(OneState* state); // сообщает всем подписчикам об изменении показаний
+    void NotifyRemoved(OneState* state); // сообщает всем подписчикам, что состояние сейчас будет удалено
+};
+
+extern StateChangeBus StateChanges;
+
+#define STATE_TYPES_COUNT 8 // сколько всего видов состояний (по количеству бит в ModuleStates)
+
 class ModuleState
 {
  uint8_t supportedStates; // какие состояния поддерживаем?
- StateVec states; // какие состояния поддерживаем?
+
+ // состояния сгруппированы по виду, внутри вида - отсортированы по индексу датчика.
+ // typeStart[N] - позиция первого состояния вида с номером бита N, typeStart[STATE_TYPES_COUNT] - общее кол-во.
+ // Так кол-во состояний вида и состояние по порядку получаются сразу, а по индексу датчика -
+ // сразу, если индексы идут подряд с нуля, и двоичным поиском - если нет.
+ StateVec states;
+ uint8_t typeStart[STATE_TYPES_COUNT + 1];
+
+ static uint8_t GetTypeSlot(ModuleStates state); // номер бита вида состояния, STATE_TYPES_COUNT - если вид неизвестен
+ int16_t FindState(uint8_t slot, uint8_t sensorIndex); // позиция состояния в states, -1 - если не найдено
 
 public:
   ModuleState();
@@ -222,7 +313,7 @@ public:
   
   uint8_t GetStateCount(ModuleStates state); // возвращает кол-во датчиков определённого вида (не даёт информации об индексах датчиков!)
   OneState* GetState(ModuleStates state, uint8_t sensorIndex); // возвращает состояние определённого вида по индексу датчика
-  OneState* GetStateByOrder(ModuleStates state, uint8_t orderNum); // возвращает состояние определённого вида по номеру его хранения в массиве
+  OneState* GetStateByOrder(ModuleStates state, uint8_t orderNum); // возвращает состояние определённого вида по порядку возрастания индекса датчика
   
   void RemoveState(ModuleStates state, uint8_t sensorIndex); // удаляет состояние по индексу датчика
 
@@ -234,16 +325,42 @@ class AbstractModule
 {
   private:
     const char* moduleID;    
+
+    uint16_t sleepInterval; // сколько миллисекунд модулю не нужно обновление (0 - обновлять на каждой итерации loop)
+    uint16_t sleepTime; // сколько миллисекунд прошло с последнего обновления модуля
     
 protected:
 
+  // модуль сообщает из Update, через сколько миллисекунд его надо обновить в следующий раз.
+  // до этого момента Update не вызывается, а прошедшее время накапливается и будет передано в dt.
+  // действует до ближайшего вызова Update, поэтому модуль должен сообщать это каждый раз.
+  void SleepFor(uint16_t ms) { sleepInterval = ms; }
+
 public:
 
-  AbstractModule(const char* id) : moduleID(id)
+  AbstractModule(const char* id) : moduleID(id), sleepInterval(0), sleepTime(0)
   { 
 
   }
 
+  void WakeUp() { sleepInterval = 0; } // обновить модуль на следующей итерации loop, даже если он спит
+
+  // вызывается контроллером на каждой итерации loop, возвращает true, если модулю пора обновляться,
+  // в updateDt при этом возвращается время, прошедшее с последнего обновления модуля
+  bool IsUpdateDue(uint16_t dt, uint16_t& updateDt)
+  {
+    uint32_t elapsed = (uint32_t) sleepTime + dt;
+    sleepTime = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+
+    if(sleepTime < sleepInterval) // ещё спим
+      return false;
+
+    updateDt = sleepTime;
+    sleepTime = 0;
+    sleepInterval = 0;
+    return true;
+  }
+
   ModuleState State; // текущее состояние модуля
  
   const char* GetID() {return moduleID;}
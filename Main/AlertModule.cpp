@@ -3,25 +3,81 @@
 #include <EEPROM.h>
 
 AlertModule* RulesDispatcher = NULL;
+
+// имена известных правилам модулей, в порядке RuleKnownModules, начиная с moduleState
+const char KNOWN_MODULE_STATE[] PROGMEM = "STATE";
+const char KNOWN_MODULE_PIN[] PROGMEM = "PIN";
+const char KNOWN_MODULE_LIGHT[] PROGMEM = "LIGHT";
+const char KNOWN_MODULE_CC[] PROGMEM = "CC";
+const char KNOWN_MODULE_HUMIDITY[] PROGMEM = "HUMIDITY";
+const char KNOWN_MODULE_DELTA[] PROGMEM = "DELTA";
+const char KNOWN_MODULE_SOIL[] PROGMEM = "SOIL";
+const char KNOWN_MODULE_PH[] PROGMEM = "PH";
+const char KNOWN_MODULE_ZERO[] PROGMEM = "0";
+
+const char* const KNOWN_MODULES_NAMES[] PROGMEM = 
+{
+   KNOWN_MODULE_STATE
+  ,KNOWN_MODULE_PIN
+  ,KNOWN_MODULE_LIGHT
+  ,KNOWN_MODULE_CC
+  ,KNOWN_MODULE_HUMIDITY
+  ,KNOWN_MODULE_DELTA
+  ,KNOWN_MODULE_SOIL
+  ,KNOWN_MODULE_PH
+  ,KNOWN_MODULE_ZERO
+};
+
 AlertModule::AlertModule() : AbstractModule("ALERT") 
 {
       RulesDispatcher = this;
+      queuedRuleIdx = 0;
+      rulesChanged = true;
+      workTimeDue = true;
+
+    #ifdef USE_ALERT_RULES_ON_SD
+      useRulesStore = false;
+      rulesCacheDirty = true;
+      rulesCacheMinute = -1;
+      cachedRulesCnt = 0;
+      rulesSkipped = 0;
+    #endif
       InitRules();
 }
 
 AlertRule::~AlertRule()
 {
   delete rawCommand;
+  delete[] code;
+  delete[] targetArgs;
 }
 AlertRule::AlertRule()
 {
   rawCommand = NULL;
+  targetArgs = NULL;
+  targetArgsLength = 0;
   linkedModule = NULL;
+  targetModule = NULL;
+  code = NULL;
+  latches = 0;
+
+  stateDirty = true;
+  volatileAlert = true;
+  lastAlert = false;
+
+  memset(&Filter,0,sizeof(Filter));
+  rawAlert = false;
+
+#ifdef USE_ALERT_RULES_STATS
+  ResetStats();
+#endif
+  debounceCnt = 0;
+  dwellTime = 0;
   
   Settings.StartTime = 0;
   Settings.WorkTime = 0;
   Settings.DayMask = 0xFF; // все дни недели работаем
-  Settings.DataAlert = 0;
+  Settings.CodeLength = 0;
 
   Settings.Enabled = 1;
   Settings.CanWork = 1;
@@ -30,32 +86,11 @@ AlertRule::AlertRule()
 }
 uint8_t AlertRule::GetKnownModuleID(const char* moduleName)
 {
-  if(!strcmp_P(moduleName,(const char*) F("STATE")))
-      return moduleState;
-      
-  if(!strcmp_P(moduleName,(const char*) F("PIN")))
-    return modulePin;
-
-  if(!strcmp_P(moduleName,(const char*) F("LIGHT")))
-    return moduleLight;
-
-  if(!strcmp_P(moduleName,(const char*) F("CC")))
-    return moduleCompositeCommands;
-
-  if(!strcmp_P(moduleName,(const char*) F("HUMIDITY")))
-    return moduleHumidity;
-
-  if(!strcmp_P(moduleName,(const char*) F("DELTA")))
-    return moduleDelta;
-
-  if(!strcmp_P(moduleName,(const char*) F("SOIL")))
-    return moduleSoil;
-   
-  if(!strcmp_P(moduleName,(const char*) F("PH")))
-    return modulePH;
-
-  if(!strcmp_P(moduleName,(const char*) F("0")))
-    return moduleZero;
+  for(uint8_t i=moduleState;i<=moduleZero;i++)
+  {
+    if(!strcmp_P(moduleName,(const char*) pgm_read_word(&(KNOWN_MODULES_NAMES[i-moduleState]))))
+      return i;
+  }
 
   return 0;
 
@@ -68,45 +103,8 @@ const char* AlertRule::GetKnownModuleName(uint8_t type)
 {
   SD_BUFFER[0] = 0;
   // возвращаем имя известного модуля по типу
-  switch(type)
-  {
-    case moduleZero:
-      strcpy_P(SD_BUFFER, (const char*) F("0"));
-    break;
-    
-    case moduleState:
-      strcpy_P(SD_BUFFER, (const char*) F("STATE"));
-    break;
-
-    case modulePin:
-      strcpy_P(SD_BUFFER, (const char*) F("PIN"));
-    break;
-
-    case moduleLight:
-      strcpy_P(SD_BUFFER, (const char*) F("LIGHT"));
-    break;
-
-    case moduleCompositeCommands:
-      strcpy_P(SD_BUFFER, (const char*) F("CC"));
-    break;
-
-    case moduleHumidity:
-      strcpy_P(SD_BUFFER, (const char*) F("HUMIDITY"));
-    break;
-    
-    case moduleDelta:
-      strcpy_P(SD_BUFFER, (const char*) F("DELTA"));
-    break;
-    
-    case moduleSoil:
-      strcpy_P(SD_BUFFER, (const char*) F("SOIL"));
-    break;
-    
-    case modulePH:
-      strcpy_P(SD_BUFFER, (const char*) F("PH"));
-    break;
-    
-  }
+  if(type >= moduleState && type <= moduleZero)
+    strcpy_P(SD_BUFFER, (const char*) pgm_read_word(&(KNOWN_MODULES_NAMES[type-moduleState])));
 
   return SD_BUFFER;
     
@@ -115,12 +113,32 @@ const char* AlertRule::GetTargetCommandModuleName()
 {
   return GetKnownModuleName(Settings.TargetModuleNameIndex);
 }
-bool AlertRule::HasTargetCommand()
+void AlertRule::BuildTargetCommand()
 {
-  if(Settings.TargetCommandType == commandUnparsed)
-    return (rawCommand != NULL);
+  delete[] targetArgs;
+  targetArgs = NULL;
+  targetArgsLength = 0;
 
-  return true;
+  const char* tc = GetTargetCommand();
+  if(!tc)
+    return;
+
+  size_t len = strlen(tc) + 1;
+  if(len > MAX_COMMAND_LENGTH) // всё равно не влезет в команду
+    len = MAX_COMMAND_LENGTH;
+
+  targetArgs = new char[len];
+  targetArgsLength = len;
+
+  // разбиваем по разделителю сразу, чтобы при срабатывании правила ничего не разбирать
+  for(size_t i=0;i<len;i++)
+    targetArgs[i] = (tc[i] == '|') ? '\0' : tc[i];
+
+  targetArgs[len-1] = '\0';
+}
+void AlertRule::FillTargetCommand(Command& cmd)
+{
+  cmd.Construct(targetModule->GetID(),targetArgs,targetArgsLength,ctSET);
 }
 const char* AlertRule::GetTargetCommand()
 {
@@ -204,24 +222,42 @@ void AlertRule::Update(uint16_t dt
 
   UNUSED(dt);
   
-  // считаем, что мы можем работать, если попадаем в текущий день недели
   #ifdef USE_DS3231_REALTIME_CLOCK 
-    Settings.CanWork = bitRead(Settings.DayMask,currentDOW-1);
+    Settings.CanWork = IsWorkTime(Settings.StartTime,Settings.WorkTime,Settings.DayMask,currentHour,currentMinute,currentDOW) ? 1 : 0;
   #else
     Settings.CanWork = 1;
   #endif  
+}
+#ifdef USE_DS3231_REALTIME_CLOCK
+uint16_t AlertRule::MinutesToWorkTimeChange(uint16_t nowMinuteOfDay)
+{
+  // работа правила может начаться или закончиться только в полночь (смена дня недели),
+  // в минуту начала работы и в минуту сразу после её окончания - берём ближайшую из них
+  uint16_t result = Calendar.MinutesUntil(0,nowMinuteOfDay);
+  if(Settings.StartTime == 0 && Settings.WorkTime == 0) // работаем весь день
+    return result;
 
-  if(Settings.StartTime == 0  && Settings.WorkTime == 0) // работаем всегда
-  {
-     return;
-  }
+  uint16_t change = Calendar.MinutesUntil(Settings.StartTime % MINUTES_IN_DAY,nowMinuteOfDay);
+  if(change < result)
+    result = change;
 
+  change = Calendar.MinutesUntil((Settings.StartTime + Settings.WorkTime + 1UL) % MINUTES_IN_DAY,nowMinuteOfDay);
+  if(change < result)
+    result = change;
 
-  #ifdef USE_DS3231_REALTIME_CLOCK
+  return result;
+}
+bool AlertRule::IsWorkTime(uint16_t startTime, uint16_t workTime, uint8_t dayMask, uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW)
+{
+  // считаем, что мы можем работать, если попадаем в текущий день недели
+  if(startTime == 0  && workTime == 0) // работаем всегда
+  {
+     return bitRead(dayMask,currentDOW-1);
+  }
 
   // создаём диапазон для проверки
-  uint16_t startDia = Settings.StartTime;
-  uint16_t stopDia = startDia + Settings.WorkTime;
+  uint16_t startDia = startTime;
+  uint16_t stopDia = startDia + workTime;
 
   // если мы находимся между этим диапазоном, то мы можем работать в это время,
   // иначе - не можем, и просто выставляем флаг работы в false.
@@ -241,7 +277,7 @@ void AlertRule::Update(uint16_t dt
     // правая граница диапазона перешагнула на следующие сутки,
     // отражаем диапазон текущего часа на следующие сутки
     // только в том случае, если текущее кол-во минут от начала суток меньше, чем время начала работы
-    if(checkMinutes < Settings.StartTime)
+    if(checkMinutes < startTime)
     {
       checkMinutes += mins_in_day;
       haveOverflow = true;
@@ -255,259 +291,142 @@ void AlertRule::Update(uint16_t dt
       // в диапазон попали, надо проверить попадание в дни недели.
       // считаем, что мы попали в день недели, если он выставлен
       // в флагах или у нас был перенос работы на следующие сутки.
-      canWeWork = haveOverflow || bitRead(Settings.DayMask,currentDOW-1);
+      canWeWork = haveOverflow || bitRead(dayMask,currentDOW-1);
     }
 
-    Settings.CanWork = canWeWork ? 1 : 0;
-
-
-  #endif  
-  
+    return canWeWork;
 }
-bool AlertRule::HasAlert()
+#endif
+bool AlertRule::CheckAlert(uint16_t dt, bool& alertChanged)
 {
-  if(!linkedModule || !Settings.Enabled || !Settings.CanWork)
-    return false;
+  alertChanged = false;
 
+  if(dwellTime < 0xFFFF0000UL)
+    dwellTime += dt;
 
-  switch(Settings.Target)
+  bool evaluated = stateDirty || volatileAlert;
+  if(evaluated) // иначе ничего, от чего зависит условие, не менялось - берём прошлый результат
   {
-    case rtTemp: // проверяем температуру
-    {
-     if(!linkedModule->State.HasState(StateTemperature))  // не поддерживаем температуру
-        return false;
+    stateDirty = false;
 
-     OneState* os = linkedModule->State.GetState(StateTemperature,Settings.SensorIndex);
-       
-     if(!os) // не срослось
-      return false;
+  #ifdef USE_ALERT_RULES_STATS
+    unsigned long evalStart = micros();
+  #endif
 
-       TemperaturePair tp = *os; 
-       int8_t curTemp = tp.Current.Value;
+    rawAlert = HasAlert();
 
-       int8_t tAlert = (int8_t) Settings.DataAlert; // следим за переданной температурой
+  #ifdef USE_ALERT_RULES_STATS
+    unsigned long evalTime = micros() - evalStart;
+    stats.Evaluations++;
+    stats.EvalTime += evalTime;
+    if(evalTime > stats.MaxEvalTime)
+      stats.MaxEvalTime = evalTime > 0xFFFF ? 0xFFFF : evalTime;
 
-       if(curTemp == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-        // пытаемся найти резервирование
-        OneState* reservedState = MainController->GetReservedState(linkedModule,StateTemperature,Settings.SensorIndex);
-        if(!reservedState)
-          return (curTemp == tAlert); // на случай, если правило следит за отсутствием показаний с датчика
-        else // есть зарезервированный датчик с показаниями
-        {
-          TemperaturePair tp = *reservedState; 
-          curTemp = tp.Current.Value;
-        } // else
-       }
- 
-       switch(Settings.DataSource)
-       {
-          case tsOpenTemperature: // попросили подставить температуру открытия из настроек
-            tAlert = MainController->GetSettings()->GetOpenTemp();
-          break;
+    if(rawAlert)
+      stats.TrueResults++;
+  #endif
+  }
 
-          case tsCloseTemperature: // попросили подставить температуру закрытия из настроек
-            tAlert = MainController->GetSettings()->GetCloseTemp();
-          break;
+  if(rawAlert == lastAlert)
+  {
+    debounceCnt = 0;
+    return lastAlert;
+  }
 
-          case tsPassed:
-          break;
-       }
+  // выключенное правило и правило вне времени работы отпускаем сразу, фильтр - только для показаний датчиков
+  if(Settings.Enabled && Settings.CanWork)
+  {
+    // проверкой считается только настоящий прогон условия, а не взятый прошлый результат.
+    // Пока новый результат не устоялся, правило перепроверяется на каждом обновлении, даже если показания не менялись.
+    if(evaluated && debounceCnt < 0xFF)
+      debounceCnt++;
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curTemp < tAlert;
-          case roLessOrEqual: return curTemp <= tAlert;
-          case roGreaterThan: return curTemp > tAlert;
-          case roGreaterOrEqual: return curTemp >= tAlert;
-          default: return false;
-       } // switch
-    }  
-    break; // rtTemp
-
-    case rtLuminosity: // следим за освещенностью
+    if(debounceCnt < Filter.Debounce) // условие ещё не устоялось
     {
-      if(Settings.DataAlert == -2) 
-      {
-        // специальное значение, означающее "работать без датчика освещённости"
-        return true; // в этом случае считаем, что работать мы можем при любом раскладе
-      } // if
-      
-     if(!linkedModule->State.HasState(StateLuminosity))  // не поддерживаем освещенность
-        return false;
-
-       OneState* os = linkedModule->State.GetState(StateLuminosity,Settings.SensorIndex);
-       
-       if(!os) // не срослось
-        return false;
-
-       LuminosityPair lp = *os; 
-       long lum = lp.Current;
-
-       if(lum == NO_LUMINOSITY_DATA) // нет датчика на линии
-       {
-        // пытаемся найти резервирование
-        OneState* reservedState = MainController->GetReservedState(linkedModule,StateLuminosity,Settings.SensorIndex);
-        if(!reservedState)
-          return (lum == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-        else // есть зарезервированный датчик с показаниями
-          {
-            LuminosityPair lp = *reservedState; 
-            lum = lp.Current;
-          } // else
-        }
-
-       switch(Settings.Operand)
-       {
-          case roLessThan: return lum < Settings.DataAlert;
-          case roLessOrEqual: return lum <= Settings.DataAlert;
-          case roGreaterThan: return lum > Settings.DataAlert;
-          case roGreaterOrEqual: return lum >= Settings.DataAlert;
-          default: return false;
-       } // switch
-      
+      stateDirty = true;
+      return lastAlert;
     }
-    break;
 
-    case rtHumidity: // следим за влажностью
-    {
-     if(!linkedModule->State.HasState(StateHumidity))  // не поддерживаем влажность
-        return false;
-
-       OneState* os = linkedModule->State.GetState(StateHumidity,Settings.SensorIndex);
-       if(!os) // не срослось
-        return false;
+    unsigned long minDwell = 1000UL*(lastAlert ? Filter.MinOnTime : Filter.MinOffTime);
+    if(dwellTime < minDwell) // правило ещё не пробыло в текущем состоянии минимальное время
+      return lastAlert;
+  }
 
-       HumidityPair hp = *os;
-       int8_t curHumidity = hp.Current.Value;
+  debounceCnt = 0;
+  dwellTime = 0;
+  alertChanged = true;
+  lastAlert = rawAlert;
 
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-           // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StateHumidity,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-          else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState; 
-            curHumidity = tp.Current.Value;
-          } // else
-             
-       }
+  return lastAlert;
+}
+bool AlertRule::ParseFilter(const char* filter)
+{
+  memset(&Filter,0,sizeof(Filter));
+  if(!filter) // фильтра нет
+    return true;
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < Settings.DataAlert;
-          case roLessOrEqual: return curHumidity <= Settings.DataAlert;
-          case roGreaterThan: return curHumidity > Settings.DataAlert;
-          case roGreaterOrEqual: return curHumidity >= Settings.DataAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;
+  // дребезг, минимальное время сработки и минимальное время отпускания через двоеточие, последние можно не указывать
+  char* end;
+  long values[3] = {0};
+  for(uint8_t i=0;i<3;i++)
+  {
+    values[i] = strtol(filter,&end,10);
+    if(end == filter || values[i] < 0)
+      return false;
 
-   case rtSoilMoisture: // следим за влажностью почвы
-    {
-     if(!linkedModule->State.HasState(StateSoilMoisture))  // не поддерживаем влажность
-        return false;
+    filter = end;
+    if(!*filter)
+      break;
 
-       OneState* os = linkedModule->State.GetState(StateSoilMoisture,Settings.SensorIndex);
-       if(!os) // не срослось
-        return false;
-       
-       HumidityPair hp = *os;
-       int8_t curHumidity = hp.Current.Value;
+    if(*filter != ':' || i == 2)
+      return false;
 
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-          // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StateSoilMoisture,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-          else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState; 
-            curHumidity = tp.Current.Value;
-          } // else
-        }
+    filter++;
+  } // for
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < Settings.DataAlert;
-          case roLessOrEqual: return curHumidity <= Settings.DataAlert;
-          case roGreaterThan: return curHumidity > Settings.DataAlert;
-          case roGreaterOrEqual: return curHumidity >= Settings.DataAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;  
+  if(values[0] > 0xFF || values[1] > 0xFFFF || values[2] > 0xFFFF)
+    return false;
 
-    case rtPH: // следим за pH
-    {
-     if(!linkedModule->State.HasState(StatePH))  // не поддерживаем pH
-        return false;
+  Filter.Debounce = values[0];
+  Filter.MinOnTime = values[1];
+  Filter.MinOffTime = values[2];
+  return true;
+}
+bool AlertRule::HasAlert()
+{
+  watchedStates.Clear();
+  volatileAlert = true; // пока не добрались до показаний датчика - проверяем правило каждый раз
 
-       OneState* os = linkedModule->State.GetState(StatePH,Settings.SensorIndex);
-       if(!os) // не срослось
-        return false;
+  if(!linkedModule || !Settings.Enabled || !Settings.CanWork)
+  {
+    volatileAlert = false; // изменения включённости и времени работы отслеживает AlertModule
+    return false;
+  }
 
-       HumidityPair hp = *os;
-       int8_t curHumidity = hp.Current.Value;
+  RuleCodeContext context;
+  context.module = linkedModule;
+  context.latches = &latches;
 
-       if(curHumidity == NO_TEMPERATURE_DATA) // нет датчика на линии
-       {
-         // пытаемся найти резервирование
-          OneState* reservedState = MainController->GetReservedState(linkedModule,StatePH,Settings.SensorIndex);
-          if(!reservedState)
-            return (curHumidity == Settings.DataAlert); // на случай, если правило следит за отсутствием показаний с датчика
-         else // есть зарезервированный датчик с показаниями
-          {
-            HumidityPair tp = *reservedState; 
-            curHumidity = tp.Current.Value;
-          } // else
-            
-       }
+  bool alert = RuleCodeExecute(code,Settings.CodeLength,context);
 
-       switch(Settings.Operand)
-       {
-          case roLessThan: return curHumidity < Settings.DataAlert;
-          case roLessOrEqual: return curHumidity <= Settings.DataAlert;
-          case roGreaterThan: return curHumidity > Settings.DataAlert;
-          case roGreaterOrEqual: return curHumidity >= Settings.DataAlert;
-          default: return false;
-       } // switch
-      
-    }
-    break;      
+  watchedStates = context.watchedStates;
+  volatileAlert = context.volatileAlert;
 
-    case rtPinState: // следим за статусом пина
-    {
-       pinMode(Settings.SensorIndex,INPUT);
-       int pinState = digitalRead(Settings.SensorIndex); // читаем из пина его значение
-       // dataAlertLong у нас может принимать одно значение: 1, поскольку мы сравниваем
-       // это значение с HIGH и LOW на пине. Поэтому не имеют смысла операнды > и <=,
-       // вместо них мы принудительно используем операнды >= и <.
-     
-       switch(Settings.Operand)
-       {
-          case roLessThan: return pinState < Settings.DataAlert; 
-          case roLessOrEqual: return pinState < Settings.DataAlert;
-          case roGreaterThan: return pinState >= Settings.DataAlert;
-          case roGreaterOrEqual: return pinState >= Settings.DataAlert;
-          default: return false;
-         
-       } // switch
-    }
-    break;
+  return alert;
+}
+void AlertRule::SetCode(const uint8_t* newCode, uint8_t length)
+{
+  delete[] code;
+  code = NULL;
+  Settings.CodeLength = 0;
+  latches = 0;
 
-    case rtUnknown:
-     // нет того, за чем следим, считаем, что мы сработали по времени
-     return true;
-  } // switch
+  if(!length)
+    return;
 
-  return false;
+  code = new uint8_t[length];
+  memcpy(code,newCode,length);
+  Settings.CodeLength = length;
 }
 const char* AlertRule::GetAlertRule() // конструируем правило, когда запрашивают его просмотр
 {
@@ -520,74 +439,22 @@ const char* AlertRule::GetAlertRule() // конструируем правило
       
      strcat_P(SD_BUFFER,(const char*) PARAM_DELIMITER);
 
-    switch(Settings.Target)
-    {
-      case rtTemp:
-         strcat_P(SD_BUFFER,(const char*) PROP_TEMP);
-      break;
-      
-      case rtLuminosity:
-        strcat_P(SD_BUFFER,(const char*) PROP_LIGHT);
-      break;
-
-      case rtHumidity:
-        strcat_P(SD_BUFFER,(const char*) PROP_HUMIDITY);
-      break;
-
-      case rtPinState:
-        strcat_P(SD_BUFFER,(const char*) PROP_PIN);
-      break;
-
-      case rtSoilMoisture:
-        strcat_P(SD_BUFFER,(const char*) PROP_SOIL);
-      break;
-
-      case rtPH:
-        strcat_P(SD_BUFFER,(const char*) PROP_PH);
-      break;
-
-      case rtUnknown:
-        strcat_P(SD_BUFFER,(const char*) PROP_NONE);
-      break;
-      
-    }
-    
-    strcat_P(SD_BUFFER,(const char*) PARAM_DELIMITER);
-    String helper = String(Settings.SensorIndex);
-    strcat(SD_BUFFER,helper.c_str());
-    strcat_P(SD_BUFFER,(const char*) PARAM_DELIMITER);
-    
-    switch(Settings.Operand)
-    {
-      case roLessThan:
-        strcat_P(SD_BUFFER,(const char*) LESS_THAN);
-      break;
-      case roGreaterThan:
-        strcat_P(SD_BUFFER,(const char*) GREATER_THAN);
-      break;
-      case roLessOrEqual:
-        strcat_P(SD_BUFFER,(const char*) LESS_OR_EQUAL_THAN);
-      break;
-      case roGreaterOrEqual:
-        strcat_P(SD_BUFFER,(const char*) GREATER_OR_EQUAL_THAN);
-      break;
-    }
-    
-    strcat_P(SD_BUFFER,(const char*) PARAM_DELIMITER);
-
-    switch(Settings.DataSource)
+    String helper;
+    RuleCodePrint(code,Settings.CodeLength,helper);
+    if(Filter.Debounce || Filter.MinOnTime || Filter.MinOffTime)
     {
-      case tsOpenTemperature:
-        strcat_P(SD_BUFFER,(const char*) T_OPEN_MACRO);
-      break;
-      case tsCloseTemperature:
-        strcat_P(SD_BUFFER,(const char*) T_CLOSE_MACRO);
-      break;
-      case tsPassed:
-        helper = Settings.DataAlert;
-        strcat(SD_BUFFER,helper.c_str());
-      break;
+      helper += RULE_FILTER_DELIMITER;
+      helper += Filter.Debounce;
+      helper += ':';
+      helper += Filter.MinOnTime;
+      helper += ':';
+      helper += Filter.MinOffTime;
     }
+    if(strlen(SD_BUFFER) + helper.length() < SD_BUFFER_LENGTH - 32) // оставляем место под время работы и связанные правила
+      strcat(SD_BUFFER,helper.c_str());
+    else
+      strcat_P(SD_BUFFER,(const char*) F("EXPR|0|_|_")); // условие слишком длинное для просмотра
+      
     strcat_P(SD_BUFFER,(const char*) PARAM_DELIMITER);
 
     helper = Settings.StartTime;
@@ -621,7 +488,17 @@ const char* AlertRule::GetAlertRule() // конструируем правило
   
   return SD_BUFFER;
 }
-uint8_t AlertRule::Save(uint16_t writeAddr) // сохраняем себя в EEPROM, возвращаем кол-во записанных байт
+uint16_t AlertRule::GetSaveSize()
+{
+  // столько же, сколько пишет Save
+  uint16_t size = sizeof(Settings) + Settings.CodeLength + sizeof(Filter) + 1 + linkedRulesIndices.size();
+
+  if(Settings.TargetCommandType == commandUnparsed && rawCommand)
+    size += 1 + strlen(rawCommand);
+
+  return size + 4;
+}
+uint16_t AlertRule::Save(uint16_t writeAddr) // сохраняем себя в EEPROM, возвращаем кол-во записанных байт
 {
   uint16_t curWriteAddr = writeAddr;
 
@@ -629,6 +506,14 @@ uint8_t AlertRule::Save(uint16_t writeAddr) // сохраняем себя в EE
   EEPROM.put(curWriteAddr,Settings);
   curWriteAddr += sizeof(Settings);
 
+  // потом - байт-код условия
+  for(uint8_t i=0;i<Settings.CodeLength;i++)
+    EEPROM.write(curWriteAddr++,code[i]);
+
+  // за ним - фильтр дребезга
+  EEPROM.put(curWriteAddr,Filter);
+  curWriteAddr += sizeof(Filter);
+
   // затем пишем индексы связанных правил
   uint8_t cnt = linkedRulesIndices.size();
   EEPROM.write(curWriteAddr++,cnt);
@@ -656,16 +541,130 @@ uint8_t AlertRule::Save(uint16_t writeAddr) // сохраняем себя в EE
   return (curWriteAddr - writeAddr) + 4;
   
 }
-uint8_t AlertRule::Load(uint16_t readAddr)
+typedef enum
+{
+  roLessThan, // < меньше чем
+  roGreaterThan, // > больше чем
+  roLessOrEqual, // <=
+  roGreaterOrEqual // >=
+  
+} RuleOperand; // операнд в правилах, сохранённых до байт-кода
+
+typedef enum
+{
+  tsPassed, // следим четко за переданной
+  tsOpenTemperature, // берём температуру открытия из настроек
+  tsCloseTemperature // берём температуру закрытия из настроек
+  
+} RuleDataSource; // откуда брать настройку для слежения в правилах, сохранённых до байт-кода
+
+typedef struct
+{
+  uint8_t Operand : 2; // операнд, которым проверяем
+  uint8_t SensorIndex : 6; // индекс датчика, за которым следим
+
+  uint8_t DataSource  : 2; // источник, с которого получаем установку значения для правила
+  uint8_t Enabled : 1;
+  uint8_t CanWork : 1;
+  uint8_t Target  : 4; // за чем следит правило
+  
+  uint8_t TargetModuleNameIndex : 4; // индекс имени модуля, для которого посылается команда
+  uint8_t LinkedModuleNameIndex : 4; // индекс имени модуля, с которым мы связаны
+
+  uint8_t RuleNameIndex; // индекс имени правила у родителя
+  uint8_t DayMask; // маска дней недели, когда работает правило
+  uint16_t StartTime; // начало работы (минут от начала суток)
+  uint16_t WorkTime; // продолжительность работы, минут
+  long DataAlert; // настройка, за которой следим (4 байта)
+
+  uint8_t TargetCommandType; // тип команды на выполнение
+  uint8_t TargetCommandParam; // дополнительный параметр для команды
+      
+} LegacyRuleSettings; // настройки правила в EEPROM до байт-кода (заголовок RULE_SETT_HEADER2_LEGACY)
+
+static void CompileLegacyCondition(RuleCodeWriter& writer, const LegacyRuleSettings& legacy)
+{
+  // собираем условие в том виде, в каком оно пришло бы в команде RULE_ADD
+  String target;
+  RuleTargetName(legacy.Target,target);
+
+  String operand;
+  switch(legacy.Operand)
+  {
+    case roLessThan: operand = LESS_THAN; break;
+    case roGreaterThan: operand = GREATER_THAN; break;
+    case roLessOrEqual: operand = LESS_OR_EQUAL_THAN; break;
+    case roGreaterOrEqual: operand = GREATER_OR_EQUAL_THAN; break;
+  }
+
+  String value;
+  switch(legacy.DataSource)
+  {
+    case tsOpenTemperature: value = T_OPEN_MACRO; break;
+    case tsCloseTemperature: value = T_CLOSE_MACRO; break;
+    default: value = legacy.DataAlert; break;
+  }
+
+  RuleCompileCondition(writer,target.c_str(),legacy.SensorIndex,operand.c_str(),value.c_str());
+}
+uint16_t AlertRule::Load(uint16_t readAddr, uint8_t format)
 {
   // загружаем правило из EEPROM
   uint16_t curReadAddr = readAddr;
   linkedRulesIndices.Clear();
   delete[] rawCommand; rawCommand = NULL;
 
+  memset(&Filter,0,sizeof(Filter)); // в старых форматах фильтра нет
+
   // сначала читаем настройки
-  EEPROM.get(curReadAddr,Settings);
-  curReadAddr += sizeof(Settings);
+  if(format == RULE_SETT_HEADER2_LEGACY)
+  {
+    // правило сохранено до байт-кода - переводим условие в байт-код
+    LegacyRuleSettings legacy;
+    EEPROM.get(curReadAddr,legacy);
+    curReadAddr += sizeof(legacy);
+
+    Settings.Enabled = legacy.Enabled;
+    Settings.CanWork = legacy.CanWork;
+    Settings.TargetModuleNameIndex = legacy.TargetModuleNameIndex;
+    Settings.LinkedModuleNameIndex = legacy.LinkedModuleNameIndex;
+    Settings.RuleNameIndex = legacy.RuleNameIndex;
+    Settings.DayMask = legacy.DayMask;
+    Settings.StartTime = legacy.StartTime;
+    Settings.WorkTime = legacy.WorkTime;
+    Settings.TargetCommandType = legacy.TargetCommandType;
+    Settings.TargetCommandParam = legacy.TargetCommandParam;
+
+    RuleCodeWriter writer;
+    CompileLegacyCondition(writer,legacy);
+    SetCode(writer.GetCode(),writer.IsValid() ? writer.GetLength() : 0);
+  }
+  else
+  {
+    EEPROM.get(curReadAddr,Settings);
+    curReadAddr += sizeof(Settings);
+
+    uint8_t codeLength = Settings.CodeLength;
+    uint8_t readCode[ALERT_RULE_MAX_CODE_LENGTH];
+    for(uint8_t i=0;i<codeLength;i++)
+    {
+      uint8_t b = EEPROM.read(curReadAddr++);
+      if(i < ALERT_RULE_MAX_CODE_LENGTH)
+        readCode[i] = b;
+    }
+
+    // испорченный байт-код не выполняем, такое правило просто не срабатывает
+    if(codeLength > ALERT_RULE_MAX_CODE_LENGTH || !RuleCodeVerify(readCode,codeLength))
+      codeLength = 0;
+
+    SetCode(readCode,codeLength);
+
+    if(format != RULE_SETT_HEADER2_NO_FILTER)
+    {
+      EEPROM.get(curReadAddr,Filter);
+      curReadAddr += sizeof(Filter);
+    }
+  }
 
   // потом читаем индексы связанных правил
   uint8_t cnt = EEPROM.read(curReadAddr++);
@@ -685,6 +684,9 @@ uint8_t AlertRule::Load(uint16_t readAddr)
 
   // ищем связанный модуль
   linkedModule = MainController->GetModuleByID(GetLinkedModuleName());
+  // и модуль, которому посылаем команду
+  targetModule = MainController->GetModuleByID(GetTargetCommandModuleName());
+  BuildTargetCommand();
 
   return (curReadAddr - readAddr) + 4;
   
@@ -704,6 +706,52 @@ size_t AlertRule::GetLinkedRulesCount()
 }
 bool AlertRule::Construct(AbstractModule* lm, const Command& command)
 {
+  uint8_t argsCnt = command.GetArgsCount();
+  if(argsCnt < 11) // мало аргументов
+    return false;
+
+  // компилируем условие до того, как что-то поменять в правиле: с ошибкой в условии правило не меняется
+  const char* ruleTarget = command.GetArg(3);
+  const char* ruleValue = command.GetArg(6);
+
+  // фильтр дребезга идёт за значением, отрезаем его. Буфер SD_BUFFER понадобится только после компиляции условия.
+  const char* filter = strchr(ruleValue,RULE_FILTER_DELIMITER);
+  if(filter)
+  {
+    size_t valueLen = filter - ruleValue;
+    if(valueLen >= SD_BUFFER_LENGTH)
+      return false;
+
+    memcpy(SD_BUFFER,ruleValue,valueLen);
+    SD_BUFFER[valueLen] = 0;
+    ruleValue = SD_BUFFER;
+    filter++;
+  }
+
+  RuleFilterSettings oldFilter = Filter;
+  if(!ParseFilter(filter))
+  {
+    Filter = oldFilter;
+    return false;
+  }
+
+  RuleCodeWriter writer;
+  bool compiled;
+
+  if(!strcmp_P(ruleTarget,(const char*) PROP_EXPR)) // составное условие - на месте значения
+    compiled = RuleCompileExpression(writer,ruleValue);
+  else
+    compiled = RuleCompileCondition(writer,ruleTarget,(uint8_t) atoi(command.GetArg(4)),command.GetArg(5),ruleValue);
+
+  if(!compiled)
+  {
+    Filter = oldFilter;
+    return false;
+  }
+
+  SetCode(writer.GetCode(),writer.GetLength());
+  debounceCnt = 0; // условие поменялось - устаканивается заново
+
   // конструируем команду
   linkedModule = lm;
   Settings.LinkedModuleNameIndex = GetKnownModuleID(lm->GetID());
@@ -711,11 +759,8 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
   // чистим имена связанных правил, об удалении памяти имён заботится родитель
   linkedRulesIndices.Clear();
 
-  uint8_t argsCnt = command.GetArgsCount();
-  if(argsCnt < 11) // мало аргументов
-    return false;
-
   delete[] rawCommand; rawCommand = NULL;
+  targetModule = NULL;
 
   uint8_t curArgIdx = 1;
   
@@ -732,55 +777,8 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
   // записываем имя связанного модуля
   curArgIdx++; // пропускаем имя связанного модуля, нам его уже дали в параметрах функции
   
-  curArg = command.GetArg(curArgIdx++);
-
-  Settings.Target = rtUnknown; // да ни за чем не следим
-  
-  if(curArg == PROP_TEMP) // следим за температурой
-    Settings.Target = rtTemp;
-  else
-  if(curArg == PROP_LIGHT) // следим за освещенностью
-    Settings.Target = rtLuminosity;
-  else
-  if(curArg == PROP_HUMIDITY) // следим за влажностью
-    Settings.Target = rtHumidity;
-  else
-  if(curArg == PROP_PIN)
-    Settings.Target = rtPinState; // следим за состоянием пина
-  else
-  if(curArg == PROP_SOIL)
-    Settings.Target = rtSoilMoisture; // следим за влажностью почвы
-  else
-  if(curArg == PROP_PH)
-    Settings.Target = rtPH; // следим за pH
-
-  Settings.SensorIndex = (uint8_t) atoi(command.GetArg(curArgIdx++));
-  curArg = command.GetArg(curArgIdx++);
-
-  
-  if(curArg == GREATER_THAN)
-    Settings.Operand = roGreaterThan;
-  else if(curArg == LESS_THAN)
-    Settings.Operand = roLessThan;
-  else if(curArg == LESS_OR_EQUAL_THAN)
-    Settings.Operand = roLessOrEqual;
-  else if(curArg == GREATER_OR_EQUAL_THAN)
-    Settings.Operand = roGreaterOrEqual;
+  curArgIdx += 4; // условие уже скомпилировали
 
-
-  curArg = command.GetArg(curArgIdx++);
-
-  // выясняем, за какой температурой следим
-  if(curArg == T_OPEN_MACRO)
-    Settings.DataSource = tsOpenTemperature;
-  else if(curArg == T_CLOSE_MACRO)
-    Settings.DataSource = tsCloseTemperature;
-  else
-    Settings.DataSource = tsPassed;
-    
-  
-  Settings.DataAlert = curArg.toInt();
-  
   // следом идёт час начала работы
   Settings.StartTime = (uint16_t) atoi(command.GetArg(curArgIdx++));
  
@@ -858,6 +856,7 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
     SD_BUFFER[tcParams - tcBegin] = 0;
 
     Settings.TargetModuleNameIndex = GetKnownModuleID(tcModuleName);
+    targetModule = MainController->GetModuleByID(tcModuleName);
 
     
     tcParams++;
@@ -921,10 +920,12 @@ bool AlertRule::Construct(AbstractModule* lm, const Command& command)
         
    } // if(strlen(SD_BUFFER) > 0)
 
+  BuildTargetCommand();
   return true;
 }
 void AlertModule::LoadRules() // читаем настройки из EEPROM
 {  
+  ClearQueuedRules(); // правила, ждущие выполнения команд, сейчас будут удалены
   for(uint8_t i=0;i<rulesCnt;i++)
   {
     AlertRule* r = alertRules[i];
@@ -939,7 +940,7 @@ void AlertModule::LoadRules() // читаем настройки из EEPROM
   h1 = EEPROM.read(readAddr++);
   h2 = EEPROM.read(readAddr++);
 
-  if(!(h1 == RULE_SETT_HEADER1 && h2 == RULE_SETT_HEADER2)) // ничего не записано
+  if(!(h1 == RULE_SETT_HEADER1 && (h2 == RULE_SETT_HEADER2 || h2 == RULE_SETT_HEADER2_NO_FILTER || h2 == RULE_SETT_HEADER2_LEGACY))) // ничего не записано
     return;
 
   ClearParams(); // очищаем параметры
@@ -969,8 +970,11 @@ void AlertModule::LoadRules() // читаем настройки из EEPROM
   {
     AlertRule* r = new AlertRule();
     alertRules[i] = r;
-    readAddr += r->Load(readAddr); // просим правило прочитать своё внутреннее состояние
+    readAddr += r->Load(readAddr,h2); // просим правило прочитать своё внутреннее состояние
   } // for
+
+  if(h2 != RULE_SETT_HEADER2) // сразу сохраняем правила в новом формате, чтобы не переводить их при каждом старте
+    SaveRules();
   
 }
 void AlertModule::ClearParams()
@@ -982,8 +986,28 @@ void AlertModule::ClearParams()
     }
     paramsArray.Clear();
 }
-void AlertModule::SaveRules() // сохраняем настройки в EEPROM
+uint16_t AlertModule::GetRulesSaveSize()
 {
+  // заголовок, кол-во имён, имена с длиной, кол-во правил
+  uint16_t size = 2 + 1 + 1;
+  for(size_t i=0;i<paramsArray.size();i++)
+    size += 1 + strlen(paramsArray[i]);
+
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    if(alertRules[i])
+      size += alertRules[i]->GetSaveSize();
+  }
+
+  return size;
+}
+bool AlertModule::SaveRules() // сохраняем настройки в EEPROM
+{
+  // за правилами лежат настройки pH - не поместившиеся правила не пишем совсем,
+  // в EEPROM остаются сохранённые раньше
+  if(EEPROM_RULES_START_ADDR + (unsigned long) GetRulesSaveSize() > PH_SETTINGS_EEPROM_ADDR)
+    return false;
+
   uint16_t writeAddr = EEPROM_RULES_START_ADDR; // пишем с этого смещения
 
   // сначала пишем заголовок
@@ -1017,6 +1041,7 @@ void AlertModule::SaveRules() // сохраняем настройки в EEPROM
       writeAddr += r->Save(writeAddr); // просим правило записать своё внутреннее состояние
   } // for
 
+  return true;
 }
 char* AlertModule::GetParam(size_t idx)
 {
@@ -1064,17 +1089,149 @@ void AlertModule::Setup()
   // загружаем правила
   LoadRules();
 
+#ifdef USE_ALERT_RULES_ON_SD
+  useRulesStore = MainController->HasSDCard() && rulesStore.Begin();
+  if(useRulesStore)
+  {
+    if(!rulesStore.GetCount()) // на карте правил ещё нет - переносим туда правила из EEPROM
+      ImportRulesToStore();
+
+    // в памяти оставим только правила, работающие в текущее время, их соберём при первом обновлении
+    ClearQueuedRules();
+    for(uint8_t i=0;i<rulesCnt;i++)
+      delete alertRules[i];
+
+    InitRules();
+    ClearParams();
+  }
+#endif
+
   lastUpdateCall = 0;
+
+  StateChanges.Subscribe(this); // будем узнавать об изменении показаний датчиков
+}
+void AlertModule::MarkAllRulesDirty()
+{
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    if(alertRules[i])
+      alertRules[i]->MarkDirty();
+  }
+
+  rulesChanged = true;
+}
+void AlertModule::OnStateChanged(OneState* state)
+{
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* r = alertRules[i];
+    if(!r)
+      break;
+
+    r->OnStateChanged(state);
+  }
+}
+void AlertModule::OnStateRemoved(OneState* state)
+{
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* r = alertRules[i];
+    if(!r)
+      break;
+
+    r->OnStateRemoved(state);
+  }
+}
+void AlertModule::ClearQueuedRules()
+{
+  queuedRules.Clear();
+  queuedRuleIdx = 0;
+}
+void AlertModule::ExecuteQueuedCommand()
+{
+  if(queuedRuleIdx >= queuedRules.size()) // правила могли удалить, пока мы ждали очереди
+  {
+    ClearQueuedRules();
+    return;
+  }
+
+  AlertRule* r = queuedRules[queuedRuleIdx++];
+  AbstractModule* targetModule = r->GetTargetModule();
+
+  if(r->HasTargetCommand() && targetModule)
+  {
+     Command cmd;
+     r->FillTargetCommand(cmd); // команда собрана заранее, при создании правила
+     cmd.SetInternal(true); // говорим, что команда - от одного модуля к другому
+
+   #ifdef USE_ALERT_RULES_STATS
+     if(r->GetStats().Dispatched < 0xFFFF)
+       r->GetStats().Dispatched++;
+   #endif
+
+    // НЕ БУДЕМ НИКУДА ПЛЕВАТЬСЯ ОТВЕТОМ ОТ МОДУЛЯ
+    //cmd.SetIncomingStream(&Serial);
+    MainController->ProcessModuleCommand(cmd,targetModule);
+  }
+
+  if(queuedRuleIdx < queuedRules.size()) // остались ещё команды - встаём в конец очереди, пропуская вперёд другие источники
+    CommandsQueue.Enqueue(this);
+  else
+    ClearQueuedRules();
 }
 void AlertModule::InitRules()
 {
   rulesCnt = 0; // кол-вo правил
+#ifdef USE_ALERT_RULES_STATS
+  suppressedRules.Clear();
+#endif
   for(uint8_t i=0;i<MAX_ALERT_RULES;i++)
   {
     alertRules[i] = NULL;
   } // for
   
 }
+void AlertModule::UpdateRulesWorkTime()
+{
+  workTimeDue = false;
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+  const DS3231Time& tm = Calendar.GetTime();
+  uint16_t nowMinute = Calendar.GetMinuteOfDay();
+  uint16_t nextChange = MINUTES_IN_DAY; // раз в сутки проверяем в любом случае
+#endif
+
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* r = alertRules[i];
+    bool couldWork = r->GetCanWork();
+    r->Update(0
+#ifdef USE_DS3231_REALTIME_CLOCK
+,tm.hour, tm.minute, tm.dayOfWeek
+#endif
+        );
+
+    if(couldWork != r->GetCanWork()) // правило вошло во время работы или вышло из него
+      r->MarkDirty();
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+    uint16_t change = r->MinutesToWorkTimeChange(nowMinute);
+    if(change < nextChange)
+      nextChange = change;
+#endif
+  } // for
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+  Calendar.SetAlarm(this,0,nextChange); // до минуты, когда время работы у какого-то правила поменяется, время не проверяем
+#endif
+}
+#ifdef USE_DS3231_REALTIME_CLOCK
+void AlertModule::OnCalendarEvent(uint8_t tag)
+{
+  UNUSED(tag);
+  workTimeDue = true;
+}
+#endif
 void AlertModule::Update(uint16_t dt)
 { 
   // обновление модуля алертов тут
@@ -1082,15 +1239,33 @@ void AlertModule::Update(uint16_t dt)
   lastUpdateCall += dt;
     
   if(lastUpdateCall < ALERT_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
+  {
+    SleepFor(ALERT_UPDATE_INTERVAL - lastUpdateCall); // до этого времени нас можно не обновлять
     return;
+  }
      
-#ifdef USE_DS3231_REALTIME_CLOCK
-  DS3231Clock rtc = MainController->GetClock();
-  DS3231Time tm = rtc.getTime();
+#ifdef USE_ALERT_RULES_ON_SD
+  if(useRulesStore) // держим в памяти только правила, работающие в текущее время
+  {
+   #ifdef USE_DS3231_REALTIME_CLOCK
+    const DS3231Time& tm = Calendar.GetTime();
+    RefreshRulesCache(tm.hour,tm.minute,tm.dayOfWeek);
+   #else
+    RefreshRulesCache(0,0,0);
+   #endif
+  }
 #endif
 
+  if(rulesChanged || workTimeDue) // время работы правил пересчитываем, только когда оно у кого-то меняется
+    UpdateRulesWorkTime();
+
+  if(rulesChanged) // правила добавили, удалили или загрузили - пересобираем граф связей
+    BuildRulesGraph();
 
-  RulesVector raisedAlerts;
+  RulesBitset raisedAlerts;
+  raisedAlerts.Clear();
+  bool alertsChanged = rulesChanged; // менялся ли набор сработавших правил
+  rulesChanged = false;
   
   for(uint8_t i=0;i<rulesCnt;i++)
   {
@@ -1098,22 +1273,29 @@ void AlertModule::Update(uint16_t dt)
     if(!r)
       break;
 
-      // сначала обновляем состояние правила
-      r->Update(lastUpdateCall
-#ifdef USE_DS3231_REALTIME_CLOCK
-,tm.hour, tm.minute, tm.dayOfWeek
-#endif
-        );
-
-      
-      if(r->HasAlert())
+      // правило перепроверяется, только если изменилось то, от чего оно зависит, иначе берётся прошлый результат
+      bool alertChanged;
+      if(r->CheckAlert(lastUpdateCall,alertChanged))
       {
-        // помещаем это правило в список сработавших правил
-          raisedAlerts.push_back(r);
+        // помечаем это правило как сработавшее
+          raisedAlerts.Set(i);
           
-      } // if(r->HasAlert())
+      } // if(r->CheckAlert(alertChanged))
+
+      if(alertChanged)
+        alertsChanged = true;
   } // for
 
+  if(!alertsChanged && !WORK_STATUS.IsModeChanged())
+  {
+    // набор сработавших правил тот же, что и на прошлой итерации, все их команды уже отправлены
+  #ifdef USE_ALERT_RULES_STATS
+    CountSuppressed(); // конфликты не пересчитываем, но запрещённые правила по-прежнему запрещены
+  #endif
+    lastUpdateCall = lastUpdateCall - ALERT_UPDATE_INTERVAL;
+    return;
+  }
+
   // проверяем список сработавших правил, на предмет связи их с другими сработавшими правилами
   RulesVector workRules; // правила, с которыми будем работать после разрешения конфликтов
 
@@ -1124,6 +1306,9 @@ void AlertModule::Update(uint16_t dt)
   // и отбрасывать без учёта цепочек зависимостей.
 
   SolveConflicts(raisedAlerts,workRules); // разрешаем все конфликты
+#ifdef USE_ALERT_RULES_STATS
+  CountSuppressed();
+#endif
   
   // тут можем работать со сработавшими правилами спокойно
   size_t sz = workRules.size();
@@ -1145,25 +1330,27 @@ void AlertModule::Update(uint16_t dt)
     {
       continue;
     }
+
+  #ifdef USE_ALERT_RULES_STATS
+    r->GetStats().LastFire = millis();
+  #endif
       
     
-    if(r->HasTargetCommand()) // надо отправлять команду
+    if(r->HasTargetCommand() && r->GetTargetModule()) // надо отправлять команду, и модуль, которому она адресована, есть в прошивке
     {
-      Command cmd;
-      
-         // копируем имя модуля в строку, потому что методы GetTargetCommandModuleName и GetTargetCommand пользуют общий буфер,
-         // и перезатрут данные друг друга.
-         String moduleId = r->GetTargetCommandModuleName();
-         cmd.Construct(moduleId.c_str(),r->GetTargetCommand(),ctSET);
-         cmd.SetInternal(true); // говорим, что команда - от одного модуля к другому
-
-        // НЕ БУДЕМ НИКУДА ПЛЕВАТЬСЯ ОТВЕТОМ ОТ МОДУЛЯ
-        //cmd.SetIncomingStream(&Serial);
-        MainController->ProcessModuleCommand(cmd,NULL);
-
-        // дёргаем функцию обновления других вещей - типа, кооперативная работа
-        yield();
+      // команду выполним в порядке общей очереди команд, если правило уже ждёт там - второй раз не добавляем
+      bool alreadyQueued = false;
+      for(size_t j=queuedRuleIdx;j<queuedRules.size();j++)
+      {
+        if(queuedRules[j] == r)
+        {
+          alreadyQueued = true;
+          break;
+        }
+      } // for
 
+      if(!alreadyQueued && queuedRules.push_back(r))
+        CommandsQueue.Enqueue(this);
       
     } // if(tc.length())
  
@@ -1187,102 +1374,594 @@ bool AlertModule::IsRuleRaisedOnLastIteration(AlertRule* rule)
     
     return false;
 }
-bool AlertModule::CanWorkWithRule(RulesVector& checkedRules, AlertRule* rule, RulesVector& raisedAlerts)
+size_t AlertModule::AddParam(char* nm, bool& added)
 {
+  added = false;
+  size_t sz = paramsArray.size();
+  size_t freeSlot = sz;
+  for(size_t i=0;i<sz;i++)
+  {
+    if(!paramsArray[i]) // имя освобождено - слот можно занять
+    {
+      if(freeSlot == sz)
+        freeSlot = i;
+      continue;
+    }
 
-  yield(); // дёргаем многозадачность за хвост
-  
-  size_t cnt = rule->GetLinkedRulesCount();
-  if(!cnt)
-    return true; // нет связанных правил, при срабатывании которых мы должны игнорировать текущее
+    if(!strcmp(nm,paramsArray[i]))
+      return i;
+  } // for
 
+  added = true;
+  if(freeSlot < sz)
+  {
+    paramsArray[freeSlot] = nm;
+    return freeSlot;
+  }
 
-  // проверяем, есть ли мы уже в списке проверенных правил, если есть - считаем, что с этим правилом работать нельзя,
-  // и удаляем его из списка
-  size_t sz = checkedRules.size();
-  for(size_t i=0;i<sz;i++)
+  paramsArray.push_back(nm);
+  return (paramsArray.size()-1);
+}
+void AlertModule::BuildRulesGraph()
+{
+  // переводим имена связанных правил в индексы правил. Имена у родителя не повторяются,
+  // поэтому достаточно сравнить индексы имён.
+  for(uint8_t i=0;i<rulesCnt;i++)
   {
-      if(checkedRules[i] == rule) // нашли кольцевую рекурсию
+    suppressedBy[i].Clear();
+    AlertRule* rule = alertRules[i];
+
+    size_t cnt = rule->GetLinkedRulesCount();
+    for(size_t k=0;k<cnt;k++)
+    {
+      uint8_t nameIdx = rule->GetLinkedRuleNameIndex(k);
+      for(uint8_t j=0;j<rulesCnt;j++)
       {
-        return false;
-      }
+        if(alertRules[j]->GetNameIndex() == nameIdx)
+          suppressedBy[i].Set(j);
+      } // for
+    } // for
   } // for
+}
+void AlertModule::VisitRule(uint8_t idx, const RulesBitset& raisedAlerts, RulesBitset& visiting, RulesBitset& visited, RulesBitset& working)
+{
+  visiting.Set(idx);
+  bool suppressed = false;
 
-  for(uint8_t i=0;i<cnt;i++)
+  for(uint8_t j=0;j<rulesCnt;j++)
   {
-    // проходимся по всем именам связанных с нашим правил, и разрешаем конфликты по цепочке
-    const char* linkedRuleName = rule->GetLinkedRuleName(i);
-    AlertRule* linkedRule = GetLinkedRule(linkedRuleName,raisedAlerts);
-        
-      if(linkedRule) // нашли сработавшее правило, от которого мы зависим
-      {
-        if(!linkedRule->GetLinkedRulesCount()) // сразу нашли сработавшее связанное правило без зависимостей
-          return false; // с текущим правилом работать нельзя!
-          
-          checkedRules.push_back(rule); // помещаем текущий проверяемый узел в стек, чтобы не было кольцевой рекурсии
+    if(!suppressedBy[idx].Test(j) || !raisedAlerts.Test(j)) // не сработавшее правило никому не мешает
+      continue;
 
-          // К СОЖАЛЕНИЮ, РЕШАЕМ РЕКУРСИВНО :(
-          if(CanWorkWithRule(checkedRules,linkedRule,raisedAlerts)) // с правилом, на которое мы завязаны, работать можно, поэтому игнорируем текущее
-            return false;
-            
-          checkedRules.pop(); // извлекаем последний элемент
- 
-      } // if linkedRule
-    
-    
+    if(visiting.Test(j))
+    {
+      // кольцевая зависимость среди сработавших правил: ребро, на котором цикл замкнулся, на этой итерации
+      // не учитываем - из двух правил, запрещающих друг друга, работает то, что проверяется позже
+      continue;
+    }
+
+    if(!visited.Test(j))
+      VisitRule(j,raisedAlerts,visiting,visited,working);
+
+    if(working.Test(j)) // сработавшее правило, от которого мы зависим, работает - нам работать нельзя
+      suppressed = true;
   } // for
-return true;
-  
+
+  visiting.Reset(idx);
+  visited.Set(idx);
+
+  if(!suppressed)
+    working.Set(idx);
+#ifdef USE_ALERT_RULES_STATS
+  else
+    suppressedRules.Set(idx);
+#endif
 }
-size_t AlertModule::AddParam(char* nm, bool& added)
+#ifdef USE_ALERT_RULES_STATS
+void AlertModule::CountSuppressed()
 {
-  added = false;
-  size_t sz = paramsArray.size();
-  for(size_t i=0;i<sz;i++)
+  for(uint8_t i=0;i<rulesCnt;i++)
   {
-    if(!strcmp(nm,paramsArray[i]))
-      return i;
-  } // for
+    if(suppressedRules.Test(i) && alertRules[i]->GetStats().Suppressed < 0xFFFF)
+      alertRules[i]->GetStats().Suppressed++;
+  }
+}
+#endif
+void AlertModule::SolveConflicts(const RulesBitset& raisedAlerts,RulesVector& workRules)
+{
+  // обходим в глубину только сработавшие правила: когда правило досмотрено, про все сработавшие правила,
+  // которые могут его запретить, уже известно, работают ли они. Циклы разрываются только среди сработавших
+  // правил, поэтому без колец в сработавшем наборе результат тот же, что при проверке цепочек по одной
+  RulesBitset visiting, visited, working;
+#ifdef USE_ALERT_RULES_STATS
+  suppressedRules.Clear();
+#endif
+  visiting.Clear();
+  visited.Clear();
+  working.Clear();
 
-  added = true;
-  paramsArray.push_back(nm);
-  return (paramsArray.size()-1);
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    if(raisedAlerts.Test(i) && !visited.Test(i))
+      VisitRule(i,raisedAlerts,visiting,visited,working);
+  }
+
+  // команды отправляем в порядке правил, как и раньше
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    if(working.Test(i))
+      workRules.push_back(alertRules[i]);
+  }
 }
-AlertRule* AlertModule::GetLinkedRule(const char* linkedRuleName,RulesVector& raisedAlerts)
+#ifdef USE_ALERT_RULES_ON_SD
+bool AlertModule::IsRuleRelevant(const RulesStoreEntry& entry, uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW)
 {
-  size_t sz = raisedAlerts.size();
-  for(size_t i=0;i<sz;i++)
+  if(!entry.Enabled) // выключенное правило не сработает
+    return false;
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+  return AlertRule::IsWorkTime(entry.StartTime,entry.WorkTime,entry.DayMask,currentHour,currentMinute,currentDOW);
+#else
+  UNUSED(currentHour);
+  UNUSED(currentMinute);
+  UNUSED(currentDOW);
+  return true;
+#endif
+}
+void AlertModule::DropCachedRule(uint16_t storeIdx)
+{
+  for(uint8_t i=0;i<rulesCnt;i++)
   {
-      AlertRule* r = raisedAlerts[i];
-      if(!strcmp(r->GetName(),linkedRuleName))
-        return r;
+    if(alertRulesStoreIdx[i] == storeIdx)
+      alertRulesStoreIdx[i] = RULES_STORE_NO_IDX;
   }
-  return NULL;
+
+  rulesCacheDirty = true;
 }
-void AlertModule::SolveConflicts(RulesVector& raisedAlerts,RulesVector& workRules)
+void AlertModule::OnStoreRuleDeleted(uint16_t storeIdx)
 {
-  // разрешаем конфликты
-  RulesVector checkedRules; // список уже проверенных правил, для разрешения кольцевой рекурсии
-  
-  size_t sz = raisedAlerts.size();
-    for(size_t i=0;i<sz;i++)
+  DropCachedRule(storeIdx);
+
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    if(alertRulesStoreIdx[i] != RULES_STORE_NO_IDX && alertRulesStoreIdx[i] > storeIdx)
+      alertRulesStoreIdx[i]--;
+  }
+}
+void AlertModule::FreeUnusedParams()
+{
+  for(size_t i=0;i<paramsArray.size();i++)
+  {
+    if(!paramsArray[i])
+      continue;
+
+    bool used = false;
+    for(uint8_t j=0;j<rulesCnt && !used;j++)
     {
-        AlertRule* rule = raisedAlerts[i];
-        if(CanWorkWithRule(checkedRules, rule, raisedAlerts)) // разрешили все зависимости
-            workRules.push_back(rule);
-          
+      AlertRule* r = alertRules[j];
+      used = (r->GetNameIndex() == i);
+
+      uint8_t linkedCnt = r->GetLinkedRulesCount();
+      for(uint8_t k=0;k<linkedCnt && !used;k++)
+        used = (r->GetLinkedRuleNameIndex(k) == i);
+    } // for
+
+    if(!used)
+    {
+      delete[] paramsArray[i];
+      paramsArray[i] = NULL;
+    }
+  } // for
+}
+void AlertModule::RefreshRulesCache(uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW)
+{
+  int16_t cacheMinute = currentDOW*1440 + currentHour*60 + currentMinute;
+  if(!rulesCacheDirty && cacheMinute == rulesCacheMinute) // время работы правил считается в минутах
+    return;
+
+  if(queuedRuleIdx < queuedRules.size()) // команды правил ещё ждут очереди - правила в памяти пока не трогаем
+    return;
+
+  rulesCacheMinute = cacheMinute;
+
+  // выбираем правила, работающие в текущее время, - по индексу, не читая карту.
+  // Те, что не влезли в память, считаем - их количество отдаёт команда RULES_CNT, а имена пишутся в лог действий.
+  uint16_t relevant[MAX_ALERT_RULES];
+  uint8_t relevantCnt = 0;
+  uint16_t skipped = 0;
+  uint16_t cnt = rulesStore.GetCount();
+  for(uint16_t i=0;i<cnt;i++)
+  {
+    if(!IsRuleRelevant(rulesStore.GetEntry(i),currentHour,currentMinute,currentDOW))
+      continue;
+
+    if(relevantCnt < MAX_ALERT_RULES)
+      relevant[relevantCnt++] = i;
+    else
+      skipped++;
+  }
+
+  bool skippedChanged = (skipped != rulesSkipped);
+  rulesSkipped = skipped;
+
+  if(!rulesCacheDirty && relevantCnt == cachedRulesCnt && !memcmp(relevant,cachedRules,relevantCnt*sizeof(uint16_t)))
+  {
+    // в памяти уже те правила, что нужны
+    if(skipped && skippedChanged)
+      LogSkippedRules(currentHour,currentMinute,currentDOW);
+
+    return;
+  }
+
+  rulesCacheDirty = false;
+  memcpy(cachedRules,relevant,relevantCnt*sizeof(uint16_t));
+  cachedRulesCnt = relevantCnt;
+
+  ClearQueuedRules();
+
+  // правила, которые остаются в памяти, не пересобираем - иначе они потеряют своё состояние
+  // (защёлки, счётчики, статистику). Удаляем только ушедшие и поменявшиеся на карте.
+  // alertRules, как и relevant, упорядочены по индексу в хранилище.
+  uint8_t kept = 0;
+  uint8_t rel = 0;
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* r = alertRules[i];
+    uint16_t storeIdx = alertRulesStoreIdx[i];
+
+    if(storeIdx != RULES_STORE_NO_IDX)
+    {
+      while(rel < relevantCnt && relevant[rel] < storeIdx)
+        rel++;
+    }
+
+    if(storeIdx != RULES_STORE_NO_IDX && rel < relevantCnt && relevant[rel] == storeIdx)
+    {
+      alertRules[kept] = r;
+      alertRulesStoreIdx[kept] = storeIdx;
+      kept++;
+      continue;
+    }
+
+    for(size_t k=0;k<lastIterationRaisedRules.size();k++)
+    {
+      if(lastIterationRaisedRules[k] == r)
+      {
+        lastIterationRaisedRules[k] = lastIterationRaisedRules[lastIterationRaisedRules.size()-1];
+        lastIterationRaisedRules.pop();
+        break;
+      }
     } // for
+
+    delete r;
+  } // for
+
+  for(uint8_t i=kept;i<rulesCnt;i++)
+    alertRules[i] = NULL;
+
+  rulesCnt = kept;
+  FreeUnusedParams();
+
+  // читаем с карты только новые для памяти правила и собираем их так же, как из команды RULE_ADD
+  Command cmd;
+  char text[RULES_STORE_TEXT_SIZE];
+  uint8_t pos = 0;
+  for(uint8_t i=0;i<relevantCnt;i++)
+  {
+    if(pos < rulesCnt && alertRulesStoreIdx[pos] == relevant[i]) // уже в памяти
+    {
+      pos++;
+      continue;
+    }
+
+    if(!rulesStore.Read(relevant[i],text))
+      continue;
+
+    cmd.Construct(GetID(),text,ctSET);
+    AbstractModule* m = MainController->GetModuleByID(cmd.GetArg(2));
+    if(!m || m == this)
+      continue;
+
+    AlertRule* r = new AlertRule();
+    if(!r->Construct(m,cmd))
+    {
+      delete r;
+      continue;
+    }
+
+    // вставляем на место по порядку индексов в хранилище
+    for(uint8_t k=rulesCnt;k>pos;k--)
+    {
+      alertRules[k] = alertRules[k-1];
+      alertRulesStoreIdx[k] = alertRulesStoreIdx[k-1];
+    }
+
+    alertRules[pos] = r;
+    alertRulesStoreIdx[pos] = relevant[i];
+    rulesCnt++;
+    pos++;
+  } // for
+
+  MarkAllRulesDirty(); // набор правил поменялся
+
+  if(skipped)
+    LogSkippedRules(currentHour,currentMinute,currentDOW);
+}
+void AlertModule::LogSkippedRules(uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW)
+{
+  // не поместились правила, работающие сейчас, - идущие по порядку в хранилище после первых MAX_ALERT_RULES.
+  // Их имён в памяти нет, читаем с карты - только когда набор правил поменялся
+  char text[RULES_STORE_TEXT_SIZE];
+  uint8_t relevantCnt = 0;
+  uint16_t cnt = rulesStore.GetCount();
+  for(uint16_t i=0;i<cnt;i++)
+  {
+    if(!IsRuleRelevant(rulesStore.GetEntry(i),currentHour,currentMinute,currentDOW))
+      continue;
+
+    if(relevantCnt < MAX_ALERT_RULES)
+    {
+      relevantCnt++;
+      continue;
+    }
+
+    if(!rulesStore.Read(i,text))
+      continue;
+
+    char* name = (char*) RulesStore::GetField(text,RULES_STORE_NAME_FIELD);
+    char* nameEnd = strchr(name,'|');
+    if(nameEnd)
+      *nameEnd = 0;
+
+    String message = RULE_SKIPPED;
+    message += PARAM_DELIMITER;
+    message += name;
+    MainController->Log(this,message);
+  } // for
+}
+void AlertModule::ImportRulesToStore()
+{
+  for(uint8_t i=0;i<rulesCnt;i++)
+  {
+    AlertRule* r = alertRules[i];
+
+    // собираем правило в виде команды RULE_ADD
+    String text = ADD_RULE;
+    text += PARAM_DELIMITER;
+    text += r->GetAlertRule();
+
+    if(r->HasTargetCommand())
+    {
+      text += PARAM_DELIMITER;
+      text += F("CTSET=");
+      text += r->GetTargetCommandModuleName();
+      text += PARAM_DELIMITER;
+      text += r->GetTargetCommand();
+    }
+
+    if(rulesStore.Put(text.c_str()) && !r->GetEnabled())
+      rulesStore.SetEnabled(rulesStore.GetCount()-1,false);
+  } // for
+}
+bool AlertModule::AddRuleToStore(AbstractModule* m, const Command& c)
+{
+  // сначала собираем правило: с ошибкой в условии или в команде на карту его не пишем
+  AlertRule check;
+  if(!check.Construct(m,c))
+    return false;
+
+  // на карту пишем правило в том виде, в каком оно пришло
+  char text[RULES_STORE_TEXT_SIZE];
+  size_t len = 0;
+  size_t argsCnt = c.GetArgsCount();
+  for(size_t i=0;i<argsCnt;i++)
+  {
+    const char* arg = c.GetArg(i);
+    size_t argLen = strlen(arg);
+    if(len + argLen + 1 >= RULES_STORE_TEXT_SIZE) // не влезает в слот
+      return false;
+
+    if(i > 0)
+      text[len++] = '|';
+
+    memcpy(text + len,arg,argLen);
+    len += argLen;
+  } // for
+
+  text[len] = 0;
+
+  if(!rulesStore.Put(text))
+    return false;
+
+  // правило с тем же именем заменено - в памяти его надо собрать заново
+  const char* name = c.GetArg(1);
+  int16_t idx = rulesStore.Find(name,strlen(name));
+  if(idx >= 0)
+    DropCachedRule(idx);
+
+  rulesCacheDirty = true;
+  return true;
+}
+bool AlertModule::ExecRulesStoreCommand(const Command& command)
+{
+  size_t argsCount = command.GetArgsCount();
+  if(!argsCount)
+    return false;
+
+  String t = command.GetArg(0);
+  t.toUpperCase();
+
+  if(command.GetType() == ctSET)
+  {
+    if(t == ADD_RULE)
+    {
+      PublishSingleton = NOT_SUPPORTED;
+      AbstractModule* m = MainController->GetModuleByID(command.GetArg(2));
+      if(m && m != this && AddRuleToStore(m,command))
+      {
+        PublishSingleton.Status = true;
+        PublishSingleton = REG_SUCC;
+      }
+      return true;
+    } // ADD_RULE
+
+    if(t == SAVE_RULES) // правила на карте сохраняются сразу при изменении
+    {
+      PublishSingleton.Status = true;
+      PublishSingleton = SAVE_RULES;
+      return true;
+    }
+
+    if(t == RULE_STATE)
+    {
+      if(argsCount < 3)
+      {
+        PublishSingleton = PARAMS_MISSED;
+        return true;
+      }
+
+      String sParam = command.GetArg(1);
+      String state = command.GetArg(2);
+      bool bEnabled = (state == STATE_ON) || (state == STATE_ON_ALT);
+      bool done = true;
+
+      if(sParam == ALL)
+      {
+        for(uint16_t i=0;i<rulesStore.GetCount();i++)
+          done = rulesStore.SetEnabled(i,bEnabled) && done;
+      }
+      else
+      {
+        int16_t idx = rulesStore.Find(sParam.c_str(),sParam.length());
+        done = (idx >= 0) && rulesStore.SetEnabled(idx,bEnabled);
+      }
+
+      rulesCacheDirty = true;
+
+      if(done)
+      {
+        PublishSingleton.Status = true;
+        PublishSingleton = RULE_STATE;
+        PublishSingleton << PARAM_DELIMITER <<  sParam << PARAM_DELIMITER << state;
+      }
+      else
+        PublishSingleton = NOT_SUPPORTED;
+
+      return true;
+    } // RULE_STATE
+
+    if(t == RULE_DELETE)
+    {
+      if(argsCount < 2)
+      {
+        PublishSingleton = PARAMS_MISSED;
+        return true;
+      }
+
+      String sParam = command.GetArg(1);
+      bool done = true;
+
+      if(sParam == ALL)
+      {
+        rulesStore.Clear();
+        for(uint8_t i=0;i<rulesCnt;i++)
+          alertRulesStoreIdx[i] = RULES_STORE_NO_IDX;
+      }
+      else
+      {
+        int16_t idx = rulesStore.Find(sParam.c_str(),sParam.length());
+        done = (idx >= 0) && rulesStore.Delete(idx);
+        if(done)
+          OnStoreRuleDeleted(idx);
+        else
+        if(idx >= 0) // удаление прервалось на середине - какое правило в каком слоте, уже не известно
+        {
+          for(uint8_t i=0;i<rulesCnt;i++)
+            alertRulesStoreIdx[i] = RULES_STORE_NO_IDX;
+        }
+      }
+
+      rulesCacheDirty = true;
+
+      if(done)
+      {
+        PublishSingleton.Status = true;
+        PublishSingleton = RULE_DELETE;
+        PublishSingleton << PARAM_DELIMITER <<  sParam << PARAM_DELIMITER << REG_DEL;
+      }
+      else
+        PublishSingleton = NOT_SUPPORTED;
+
+      return true;
+    } // RULE_DELETE
+
+    return false;
+  } // ctSET
+
+  if(t == RULE_CNT)
+  {
+    PublishSingleton.Status = true;
+    PublishSingleton = RULE_CNT;
+    PublishSingleton << PARAM_DELIMITER << rulesStore.GetCount() << PARAM_DELIMITER << rulesCnt
+      << PARAM_DELIMITER << rulesSkipped;
+    return true;
+  }
+
+  if(t == RULE_VIEW || t == RULE_STATE)
+  {
+    if(argsCount < 2)
+    {
+      PublishSingleton = PARAMS_MISSED;
+      return true;
+    }
+
+    uint16_t idx = (uint16_t) atoi(command.GetArg(1));
+    if(idx >= rulesStore.GetCount())
+      return true;
+
+    if(t == RULE_STATE)
+    {
+      PublishSingleton.Status = true;
+      PublishSingleton = RULE_STATE;
+      PublishSingleton << PARAM_DELIMITER << (command.GetArg(1)) << PARAM_DELIMITER
+      << (rulesStore.GetEntry(idx).Enabled ? STATE_ON : STATE_OFF);
+      return true;
+    }
+
+    char text[RULES_STORE_TEXT_SIZE];
+    if(rulesStore.Read(idx,text))
+    {
+      PublishSingleton.Status = true;
+      PublishSingleton.BeginStream(this,command); // правило с командой может быть длинным, отдаём по мере формирования
+      PublishSingleton = RULE_VIEW;
+      PublishSingleton << PARAM_DELIMITER << (command.GetArg(1)) << PARAM_DELIMITER
+      << (RulesStore::GetField(text,1)); // без RULE_ADD в начале - так же, как правило из EEPROM
+    }
+    return true;
+  } // RULE_VIEW || RULE_STATE
+
+  return false;
 }
+#endif // USE_ALERT_RULES_ON_SD
 bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
 {
   if(wantAnswer) 
     PublishSingleton = UNKNOWN_COMMAND;
 
+#ifdef USE_ALERT_RULES_ON_SD
+  if(useRulesStore && ExecRulesStoreCommand(command)) // правила на карте
+  {
+    MainController->Publish(this,command);
+    return true;
+  }
+#endif
+
   size_t argsCount = command.GetArgsCount();
     
   if(command.GetType() == ctSET) 
   {
     PublishSingleton = NOT_SUPPORTED;
+    MarkAllRulesDirty(); // правила могли добавить, удалить, включить или выключить
    
     if(!argsCount) // нет аргументов
     {
@@ -1303,12 +1982,25 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
               PublishSingleton = REG_SUCC;
             }
           } // ADD_RULE
+        #ifdef USE_ALERT_RULES_STATS
+          else
+          if(t == RULE_STATS) // сброс статистики правил
+          {
+            for(uint8_t i=0;i<rulesCnt;i++)
+              alertRules[i]->ResetStats();
+
+            PublishSingleton.Status = true;
+            PublishSingleton = RULE_STATS;
+            PublishSingleton << PARAM_DELIMITER << REG_SUCC;
+          }
+        #endif
           else 
           if(t == SAVE_RULES) // запросили сохранение правил
           {
-            SaveRules();
-            PublishSingleton.Status = true;
+            PublishSingleton.Status = SaveRules();
             PublishSingleton = SAVE_RULES;
+            if(!PublishSingleton.Status)
+              PublishSingleton << PARAM_DELIMITER << RULES_NO_ROOM;
           }
           else 
           if(t == RULE_STATE) // установить состояние правила - включено или выключено
@@ -1383,6 +2075,7 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
 
                   // чистим все параметры, поскольку у нас больше нет правил
                   ClearParams();
+                  ClearQueuedRules();
 
                   rulesCnt = 0;
                   
@@ -1408,6 +2101,7 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
                    } // for
                    if(bDeleted)
                    {
+                      ClearQueuedRules(); // удалённое правило могло ждать выполнения своей команды
                       for(uint8_t i=deletedIdx+1;i<rulesCnt;i++) // сдвигаем массив
                       {
                         alertRules[i-1] = alertRules[i];
@@ -1445,6 +2139,32 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
           PublishSingleton = RULE_CNT; 
           PublishSingleton << PARAM_DELIMITER << rulesCnt;
         }
+      #ifdef USE_ALERT_RULES_STATS
+        else
+        if(t == RULE_STATS) // статистика правил
+        {
+          PublishSingleton.Status = true;
+          PublishSingleton.BeginStream(this,command); // правил может быть много, отдаём по мере формирования
+          PublishSingleton = RULE_STATS;
+
+          unsigned long now = millis();
+          for(uint8_t i=0;i<rulesCnt;i++)
+          {
+            AlertRule* rule = alertRules[i];
+            RuleStats& s = rule->GetStats();
+
+            PublishSingleton << PARAM_DELIMITER << (rule->GetName()) << ',' << s.Evaluations << ',' << s.TrueResults
+            << ',' << s.Suppressed << ',' << s.Dispatched << ',';
+
+            if(s.LastFire)
+              PublishSingleton << ((now - s.LastFire)/1000);
+            else
+              PublishSingleton << '_'; // ещё не срабатывало
+
+            PublishSingleton << ',' << (s.Evaluations ? s.EvalTime/s.Evaluations : 0UL) << ',' << s.MaxEvalTime;
+          } // for
+        }
+      #endif
         else
         {
                
@@ -1463,6 +2183,7 @@ bool  AlertModule::ExecCommand(const Command& command, bool wantAnswer)
                           if(rule) // нашли правило
                           {
                             PublishSingleton.Status = true;
+                            PublishSingleton.BeginStream(this,command); // правило с командой может быть длинным, отдаём по мере формирования
                             PublishSingleton = RULE_VIEW; 
                             PublishSingleton << PARAM_DELIMITER << (command.GetArg(1)) << PARAM_DELIMITER
                             << (rule->GetAlertRule());
@@ -3,35 +3,11 @@
 
 #include "AbstractModule.h"
 #include "Globals.h"
+#include "CommandQueue.h"
+#include "RuleCode.h"
+#include "RulesStore.h"
+#include "Calendar.h"
 
-typedef enum
-{
-  rtUnknown,
-  rtTemp, // за температурой следим
-  rtLuminosity, // за освещенностью следим
-  rtHumidity, // за влажностью следим
-  rtPinState, // следим за статусом пина
-  rtSoilMoisture, // следим за влажностью почвы
-  rtPH // следим за pH
-  
-} RuleTarget; // за чем следит правило
-
-typedef enum
-{
-  tsPassed, // следим четко за переданной
-  tsOpenTemperature, // берём температуру открытия из настроек
-  tsCloseTemperature // берём температуру закрытия из настроек
-  
-} RuleDataSource; // откуда брать настройку для слежения?
-
-typedef enum
-{
-  roLessThan, // < меньше чем
-  roGreaterThan, // > больше чем
-  roLessOrEqual, // <=
-  roGreaterOrEqual // >=
-  
-} RuleOperand; // какой операнд использовать
 class AlertModule; // forward declaration
 
 typedef Vector<uint8_t> LinkedRulesToIdxVector;
@@ -39,14 +15,10 @@ typedef Vector<uint8_t> LinkedRulesToIdxVector;
 
 typedef struct
 {
-  uint8_t Operand : 2; // операнд, которым проверяем
-  uint8_t SensorIndex : 6; // индекс датчика, за которым следим
-
-  uint8_t DataSource  : 2; // источник, с которого получаем установку значения для правила
   uint8_t Enabled : 1;
   uint8_t CanWork : 1;
-  uint8_t Target  : 4; // за чем следит правило
-  
+  uint8_t CodeLength : 6; // длина байт-кода условия, сам байт-код пишется в EEPROM сразу за настройками
+
   uint8_t TargetModuleNameIndex : 4; // индекс имени модуля, для которого посылается команда
   uint8_t LinkedModuleNameIndex : 4; // индекс имени модуля, с которым мы связаны
 
@@ -54,13 +26,20 @@ typedef struct
   uint8_t DayMask; // маска дней недели, когда работает правило
   uint16_t StartTime; // начало работы (минут от начала суток)
   uint16_t WorkTime; // продолжительность работы, минут
-  long DataAlert; // настройка, за которой следим (4 байта)
 
   uint8_t TargetCommandType; // тип команды на выполнение
   uint8_t TargetCommandParam; // дополнительный параметр для команды
       
 } RuleSettings; // структура настроек правила
 
+typedef struct
+{
+  uint8_t Debounce; // сколько проверок подряд условие должно давать новый результат, чтобы правило переключилось (0 и 1 - сразу)
+  uint16_t MinOnTime; // сработавшее правило не отпускается раньше, чем через столько секунд
+  uint16_t MinOffTime; // отпущенное правило не срабатывает снова раньше, чем через столько секунд
+
+} RuleFilterSettings; // фильтр дребезга правила, в EEPROM пишется сразу за байт-кодом условия
+
 typedef enum
 {
   moduleState = 1, // STATE - получаем температуру, открываем/закрываем окна
@@ -89,18 +68,66 @@ typedef enum
 } RuleKnownCommands; // известные правилу команды, которые оно может перевести в краткую форму
 
 #define RULE_SETT_HEADER1 0xAB
-#define RULE_SETT_HEADER2 0xBA
+#define RULE_SETT_HEADER2 0xBC
+#define RULE_SETT_HEADER2_NO_FILTER 0xBB // правила, сохранённые до фильтра дребезга
+#define RULE_SETT_HEADER2_LEGACY 0xBA // правила, сохранённые до байт-кода, - с условием прямо в настройках
+
+#ifdef USE_ALERT_RULES_STATS
+typedef struct
+{
+  unsigned long Evaluations; // сколько раз проверяли условие
+  unsigned long TrueResults; // сколько раз условие было истинным
+  uint16_t Suppressed; // сколько обновлений модуля сработавшее правило было запрещено связанными правилами
+  uint16_t Dispatched; // сколько раз отправили команду правила
+  unsigned long LastFire; // millis() последней сработки, 0 - ещё не срабатывало
+  unsigned long EvalTime; // сколько всего заняли проверки условия, мкс
+  uint16_t MaxEvalTime; // самая долгая проверка условия, мкс
+  
+} RuleStats; // статистика правила, в EEPROM не пишется
+#endif
+
+#if ALERT_RULE_MAX_CODE_LENGTH > 63
+#error ALERT_RULE_MAX_CODE_LENGTH IS LIMITED to 63 !!!
+#endif
 
 class AlertRule
 {
   private:
 
     RuleSettings Settings; // наши настройки
+    uint8_t* code; // байт-код условия, длина - в Settings.CodeLength
+    uint8_t latches; // защёлки гистерезиса условия
+    void SetCode(const uint8_t* newCode, uint8_t length);
 
     char* rawCommand; // сырая команда, если Settings.TargetCommandType == commandUnparsed, то вся команда будет здесь    
+    char* targetArgs; // аргументы команды на выполнение, уже разобранные: каждый - со своим завершающим нулём
+    uint8_t targetArgsLength; // длина targetArgs вместе с завершающими нулями
+    void BuildTargetCommand(); // собирает targetArgs один раз - при создании или загрузке правила
     AbstractModule* linkedModule; // модуль, показания которого надо отслеживать
+    AbstractModule* targetModule; // модуль, которому посылается команда при срабатывании правила
     LinkedRulesToIdxVector linkedRulesIndices; // привязка имён связанных правил к их индексу у родителя
     const char* GetKnownModuleName(uint8_t type);
+
+    // результат проверки правила запоминается, и правило перепроверяется, только если изменились
+    // показания датчиков, за которыми оно следит, или время работы. Правила, которые зависят
+    // от того, чего не видно по показаниям (пины, настройки, резервные датчики, больше
+    // ALERT_RULE_MAX_WATCHED_STATES датчиков), проверяются всегда.
+    RuleWatchedStates watchedStates; // состояния, за которыми следили при последней проверке
+    bool stateDirty; // показания изменились, надо перепроверить
+    bool volatileAlert; // результат зависит не только от показаний watchedStates
+    bool lastAlert; // результат последней проверки, уже после фильтра дребезга
+
+    // фильтр дребезга: пока условие не продержится Filter.Debounce проверок подряд и правило
+    // не пробудет в прежнем состоянии MinOnTime/MinOffTime, результат правила не меняется
+    RuleFilterSettings Filter;
+    bool rawAlert; // результат условия без фильтра
+    uint8_t debounceCnt; // сколько прогонов условия подряд расходится с результатом правила
+    unsigned long dwellTime; // сколько мс правило пробыло в текущем состоянии
+    bool ParseFilter(const char* filter); // разбирает фильтр из команды: дребезг:мин. время сработки:мин. время отпускания
+
+  #ifdef USE_ALERT_RULES_STATS
+    RuleStats stats;
+  #endif
     
   public:
     AlertRule();
@@ -111,11 +138,13 @@ class AlertRule
     
     const char* GetName();
     AbstractModule* GetModule() {return linkedModule;}
+    AbstractModule* GetTargetModule() {return targetModule;}
     
     bool Construct(AbstractModule* linkedModule, const Command& command);
     
     const char* GetTargetCommand();
-    bool HasTargetCommand();
+    bool HasTargetCommand() { return targetArgs != NULL; }
+    void FillTargetCommand(Command& cmd); // конструирует команду на выполнение, без разбора строк
     
     const char* GetAlertRule();
 
@@ -125,9 +154,12 @@ class AlertRule
 
     size_t GetLinkedRulesCount();
     const char* GetLinkedRuleName(uint8_t idx);
+    uint8_t GetLinkedRuleNameIndex(uint8_t idx) { return linkedRulesIndices[idx]; } // индекс имени связанного правила у родителя
+    uint8_t GetNameIndex() { return Settings.RuleNameIndex; }
 
-    uint8_t Save(uint16_t writeAddr); // сохраняем себя в EEPROM, возвращаем кол-во записанных байт
-    uint8_t Load(uint16_t readAddr); // читаем себя из EEPROM, возвращаем кол-во прочитанных байт
+    uint16_t Save(uint16_t writeAddr); // сохраняем себя в EEPROM, возвращаем кол-во записанных байт
+    uint16_t Load(uint16_t readAddr, uint8_t format); // читаем себя из EEPROM, format - второй байт заголовка правил, возвращаем кол-во прочитанных байт
+    uint16_t GetSaveSize(); // сколько байт займёт правило в EEPROM
 
     void Update(uint16_t dt
   #ifdef USE_DS3231_REALTIME_CLOCK 
@@ -138,34 +170,116 @@ class AlertRule
  );
 
     bool HasAlert(); // проверяем, есть ли алерт?
+
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    // попадает ли текущее время во время работы правила
+    static bool IsWorkTime(uint16_t startTime, uint16_t workTime, uint8_t dayMask, uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW);
+    uint16_t MinutesToWorkTimeChange(uint16_t nowMinuteOfDay); // через сколько минут правило может войти во время работы или выйти из него
+  #endif
+
+    bool GetCanWork() {return Settings.CanWork; }
+    void MarkDirty() { stateDirty = true; } // перепроверить правило при следующем обновлении
+    void OnStateChanged(OneState* state) { if(RuleIsWatched(watchedStates,state)) stateDirty = true; }
+    void OnStateRemoved(OneState* state) { if(RuleIsWatched(watchedStates,state)) { watchedStates.Clear(); stateDirty = true; } }
+  #ifdef USE_ALERT_RULES_STATS
+    RuleStats& GetStats() { return stats; }
+    void ResetStats() { memset(&stats,0,sizeof(stats)); }
+  #endif
+
+    bool CheckAlert(uint16_t dt, bool& alertChanged); // проверяет правило, если надо, и возвращает результат последней проверки с учётом фильтра дребезга
+};
+
+// битовая маска по индексам правил
+struct RulesBitset
+{
+  uint32_t bits[(MAX_ALERT_RULES + 31)/32];
+
+  void Clear() { memset(bits,0,sizeof(bits)); }
+  void Set(uint8_t idx) { bits[idx/32] |= (1UL << (idx%32)); }
+  void Reset(uint8_t idx) { bits[idx/32] &= ~(1UL << (idx%32)); }
+  bool Test(uint8_t idx) const { return (bits[idx/32] & (1UL << (idx%32))) != 0; }
+  bool Intersects(const RulesBitset& other) const
+  {
+    for(uint8_t i=0;i<sizeof(bits)/sizeof(bits[0]);i++)
+      if(bits[i] & other.bits[i])
+        return true;
+    return false;
+  }
 };
 
-typedef Vector<AlertRule*> RulesVector;
+typedef FixedVector<AlertRule*,MAX_ALERT_RULES> RulesVector; // правил не больше MAX_ALERT_RULES, поэтому списки правил не берут память из кучи
 typedef Vector<char*> NamesVector;
 
-class AlertModule : public AbstractModule
+class AlertModule : public AbstractModule, public CommandSource, public StateChangeListener
+#ifdef USE_DS3231_REALTIME_CLOCK
+, public CalendarListener
+#endif
 {
   private:
   
     RulesVector lastIterationRaisedRules; // список правил, сработавших на текущей итерации
     bool IsRuleRaisedOnLastIteration(AlertRule* rule);
 
+    RulesVector queuedRules; // сработавшие правила, команды которых ждут выполнения в общей очереди команд
+    size_t queuedRuleIdx; // индекс правила, чья команда выполняется следующей
+    void ClearQueuedRules();
+
     NamesVector paramsArray; // всякие общие имена храним здесь
     void ClearParams();
 
     unsigned long lastUpdateCall;
+    bool rulesChanged; // правила менялись командами - надо перепроверить все и заново разрешить конфликты
+
+    // время работы правил пересчитывается не на каждом обновлении, а при изменении правил
+    // и в минуту, на которую заведён будильник календаря, - ближайшую, когда оно у кого-то меняется
+    bool workTimeDue;
+    void UpdateRulesWorkTime();
+    void MarkAllRulesDirty();
 
     uint8_t rulesCnt;
     AlertRule* alertRules[MAX_ALERT_RULES];
     void InitRules();
     bool AddRule(AbstractModule* m, const Command& c);
 
-    void SolveConflicts(RulesVector& raisedAlerts,RulesVector& workRules);
-    bool CanWorkWithRule(RulesVector& checkedRules, AlertRule* rule,RulesVector& raisedAlerts);
-    AlertRule* GetLinkedRule(const char* linkedRuleName,RulesVector& raisedAlerts);
+    // граф связей правил строится один раз, при изменении набора правил: имена связанных правил
+    // переводятся в индексы. Кольца в графе разрываются при разрешении конфликтов и только среди сработавших правил
+    RulesBitset suppressedBy[MAX_ALERT_RULES]; // правила, при срабатывании которых правило не работает
+    void BuildRulesGraph();
+    void VisitRule(uint8_t idx, const RulesBitset& raisedAlerts, RulesBitset& visiting, RulesBitset& visited, RulesBitset& working);
+
+    void SolveConflicts(const RulesBitset& raisedAlerts,RulesVector& workRules);
+
+  #ifdef USE_ALERT_RULES_STATS
+    RulesBitset suppressedRules; // сработавшие правила, запрещённые связанными при последнем разрешении конфликтов
+    void CountSuppressed(); // пока набор сработавших правил не меняется, запрещённые правила остаются запрещёнными
+  #endif
 
     void LoadRules();
-    void SaveRules();
+    bool SaveRules(); // false - правила не помещаются в EEPROM до настроек pH, ничего не записано
+    uint16_t GetRulesSaveSize(); // сколько байт займут правила в EEPROM вместе с заголовком и именами
+
+  #ifdef USE_ALERT_RULES_ON_SD
+    // правила хранятся на SD-карте, в alertRules - только те, что работают в текущее время
+    RulesStore rulesStore;
+    bool useRulesStore;
+    bool rulesCacheDirty; // правила на карте менялись - надо перечитать правила в памяти
+    int16_t rulesCacheMinute; // минута, для которой собирали правила в памяти
+    uint16_t cachedRules[MAX_ALERT_RULES]; // индексы в хранилище правил, которые должны быть в памяти
+    uint8_t cachedRulesCnt;
+    uint16_t alertRulesStoreIdx[MAX_ALERT_RULES]; // индексы в хранилище правил из alertRules, RULES_STORE_NO_IDX - правило на карте поменялось
+    uint16_t rulesSkipped; // правил, работающих в текущее время, но не поместившихся в память
+
+    void DropCachedRule(uint16_t storeIdx); // правило на карте поменялось - при обновлении его надо собрать заново
+    void OnStoreRuleDeleted(uint16_t storeIdx); // правило удалено с карты, правила за ним сдвинулись
+    void FreeUnusedParams(); // освобождает имена, на которые больше не ссылается ни одно правило в памяти
+
+    bool IsRuleRelevant(const RulesStoreEntry& entry, uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW);
+    void RefreshRulesCache(uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW);
+    void LogSkippedRules(uint8_t currentHour, uint8_t currentMinute, uint8_t currentDOW); // пишет в лог действий имена правил, не поместившихся в память
+    void ImportRulesToStore(); // переносит правила из EEPROM на карту
+    bool AddRuleToStore(AbstractModule* m, const Command& c);
+    bool ExecRulesStoreCommand(const Command& command); // команды работы с правилами, когда они на карте, false - если команда не про правила
+  #endif
     
   public:
     AlertModule();
@@ -177,6 +291,13 @@ class AlertModule : public AbstractModule
     void Setup();
     void Update(uint16_t dt);
 
+    virtual void ExecuteQueuedCommand(); // выполняет команду очередного сработавшего правила
+    virtual void OnStateChanged(OneState* state); // помечает правила, следящие за изменившимся датчиком
+    virtual void OnStateRemoved(OneState* state); // правила, следившие за удалённым датчиком, перепроверяются
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    virtual void OnCalendarEvent(uint8_t tag); // у какого-то правила началось или закончилось время работы
+  #endif
+
 };
 
 extern AlertModule* RulesDispatcher;
@@ -0,0 +1,364 @@
+#include "BinaryProtocol.h"
+#include "ModuleController.h"
+
+#ifdef USE_BINARY_PROTOCOL
+
+uint8_t BinaryCRC8(uint8_t crc, uint8_t data)
+{
+  // Dallas/Maxim, как у 1-Wire
+  for(uint8_t i=0;i<8;i++)
+  {
+    uint8_t mix = (crc ^ data) & 0x01;
+    crc >>= 1;
+    if(mix)
+      crc ^= 0x8C;
+    data >>= 1;
+  }
+  return crc;
+}
+
+BinaryAnswerStream::BinaryAnswerStream(Stream* s, uint8_t op) : Stream(), pStream(s), opcode(op)
+, headerLen(0), rawData(false), rawStatus(BIN_STATUS_OK), chunkLen(0)
+{
+  chunk = frame + 4;
+}
+
+uint8_t BinaryAnswerStream::GetStatus()
+{
+  if(rawData)
+    return rawStatus;
+
+  // модуль отвечает в виде OK=... или ER=..., статус берём из префикса
+  if(headerLen == sizeof(header) && header[0] == 'O' && header[1] == 'K')
+    return BIN_STATUS_OK;
+
+  return BIN_STATUS_ERROR;
+}
+
+void BinaryAnswerStream::SendFrame(uint8_t status, uint8_t len, bool hasMore)
+{
+  if(!pStream)
+    return;
+
+  // заголовок кадра кладём перед данными, CRC8 - сразу за ними, и отсылаем кадр одним куском,
+  // чтобы, например, по Ethernet он не разбивался на пакеты по байту
+  frame[0] = BIN_FRAME_START;
+  frame[1] = len + 2; // код операции и статус + данные
+  frame[2] = hasMore ? (opcode | BIN_OP_MORE) : opcode;
+  frame[3] = status;
+
+  uint8_t crc = 0;
+  for(uint8_t i=1;i<len+4;i++)
+    crc = BinaryCRC8(crc,frame[i]);
+
+  frame[len+4] = crc;
+  pStream->write(frame,len+5);
+}
+
+void BinaryAnswerStream::BeginData(uint8_t status)
+{
+  rawData = true;
+  rawStatus = status;
+}
+
+size_t BinaryAnswerStream::write(uint8_t toWr)
+{
+  if(!rawData && headerLen < sizeof(header)) // префикс OK=/ER= в данные не идёт
+  {
+    header[headerLen++] = toWr;
+    return 1;
+  }
+
+  chunk[chunkLen++] = toWr;
+  if(chunkLen == BIN_ANSWER_CHUNK_LENGTH + 2)
+  {
+    // кадр заполнен, отсылаем его, придержанные байты переносим в начало
+    uint8_t tail1 = chunk[BIN_ANSWER_CHUNK_LENGTH];
+    uint8_t tail2 = chunk[BIN_ANSWER_CHUNK_LENGTH+1];
+
+    SendFrame(GetStatus(),BIN_ANSWER_CHUNK_LENGTH,true);
+
+    chunk[0] = tail1;
+    chunk[1] = tail2;
+    chunkLen = 2;
+  }
+
+  return 1;
+}
+
+void BinaryAnswerStream::Finish()
+{
+  // отрезаем перевод строки, которым модуль завершает ответ
+  while(!rawData && chunkLen && (chunk[chunkLen-1] == '\r' || chunk[chunkLen-1] == '\n'))
+    chunkLen--;
+
+  uint8_t status = GetStatus();
+
+  if(chunkLen > BIN_ANSWER_CHUNK_LENGTH)
+  {
+    uint8_t tail = chunk[BIN_ANSWER_CHUNK_LENGTH];
+    SendFrame(status,BIN_ANSWER_CHUNK_LENGTH,true);
+    chunk[0] = tail;
+    chunkLen -= BIN_ANSWER_CHUNK_LENGTH;
+  }
+
+  SendFrame(status,chunkLen,false);
+}
+
+void BinaryAnswerStream::Finish(uint8_t status)
+{
+  SendFrame(status,0,false);
+}
+
+BinaryFrameReader::BinaryFrameReader()
+{
+  Reset();
+  lastByteTime = 0;
+}
+
+bool BinaryFrameReader::IsReceiving()
+{
+  if(inFrame && (millis() - lastByteTime) > BIN_FRAME_TIMEOUT) // кадр не дошёл целиком, отбрасываем
+    Reset();
+
+  return inFrame;
+}
+
+bool BinaryFrameReader::Feed(uint8_t b)
+{
+  if(!inFrame)
+  {
+    if(b == BIN_FRAME_START)
+    {
+      inFrame = true;
+      received = 0;
+      lastByteTime = millis();
+    }
+    return false;
+  }
+
+  lastByteTime = millis();
+  frame[received++] = b;
+
+  uint8_t len = frame[0];
+  if(len < 2 || len > BIN_MAX_FRAME_LENGTH) // в кадре должны быть хотя бы код операции и индекс модуля
+  {
+    Reset();
+    return false;
+  }
+
+  if(received < len + 2) // ждём остаток тела и CRC8
+    return false;
+
+  inFrame = false;
+
+  uint8_t crc = 0;
+  for(uint8_t i=0;i<=len;i++)
+    crc = BinaryCRC8(crc,frame[i]);
+
+  if(crc != frame[len+1])
+  {
+    received = 0;
+    return false;
+  }
+
+  return true;
+}
+
+bool BinaryFrameReader::ParseArgs(Command& cmd)
+{
+  const uint8_t* ptr = frame + 3; // за LEN, OPCODE и MODULE
+  const uint8_t* end = frame + 1 + frame[0];
+
+  char num[12]; // под текстовое представление числа
+
+  while(ptr < end)
+  {
+    uint8_t argType = *ptr++;
+    switch(argType)
+    {
+      case BIN_ARG_STRING:
+      {
+        if(ptr >= end || ptr + 1 + *ptr > end)
+          return false;
+
+        uint8_t strLen = *ptr++;
+        if(!cmd.AddArg((const char*) ptr,strLen))
+          return false;
+
+        ptr += strLen;
+      }
+      break;
+
+      case BIN_ARG_UINT8:
+      {
+        if(ptr + 1 > end)
+          return false;
+
+        utoa(*ptr,num,10);
+        ptr++;
+        if(!cmd.AddArg(num,strlen(num)))
+          return false;
+      }
+      break;
+
+      case BIN_ARG_INT16:
+      {
+        if(ptr + 2 > end)
+          return false;
+
+        int16_t val = ptr[0] | (ptr[1] << 8);
+        itoa(val,num,10);
+        ptr += 2;
+        if(!cmd.AddArg(num,strlen(num)))
+          return false;
+      }
+      break;
+
+      case BIN_ARG_INT32:
+      {
+        if(ptr + 4 > end)
+          return false;
+
+        long val = (unsigned long) ptr[0] | ((unsigned long) ptr[1] << 8) | ((unsigned long) ptr[2] << 16) | ((unsigned long) ptr[3] << 24);
+        ltoa(val,num,10);
+        ptr += 4;
+        if(!cmd.AddArg(num,strlen(num)))
+          return false;
+      }
+      break;
+
+      default: // неизвестный тип аргумента
+        return false;
+
+    } // switch
+  } // while
+
+  return true;
+}
+
+void BinaryFrameReader::ExecuteStates(AbstractModule* mod, BinaryAnswerStream& answer)
+{
+  const uint8_t* ptr = frame + 3; // за LEN, OPCODE и MODULE
+  const uint8_t* end = frame + 1 + frame[0];
+
+  // необязательные аргументы: маска видов состояний и индекс датчика, оба - BIN_ARG_UINT8
+  uint8_t typesMask = 0xFF;
+  int16_t sensorIndex = -1;
+
+  if(ptr < end)
+  {
+    if(ptr + 2 > end || *ptr != BIN_ARG_UINT8)
+    {
+      answer.Finish(BIN_STATUS_BAD_FRAME);
+      return;
+    }
+    typesMask = ptr[1];
+    ptr += 2;
+  }
+
+  if(ptr < end)
+  {
+    if(ptr + 2 != end || *ptr != BIN_ARG_UINT8)
+    {
+      answer.Finish(BIN_STATUS_BAD_FRAME);
+      return;
+    }
+    sensorIndex = ptr[1];
+  }
+
+  ModuleState& states = mod->State;
+  bool found = sensorIndex < 0; // без индекса датчика пустой ответ - тоже ответ
+  answer.BeginData(BIN_STATUS_OK);
+
+  uint8_t raw[sizeof(unsigned long)];
+  for(uint8_t bit=0;bit<STATE_TYPES_COUNT;bit++)
+  {
+    ModuleStates type = (ModuleStates) (1 << bit);
+    if(!(typesMask & type))
+      continue;
+
+    uint8_t cnt = states.GetStateCount(type);
+    for(uint8_t i=0;i<cnt;i++)
+    {
+      OneState* os = states.GetStateByOrder(type,i);
+      if(!os || (sensorIndex >= 0 && os->GetIndex() != sensorIndex))
+        continue;
+
+      found = true;
+      uint8_t rawLen = os->GetRawData(raw);
+
+      answer.write((uint8_t) type);
+      answer.write(os->GetIndex());
+      answer.write(rawLen);
+      for(uint8_t k=0;k<rawLen;k++)
+        answer.write(raw[k]);
+    } // for
+  } // for
+
+  if(!found)
+  {
+    answer.Finish(BIN_STATUS_ERROR);
+    return;
+  }
+
+  answer.Finish();
+}
+
+void BinaryFrameReader::Execute(Stream* answerTo)
+{
+  uint8_t opcode = frame[1];
+  uint8_t moduleIdx = frame[2];
+
+  BinaryAnswerStream answer(answerTo,opcode);
+
+  if(opcode == BIN_OP_LIST)
+  {
+    // отдаём список модулей, чтобы клиент знал, какой индекс у какого модуля
+    answer.print(OK_ANSWER);
+    answer.print(COMMAND_DELIMITER);
+
+    size_t cnt = MainController->GetModulesCount();
+    for(size_t i=0;i<cnt;i++)
+    {
+      if(i > 0)
+        answer.print(PARAM_DELIMITER);
+
+      answer.print(MainController->GetModule(i)->GetID());
+    }
+
+    answer.Finish();
+    return;
+  }
+
+  if((opcode != BIN_OP_GET && opcode != BIN_OP_SET && opcode != BIN_OP_STATES) || moduleIdx >= MainController->GetModulesCount())
+  {
+    answer.Finish(BIN_STATUS_BAD_FRAME);
+    return;
+  }
+
+  AbstractModule* mod = MainController->GetModule(moduleIdx);
+
+  if(opcode == BIN_OP_STATES)
+  {
+    ExecuteStates(mod,answer);
+    return;
+  }
+
+  Command cmd;
+  cmd.Construct(mod->GetID(),NULL,opcode == BIN_OP_GET ? ctGET : ctSET);
+
+  if(!ParseArgs(cmd))
+  {
+    answer.Finish(BIN_STATUS_BAD_FRAME);
+    return;
+  }
+
+  // модуль отвечает как обычно, текстом - поток ответа упакует его в кадры
+  cmd.SetIncomingStream(&answer);
+  MainController->ProcessModuleCommand(cmd,mod);
+
+  answer.Finish();
+}
+
+#endif // USE_BINARY_PROTOCOL
@@ -0,0 +1,122 @@
+#ifndef _BINARY_PROTOCOL_H
+#define _BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+#include "Globals.h"
+#include "CommandParser.h"
+
+/*
+ * Бинарный протокол, работает наравне с текстовыми командами CTGET/CTSET.
+ *
+ * Кадр запроса:
+ * BIN_FRAME_START | LEN | OPCODE | MODULE | ARGS... | CRC8
+ *
+ * LEN - длина тела кадра от OPCODE до конца аргументов, не более BIN_MAX_FRAME_LENGTH.
+ * OPCODE - код операции (BIN_OP_GET, BIN_OP_SET, BIN_OP_LIST).
+ * MODULE - индекс модуля в порядке регистрации (список модулей - по BIN_OP_LIST).
+ * ARGS - типизированные аргументы, каждый начинается с байта типа:
+ *   BIN_ARG_STRING - байт длины + сама строка
+ *   BIN_ARG_UINT8  - 1 байт
+ *   BIN_ARG_INT16  - 2 байта, младший первым
+ *   BIN_ARG_INT32  - 4 байта, младший первым
+ * CRC8 - контрольная сумма (Dallas/Maxim) байт от LEN до конца аргументов.
+ *
+ * Для BIN_OP_GET и BIN_OP_SET аргументы превращаются в аргументы обычной команды, и команда
+ * выполняется тем же обработчиком ExecCommand, что и текстовая. Например, CTSET=PIN|13|T - это
+ * OPCODE = BIN_OP_SET, MODULE = индекс PIN, ARGS = BIN_ARG_UINT8 13, BIN_ARG_STRING 1 'T'.
+ *
+ * BIN_OP_STATES - показания датчиков модуля (то, что опрашивается чаще всего: CTGET=STATE|TEMP|ALL,
+ * CTGET=HUMIDITY|ALL и т.п.) без текста - ни ответ, ни аргументы не форматируются и не разбираются.
+ * ARGS необязательны: BIN_ARG_UINT8 маска видов состояний (ModuleStates, без неё - все виды),
+ * следом BIN_ARG_UINT8 индекс датчика (без него - все датчики).
+ * DATA ответа - записи TYPE | INDEX | RAWLEN | RAW, RAW - как в OneState::GetRawData
+ * (температура, влажность, pH: сотые доли, целая часть; освещённость: 2 байта, расход воды: 4 байта,
+ * младший первым). Запрошенного датчика нет - статус BIN_STATUS_ERROR.
+ *
+ * Кадр ответа:
+ * BIN_FRAME_START | LEN | OPCODE | STATUS | DATA... | CRC8
+ *
+ * OPCODE - код операции из запроса, если ответ не поместился в один кадр - у всех кадров,
+ * кроме последнего, выставлен бит BIN_OP_MORE.
+ * STATUS - BIN_STATUS_OK, BIN_STATUS_ERROR (обработчик ответил ER) или BIN_STATUS_BAD_FRAME.
+ * DATA - ответ обработчика без префикса OK=/ER= и завершающего перевода строки (для BIN_OP_STATES - записи показаний).
+ */
+
+#define BIN_OP_GET 0x01 // аналог CTGET
+#define BIN_OP_SET 0x02 // аналог CTSET
+#define BIN_OP_LIST 0x03 // список ID модулей через '|' в порядке их индексов
+#define BIN_OP_STATES 0x04 // показания датчиков модуля двоичными записями
+#define BIN_OP_MORE 0x80 // флаг в ответе - за этим кадром последуют ещё
+
+#define BIN_ARG_STRING 0x01
+#define BIN_ARG_UINT8 0x02
+#define BIN_ARG_INT16 0x03
+#define BIN_ARG_INT32 0x04
+
+#define BIN_STATUS_OK 0x00 // модуль ответил OK
+#define BIN_STATUS_ERROR 0x01 // модуль ответил ER
+#define BIN_STATUS_BAD_FRAME 0x02 // неизвестная операция, неверный индекс модуля или аргументы
+
+class AbstractModule;
+
+uint8_t BinaryCRC8(uint8_t crc, uint8_t data); // обновляет контрольную сумму байтом данных
+
+// поток, собирающий ответ обработчика команды и отсылающий его кадрами
+class BinaryAnswerStream : public Stream
+{
+  private:
+    Stream* pStream; // куда пишем кадры
+    uint8_t opcode; // код операции, на которую отвечаем
+
+    char header[3]; // префикс ответа OK= или ER=
+    uint8_t headerLen;
+    bool rawData; // ответ пишется двоичными данными, без префикса и перевода строки
+    uint8_t rawStatus;
+
+    // кадр собирается целиком: 4 байта заголовка, данные и CRC8. Два последних байта данных
+    // придерживаем, чтобы отрезать завершающий перевод строки, CRC8 пишется поверх них.
+    uint8_t frame[4 + BIN_ANSWER_CHUNK_LENGTH + 2];
+    uint8_t* chunk; // данные кадра
+    uint8_t chunkLen;
+
+    uint8_t GetStatus();
+    void SendFrame(uint8_t status, uint8_t len, bool hasMore);
+
+  public:
+    BinaryAnswerStream(Stream* s, uint8_t op);
+
+    void BeginData(uint8_t status); // дальше пишутся двоичные данные ответа с переданным статусом
+    void Finish(); // отсылает последний кадр ответа
+    void Finish(uint8_t status); // отсылает ответ с переданным статусом, без данных
+
+    virtual int available(){ return false; };
+    virtual int read(){ return -1;};
+    virtual int peek(){return -1;};
+    virtual void flush(){};
+
+    virtual size_t write(uint8_t toWr);
+};
+
+// класс для накопления кадра бинарной команды из потока
+class BinaryFrameReader
+{
+  private:
+    uint8_t frame[BIN_MAX_FRAME_LENGTH + 2]; // LEN, тело кадра, CRC8
+    uint8_t received; // сколько байт кадра принято
+    bool inFrame; // флаг, что принимаем кадр
+    unsigned long lastByteTime; // когда пришёл последний байт кадра
+
+    bool ParseArgs(Command& cmd); // переводит типизированные аргументы кадра в аргументы команды
+    void ExecuteStates(AbstractModule* mod, BinaryAnswerStream& answer); // отдаёт показания датчиков модуля
+
+  public:
+    BinaryFrameReader();
+
+    bool IsReceiving(); // принимаем ли кадр (недопринятый кадр отбрасывается по таймауту)
+    bool Feed(uint8_t b); // добавляет байт, возвращает true, если кадр принят целиком и CRC совпала
+    void Reset() {inFrame = false; received = 0;}
+
+    void Execute(Stream* answerTo); // выполняет принятый кадр, ответ кадрами пишется в answerTo
+};
+
+#endif
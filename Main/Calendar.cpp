@@ -0,0 +1,110 @@
+#include "Calendar.h"
+#include "ModuleController.h"
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+
+CalendarScheduler Calendar;
+
+CalendarScheduler::CalendarScheduler()
+{
+  memset(&now,0,sizeof(now));
+  now.dayOfWeek = 1;
+  nowMinute = 0;
+  sinceRead = 0;
+  alarmsCount = 0;
+}
+void CalendarScheduler::ReadClock()
+{
+  now = MainController->GetClock().getTime();
+
+  uint8_t dow = (now.dayOfWeek >= 1 && now.dayOfWeek <= 7) ? now.dayOfWeek : 1; // с испорченным днём недели считаем, что понедельник
+  nowMinute = (dow-1)*MINUTES_IN_DAY + now.hour*60 + now.minute;
+}
+void CalendarScheduler::Begin()
+{
+  ReadClock();
+  sinceRead = 0;
+}
+int8_t CalendarScheduler::FindAlarm(CalendarListener* listener, uint8_t tag)
+{
+  for(uint8_t i=0;i<alarmsCount;i++)
+  {
+    if(alarms[i].Listener == listener && alarms[i].Tag == tag)
+      return i;
+  }
+
+  return -1;
+}
+void CalendarScheduler::RemoveAlarm(uint8_t idx)
+{
+  // порядок будильников неважен - на место удалённого ставим последний
+  alarms[idx] = alarms[--alarmsCount];
+}
+bool CalendarScheduler::SetAlarm(CalendarListener* listener, uint8_t tag, uint16_t minutesFromNow)
+{
+  if(!listener || !minutesFromNow || minutesFromNow >= MINUTES_IN_WEEK)
+    return false;
+
+  int8_t idx = FindAlarm(listener,tag);
+  if(idx < 0)
+  {
+    if(alarmsCount >= MAX_CALENDAR_ALARMS)
+      return false;
+
+    idx = alarmsCount++;
+    alarms[idx].Listener = listener;
+    alarms[idx].Tag = tag;
+  }
+
+  alarms[idx].WakeMinute = (nowMinute + minutesFromNow) % MINUTES_IN_WEEK;
+  return true;
+}
+void CalendarScheduler::CancelAlarm(CalendarListener* listener, uint8_t tag)
+{
+  int8_t idx = FindAlarm(listener,tag);
+  if(idx >= 0)
+    RemoveAlarm(idx);
+}
+uint16_t CalendarScheduler::MinutesUntil(uint16_t minuteOfDay, uint16_t nowMinuteOfDay)
+{
+  uint16_t result = (minuteOfDay + MINUTES_IN_DAY - nowMinuteOfDay % MINUTES_IN_DAY) % MINUTES_IN_DAY;
+  return result ? result : MINUTES_IN_DAY; // эта минута уже идёт - ближайшая будет через сутки
+}
+void CalendarScheduler::Update(uint16_t dt)
+{
+  sinceRead += dt;
+  if(sinceRead < CALENDAR_UPDATE_INTERVAL) // часы читаем не на каждой итерации loop
+    return;
+
+  sinceRead = 0;
+
+  uint16_t lastMinute = nowMinute;
+  ReadClock();
+
+  if(nowMinute == lastMinute)
+    return;
+
+  uint16_t step = (nowMinute + MINUTES_IN_WEEK - lastMinute) % MINUTES_IN_WEEK;
+  bool wakeAll = (step > CALENDAR_MAX_STEP); // время перевели - будим всех
+
+  // сначала снимаем наступившие будильники, потом будим подписчиков: подписчик тут же заводит следующий
+  CalendarAlarm due[MAX_CALENDAR_ALARMS];
+  uint8_t dueCount = 0;
+
+  for(uint8_t i=0;i<alarmsCount;)
+  {
+    uint16_t wait = (alarms[i].WakeMinute + MINUTES_IN_WEEK - lastMinute) % MINUTES_IN_WEEK;
+    if(wakeAll || (wait > 0 && wait <= step)) // будильник пришёлся на минуты, прошедшие с прошлого чтения
+    {
+      due[dueCount++] = alarms[i];
+      RemoveAlarm(i);
+    }
+    else
+      i++;
+  } // for
+
+  for(uint8_t i=0;i<dueCount;i++)
+    due[i].Listener->OnCalendarEvent(due[i].Tag);
+}
+
+#endif // USE_DS3231_REALTIME_CLOCK
@@ -0,0 +1,73 @@
+#ifndef _CALENDAR_H
+#define _CALENDAR_H
+
+#include <Arduino.h>
+#include "Globals.h"
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+
+#include "DS3231Support.h"
+
+/*
+ * Общий календарь. Часы реального времени читаются в одном месте, не чаще раза в CALENDAR_UPDATE_INTERVAL,
+ * модули берут уже прочитанное время. То, что работает по расписанию, заводит будильник на минуту,
+ * когда у него что-то поменяется, и до этой минуты время не проверяет.
+ * Будильник срабатывает один раз, следующий подписчик заводит сам. Если время перевели или календарь
+ * долго не обновлялся (больше CALENDAR_MAX_STEP минут), будятся все подписчики - пусть пересчитают расписание.
+ */
+
+#define MINUTES_IN_DAY 1440
+#define MINUTES_IN_WEEK 10080
+
+class CalendarListener // подписчик календаря
+{
+  public:
+    virtual void OnCalendarEvent(uint8_t tag) = 0; // наступила минута, на которую заводили будильник с этим tag
+};
+
+typedef struct
+{
+  CalendarListener* Listener;
+  uint16_t WakeMinute; // минута недели, 0 - полночь понедельника
+  uint8_t Tag;
+
+} CalendarAlarm; // будильник календаря
+
+class CalendarScheduler
+{
+  private:
+
+    DS3231Time now; // время, прочитанное с часов последний раз
+    uint16_t nowMinute; // текущая минута недели
+    uint16_t sinceRead; // сколько мс прошло с последнего чтения часов
+
+    CalendarAlarm alarms[MAX_CALENDAR_ALARMS];
+    uint8_t alarmsCount;
+
+    int8_t FindAlarm(CalendarListener* listener, uint8_t tag);
+    void RemoveAlarm(uint8_t idx);
+    void ReadClock();
+
+  public:
+    CalendarScheduler();
+
+    void Begin(); // читает часы первый раз, вызывается после настройки часов
+    void Update(uint16_t dt); // читает часы, если пора, и будит подписчиков, чья минута наступила
+    void Refresh() { sinceRead = CALENDAR_UPDATE_INTERVAL; } // перечитать часы при следующем обновлении (например, после установки времени)
+
+    const DS3231Time& GetTime() { return now; }
+    uint16_t GetMinuteOfDay() { return now.hour*60 + now.minute; }
+
+    // заводит будильник через minutesFromNow минут (от 1 до MINUTES_IN_WEEK-1), прежний будильник с тем же tag заменяется.
+    // false - если мест под будильники нет
+    bool SetAlarm(CalendarListener* listener, uint8_t tag, uint16_t minutesFromNow);
+    void CancelAlarm(CalendarListener* listener, uint8_t tag);
+
+    static uint16_t MinutesUntil(uint16_t minuteOfDay, uint16_t nowMinuteOfDay); // сколько минут до ближайшего наступления минуты суток, от 1 до MINUTES_IN_DAY
+};
+
+extern CalendarScheduler Calendar;
+
+#endif // USE_DS3231_REALTIME_CLOCK
+
+#endif
@@ -1,7 +1,11 @@
 #include "CommandBuffer.h"
 #include "Globals.h"
+#include "ModuleController.h"
 
 CommandBuffer::CommandBuffer(Stream* s) : pStream(s)
+#ifdef USE_BINARY_PROTOCOL
+, hasBinaryFrame(false)
+#endif
 {
 }
 
@@ -14,6 +18,20 @@ bool CommandBuffer::HasCommand()
     while(pStream->available())
     {
       ch = pStream->read();
+
+#ifdef USE_BINARY_PROTOCOL
+      // бинарный кадр может начаться только вместо текстовой команды, не посреди неё
+      if(binaryFrame.IsReceiving() || (!strBuff.length() && (uint8_t) ch == BIN_FRAME_START))
+      {
+        if(binaryFrame.Feed(ch))
+        {
+          hasBinaryFrame = true; // кадр принят, остальное вычитаем в следующий раз
+          return true;
+        }
+        continue;
+      }
+#endif
+
       if(ch == '\r' || ch == '\n')
       {
         return strBuff.length() > 0; // вдруг лишние управляющие символы придут в начале строки?
@@ -31,4 +49,28 @@ bool CommandBuffer::HasCommand()
     return false;
 }
 
+void CommandBuffer::ExecuteQueuedCommand()
+{
+#ifdef USE_BINARY_PROTOCOL
+  if(hasBinaryFrame)
+  {
+    // бинарная команда сама разбирается и отвечает кадрами в тот же поток
+    binaryFrame.Execute(pStream);
+    hasBinaryFrame = false;
+    return;
+  }
+#endif
+
+  Command cmd;
+  if(MainController->GetCommandParser()->ParseCommand(strBuff, cmd))
+  {
+    // разобрали, назначили поток, с которого пришла команда
+    cmd.SetIncomingStream(pStream);
+
+    // запустили команду в обработку
+    MainController->ProcessModuleCommand(cmd);
+  }
+  
+  ClearCommand(); // очищаем полученную команду
+}
 
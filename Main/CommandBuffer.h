@@ -2,21 +2,36 @@
 #define _COMMAND_BUFFER_H
 
 #include <Stream.h>
+#include "Globals.h"
+#include "CommandQueue.h"
 
-// класс для накопления команды из потока
-class CommandBuffer
+#ifdef USE_BINARY_PROTOCOL
+#include "BinaryProtocol.h"
+#endif
+
+// класс для накопления команды из потока. Накопленную команду выполняет из общей очереди команд,
+// пока команда ждёт выполнения - новые данные из потока не вычитываются.
+class CommandBuffer : public CommandSource
 {
 private:
   Stream* pStream;
   String strBuff;
+
+#ifdef USE_BINARY_PROTOCOL
+  BinaryFrameReader binaryFrame; // кадр бинарной команды, приходит в тот же поток
+  bool hasBinaryFrame;
+#endif
+
 public:
   CommandBuffer(Stream* s);
 
-  bool HasCommand();
+  bool HasCommand(); // true, если принята текстовая команда или бинарный кадр
   const String& GetCommand() {return strBuff;}
   void ClearCommand() {strBuff = "";}
   Stream* GetStream() {return pStream;}
 
+  virtual void ExecuteQueuedCommand();
+
 };
 
 #endif
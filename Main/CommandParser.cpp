@@ -1,23 +1,41 @@
 #include <Arduino.h>
 #include "CommandParser.h"
 
+// общий пул буферов команд: занятые буферы отмечены битами
+static char commandBuffers[COMMAND_BUFFERS_COUNT][MAX_COMMAND_LENGTH];
+static uint8_t commandBuffersBusy = 0;
+
 Command::Command()
 {
+  bufferSlot = 0;
+  while(bufferSlot < COMMAND_BUFFERS_COUNT && bitRead(commandBuffersBusy,bufferSlot))
+    bufferSlot++;
+
+  if(bufferSlot < COMMAND_BUFFERS_COUNT)
+  {
+    bitSet(commandBuffersBusy,bufferSlot);
+    buffer = commandBuffers[bufferSlot];
+  }
+  else // все буферы пула заняты командами, выполняющимися сейчас
+    buffer = new char[MAX_COMMAND_LENGTH];
 
   Clear();  
 }
 Command::~Command()
 {
-  Clear();
+  if(bufferSlot < COMMAND_BUFFERS_COUNT)
+    bitClear(commandBuffersBusy,bufferSlot);
+  else
+    delete[] buffer;
 }
 size_t Command::GetArgsCount() const
 { 
-  return arguments.size();
+  return argsCount;
 }
  const char* Command::GetArg(size_t idx) const
 {
-  if(idx < arguments.size())
-    return arguments[idx];
+  if(idx < argsCount)
+    return buffer + argsOffsets[idx];
 
  return NULL;
 }
@@ -30,64 +48,118 @@ void Command::Construct(const char* moduleID,const char* rawArgs, const char* ct
   Construct(moduleID,rawArgs,commandType);
  
 }
+void Command::Tokenize(const char* src, size_t writeIdx, bool firstIsModuleID)
+{
+  // копируем строку в буфер, заменяя разделители '|' на завершающие нули
+  while(*src && writeIdx < MAX_COMMAND_LENGTH)
+  {
+    if(firstIsModuleID)
+      firstIsModuleID = false; // ID модуля всегда лежит в начале буфера, его смещение не запоминаем
+    else
+    {
+      if(argsCount >= MAX_ARGS_IN_LIST) // больше аргументов не влезет
+        break;
+        
+      argsOffsets[argsCount++] = writeIdx;
+    }
+
+    while(*src && *src != '|' && writeIdx < MAX_COMMAND_LENGTH - 1)
+      buffer[writeIdx++] = *src++;
+
+    buffer[writeIdx++] = '\0';
+
+    if(*src != '|') // либо строка закончилась, либо буфер - дальше не разбираем
+      break;
+
+    src++; // за разделитель
+  } // while
+}
 void Command::Construct(const char* id, const char* rawArgs, uint8_t ct)
 {
   Clear(); // сбрасываем все настройки
   
     Type = ct;
-    ModuleID = id;
+
+    // ID модуля - в начало буфера
+    size_t writeIdx = 0;
+    while(*id && writeIdx < MAX_COMMAND_LENGTH - 1)
+      buffer[writeIdx++] = *id++;
+
+    buffer[writeIdx++] = '\0';
 
     if(!rawArgs) // нет аргументов
       return;
        
     // разбиваем на аргументы
-    const char* startPtr = rawArgs;
-    size_t len = 0;
+    Tokenize(rawArgs,writeIdx,false);
+         
+}
+void Command::Construct(const char* moduleIDAndArgs, uint8_t ct)
+{
+  Clear(); // сбрасываем все настройки
+
+  Type = ct;
+  Tokenize(moduleIDAndArgs,0,true);
+}
+void Command::Construct(const char* id, const char* packedArgs, size_t packedLength, uint8_t ct)
+{
+  Clear(); // сбрасываем все настройки
+
+  Type = ct;
+
+  size_t writeIdx = 0;
+  while(*id && writeIdx < MAX_COMMAND_LENGTH - 1)
+    buffer[writeIdx++] = *id++;
+
+  buffer[writeIdx++] = '\0';
 
-    while(*startPtr)
+  if(writeIdx + packedLength > MAX_COMMAND_LENGTH) // не влезает - берём аргументы, сколько влезет
+    packedLength = MAX_COMMAND_LENGTH - writeIdx;
+
+  // аргументы уже разделены нулями, разбирать ничего не надо - копируем и запоминаем смещения
+  memcpy(buffer + writeIdx, packedArgs, packedLength);
+
+  size_t readIdx = 0;
+  while(readIdx < packedLength && argsCount < MAX_ARGS_IN_LIST)
+  {
+    argsOffsets[argsCount++] = writeIdx + readIdx;
+    while(readIdx < packedLength && packedArgs[readIdx])
+      readIdx++;
+
+    if(readIdx >= packedLength) // последний аргумент обрезан, завершаем его сами
     {
-      const char* delimPtr = strchr(startPtr,'|');
-            
-      if(!delimPtr)
-      {
-        len = strlen(startPtr);
-        char* newArg = new char[len + 1];
-        memset(newArg,0,len+1);
-        strncpy(newArg,startPtr,len);
-        arguments.push_back(newArg);        
-
-        return;
-      } // if(!delimPtr)
-
-      size_t len = delimPtr - startPtr;
-
-     
-      char* newArg = new char[len + 1];
-      memset(newArg,0,len+1);
-      strncpy(newArg,startPtr,len);
-      arguments.push_back(newArg);
-
-
-      startPtr = delimPtr + 1;
-      
-    } // while    
-         
+      buffer[writeIdx + packedLength - 1] = '\0';
+      break;
+    }
+
+    readIdx++; // за завершающий ноль
+  } // while
+}
+bool Command::AddArg(const char* arg, size_t len)
+{
+  if(argsCount >= MAX_ARGS_IN_LIST)
+    return false;
+
+  // новый аргумент пишем сразу за завершающим нулём последнего аргумента (или ID модуля)
+  const char* last = argsCount ? buffer + argsOffsets[argsCount-1] : buffer;
+  size_t writeIdx = (last - buffer) + strlen(last) + 1;
+
+  if(writeIdx + len >= MAX_COMMAND_LENGTH)
+    return false;
+
+  argsOffsets[argsCount++] = writeIdx;
+  memcpy(buffer + writeIdx, arg, len);
+  buffer[writeIdx + len] = '\0';
+
+  return true;
 }
 void Command::Clear()
 {
   Type = ctUNKNOWN;
-  ModuleID = F("");
+  buffer[0] = '\0';
+  argsCount = 0;
   IncomingStream = NULL;
   bIsInternal = false;
-
-  size_t sz = arguments.size();
-  for(size_t i=0;i<sz;i++)
-  {
-    char* ch = arguments[i];
-    delete[] ch;
-  } // for
-  arguments.Clear();
-
 }
   
 CommandParser::CommandParser()
@@ -130,27 +202,8 @@ bool CommandParser::ParseCommand(const String& command, Command& outCommand)
   // перемещаемся за тип команды и знак '='
   readPtr += CMD_TYPE_LEN + 1;
 
-  // ищем, есть ли разделитель в строке. Если он есть, значит, передали ещё и параметры помимо просто имени модуля
-  const char* delimPtr = strchr(readPtr,'|');
-  if(!delimPtr)
-  {
-    // без параметров, тупо конструируем и выходим
-     outCommand.Construct(readPtr,NULL,commandType);
-     return true;
-  }
-
-  // есть параметры, надо выцепить имя модуля
-  size_t len = (delimPtr - readPtr);
-
-  
-  char* moduleName = new char[len+1];
-  memset(moduleName,0,len+1);
-  strncpy(moduleName,readPtr,len);
-  
-  delimPtr++;
-
-  outCommand.Construct(moduleName,delimPtr,commandType);
-  delete[] moduleName;
+  // конструируем команду прямо из строки, имя модуля идёт первым, до разделителя
+  outCommand.Construct(readPtr,commandType);
   return true;
    
 }
@@ -32,7 +32,15 @@ ctGET,
 ctSET,
 } COMMAND_TYPE; // тип команды
 
-typedef Vector<char*> CommandArgsVec;
+#if (COMMAND_BUFFERS_COUNT > 8)
+#error COMMAND BUFFERS COUNT IS LIMITED to 8 !!!
+#endif
+
+#if (MAX_COMMAND_LENGTH > 256)
+typedef uint16_t command_offset_t;
+#else
+typedef uint8_t command_offset_t;
+#endif
 
 class Command
 {
@@ -40,13 +48,21 @@ class Command
 
 
     Stream* IncomingStream; // поток, из которого пришла команда
-    CommandArgsVec arguments; // аргументы команды
+
+    // ID модуля и аргументы команды лежат в одном буфере фиксированного размера,
+    // каждый - со своим завершающим нулём. ID модуля - всегда в начале буфера.
+    // Буфер команда берёт на время жизни из общего пула (см. COMMAND_BUFFERS_COUNT), а не держит на стеке:
+    // команды выполняются одна внутри другой, и каждая копия на стеке - MAX_COMMAND_LENGTH байт.
+    char* buffer;
+    uint8_t bufferSlot; // номер буфера в пуле, COMMAND_BUFFERS_COUNT - буфер взят из кучи
+    command_offset_t argsOffsets[MAX_ARGS_IN_LIST]; // смещения аргументов в буфере
+    uint8_t argsCount; // кол-во аргументов
     
     bool bIsInternal; // флаг того, что команда получена от другого зарегистрированного модуля
     uint8_t Type; // тип команды
-    String ModuleID; // ID модуля
 
     void Clear();
+    void Tokenize(const char* src, size_t writeIdx, bool firstIsModuleID); // режет строку на аргументы прямо в буфере
 
  public:
 
@@ -61,13 +77,16 @@ class Command
     
     void Construct(const char* moduleID,const char* rawArgs, uint8_t ct); // конструирует команду из переданных аргументов
     void Construct(const char* moduleID,const char* rawArgs, const char* ct); // конструирует команду из переданных аргументов
+    void Construct(const char* moduleIDAndArgs, uint8_t ct); // конструирует команду из строки вида MODULE_ID|ARG1|ARGn
+    void Construct(const char* moduleID, const char* packedArgs, size_t packedLength, uint8_t ct); // конструирует команду из уже разобранных аргументов, каждый - со своим завершающим нулём
+    bool AddArg(const char* arg, size_t len); // добавляет аргумент в конец списка, false - если аргумент не влез
 
 
     // возвращает тип команды
     uint8_t GetType() const {return Type;}
 
     // возвращает ID программного модуля, которому адресована команда
-    String GetTargetModuleID() const {return ModuleID;}
+    const char* GetTargetModuleID() const {return buffer;}
 
     // возвращает количество переданных аргументов
     size_t GetArgsCount() const;
@@ -77,6 +96,11 @@ class Command
     
     Command();
     ~Command();
+
+  private:
+    // буфер не копируется вместе с командой
+    Command(const Command&);
+    Command& operator=(const Command&);
 };
 
 
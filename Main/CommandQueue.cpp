@@ -0,0 +1,39 @@
+#include "CommandQueue.h"
+
+CommandQueue CommandsQueue;
+
+CommandQueue::CommandQueue() : head(0), count(0)
+{
+}
+
+bool CommandQueue::Enqueue(CommandSource* src)
+{
+  if(!src)
+    return false;
+
+  if(src->queued) // уже ждёт своей очереди
+    return true;
+
+  if(count >= COMMAND_QUEUE_LENGTH) // источников больше, чем мест в очереди - увеличьте COMMAND_QUEUE_LENGTH
+    return false;
+
+  sources[(head + count) % COMMAND_QUEUE_LENGTH] = src;
+  count++;
+  src->queued = true;
+
+  return true;
+}
+
+void CommandQueue::Process(uint8_t maxCommands)
+{
+  while(maxCommands-- && count)
+  {
+    CommandSource* src = sources[head];
+    head = (head + 1) % COMMAND_QUEUE_LENGTH;
+    count--;
+
+    // снимаем флаг до выполнения - источник может сразу же встать в очередь со следующей командой
+    src->queued = false;
+    src->ExecuteQueuedCommand();
+  } // while
+}
@@ -0,0 +1,46 @@
+#ifndef _COMMAND_QUEUE_H
+#define _COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include "Globals.h"
+
+// источник команд (Serial, клиенты Wi-Fi и Ethernet, SMS, правила алертов).
+// Команду источник хранит у себя, а в очередь ставит только себя - поэтому в очереди
+// каждый источник может стоять не более одного раза, и один источник не может занять её целиком.
+class CommandSource
+{
+  friend class CommandQueue;
+
+  private:
+    bool queued; // источник стоит в очереди
+
+  public:
+    CommandSource() : queued(false) {}
+
+    bool IsQueued() {return queued;}
+
+    // выполняет очередную команду источника. Если у источника остались ещё команды - он
+    // снова ставит себя в очередь, за всеми остальными.
+    virtual void ExecuteQueuedCommand() = 0;
+};
+
+// общая очередь команд от всех источников, разбирается из loop() не более
+// COMMANDS_PER_LOOP команд за проход, чтобы всплеск запросов не забирал время у модулей
+class CommandQueue
+{
+  private:
+    CommandSource* sources[COMMAND_QUEUE_LENGTH]; // кольцевой буфер источников
+    uint8_t head; // откуда берём следующий источник
+    uint8_t count; // сколько источников в очереди
+
+  public:
+    CommandQueue();
+
+    bool Enqueue(CommandSource* src); // ставит источник в очередь, если он там уже есть - ничего не делает
+    void Process(uint8_t maxCommands); // выполняет не более maxCommands команд
+    uint8_t GetCount() {return count;}
+};
+
+extern CommandQueue CommandsQueue;
+
+#endif
@@ -57,7 +57,9 @@ void DeltaModule::OnDeltaRead(uint8_t& _sensorType, String& moduleName1,uint8_t&
  }
 
   //теперь проверяем, правильные ли индексы датчиков переданы
- if(!(ds.Module1->State.GetState(sensorType,sensorIdx1) && ds.Module2->State.GetState(sensorType,sensorIdx2)))
+ ds.State1 = ds.Module1->State.GetState(sensorType,sensorIdx1);
+ ds.State2 = ds.Module2->State.GetState(sensorType,sensorIdx2);
+ if(!(ds.State1 && ds.State2))
  {
   #ifdef _DEBUG
   Serial.println(F("One of sensors indicies is wrong!"));
@@ -71,6 +73,7 @@ void DeltaModule::OnDeltaRead(uint8_t& _sensorType, String& moduleName1,uint8_t&
  ds.SensorType = sensorType;
  ds.SensorIndex1 = sensorIdx1;
  ds.SensorIndex2 = sensorIdx2;
+ ds.Dirty = true;
 
  // теперь не забываем добавить своё внутреннее состояние, которое будет дёргать модуль ALERT, получая показания
  DeltaModule::_thisDeltaModule->State.AddState(sensorType,DeltaModule::_thisDeltaModule->deltas.size()); // индексом виртуального датчика будет размер массива, т.е. автоматически увеличиваться с каждой новой настройкой.
@@ -128,6 +131,30 @@ void DeltaModule::Setup()
   // настройка модуля тут
   isDeltasInited = false;
   settings = MainController->GetSettings();
+
+  StateChanges.Subscribe(this); // пересчитываем только дельты, показания которых изменились
+}
+void DeltaModule::OnStateChanged(OneState* state)
+{
+  size_t cnt = deltas.size();
+  for(size_t i=0;i<cnt;i++)
+  {
+    DeltaSettings* ds = &(deltas[i]);
+    if(ds->State1 == state || ds->State2 == state)
+      ds->Dirty = true;
+  }
+}
+void DeltaModule::OnStateRemoved(OneState* state)
+{
+  size_t cnt = deltas.size();
+  for(size_t i=0;i<cnt;i++)
+  {
+    DeltaSettings* ds = &(deltas[i]);
+    if(ds->State1 == state)
+      ds->State1 = NULL;
+    if(ds->State2 == state)
+      ds->State2 = NULL;
+  }
 }
 void DeltaModule::SaveDeltas()
 {
@@ -160,7 +187,10 @@ void DeltaModule::Update(uint16_t dt)
 
   lastUpdateCall += dt;
   if(lastUpdateCall < DELTA_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
+  {
+    SleepFor(DELTA_UPDATE_INTERVAL - lastUpdateCall); // до этого времени нас можно не обновлять
     return;
+  }
   else
     lastUpdateCall = 0;
   
@@ -177,10 +207,15 @@ void DeltaModule::UpdateDeltas()
     DeltaSettings* ds = &(deltas[i]);
     // получили первую настройку дельты, работаем с ней
 
+    if(!ds->Dirty) // показания датчиков не менялись, дельта та же
+      continue;
+
+    ds->Dirty = false;
+
     // получаем значения двух датчиков
 
     // первого...
-    OneState* os1 = ds->Module1->State.GetState((ModuleStates)ds->SensorType,ds->SensorIndex1);
+    OneState* os1 = ds->State1;
     #ifdef _DEBUG
     if(!os1)
     {
@@ -190,7 +225,7 @@ void DeltaModule::UpdateDeltas()
     #endif
 
     // и второго
-    OneState* os2 = ds->Module2->State.GetState((ModuleStates)ds->SensorType,ds->SensorIndex2);
+    OneState* os2 = ds->State2;
 
     #ifdef _DEBUG
     if(!os2)
@@ -328,6 +363,7 @@ bool  DeltaModule::ExecCommand(const Command& command, bool wantAnswer)
             if(wantAnswer)
             {
               PublishSingleton.Status = true;
+              PublishSingleton.BeginStream(this,command); // отдаём ответ в поток по мере формирования
               PublishSingleton = DELTA_VIEW_COMMAND;
               PublishSingleton << PARAM_DELIMITER << deltaIdx << PARAM_DELIMITER;
 
@@ -418,14 +454,18 @@ bool  DeltaModule::ExecCommand(const Command& command, bool wantAnswer)
             ds.Module1 = MainController->GetModuleByID(moduleName1);
             ds.Module2 = MainController->GetModuleByID(moduleName2);
 
+            ds.State1 = ds.Module1 ? ds.Module1->State.GetState((ModuleStates)ds.SensorType,ds.SensorIndex1) : NULL;
+            ds.State2 = ds.Module2 ? ds.Module2->State.GetState((ModuleStates)ds.SensorType,ds.SensorIndex2) : NULL;
+            ds.Dirty = true;
+
             // проверяем все параметры
             if(!ds.SensorType || // если тип датчика не задан
             !(ds.Module1 && ds.Module2) || // или один из модулей не найден
             ds.Module1 == this || ds.Module2 == this || // или любой из них ссылается на нас
             !ds.Module1->State.HasState((ModuleStates)ds.SensorType) || // или у первого нет нужного типа датчика
             !ds.Module2->State.HasState((ModuleStates)ds.SensorType) || // или у второго нет нужного типа датчика
-            !ds.Module1->State.GetState((ModuleStates)ds.SensorType,ds.SensorIndex1) || // или переданный индекс первого датчика неправильный
-            !ds.Module2->State.GetState((ModuleStates)ds.SensorType,ds.SensorIndex2) // или переданный индекс второго датчика неправильный
+            !ds.State1 || // или переданный индекс первого датчика неправильный
+            !ds.State2 // или переданный индекс второго датчика неправильный
             )
             {
               // чего-то пошло не так
@@ -12,13 +12,17 @@ typedef struct
   AbstractModule* Module2; // второй модуль, с которого мы запрашиваем показания
   uint8_t SensorIndex1; // индекс сенсора в первом модуле
   uint8_t SensorIndex2; // индекс сенсора во втором модуле
+
+  OneState* State1; // состояние первого датчика
+  OneState* State2; // состояние второго датчика
+  bool Dirty; // показания одного из датчиков изменились, дельту надо пересчитать
   
 } DeltaSettings; // настройки одной дельты
 
 typedef Vector<DeltaSettings> DeltasVector; // наш вектор с дельтами
 
 class DeltaModule; // forward declaration
-class DeltaModule : public AbstractModule // модуль регистрации дельт с показаний датчиков
+class DeltaModule : public AbstractModule, public StateChangeListener // модуль регистрации дельт с показаний датчиков
 {
   private:
 
@@ -47,6 +51,9 @@ class DeltaModule : public AbstractModule // модуль регистрации
     void Setup();
     void Update(uint16_t dt);
 
+    virtual void OnStateChanged(OneState* state); // помечает дельты, завязанные на изменившийся датчик
+    virtual void OnStateRemoved(OneState* state); // забывает удалённое состояние датчика
+
 };
 
 
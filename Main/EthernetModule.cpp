@@ -50,38 +50,36 @@ void EthernetModule::Update(uint16_t dt)
   {
     // есть активный клиент
     uint8_t sockNumber = client.getSocketNumber(); // получили номер сокета клиента
+    LanClient& lanClient = lanClients[sockNumber];
 
-    while(client.available()) // пока есть данные с клиента
+    // пока команда с этого сокета ждёт выполнения в очереди - новые данные с него не читаем
+    while(!lanClient.IsQueued() && client.available()) // пока есть данные с клиента
     {
       char c = client.read(); // читаем символ
+
+    #ifdef USE_BINARY_PROTOCOL
+      if(lanClient.frame.IsReceiving() || (!lanClient.command.length() && (uint8_t) c == BIN_FRAME_START))
+      {
+        if(lanClient.frame.Feed(c))
+        {
+          // бинарная команда принята целиком - выполним её в порядке общей очереди
+          lanClient.hasBinaryFrame = true;
+          lanClient.client = client;
+          CommandsQueue.Enqueue(&lanClient);
+          break;
+        }
+        continue;
+      }
+    #endif
       
       if(c == '\r') // этот символ нам не нужен, мы ждём '\n'
         continue;
 
       if(c == '\n') // дождались перевода строки
       {
-        // пытаемся распарсить команду
-        Command cmd;
-        CommandParser* cParser = MainController->GetCommandParser();
-
-        if(cParser->ParseCommand(clientCommands[sockNumber], cmd))
-        {
-          // команду разобрали, выполняем
-          
-          cmd.SetIncomingStream(&client); // назначаем команде поток, куда выводить данные
-
-          // запустили команду в обработку
-          MainController->ProcessModuleCommand(cmd);
-        }
-
-        // останавливаем клиента, т.к. все данные ему уже посланы.
-        // даже если команда неправильная - считаем, что раз мы
-        // получили строку, значит, имеем полное право с ней работать,
-        // и каждый ССЗБ, если пришло что-то не то.
-        client.stop();
-
-        // очищаем внутренний буфер, подготавливая его к приёму следующей команды
-        clientCommands[sockNumber] = F(""); 
+        // запоминаем клиента, чтобы ответить ему, и встаём в общую очередь команд
+        lanClient.client = client;
+        CommandsQueue.Enqueue(&lanClient);
         
         break; // выходим из цикла
         
@@ -90,7 +88,7 @@ void EthernetModule::Update(uint16_t dt)
       // если символ не '\r' и не '\n' -
       // запоминаем его во внутренний буфер, 
       // привязанный к номеру клиента
-      clientCommands[sockNumber] += c; 
+      lanClient.command += c; 
       
     } // while
 
@@ -100,6 +98,50 @@ void EthernetModule::Update(uint16_t dt)
 
 }
 
+LanClient::LanClient() : CommandSource()
+#ifdef USE_BINARY_PROTOCOL
+, hasBinaryFrame(false)
+#endif
+{
+}
+
+void LanClient::ExecuteQueuedCommand()
+{
+#ifdef USE_BINARY_PROTOCOL
+  if(hasBinaryFrame)
+  {
+    // бинарная команда сама разбирается и отвечает кадрами
+    frame.Execute(&client);
+    hasBinaryFrame = false;
+  }
+  else
+#endif
+  {
+    // пытаемся распарсить команду
+    Command cmd;
+    CommandParser* cParser = MainController->GetCommandParser();
+
+    if(cParser->ParseCommand(command, cmd))
+    {
+      // команду разобрали, выполняем
+      
+      cmd.SetIncomingStream(&client); // назначаем команде поток, куда выводить данные
+
+      // запустили команду в обработку
+      MainController->ProcessModuleCommand(cmd);
+    }
+  }
+
+  // останавливаем клиента, т.к. все данные ему уже посланы.
+  // даже если команда неправильная - считаем, что раз мы
+  // получили строку, значит, имеем полное право с ней работать,
+  // и каждый ССЗБ, если пришло что-то не то.
+  client.stop();
+
+  // очищаем внутренний буфер, подготавливая его к приёму следующей команды
+  command = F(""); 
+}
+
 bool EthernetModule::ExecCommand(const Command& command, bool wantAnswer)
 {
   UNUSED(wantAnswer);
@@ -2,15 +2,37 @@
 #define _ETHERNET_MODULE_H
 
 #include "AbstractModule.h"
+#include "CommandQueue.h"
+#include <Ethernet.h>
+
+#ifdef USE_BINARY_PROTOCOL
+#include "BinaryProtocol.h"
+#endif
 
 #define MAX_LAN_CLIENTS 4 // максимальное кол-во клиентов
 
+// клиент, привязанный к сокету W5100. Принятую команду выполняет из общей очереди команд,
+// после чего отсоединяет клиента.
+class LanClient : public CommandSource
+{
+  public:
+    EthernetClient client; // клиент, от которого пришла команда
+    String command; // команда с клиента
+#ifdef USE_BINARY_PROTOCOL
+    BinaryFrameReader frame; // бинарная команда с клиента
+    bool hasBinaryFrame;
+#endif
+
+    LanClient();
+    virtual void ExecuteQueuedCommand();
+};
+
 class EthernetModule : public AbstractModule // модуль поддержки W5100
 {
   private:
 
     bool bInited;
-    String clientCommands[MAX_LAN_CLIENTS]; // наши команды с клиентов
+    LanClient lanClients[MAX_LAN_CLIENTS]; // наши клиенты с их командами
   
   public:
     EthernetModule() : AbstractModule("LAN") {}
@@ -61,6 +61,7 @@
 #define USE_RESERVATION_MODULE // закомментировать, если не нужем модуль резервирования датчиков (когда при отсутствии показаний с одного датчика показания берутся со связанных с ним).
 // модуль резервирования нужен для работы правил, если необходимо обеспечить работу правила даже тогда, когда один из датчиков вышел из строя
 #define USE_TIMER_MODULE // закомментировать, если не нужна поддержка модуля таймеров (4 таймера)
+//#define USE_ALERT_RULES_ON_SD // раскомментировать, чтобы хранить правила алертов на SD-карте (до MAX_SD_ALERT_RULES правил), в памяти при этом держатся только правила, работающие в текущее время (не больше MAX_ALERT_RULES). Без SD-карты правила хранятся в EEPROM, как обычно.
 //--------------------------------------------------------------------------------------------------------------------------------
 // шлюзы (ИСПОЛЬЗОВАТЬ ВМЕСТЕ НЕ ДОПУСКАЕТСЯ, прошивка не скомпилируется!)
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -108,6 +109,13 @@
 //--------------------------------------------------------------------------------------------------------------------------------
 #define SERIAL_BAUD_RATE 57600 // скорость работы с портом, бод
 
+//--------------------------------------------------------------------------------------------------------------------------------
+// сборка под Linux (см. host/CMakeLists.txt): конфигурация сборки может переопределить настройки выше
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef HOST_CONFIG
+#include HOST_CONFIG
+#endif
+
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки информационных диодов и других пинов 
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -128,11 +136,20 @@
 // настройки максимумов
 //--------------------------------------------------------------------------------------------------------------------------------
 #define MAX_ALERT_RULES 30 // максимальное кол-во поддерживаемых правил
+#define ALERT_RULE_MAX_CODE_LENGTH 32 // максимальная длина байт-кода условия правила, байт (не больше 63)
+#define ALERT_RULE_STACK_DEPTH 8 // глубина стека при выполнении условия правила (не больше 8)
+#define ALERT_RULE_MAX_WATCHED_STATES ((ALERT_RULE_MAX_CODE_LENGTH + 1)/7) // за изменениями скольких датчиков следит правило: столько сравнений (7 байт с И/ИЛИ) помещается в байт-код
+#define MAX_SD_ALERT_RULES 200 // максимальное кол-во правил на SD-карте (USE_ALERT_RULES_ON_SD), на каждое правило - 5 байт оперативной памяти под индекс
+#define ALERT_RULES_SD_SLOT_SIZE 160 // сколько байт занимает одно правило в файле на SD-карте, правила длиннее не сохраняются
+#define ALERT_RULES_FILE F("RULES.DAT") // имя файла с правилами на SD-карте
+#define MAX_CALENDAR_ALARMS 4 // сколько будильников можно завести в календаре (по одному на модуль, работающий по расписанию)
 #define MAX_DELTAS 20 // максимальное кол-во дельт. Внимание: на 20 дельт нужно примерно 500 байт в EEPROM, поэтому если нужно больше 20 - смените адрес записи правил в EEPROM на бОльший!
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки интервалов обновлений модулей
 //--------------------------------------------------------------------------------------------------------------------------------
+#define CALENDAR_UPDATE_INTERVAL 1000 // как часто календарь читает часы реального времени, мс. Модули берут уже прочитанное время.
+#define CALENDAR_MAX_STEP 5 // если между чтениями часов прошло больше минут - считаем, что время перевели, и будим всех подписчиков календаря
 #define ALERT_UPDATE_INTERVAL 500 // интервал обновления состояния модуля ALERT, мс. Нужен, чтобы часто не разрешать зависимости - это ресурсоёмкая операция.
 #define LOGGING_INTERVAL 300000 // интервал логгирования, мс (300000 - каждые 5 минут и т.п.)
 #define LUMINOSITY_UPDATE_INTERVAL 3000 // через сколько мс обновлять показания с датчиков освещенности 
@@ -471,12 +488,52 @@
 //#define LOGGING_DEBUG_MODE // раскомментировать для отладочного режима (КОНФИГУРАТОР НЕ ЗАПУСКАТЬ, ТОЛЬКО МОНИТОР ПОРТА!)
 //#define LCD_DEBUG // отладочный режим LCD-модуля
 //#define ETHERNET_DEBUG // отладочный режим Ethernet-модуля
+//#define LOOP_TIMINGS_DEBUG // вывод в Serial времени обновления каждого модуля на каждой итерации loop, мкс (КОНФИГУРАТОР НЕ ЗАПУСКАТЬ, ТОЛЬКО МОНИТОР ПОРТА!)
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки максимумов
 //--------------------------------------------------------------------------------------------------------------------------------
 #define MAX_ARGS_IN_LIST 20 // максимальное кол-во аргументов у команды, передаваемой контроллеру по UART
 #define MAX_RECEIVE_BUFFER_LENGTH 256 // максимальная длина (в байтах) пакета в сети, дла защиты от спама
+#define MAX_COMMAND_LENGTH MAX_RECEIVE_BUFFER_LENGTH // размер буфера команды под ID модуля и аргументы, не влезшие аргументы отбрасываются
+#define COMMAND_BUFFERS_COUNT 2 // буферов команд в общем пуле (по MAX_COMMAND_LENGTH байт): столько команд может выполняться одна внутри другой без выделения памяти из кучи
+#define WIFI_RX_RING_SIZE 512 // приёмный буфер модуля Wi-Fi, байт: столько может придти, пока loop занят (выгребается из буфера ядра в прерывании таймера)
+#define GSM_RX_RING_SIZE 256 // приёмный буфер GSM-модема, байт
+#define WIFI_MAX_LINE_LENGTH 256 // максимальная длина строки от модуля Wi-Fi (вместе с данными пакета +IPD), длиннее - отбрасывается
+#define GSM_MAX_LINE_LENGTH 400 // максимальная длина строки от GSM-модема (PDU входящей SMS - до 360 символов), длиннее - отбрасывается
+#define COMMAND_QUEUE_LENGTH 12 // мест в общей очереди команд, не меньше, чем источников команд (Serial, клиенты Wi-Fi и Ethernet, SMS, алерты)
+#define COMMANDS_PER_LOOP 2 // сколько команд из очереди выполнять за один проход loop()
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// настройки пула состояний датчиков
+//--------------------------------------------------------------------------------------------------------------------------------
+#define STATE_POOL_UNI_RESERVE 20 // сколько мест в пуле оставить под универсальные датчики, регистрируемые на лету
+// всего мест в пуле: проводные датчики (влажность - это ещё и температура, расход воды - два показания на датчик),
+// датчик pH, температура часов, дельты и запас под универсальные датчики.
+#define STATE_POOL_SIZE (SUPPORTED_SENSORS + SUPPORTED_HUMIDITY_SENSORS*2 + LIGHT_SENSORS_COUNT + SUPPORTED_SOIL_MOISTURE_SENSORS \
+  + WATERFLOW_SENSORS_COUNT*2 + 1 + 1 + MAX_DELTAS + STATE_POOL_UNI_RESERVE)
+#if STATE_POOL_SIZE > 255
+#error STATE POOL SIZE IS LIMITED to 255 !!!
+#endif
+#define MAX_STATE_LISTENERS 4 // сколько подписчиков на изменение показаний датчиков (алерты, дельты, экран ожидания LCD или Nextion, выносной Nextion)
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// настройки профилировщика обновления модулей
+//--------------------------------------------------------------------------------------------------------------------------------
+#define USE_UPDATE_PROFILER // закомментировать, если не нужен сбор статистики времени обновления модулей (CTGET=0|PROFILE)
+#define PROFILER_MODULE_BUDGET 2000 // бюджет на одно обновление модуля, мкс. Обновления дольше - считаются превышением
+#define PROFILER_LOOP_BUDGET 10000 // бюджет на обновление всех модулей за одну итерацию loop, мкс
+//#define USE_ALERT_RULES_STATS // раскомментировать для статистики срабатывания правил алертов (CTGET=ALERT|STATS) при настройке правил.
+// На каждое правило - 24 байта оперативной памяти, при MAX_ALERT_RULES 30 - 720 байт, поэтому по умолчанию выключено
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// настройки бинарного протокола (формат кадров описан в BinaryProtocol.h)
+//--------------------------------------------------------------------------------------------------------------------------------
+#define USE_BINARY_PROTOCOL // закомментировать, если не нужен приём бинарных команд по Serial, Ethernet и Wi-Fi наравне с текстовыми CTGET/CTSET
+#define BIN_FRAME_START 0xCB // стартовый байт кадра, в текстовых командах не встречается
+#define BIN_MAX_FRAME_LENGTH 64 // максимальная длина тела входящего кадра (от кода операции до конца аргументов), байт
+#define BIN_ANSWER_CHUNK_LENGTH 64 // максимальная длина данных в одном кадре ответа, длинные ответы разбиваются на несколько кадров
+#define BIN_FRAME_TIMEOUT 500 // через сколько мс молчания недопринятый кадр отбрасывается
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // настройки модуля алертов (событий по срабатыванию каких-либо условий)
@@ -487,8 +544,10 @@
 // правило алерта CTSET=ALERT|RULE_ADD|RuleName|STATE|TEMP|1|>|23|Время начала работы|Продолжительность работы, мин|Маска дней недели|Список связанных правил|Команды для стороннего модуля
 // пример №1: CTSET=ALERT|RULE_ADD|N1|STATE|TEMP|1|>|23|0|30|127|N3,N4|CTSET=STATE|WINDOW|ALL|OPEN
 // пример №2: CTSET=ALERT|RULE_ADD|N1|STATE|TEMP|1|>|23|0|0|127|_|CTSET=STATE|WINDOW|ALL|OPEN
+// составное условие (см. RuleCode.h): CTSET=ALERT|RULE_ADD|N1|HUMIDITY|EXPR|0|_|TEMP0{20:25}&!HUMIDITY1>80|0|0|127|_|CTSET=STATE|WINDOW|ALL|OPEN
 #define ADD_RULE F("RULE_ADD") // добавить правило
-#define RULE_CNT F("RULES_CNT") // кол-во правил CTGET=ALERT|RULES_CNT
+#define RULE_CNT F("RULES_CNT") // кол-во правил CTGET=ALERT|RULES_CNT. С правилами на SD-карте ответ RULES_CNT|на_карте|в_памяти|не_поместилось_в_память
+#define RULE_SKIPPED F("RULE_SKIPPED") // в лог действий: RULE_SKIPPED|имя - правило на SD-карте работает в текущее время, но не поместилось в память
 #define RULE_VIEW F("RULE_VIEW") // просмотр правила по индексу CTGET=ALERT|RULE_VIEW|0
 #define RULE_STATE F("RULE_STATE") // включить/выключить правило по имени CTSET=ALERT|RULE_STATE|RuleName|ON, CTSET=ALERT|RULE_STATE|RuleName|OFF, CTSET=ALERT|RULE_STATE|ALL|OFF
 // получить состояние правила по индексу -  CTGET=ALERT|RULE_STATE|0
@@ -497,12 +556,17 @@
 // Специальный параметр ALL (CTSET=ALERT|RULE_DELETE|ALL) удаляет все правила.
 
 #define SAVE_RULES F("SAVE") // команда "сохранить правила", CTSET=ALERT|SAVE
+#define RULES_NO_ROOM F("NO_ROOM") // правила не помещаются в EEPROM, ответ - ER=ALERT|SAVE|NO_ROOM
+#define RULE_STATS F("STATS") // статистика правил CTGET=ALERT|STATS, ответ - OK=ALERT|STATS|имя,проверок,истинно,обновлений запрещено связанными,команд,сек. с последней сработки,ср. мкс,макс. мкс|...
+// сброс статистики - CTSET=ALERT|STATS
 #define GREATER_THAN F(">") // больше чем
 #define GREATER_OR_EQUAL_THAN F(">=") // больше либо равно
 #define LESS_THAN F("<") // меньше чем
 #define LESS_OR_EQUAL_THAN F("<=") // меньше или равно
 #define T_OPEN_MACRO F("%TO%") // макроподстановка температуры открытия из настроек
 #define T_CLOSE_MACRO F("%TC%") // макроподстановка температуры закрытия из настроек
+#define PROP_EXPR F("EXPR") // правило с составным условием, само условие - на месте значения
+#define RULE_FILTER_DELIMITER '~' // после значения условия может идти фильтр дребезга: ~дребезг:мин. время сработки:мин. время отпускания (секунд), например TEMP0{20:25}~3:60:120
 
 
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -520,6 +584,27 @@
 //#define LOG_CHANGE_TYPE_TO_IDX // раскомментировать, если нужен лог меньшего размера.
 // в этом случае в каждой строке вместо названия типа датчика подставляется его индекс в системе.
 //#define WRITE_ABSENT_SENSORS_DATA // раскомментировать, если надо писать показания датчика, даже если показаний с него нет
+//#define LOG_BINARY_FORMAT // раскомментировать, если нужен двоичный лог (файлы YYYYMMDD.BIN) - на карту пишется примерно втрое меньше.
+// в этом случае ADD_LOG_HEADER, LOG_CNANGE_NAME_TO_IDX и LOG_CHANGE_TYPE_TO_IDX не действуют: имена модулей всегда пишутся в заголовок файла,
+// а в CSV прежнего вида лог переводится на компьютере утилитой SOFT/LogConverter/logconv.c или контроллером по команде CTGET=LOG|FILE|имя|CSV.
+//#define LOG_COMPRESS_SERIES // раскомментировать вместе с LOG_BINARY_FORMAT, если показания надо писать сжатыми: только изменения с прошлого раза,
+// обычно по байту на датчик - в десятки раз меньше текстового лога. Формат описан в LogSeriesCodec.h.
+#define LOG_SERIES_MAX STATE_POOL_SIZE // сколько датчиков помещается в сжатый лог - по умолчанию все состояния пула. На каждый датчик - 7 байт оперативной памяти
+#if LOG_SERIES_MAX > 254
+#error LOG SERIES COUNT IS LIMITED to 254 !!!
+#endif
+#define USE_LOG_WRITE_BUFFER // закомментировать, если лог и файл действий надо сбрасывать на карту после каждой записи. Буфер один на оба файла - LOG_WRITE_BUFFER_SIZE байт оперативной памяти
+#define LOG_WRITE_BUFFER_SIZE 512 // размер буфера записи - сектор карты, в файл данные уходят целыми секторами
+#define LOG_FLUSH_INTERVAL 600000 // сколько мс данные могут пролежать в буфере, не попав на карту (столько данных теряется при пропадании питания)
+#define LOG_WRITE_INDEX // закомментировать, если не нужен индекс времени (файлы YYYYMMDD.IDX рядом с логом). Без индекса CTGET=LOG|RANGE читает лог с начала
+#define LOG_INDEX_STEP 60 // раз во сколько минут в индекс пишется смещение текущих данных в логе
+#define LOG_RANGE_MAX_DAYS 31 // за сколько дней максимум отдаются данные по одному запросу CTGET=LOG|RANGE
+#define LOG_RANGE_MAX_RECORDS 200 // сколько записей лога из промежутка максимум читается за один запрос CTGET=LOG|RANGE. Остальное - следующим запросом, с времени из ответа MORE
+//#define LOG_WRITE_ROLLUPS // раскомментировать, если нужны итоги по часам и суткам (мин./макс./среднее/кол-во показаний каждого датчика) в файлах logs/YYYYMMDD.HR и logs/YYYYMM.DAY
+#define LOG_ROLLUP_MAX_SENSORS STATE_POOL_SIZE // для скольких датчиков считаются итоги - по умолчанию все состояния пула. На каждый датчик - 39 байт оперативной памяти
+#if LOG_ROLLUP_MAX_SENSORS > 255
+#error LOG ROLLUP SENSORS COUNT IS LIMITED to 255 !!!
+#endif
 #define LOG_TEMP_TYPE F("RT") // тип для температуры, который запишется в файл
 #define LOG_HUMIDITY_TYPE F("RH") // тип для влажности, который запишется в файл
 #define LOG_LUMINOSITY_TYPE F("RL") // тип для освещенности, который запишется в файл
@@ -533,6 +618,13 @@
 #define FOLLOW F("FOLLOW") // ответ, что файл будет выслан следующими строками
 #define FILE_COMMAND F("FILE") // получить данные с файла
 #define ACTIONS_COMAND F("ACTION") // получить данные с файла действий
+#define SDSTAT_COMMAND F("SDSTAT") // статистика записи на карту
+#define LOG_RANGE_COMMAND F("RANGE") // получить данные лога за промежуток времени
+#define LOG_RANGE_MORE F("MORE") // CTGET=LOG|RANGE прочитал сколько мог: OK=LOG|MORE|DD.MM.YYYY HH:MM - с какого времени запросить остальное
+#define LOG_CSV_PARAM F("CSV") // CTGET=LOG|FILE|имя|CSV - отдать двоичный лог строками текстового
+#define LOG_FLUSH_COMMAND F("FLUSH") // сбросить буферы лога на карту
+#define LOG_SERIES_COMMAND F("SERIES") // таблица серий сжатого лога: CTGET=LOG|SERIES - серий,максимум,не попало в лог
+#define LOG_ROLLUPS_COMMAND F("ROLLUPS") // итоги по часам и суткам: CTGET=LOG|ROLLUPS - датчиков,максимум,не попало в итоги
 
 
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -637,6 +729,8 @@
 //--------------------------------------------------------------------------------------------------------------------------------
 #define FREERAM_COMMAND F("FREERAM") // показать кол-во свободной памяти CTGET=STAT|FREERAM
 #define UPTIME_COMMAND F("UPTIME") // показать время работы (в секундах) CTGET=STAT|UPTIME
+#define POOL_COMMAND F("POOL") // занятость пула состояний датчиков CTGET=STAT|POOL, ответ в виде POOL|занято|максимум|всего|нехватки
+#define UART_COMMAND F("UART") // статистика приёма строк от модулей Wi-Fi и GSM, CTGET=STAT|UART, ответ в виде UART|WIFI,строк,потеряно_байт,переполнений_буфера_ядра,отброшено_длинных_строк|GSM,...
 #ifdef USE_DS3231_REALTIME_CLOCK
 #define CURDATETIME_COMMAND F("DATETIME") // вывести текущую дату и время CTGET=STAT|DATETIME
 #endif
@@ -645,6 +739,8 @@
 // настройки модуля управления по SMS
 //--------------------------------------------------------------------------------------------------------------------------------
 #define STAT_COMMAND F("STAT") // получить текущую статистику по SMS, CTGET=SMS|STAT
+#define SMS_COMMANDS_QUEUE_LENGTH 3 // сколько команд и ответов на SMS может ждать выполнения, на следующие отвечаем SMS_BUSY_ANSWER
+#define SMS_BUSY_ANSWER F("Занят, повторите позже") // ответ на SMS с командой, когда очередь команд из SMS заполнена
 #define T_INDOOR F("Твн: ") // температура внутри
 #define T_OUTDOOR F("Тнар: ") // температура снаружи
 #define W_STATE F("Окна: ") // состояние окон
@@ -767,6 +863,8 @@
 #define UNI_REGISTER F("U_REG") // запрос CTSET=0|U_REG|SCRATCHPAD_DATA, регистрирует подсоединённый к линии регистрации датчик, возвращает OK=ADDED, если датчик есть, и ERR=U_NONE, если датчика на линии нет
 #define UNI_DIFFERENT_SCRATCHPAD F("SCRATCH_TYPE_ERROR") // ошибка при регистрации, разные типы скратчпада переданы
 #define UNI_RF_CHANNEL_COMMAND F("RF") // команда на получение/установку канала для nRF
+#define PROFILE_COMMAND F("PROFILE") // статистика времени обновления модулей, CTGET=0|PROFILE, сброс статистики - CTSET=0|PROFILE
+#define PROFILE_LOOP_NAME F("LOOP") // имя записи с общим временем обновления всех модулей в ответе на CTGET=0|PROFILE
 
 //--------------------------------------------------------------------------------------------------------------------------------
 #define SD_BUFFER_LENGTH 128 // размер буфера для блочного чтения с SD
@@ -774,6 +872,7 @@
 // общий буфер для команд
 //--------------------------------------------------------------------------------------------------------------------------------
 #define SHARED_BUFFER_LENGTH 200 // сколько байт резервировать для общего буфера обмена
+#define PUBLISH_STREAM_CHUNK 64 // в потоковом режиме ответа модуля - сколько байт копить перед отправкой в поток
 #define WINDOWS_STATUS_BIT 0 // номер бита статуса окон (1 - открыты, 0 - закрыты)
 #define WINDOWS_MODE_BIT 1 // номер бита режима работы окон (1 - авто, 0 - ручной)
 #define WATER_STATUS_BIT 2 // номер бита статуса полива (1 - включен, 0 - выключен)
@@ -56,7 +56,10 @@ void HumidityModule::Update(uint16_t dt)
  
   lastUpdateCall += dt;
   if(lastUpdateCall < HUMIDITY_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
+  {
+    SleepFor(HUMIDITY_UPDATE_INTERVAL - lastUpdateCall); // до этого времени нас можно не обновлять
     return;
+  }
   else
     lastUpdateCall = 0; 
 
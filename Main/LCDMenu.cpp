@@ -83,11 +83,15 @@ IdlePageMenuItem::IdlePageMenuItem() : AbstractLCDMenuItem(MONITOR_ICON,("Мон
   rotationTimer = ROTATION_INTERVAL; // получаем данные с сенсора сразу в первом вызове update
   currentSensorIndex = 0; 
   displayString = NULL;
+  displayedState = NULL;
+  displayedStateChanged = false;
 }
 void IdlePageMenuItem::init(LCDMenu* parent)
 {
   AbstractLCDMenuItem::init(parent);
   // инициализируем экран ожидания
+
+  StateChanges.Subscribe(this); // перерисовываемся, как только изменятся показания на экране
   
   // получаем данные с сенсора
   RequestSensorData(WaitScreenInfos[currentSensorIndex]);
@@ -137,14 +141,37 @@ void IdlePageMenuItem::update(uint16_t dt, LCDMenu* menu)
     menu->notifyMenuUpdated(this);
     
   } // if(rotationTimer >= ROTATION_INTERVAL)
+  else
+  if(displayedStateChanged) // показания на экране устарели, обновляем их, не дожидаясь ротации
+  {
+    RequestSensorData(WaitScreenInfos[currentSensorIndex]);
+    menu->notifyMenuUpdated(this);
+  }
 
   
+}
+void IdlePageMenuItem::OnStateChanged(OneState* state)
+{
+  if(state == displayedState)
+    displayedStateChanged = true;
+}
+void IdlePageMenuItem::OnStateRemoved(OneState* state)
+{
+  if(state != displayedState)
+    return;
+
+  // датчика на экране больше нет - переходим к следующему
+  displayedState = NULL;
+  displayedStateChanged = false;
+  rotationTimer = ROTATION_INTERVAL;
 }
 void IdlePageMenuItem::RequestSensorData(const WaitScreenInfo& info)
 {
   // обновляем показания с датчиков
   sensorData = "";
   displayString = NULL;
+  displayedState = NULL;
+  displayedStateChanged = false;
 
   if(!info.sensorType) // нечего показывать
     return;
@@ -165,6 +192,7 @@ void IdlePageMenuItem::RequestSensorData(const WaitScreenInfo& info)
   }
 
   displayString = info.displayName; // запоминаем, чего выводить на экране
+  displayedState = os;
 
 
    //Тут получаем актуальные данные от датчиков
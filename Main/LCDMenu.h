@@ -254,7 +254,7 @@ class LCDMenu; // forward declaration
     
  };
 
-class IdlePageMenuItem : public AbstractLCDMenuItem // класс экрана ожидания
+class IdlePageMenuItem : public AbstractLCDMenuItem, public StateChangeListener // класс экрана ожидания
 {
   private:
 
@@ -262,6 +262,8 @@ class IdlePageMenuItem : public AbstractLCDMenuItem // класс экрана 
     int8_t currentSensorIndex;
     String sensorData; // данные с текущего сенсора
     const char* displayString; // что писать на экране для расшифровки показаний
+    OneState* displayedState; // показания какого датчика на экране
+    bool displayedStateChanged; // показания датчика на экране изменились, надо перерисоваться
 
     void RequestSensorData(const WaitScreenInfo& info); // получаем данные с датчика
     void SelectNextSensor(); // выбираем следующий сенсор
@@ -276,6 +278,9 @@ class IdlePageMenuItem : public AbstractLCDMenuItem // класс экрана 
     }
     virtual void update(uint16_t dt, LCDMenu* menu);
     virtual void OnButtonClicked(LCDMenu* menu);
+
+    virtual void OnStateChanged(OneState* state);
+    virtual void OnStateRemoved(OneState* state);
     
 };
 #ifdef USE_TEMP_SENSORS
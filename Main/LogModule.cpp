@@ -6,9 +6,8 @@
   #define LOG_DEBUG_WRITE(s) Serial.println((s))
 #endif 
 
-#define WRITE_TO_FILE(f,str) f.write((const uint8_t*) str.c_str(),str.length())
-#define WRITE_TO_LOG(str) WRITE_TO_FILE(logFile,str)
-#define WRITE_TO_ACTION_LOG(str) WRITE_TO_FILE(actionFile,str)
+#define WRITE_TO_LOG(str) logBuffer.Write(str)
+#define WRITE_TO_ACTION_LOG(str) actionBuffer.Write(str)
 
 String LogModule::_COMMA;
 String LogModule::_NEWLINE;
@@ -26,6 +25,15 @@ void LogModule::Setup()
    #endif
 
    lastDOW = -1;
+
+#ifdef LOG_WRITE_INDEX
+   lastIndexSlot = -1;
+#endif
+
+#if defined(LOG_BINARY_FORMAT) && defined(LOG_COMPRESS_SERIES)
+   lastKeyframeSlot = -1;
+   seriesDropped = 0;
+#endif
    
 #ifdef LOG_ACTIONS_ENABLED   
    lastActionsDOW = -1;
@@ -84,10 +92,11 @@ void LogModule::CreateActionsFile(const DS3231Time& tm)
     if(logFileName.endsWith(actionFile.name())) // такой же файл
       return; 
     else
-      actionFile.close(); // закрываем старый
+      actionBuffer.Close(); // закрываем старый
   } // if
   
   actionFile = SD.open(logFileName,FILE_WRITE); // открываем файл
+  actionBuffer.Begin();
    
 }
 #endif
@@ -132,7 +141,7 @@ void LogModule::WriteAction(const LogAction& action)
   WRITE_TO_ACTION_LOG(csv(action.Message));
   WRITE_TO_ACTION_LOG(LogModule::_NEWLINE);
 
-  actionFile.flush(); // сливаем данные на диск
+  actionBuffer.Commit(); // сливаем данные на диск
 #else
   UNUSED(action);  
 #endif
@@ -156,7 +165,7 @@ void LogModule::EnsureActionsFileCreated()
     lastActionsDOW = tm.dayOfWeek;
     
     if(actionFile)
-      actionFile.close();
+      actionBuffer.Close();
       
     CreateActionsFile(tm); // создаём новый файл
   }
@@ -169,10 +178,18 @@ void LogModule::CreateNewLogFile(const DS3231Time& tm)
     return;
   
     if(logFile) // есть открытый файл
-      logFile.close(); // закрываем его
+      logBuffer.Close(); // закрываем его
+
+#ifdef LOG_WRITE_INDEX
+    lastIndexSlot = -1; // в индекс нового файла первая же порция показаний попадёт обязательно
+#endif
+
+#if defined(LOG_BINARY_FORMAT) && defined(LOG_COMPRESS_SERIES)
+    lastKeyframeSlot = -1; // новый файл (или дозапись в старый) начинается с опорного кадра
+#endif
 
    // формируем имя нашего нового лог-файла:
-   // формат YYYYMMDD.LOG
+   // формат YYYYMMDD.LOG (YYYYMMDD.BIN для двоичного лога)
 
    currentLogFileName = String(tm.year);
 
@@ -185,7 +202,11 @@ void LogModule::CreateNewLogFile(const DS3231Time& tm)
     currentLogFileName += F("0");
    currentLogFileName += String(tm.dayOfMonth);
 
+#ifdef LOG_BINARY_FORMAT
+   currentLogFileName += F(".BIN");
+#else
    currentLogFileName += F(".LOG");
+#endif
 
    String logDirectory = LOGS_DIRECTORY; // папка с логами
    if(!SD.exists(logDirectory)) // нет папки LOGS_DIRECTORY
@@ -221,7 +242,7 @@ void LogModule::CreateNewLogFile(const DS3231Time& tm)
    #ifdef LOGGING_DEBUG_MODE
     LOG_DEBUG_WRITE(String(F("File ")) + currentLogFileName + String(F(" successfully created!")));
    #endif
-    
+    logBuffer.Begin();
    }
    else
    {
@@ -232,9 +253,13 @@ void LogModule::CreateNewLogFile(const DS3231Time& tm)
    }
 
    // файл создали, можем с ним работать.
+#ifdef LOG_BINARY_FORMAT
+   WriteBinaryHeader(tm); // без заголовка двоичный лог не прочитать, поэтому пишем его всегда
+#else
 #ifdef ADD_LOG_HEADER
    TryAddFileHeader(); // пытаемся добавить заголовок в файл
 #endif   
+#endif
       
 }
 #ifdef ADD_LOG_HEADER
@@ -390,13 +415,307 @@ void LogModule::TryAddFileHeader()
     LOG_DEBUG_WRITE(F("File header written successfully!"));
    #endif
 
-   logFile.flush(); // сливаем данные на карту
+   logBuffer.Commit(); // сливаем данные на карту
    
    yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
     
   } // if(!sz) - файл пуст
 }
 #endif
+#ifdef LOG_BINARY_FORMAT
+// состояния, которые пишутся в двоичный лог - те же, что и в текстовый
+static const ModuleStates LOGGED_STATES[] = {StateTemperature, StateHumidity, StateLuminosity, StateWaterFlowIncremental, StateSoilMoisture, StatePH};
+#define LOGGED_STATES_COUNT (sizeof(LOGGED_STATES)/sizeof(LOGGED_STATES[0]))
+
+static uint8_t GetLoggedStates(AbstractModule* m) // маска состояний модуля, которые пишутся в лог
+{
+  uint8_t result = 0;
+  for(uint8_t i=0;i<LOGGED_STATES_COUNT;i++)
+  {
+    if(m->State.HasState(LOGGED_STATES[i]))
+      result |= LOGGED_STATES[i];
+  }
+  return result;
+}
+void LogModule::WriteBinaryHeader(const DS3231Time& tm)
+{
+  if(logFile.size()) // файл уже есть, заголовок в нём записан
+    return;
+
+   #ifdef LOGGING_DEBUG_MODE
+    LOG_DEBUG_WRITE(F("Adding the binary header..."));
+   #endif
+
+  size_t cnt = MainController->GetModulesCount();
+
+  // сначала считаем модули, чьи показания попадут в лог
+  uint8_t modulesLogged = 0;
+  for(size_t i=0;i<cnt;i++)
+  {
+    AbstractModule* m = MainController->GetModule(i);
+    if(m != this && GetLoggedStates(m))
+      modulesLogged++;
+  }
+
+  uint8_t header[11];
+  memcpy(header,LOG_BINARY_SIGNATURE,4);
+#ifdef LOG_COMPRESS_SERIES
+  header[4] = LOG_SERIES_VERSION;
+  header[5] = 0; // кадры - разного размера
+#else
+  header[4] = LOG_BINARY_VERSION;
+  header[5] = LOG_BINARY_RECORD_SIZE;
+#endif
+  header[6] = tm.year & 0xFF;
+  header[7] = tm.year >> 8;
+  header[8] = tm.month;
+  header[9] = tm.dayOfMonth;
+  header[10] = modulesLogged;
+  logBuffer.Write(header,sizeof(header));
+
+  // теперь таблица модулей: индекс, маска состояний, имя
+  for(size_t i=0;i<cnt;i++)
+  {
+    AbstractModule* m = MainController->GetModule(i);
+    if(m == this)
+      continue;
+
+    uint8_t states = GetLoggedStates(m);
+    if(!states)
+      continue;
+
+    const char* name = m->GetID();
+    uint8_t entry[3] = {(uint8_t) i, states, (uint8_t) strlen(name)};
+
+    logBuffer.Write(entry,sizeof(entry));
+    logBuffer.Write((const uint8_t*) name,entry[2]);
+  } // for
+
+  logBuffer.Commit(); // сливаем данные на карту
+
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+}
+void LogModule::GatherBinaryLogInfo(const DS3231Time& tm)
+{
+  if(!logFile) // что-то пошло не так
+  {
+    #ifdef LOGGING_DEBUG_MODE
+    LOG_DEBUG_WRITE(F("Current log file not open!"));
+    #endif
+    return;
+  }
+
+    #ifdef LOGGING_DEBUG_MODE
+    LOG_DEBUG_WRITE(F("Gathering sensors data..."));
+    #endif
+
+  uint8_t record[LOG_BINARY_RECORD_SIZE];
+
+  // время у всех записей одного прохода одинаковое
+  uint16_t minuteOfDay = tm.hour*60 + tm.minute;
+  record[0] = minuteOfDay & 0xFF;
+  record[1] = minuteOfDay >> 8;
+
+  size_t cnt = MainController->GetModulesCount();
+  for(size_t i=0;i<cnt;i++)
+  {
+    AbstractModule* m = MainController->GetModule(i);
+    if(m == this) // пропускаем себя
+      continue;
+
+    record[2] = i;
+
+    for(uint8_t j=0;j<LOGGED_STATES_COUNT;j++)
+    {
+      ModuleStates state = LOGGED_STATES[j];
+      uint8_t stateCnt = m->State.GetStateCount(state);
+      record[3] = state;
+
+      for(uint8_t stateIdx = 0; stateIdx < stateCnt;stateIdx++)
+      {
+        OneState* os = m->State.GetStateByOrder(state,stateIdx);
+        if(!os)
+          continue;
+
+        #ifndef WRITE_ABSENT_SENSORS_DATA
+        if(!os->HasData())
+          continue;
+        #endif
+
+        record[4] = os->GetIndex();
+
+        // показания - как они лежат в состоянии, без перевода в строку
+        unsigned long raw;
+        if(state == StateLuminosity)
+          raw = (unsigned long) os->GetLuminosity();
+        else
+        if(state == StateWaterFlowIncremental)
+          raw = os->GetWaterFlow();
+        else
+        {
+          Temperature t = os->GetTemperature();
+          raw = (uint8_t) t.Value | ((unsigned long) t.Fract << 8);
+        }
+
+        for(uint8_t k=0;k<4;k++)
+          record[5+k] = (raw >> (k*8)) & 0xFF;
+
+        logBuffer.Write(record,LOG_BINARY_RECORD_SIZE);
+      } // for
+    } // for
+  } // for
+
+  logBuffer.Commit(); // сливаем данные на карту - один раз на весь проход
+
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+
+    #ifdef LOGGING_DEBUG_MODE
+    LOG_DEBUG_WRITE(F("Sensors data gathered."));
+    #endif
+}
+#ifdef LOG_COMPRESS_SERIES
+void LogModule::GatherCompressedLogInfo(const DS3231Time& tm)
+{
+  if(!logFile) // что-то пошло не так
+  {
+    #ifdef LOGGING_DEBUG_MODE
+    LOG_DEBUG_WRITE(F("Current log file not open!"));
+    #endif
+    return;
+  }
+
+  uint16_t minuteOfDay = tm.hour*60 + tm.minute;
+
+  // в начале каждого отрезка LOG_INDEX_STEP - опорный кадр, с него можно читать лог, не читая предыдущих кадров
+  int16_t slot = minuteOfDay/LOG_INDEX_STEP;
+  bool keyframe = slot != lastKeyframeSlot;
+  if(keyframe)
+    lastKeyframeSlot = slot;
+
+  uint8_t oldCount;
+  int32_t current[LOG_SERIES_MAX];
+  bool present[LOG_SERIES_MAX];
+  uint8_t dropped;
+
+  while(true)
+  {
+    if(keyframe)
+      seriesTable.Count = 0;
+
+    // собираем текущие показания по сериям
+    oldCount = seriesTable.Count;
+    memset(present,0,sizeof(present));
+    dropped = 0;
+
+    size_t cnt = MainController->GetModulesCount();
+    for(size_t i=0;i<cnt;i++)
+    {
+      AbstractModule* m = MainController->GetModule(i);
+      if(m == this) // пропускаем себя
+        continue;
+
+      for(uint8_t j=0;j<LOGGED_STATES_COUNT;j++)
+      {
+        ModuleStates state = LOGGED_STATES[j];
+        uint8_t stateCnt = m->State.GetStateCount(state);
+
+        for(uint8_t stateIdx = 0; stateIdx < stateCnt;stateIdx++)
+        {
+          OneState* os = m->State.GetStateByOrder(state,stateIdx);
+          if(!os)
+            continue;
+
+          #ifndef WRITE_ABSENT_SENSORS_DATA
+          if(!os->HasData())
+            continue;
+          #endif
+
+          // ищем серию датчика, новый датчик - в конец таблицы
+          uint8_t idx = 0;
+          while(idx < seriesTable.Count && !(seriesTable.Series[idx].ModuleIndex == i && seriesTable.Series[idx].Type == state && seriesTable.Series[idx].SensorIndex == os->GetIndex()))
+            idx++;
+
+          if(idx == seriesTable.Count)
+          {
+            if(seriesTable.Count >= LOG_SERIES_MAX) // датчиков больше, чем помещается в таблицу
+            {
+              dropped++;
+              continue;
+            }
+
+            LogSeries& s = seriesTable.Series[seriesTable.Count++];
+            s.ModuleIndex = i;
+            s.Type = state;
+            s.SensorIndex = os->GetIndex();
+          }
+
+          // температура и подобные - в сотых долях, так соседние показания отличаются на единицы
+          if(state == StateLuminosity)
+            current[idx] = os->GetLuminosity();
+          else
+          if(state == StateWaterFlowIncremental)
+            current[idx] = os->GetWaterFlow();
+          else
+          {
+            Temperature t = os->GetTemperature();
+            current[idx] = t.Value*100L + (t.Value < 0 ? -((long) t.Fract) : t.Fract);
+          }
+
+          present[idx] = true;
+        } // for
+      } // for
+    } // for
+
+    if(!dropped || keyframe)
+      break;
+
+    // таблицу заняли датчики, которых уже нет (пропадали и появлялись с начала отрезка) -
+    // вместо кадра изменений пишем опорный, с таблицей серий заново
+    keyframe = true;
+  } // while
+
+  seriesDropped += dropped; // не поместились даже в опорный кадр - датчиков больше, чем LOG_SERIES_MAX
+
+  // пишем кадр: маркер, время, изменения известных серий, затем новые серии целиком
+  uint8_t buff[3 + LOG_VARINT_MAX_SIZE];
+  buff[0] = keyframe ? LOG_SERIES_KEYFRAME : LOG_SERIES_DELTAFRAME;
+  buff[1] = minuteOfDay & 0xFF;
+  buff[2] = minuteOfDay >> 8;
+  logBuffer.Write(buff,3);
+
+  for(uint8_t i=0;i<oldCount;i++)
+  {
+    LogSeries& s = seriesTable.Series[i];
+    uint32_t code = 0; // показаний нет
+
+    if(present[i])
+    {
+      code = LogZigZag(current[i] - s.Last) + 1;
+      s.Last = current[i];
+    }
+
+    logBuffer.Write(buff,LogPutVarint(buff,code));
+  } // for
+
+  logBuffer.Write(buff,LogPutVarint(buff,seriesTable.Count - oldCount));
+
+  for(uint8_t i=oldCount;i<seriesTable.Count;i++)
+  {
+    LogSeries& s = seriesTable.Series[i];
+    s.Last = current[i];
+
+    buff[0] = s.ModuleIndex;
+    buff[1] = s.Type;
+    buff[2] = s.SensorIndex;
+    logBuffer.Write(buff,3 + LogPutVarint(buff + 3,LogZigZag(s.Last)));
+  } // for
+
+  logBuffer.Commit(); // сливаем данные на карту - один раз на весь кадр
+
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+}
+#endif // LOG_COMPRESS_SERIES
+#endif // LOG_BINARY_FORMAT
 void LogModule::GatherLogInfo(const DS3231Time& tm)
 {
   // собираем информацию в лог
@@ -409,7 +728,7 @@ void LogModule::GatherLogInfo(const DS3231Time& tm)
     return;
   }
   
-  logFile.flush(); // сливаем информацию на карту
+  logBuffer.Commit(); // сливаем информацию на карту
   
   yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
  
@@ -558,7 +877,7 @@ void LogModule::WriteLogLine(const String& hhmm, const String& moduleName, const
   WRITE_TO_LOG(sensorIdx);        WRITE_TO_LOG(LogModule::_COMMA);
   WRITE_TO_LOG(csv(sensorData));  WRITE_TO_LOG(LogModule::_NEWLINE);
 
-  logFile.flush(); // сливаем данные на карту
+  logBuffer.Commit(); // сливаем данные на карту
 
   yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
 
@@ -590,9 +909,20 @@ String LogModule::csv(const String& src)
 }
 void LogModule::Update(uint16_t dt)
 { 
+  // данные, долго лежащие в буферах, сбрасываем на карту
+  logBuffer.Update(dt);
+  actionBuffer.Update(dt);
+
   lastUpdateCall += dt;
   if(lastUpdateCall < loggingInterval) // не надо обновлять ничего - не пришло время
+  {
+    // до этого времени нас можно не обновлять, но не дольше, чем помещается в dt, и не дольше, чем до сброса буферов
+    unsigned long sleepMs = loggingInterval - lastUpdateCall;
+    sleepMs = min(sleepMs,logBuffer.GetTimeToFlush());
+    sleepMs = min(sleepMs,actionBuffer.GetTimeToFlush());
+    SleepFor(sleepMs > 0xFFFF ? 0xFFFF : sleepMs);
     return;
+  }
   else
     lastUpdateCall = 0;
 
@@ -614,11 +944,479 @@ void LogModule::Update(uint16_t dt)
 #endif
   }
 
+#ifdef LOG_WRITE_INDEX
+  WriteIndexEntry(tm); // запоминаем, с какого места в логе начинаются показания этого времени
+#endif
+
+#ifdef LOG_BINARY_FORMAT
+#ifdef LOG_COMPRESS_SERIES
+  GatherCompressedLogInfo(tm); // собираем информацию в сжатый лог
+#else
+  GatherBinaryLogInfo(tm); // собираем информацию в двоичный лог
+#endif
+#else
   GatherLogInfo(tm); // собираем информацию в лог
+#endif
+
+#ifdef LOG_WRITE_ROLLUPS
+  rollups.Update(tm,this); // добавляем показания к итогам часа и суток
+#endif
 #endif    
   // обновление модуля тут
 
 }
+#ifdef LOG_WRITE_INDEX
+void LogModule::WriteIndexEntry(const DS3231Time& tm)
+{
+  if(!logFile)
+    return;
+
+  uint16_t minuteOfDay = tm.hour*60 + tm.minute;
+  int16_t slot = minuteOfDay/LOG_INDEX_STEP;
+  if(slot == lastIndexSlot) // в этом отрезке индекс уже писали
+    return;
+
+  // индекс лежит рядом с логом, у него меняется только расширение
+  String indexFileName = currentLogFileName.substring(0,currentLogFileName.length()-3);
+  indexFileName += F("IDX");
+
+  File indexFile = SD.open(indexFileName,FILE_WRITE);
+  if(!indexFile)
+    return;
+
+  uint32_t offset = logBuffer.GetSize(); // порция начнётся с конца лога, вместе с тем, что ещё в буфере
+  uint8_t entry[LOG_INDEX_ENTRY_SIZE];
+  entry[0] = minuteOfDay & 0xFF;
+  entry[1] = minuteOfDay >> 8;
+  for(uint8_t i=0;i<4;i++)
+    entry[2+i] = (offset >> (i*8)) & 0xFF;
+
+  indexFile.write(entry,LOG_INDEX_ENTRY_SIZE);
+  indexFile.close();
+
+  lastIndexSlot = slot;
+
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+}
+#endif
+#define LOG_LAST_MINUTE (24*60 - 1) // последняя минута суток
+
+static uint32_t LogDateKey(uint16_t year, uint8_t month, uint8_t day) // число для сравнения дат
+{
+  return ((uint32_t) year*12 + month)*31 + day;
+}
+static uint8_t LogDaysInMonth(uint16_t year, uint8_t month)
+{
+  static const uint8_t days[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+  if(month == 2 && !(year % 4) && ((year % 100) || !(year % 400)))
+    return 29;
+
+  return days[month-1];
+}
+static bool ParseRangeTime(const char* s, LogRangeTime& out) // разбирает время в формате DD.MM.YYYY HH:MM
+{
+  out.Day = atoi(s);
+
+  s = strchr(s,'.');
+  if(!s)
+    return false;
+  out.Month = atoi(++s);
+
+  s = strchr(s,'.');
+  if(!s)
+    return false;
+  out.Year = atoi(++s);
+
+  s = strchr(s,' ');
+  if(!s)
+    return false;
+  uint8_t hour = atoi(++s);
+
+  s = strchr(s,':');
+  if(!s)
+    return false;
+  uint8_t minute = atoi(++s);
+
+  if(out.Month < 1 || out.Month > 12 || out.Day < 1 || out.Day > LogDaysInMonth(out.Year,out.Month) || hour > 23 || minute > 59)
+    return false;
+
+  out.Minute = hour*60 + minute;
+  return true;
+}
+static bool IsRangeValid(const LogRangeTime& from, const LogRangeTime& to) // начало промежутка - не позже конца
+{
+  uint32_t fromDate = LogDateKey(from.Year,from.Month,from.Day);
+  uint32_t toDate = LogDateKey(to.Year,to.Month,to.Day);
+
+  return fromDate < toDate || (fromDate == toDate && from.Minute <= to.Minute);
+}
+// учитывает прочитанную запись, если она из промежутка минут. false - на этот запрос хватит. Записи одной
+// минуты отдаются целиком, поэтому останавливаемся только на первой записи следующей минуты - с неё и продолжим
+static bool LogRangeTake(LogRangeBudget& budget, uint16_t minuteOfDay, uint16_t fromMinute, uint16_t toMinute)
+{
+  if(minuteOfDay < fromMinute || minuteOfDay > toMinute)
+    return true;
+
+  if(!budget.RecordsLeft && minuteOfDay != budget.LastMinute)
+  {
+    budget.ResumeMinute = minuteOfDay;
+    return false;
+  }
+
+  if(budget.RecordsLeft)
+    budget.RecordsLeft--;
+
+  budget.LastMinute = minuteOfDay;
+  return true;
+}
+static ModuleStates LogTypeFromString(const char* s, uint8_t len) // тип датчика в записи лога или в запросе - по названию или числом
+{
+  if(len == 2)
+  {
+    if(!strncmp_P(s,(const char*) LOG_TEMP_TYPE,2)) return StateTemperature;
+    if(!strncmp_P(s,(const char*) LOG_HUMIDITY_TYPE,2)) return StateHumidity;
+    if(!strncmp_P(s,(const char*) LOG_LUMINOSITY_TYPE,2)) return StateLuminosity;
+    if(!strncmp_P(s,(const char*) LOG_WATERFLOW_TYPE,2)) return StateWaterFlowIncremental;
+    if(!strncmp_P(s,(const char*) LOG_SOIL_TYPE,2)) return StateSoilMoisture;
+    if(!strncmp_P(s,(const char*) LOG_PH_TYPE,2)) return StatePH;
+  }
+
+  switch(atoi(s))
+  {
+    case StateTemperature: return StateTemperature;
+    case StateHumidity: return StateHumidity;
+    case StateLuminosity: return StateLuminosity;
+    case StateWaterFlowIncremental: return StateWaterFlowIncremental;
+    case StateSoilMoisture: return StateSoilMoisture;
+    case StatePH: return StatePH;
+    default: return StateUnknown;
+  }
+}
+#ifdef LOG_BINARY_FORMAT
+static const __FlashStringHelper* LogTypeName(uint8_t type)
+{
+  switch(type)
+  {
+    case StateTemperature: return LOG_TEMP_TYPE;
+    case StateHumidity: return LOG_HUMIDITY_TYPE;
+    case StateLuminosity: return LOG_LUMINOSITY_TYPE;
+    case StateWaterFlowIncremental: return LOG_WATERFLOW_TYPE;
+    case StateSoilMoisture: return LOG_SOIL_TYPE;
+    default: return LOG_PH_TYPE;
+  }
+}
+typedef struct
+{
+  uint8_t Data[LOG_HEADER_NAMES_SIZE]; // подряд для каждого модуля: индекс, длина имени, имя
+  uint8_t Length;
+
+} LogHeaderNames; // имена модулей из заголовка файла - индексы модулей в записях относятся к тому запуску, когда писался файл
+
+// возвращает смещение первой записи двоичного лога, 0 - это не двоичный лог
+static uint32_t ReadBinaryHeader(File& f, uint8_t& version, LogHeaderNames& names)
+{
+  names.Length = 0;
+
+  uint8_t header[11];
+  if(!f.seek(0) || f.read(header,sizeof(header)) != sizeof(header) || memcmp(header,LOG_BINARY_SIGNATURE,4))
+    return 0;
+
+  version = header[4];
+
+  for(uint8_t i=0;i<header[10];i++)
+  {
+    uint8_t entry[3]; // индекс модуля, маска состояний, длина имени
+    if(f.read(entry,sizeof(entry)) != sizeof(entry))
+      return 0;
+
+    if(names.Length + 2 + entry[2] <= LOG_HEADER_NAMES_SIZE)
+    {
+      uint8_t* name = names.Data + names.Length;
+      name[0] = entry[0];
+      name[1] = entry[2];
+      if(f.read(name + 2,entry[2]) != entry[2])
+        return 0;
+
+      names.Length += 2 + entry[2];
+    }
+    else
+    if(!f.seek(f.position() + entry[2]))
+      return 0;
+  }
+
+  return f.position();
+}
+
+typedef struct
+{
+  Stream* Out;
+  const char* DatePrefix; // чем предварять каждую строку, NULL - ничем
+  uint16_t FromMinute;
+  uint16_t ToMinute;
+  uint8_t Type; // StateUnknown - любые датчики
+  int16_t SensorIndex; // -1 - любой индекс
+  LogRangeBudget* Budget; // сколько записей можно прочитать, NULL - читать до конца
+  const LogHeaderNames* Names; // имена модулей из заголовка файла, заполняется при чтении
+
+} LogSendFilter; // какие показания двоичного лога отдавать и куда
+
+// отдаёт показания строкой текстового лога, если они подходят под фильтр. Температура и подобные - в сотых долях
+static void LogPrintSample(const LogSendFilter& filter, uint16_t minuteOfDay, uint8_t moduleIndex, uint8_t type, uint8_t sensorIndex, long value)
+{
+  if(minuteOfDay < filter.FromMinute || minuteOfDay > filter.ToMinute)
+    return;
+
+  if((filter.Type != StateUnknown && type != filter.Type) || (filter.SensorIndex >= 0 && sensorIndex != filter.SensorIndex))
+    return;
+
+  Stream* out = filter.Out;
+  if(filter.DatePrefix)
+    out->print(filter.DatePrefix);
+
+  char buff[16];
+  sprintf_P(buff,(const char*) F("%02u:%02u,"),minuteOfDay/60,minuteOfDay%60);
+  out->print(buff);
+
+  // имя модуля - по таблице из заголовка файла, а не по нынешнему списку модулей
+  const uint8_t* name = NULL;
+  for(uint8_t i=0;filter.Names && i < filter.Names->Length;i += 2 + filter.Names->Data[i+1])
+  {
+    if(filter.Names->Data[i] == moduleIndex)
+    {
+      name = filter.Names->Data + i;
+      break;
+    }
+  }
+
+  if(name)
+    out->write(name + 2,name[1]);
+  else
+    out->print(moduleIndex);
+
+  out->print(',');
+  out->print(LogTypeName(type));
+  out->print(',');
+  out->print(sensorIndex);
+  out->print(',');
+
+  if(type == StateLuminosity)
+    out->println(value);
+  else
+  if(type == StateWaterFlowIncremental)
+    out->println((unsigned long) value);
+  else
+  {
+    // как в текстовом логе - "Value,Fract" в кавычках
+    sprintf_P(buff,(const char*) F("\"%d,%02u\""),(int) (value/100),(unsigned) (value < 0 ? -(value % 100) : value % 100));
+    out->println(buff);
+  }
+}
+static int LogFileReadByte(void* ctx)
+{
+  return ((File*) ctx)->read();
+}
+static void LogSeriesPrint(void* ctx, uint16_t minuteOfDay, const LogSeries* series, uint8_t present)
+{
+  const LogSendFilter* filter = (const LogSendFilter*) ctx;
+  if(!present || (filter->Budget && !LogRangeTake(*filter->Budget,minuteOfDay,filter->FromMinute,filter->ToMinute)))
+    return;
+
+  LogPrintSample(*filter,minuteOfDay,series->ModuleIndex,series->Type,series->SensorIndex,series->Last);
+}
+// отдаёт показания двоичного лога любой версии, начиная со смещения startOffset (0 - с начала)
+static void SendBinaryLog(File& f, uint32_t startOffset, const LogSendFilter& sendFilter)
+{
+  LogHeaderNames names;
+  LogSendFilter filter = sendFilter;
+  filter.Names = &names;
+
+  uint8_t version = 0;
+  uint32_t firstRecord = ReadBinaryHeader(f,version,names);
+  if(!firstRecord)
+    return;
+
+  if(startOffset < firstRecord)
+    startOffset = firstRecord;
+
+  f.seek(startOffset);
+  uint16_t recordsRead = 0;
+
+  if(version == LOG_SERIES_VERSION) // сжатый лог
+  {
+    LogSeriesTable table;
+    LogSeriesReset(&table);
+
+    uint16_t minuteOfDay;
+    int result;
+    while((result = LogDecodeFrame(&table,LogFileReadByte,&f,&minuteOfDay,LogSeriesPrint,(void*) &filter)) != 0)
+    {
+      if(result < 0)
+      {
+        // индекс указал не на опорный кадр (например, индекс не записался) - тогда читаем файл с начала
+        if(recordsRead || startOffset == firstRecord) // или файл испорчен
+          break;
+
+        startOffset = firstRecord;
+        f.seek(startOffset);
+        LogSeriesReset(&table);
+        continue;
+      }
+
+      if(!(++recordsRead % 8))
+        yield(); // пока читаем карту, забираем пришедшее в UART, чтобы не потерялось
+
+      if(minuteOfDay > filter.ToMinute) // кадры идут по времени, дальше - только более поздние
+        break;
+
+      if(filter.Budget && filter.Budget->ResumeMinute != LOG_RANGE_DAY_DONE) // остальное - следующим запросом
+        break;
+    } // while
+
+    return;
+  }
+
+  // записи фиксированного размера
+  uint8_t record[LOG_BINARY_RECORD_SIZE];
+  while(f.read(record,LOG_BINARY_RECORD_SIZE) == LOG_BINARY_RECORD_SIZE)
+  {
+    if(!(++recordsRead % 32))
+      yield(); // пока читаем карту, забираем пришедшее в UART, чтобы не потерялось
+
+    uint16_t minuteOfDay = record[0] | (record[1] << 8);
+    if(minuteOfDay > filter.ToMinute) // записи идут по времени, дальше - только более поздние
+      break;
+
+    if(filter.Budget && !LogRangeTake(*filter.Budget,minuteOfDay,filter.FromMinute,filter.ToMinute))
+      break;
+
+    long value;
+    if(record[3] == StateLuminosity || record[3] == StateWaterFlowIncremental)
+      value = (long) ((unsigned long) record[5] | ((unsigned long) record[6] << 8) | ((unsigned long) record[7] << 16) | ((unsigned long) record[8] << 24));
+    else
+      value = ((int8_t) record[5])*100L + (((int8_t) record[5]) < 0 ? -((long) record[6]) : record[6]);
+
+    LogPrintSample(filter,minuteOfDay,record[2],record[3],record[4],value);
+  } // while
+}
+#endif
+void LogModule::SendRangeDay(Stream* out, uint16_t year, uint8_t month, uint8_t day, uint16_t fromMinute, uint16_t toMinute, ModuleStates type, int16_t sensorIndex, LogRangeBudget& budget)
+{
+  budget.LastMinute = LOG_RANGE_DAY_DONE;
+  budget.ResumeMinute = LOG_RANGE_DAY_DONE;
+
+  // logs/YYYYMMDD, расширение - у лога и индекса своё
+  char fileName[24];
+  sprintf_P(fileName,(const char*) F("%S/%04u%02u%02u.IDX"),(const char*) LOGS_DIRECTORY,year,month,day);
+  char* ext = fileName + strlen(fileName) - 3;
+
+  // по индексу ищем последнюю порцию показаний, записанную не позже начала промежутка
+  uint32_t startOffset = 0;
+  File f = SD.open(fileName,FILE_READ);
+  if(f)
+  {
+    uint8_t entry[LOG_INDEX_ENTRY_SIZE];
+    while(f.read(entry,LOG_INDEX_ENTRY_SIZE) == LOG_INDEX_ENTRY_SIZE)
+    {
+      uint16_t minuteOfDay = entry[0] | (entry[1] << 8);
+      if(minuteOfDay > fromMinute)
+        break;
+
+      startOffset = (uint32_t) entry[2] | ((uint32_t) entry[3] << 8) | ((uint32_t) entry[4] << 16) | ((uint32_t) entry[5] << 24);
+    }
+    f.close();
+  }
+
+#ifdef LOG_BINARY_FORMAT
+  strcpy_P(ext,(const char*) F("BIN"));
+#else
+  strcpy_P(ext,(const char*) F("LOG"));
+#endif
+
+  f = SD.open(fileName,FILE_READ);
+  if(!f)
+    return;
+
+  // каждую строку ответа предваряем датой: DD.MM.YYYY,HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA
+  char datePrefix[12];
+  sprintf_P(datePrefix,(const char*) F("%02u.%02u.%04u,"),day,month,year);
+
+#ifdef LOG_BINARY_FORMAT
+
+  LogSendFilter filter = {out, datePrefix, fromMinute, toMinute, (uint8_t) type, sensorIndex, &budget, NULL};
+  SendBinaryLog(f,startOffset,filter);
+
+#else
+
+  f.seek(startOffset);
+
+  // строки лога собираем в SD_BUFFER, строки длиннее буфера пропускаем
+  uint16_t recordsRead = 0;
+  uint8_t len = 0;
+  bool tooLong = false;
+
+  while(f.available())
+  {
+    int c = f.read();
+    if(c == '\r')
+      continue;
+
+    if(c != '\n')
+    {
+      if(len < SD_BUFFER_LENGTH-1)
+        SD_BUFFER[len++] = c;
+      else
+        tooLong = true;
+
+      continue;
+    }
+
+    SD_BUFFER[len] = 0;
+    bool skip = tooLong || len < 6 || SD_BUFFER[2] != ':' || SD_BUFFER[5] != ','; // заголовок файла или испорченная строка
+    len = 0;
+    tooLong = false;
+
+    if(skip)
+      continue;
+
+    if(!(++recordsRead % 32))
+      yield(); // пока читаем карту, забираем пришедшее в UART, чтобы не потерялось
+
+    // HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA
+    uint16_t minuteOfDay = atoi(SD_BUFFER)*60 + atoi(SD_BUFFER + 3);
+    if(minuteOfDay > toMinute) // строки идут по времени, дальше - только более поздние
+      break;
+
+    if(minuteOfDay < fromMinute)
+      continue;
+
+    if(!LogRangeTake(budget,minuteOfDay,fromMinute,toMinute))
+      break;
+
+    const char* sensorType = strchr(SD_BUFFER + 6,',');
+    if(!sensorType)
+      continue;
+    sensorType++;
+
+    const char* sensorIdx = strchr(sensorType,',');
+    if(!sensorIdx)
+      continue;
+
+    if(LogTypeFromString(sensorType,sensorIdx - sensorType) != type)
+      continue;
+
+    sensorIdx++;
+    if(sensorIndex >= 0 && atoi(sensorIdx) != sensorIndex)
+      continue;
+
+    out->print(datePrefix);
+    out->println(SD_BUFFER);
+  } // while
+
+#endif
+
+  f.close();
+}
 
 bool LogModule::ExecCommand(const Command& command, bool wantAnswer)
 {
@@ -631,7 +1429,28 @@ if(hasSD)
 {
   if(command.GetType() == ctSET) 
   {
-    PublishSingleton = NOT_SUPPORTED;
+    String cmd = argsCnt > 0 ? command.GetArg(0) : String();
+    if(cmd == SDSTAT_COMMAND) // сброс статистики записи на карту
+    {
+      logBuffer.ResetStats();
+      actionBuffer.ResetStats();
+
+      PublishSingleton.Status = true;
+      PublishSingleton = SDSTAT_COMMAND;
+      PublishSingleton << PARAM_DELIMITER << REG_SUCC;
+    }
+    else
+    if(cmd == LOG_FLUSH_COMMAND) // сбросить буферы на карту, например, перед выключением питания или извлечением карты
+    {
+      logBuffer.Flush();
+      actionBuffer.Flush();
+
+      PublishSingleton.Status = true;
+      PublishSingleton = LOG_FLUSH_COMMAND;
+      PublishSingleton << PARAM_DELIMITER << REG_SUCC;
+    }
+    else
+      PublishSingleton = NOT_SUPPORTED;
   }
   else
   {
@@ -653,7 +1472,7 @@ if(hasSD)
           {
             // такой файл существует, можно отдавать
             if(logFile)
-              logFile.close(); // сперва закрываем текущий лог-файл
+              logBuffer.Close(); // сперва закрываем текущий лог-файл, с ним на карту уйдёт и буфер
 
             // теперь можно открывать файл на чтение
             File fRead = SD.open(fullFilePath,FILE_READ);
@@ -666,6 +1485,16 @@ if(hasSD)
               writeStream->print(COMMAND_DELIMITER);
               writeStream->println(FOLLOW);
 
+            #ifdef LOG_BINARY_FORMAT
+              if(argsCnt > 2 && !strcmp_P(command.GetArg(2),(const char*) LOG_CSV_PARAM))
+              {
+                // двоичный лог отдаём строками текстового лога
+                LogSendFilter filter = {writeStream, NULL, 0, LOG_LAST_MINUTE, StateUnknown, -1, NULL, NULL};
+                SendBinaryLog(fRead,0,filter);
+              }
+              else
+            #endif
+              {
               //теперь читаем из файла блоками, делая паузы для вызова yield через несколько блоков
               const int DELAY_AFTER = 2;
               int delayCntr = 0;
@@ -683,7 +1512,7 @@ if(hasSD)
                   yield(); // даём поработать другим модулям
                 }
                } // while
-              
+              }
               
               fRead.close(); // закрыли файл
               PublishSingleton.Status = true;
@@ -720,7 +1549,7 @@ if(hasSD)
           {
             // такой файл существует, можно отдавать
             if(actionFile)
-              actionFile.close(); // сперва закрываем текущий файл действий
+              actionBuffer.Close(); // сперва закрываем текущий файл действий, с ним на карту уйдёт и буфер
 
             // теперь можно открывать файл на чтение
             File fRead = SD.open(fullFilePath,FILE_READ);
@@ -772,6 +1601,103 @@ if(hasSD)
         
       } // ACTIONS_COMAND
       else
+      if(cmd == SDSTAT_COMMAND)
+      {
+        // статистика записи на карту: файл,записей,сбросов,байт,среднее время,максимальное время (мкс),байт в буфере
+        PublishSingleton.Status = true;
+        PublishSingleton = SDSTAT_COMMAND;
+        PrintSDStats(F("LOG"),logBuffer);
+        PrintSDStats(F("ACTION"),actionBuffer);
+      } // SDSTAT_COMMAND
+    #if defined(LOG_BINARY_FORMAT) && defined(LOG_COMPRESS_SERIES)
+      else
+      if(cmd == LOG_SERIES_COMMAND)
+      {
+        // серий в таблице сжатого лога,сколько помещается,сколько раз показания датчика не попали в лог
+        PublishSingleton.Status = true;
+        PublishSingleton = LOG_SERIES_COMMAND;
+        PublishSingleton << PARAM_DELIMITER << seriesTable.Count << PARAM_DELIMITER << LOG_SERIES_MAX << PARAM_DELIMITER << seriesDropped;
+      } // LOG_SERIES_COMMAND
+    #endif
+    #ifdef LOG_WRITE_ROLLUPS
+      else
+      if(cmd == LOG_ROLLUPS_COMMAND)
+      {
+        // датчиков в итогах,сколько помещается,сколько раз показания датчика не попали в итоги
+        PublishSingleton.Status = true;
+        PublishSingleton = LOG_ROLLUPS_COMMAND;
+        PublishSingleton << PARAM_DELIMITER << rollups.GetSensorsCount() << PARAM_DELIMITER << LOG_ROLLUP_MAX_SENSORS << PARAM_DELIMITER << rollups.GetDropped();
+      } // LOG_ROLLUPS_COMMAND
+    #endif
+      else
+      if(cmd == LOG_RANGE_COMMAND)
+      {
+        // CTGET=LOG|RANGE|DD.MM.YYYY HH:MM|DD.MM.YYYY HH:MM|тип[|индекс] - показания датчиков одного типа за промежуток времени
+        LogRangeTime from, to;
+        ModuleStates type = argsCnt > 3 ? LogTypeFromString(command.GetArg(3),strlen(command.GetArg(3))) : StateUnknown;
+
+        if(type == StateUnknown || !ParseRangeTime(command.GetArg(1),from) || !ParseRangeTime(command.GetArg(2),to) || !IsRangeValid(from,to))
+        {
+          PublishSingleton = PARAMS_MISSED;
+        }
+        else
+        {
+          int16_t sensorIndex = argsCnt > 4 ? atoi(command.GetArg(4)) : -1; // без индекса - все датчики этого типа
+
+          logBuffer.Flush(); // данные текущего дня должны быть на карте, файл при этом не закрываем
+
+          Stream* writeStream = command.GetIncomingStream();
+          writeStream->print(OK_ANSWER);
+          writeStream->print(COMMAND_DELIMITER);
+          writeStream->println(FOLLOW);
+
+          // идём по дням от начала промежутка до конца, каждый день - из своего файла. За один запрос
+          // читаем не больше LOG_RANGE_MAX_RECORDS записей, чтобы надолго не останавливать loop
+          uint16_t year = from.Year;
+          uint8_t month = from.Month, day = from.Day;
+          LogRangeBudget budget = {LOG_RANGE_MAX_RECORDS, LOG_RANGE_DAY_DONE, LOG_RANGE_DAY_DONE};
+
+          PublishSingleton.Status = true;
+          PublishSingleton = END_OF_FILE; // выдаём OK=END_OF_FILE
+
+          for(uint8_t daysPassed = 0; daysPassed < LOG_RANGE_MAX_DAYS; daysPassed++)
+          {
+            bool firstDay = !daysPassed;
+            bool lastDay = (year == to.Year && month == to.Month && day == to.Day);
+            uint16_t fromMinute = firstDay ? from.Minute : 0;
+
+            if(budget.RecordsLeft)
+              SendRangeDay(writeStream,year,month,day,fromMinute,lastDay ? to.Minute : LOG_LAST_MINUTE,type,sensorIndex,budget);
+            else
+              budget.ResumeMinute = fromMinute; // этот день - уже следующим запросом
+
+            if(budget.ResumeMinute != LOG_RANGE_DAY_DONE)
+            {
+              // OK=LOG|MORE|DD.MM.YYYY HH:MM - остальное запрашивается с этого времени
+              char resumeTime[20];
+              sprintf_P(resumeTime,(const char*) F("%02u.%02u.%04u %02u:%02u"),day,month,year,budget.ResumeMinute/60,budget.ResumeMinute%60);
+              PublishSingleton = LOG_RANGE_MORE;
+              PublishSingleton << PARAM_DELIMITER << resumeTime;
+              break;
+            }
+
+            if(lastDay)
+              break;
+
+            // следующий день
+            if(++day > LogDaysInMonth(year,month))
+            {
+              day = 1;
+              if(++month > 12)
+              {
+                month = 1;
+                year++;
+              }
+            }
+          } // for
+        }
+      } // LOG_RANGE_COMMAND
+      else
       {
         PublishSingleton = UNKNOWN_COMMAND;
       }
@@ -786,4 +1712,11 @@ if(hasSD)
 
   return true;
 }
+void LogModule::PrintSDStats(const __FlashStringHelper* name, LogWriteBuffer& buffer)
+{
+  const SDWriteStats& s = buffer.GetStats();
+  unsigned long calls = s.Writes + s.Flushes;
 
+  PublishSingleton << PARAM_DELIMITER << name << ',' << s.Writes << ',' << s.Flushes << ',' << s.Bytes
+  << ',' << (calls ? s.TotalTime/calls : 0UL) << ',' << s.MaxTime << ',' << buffer.GetPending();
+}
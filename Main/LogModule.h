@@ -3,6 +3,8 @@
 #include "AbstractModule.h"
 #include "Globals.h"
 #include "DS3231Support.h"
+#include "LogWriteBuffer.h"
+#include "LogRollups.h"
 #include <SD.h>
 
 typedef struct
@@ -12,6 +14,54 @@ typedef struct
   
 } LogAction; // структура с описанием действий, которые произошли 
 
+#ifdef LOG_BINARY_FORMAT
+/*
+ * Двоичный лог (LOG_BINARY_FORMAT). Все многобайтовые числа - младшим байтом вперёд.
+ * Заголовок пишется, только если файл пуст:
+ *   LOG_BINARY_SIGNATURE (4 байта), версия формата (1), размер записи (1), год (2), месяц (1), день (1),
+ *   кол-во модулей (1), затем для каждого модуля: индекс в системе (1), маска логгируемых состояний (1), длина имени (1), имя.
+ * Дальше идут записи по LOG_BINARY_RECORD_SIZE байт:
+ *   минута от начала суток (2), индекс модуля (1), тип состояния ModuleStates (1), индекс датчика (1), показания (4).
+ * Показания: для температуры, влажности, влажности почвы и pH - Value, Fract и два нуля,
+ * для освещённости - long, для расхода воды - unsigned long.
+ * Со сжатием (LOG_COMPRESS_SERIES) версия формата - LOG_SERIES_VERSION, размер записи - 0,
+ * а вместо записей идут кадры, описанные в LogSeriesCodec.h.
+ */
+#include "LogSeriesCodec.h"
+
+#define LOG_BINARY_SIGNATURE "GHLB"
+#define LOG_BINARY_VERSION 1
+#define LOG_BINARY_RECORD_SIZE 9
+#define LOG_HEADER_NAMES_SIZE 96 // сколько байт стека под имена модулей из заголовка при чтении двоичного лога. Не поместившиеся имена отдаются индексами
+#endif
+
+/*
+ * Индекс времени лога (LOG_WRITE_INDEX) - файл YYYYMMDD.IDX рядом с логом. Раз в LOG_INDEX_STEP минут,
+ * перед очередной порцией показаний, в него дописывается запись: минута от начала суток (2 байта) и
+ * смещение порции в файле лога (4 байта), младшим байтом вперёд.
+ * По индексу CTGET=LOG|RANGE начинает читать лог сразу с нужного места, а не с начала файла.
+ */
+#define LOG_INDEX_ENTRY_SIZE 6
+
+typedef struct
+{
+  uint16_t Year;
+  uint8_t Month;
+  uint8_t Day;
+  uint16_t Minute; // минута от начала суток
+
+} LogRangeTime; // граница промежутка времени для CTGET=LOG|RANGE
+
+#define LOG_RANGE_DAY_DONE 0xFFFF // день дочитан до конца промежутка
+
+typedef struct
+{
+  uint16_t RecordsLeft; // сколько ещё записей из промежутка можно прочитать за этот запрос
+  uint16_t LastMinute; // минута последней прочитанной записи
+  uint16_t ResumeMinute; // с какой минуты дня продолжать следующим запросом, LOG_RANGE_DAY_DONE - день дочитан
+
+} LogRangeBudget; // сколько работы CTGET=LOG|RANGE делает за один запрос
+
 class LogModule : public AbstractModule // модуль логгирования данных с датчиков
 {
   private:
@@ -28,6 +78,11 @@ class LogModule : public AbstractModule // модуль логгирования
   bool hasSD;
   File logFile; // текущий файл для логгирования
   File actionFile; // файл с записями о произошедших действиях
+  LogWriteBuffer logBuffer; // запись в logFile идёт через буфер
+  LogWriteBuffer actionBuffer; // запись в actionFile идёт через буфер
+#ifdef LOG_WRITE_ROLLUPS
+  LogRollups rollups; // итоги по часам и суткам
+#endif
   String currentLogFileName; // текущее имя файла, с которым мы работаем сейчас
   unsigned long loggingInterval; // интервал между логгированиями
 
@@ -39,6 +94,16 @@ class LogModule : public AbstractModule // модуль логгирования
 
   void CreateNewLogFile(const DS3231Time& tm);
   void GatherLogInfo(const DS3231Time& tm); 
+#ifdef LOG_BINARY_FORMAT
+  void WriteBinaryHeader(const DS3231Time& tm); // пишет заголовок двоичного лога, если файл пуст
+  void GatherBinaryLogInfo(const DS3231Time& tm); // пишет показания двоичными записями, без строк
+#ifdef LOG_COMPRESS_SERIES
+  LogSeriesTable seriesTable; // последние записанные показания каждого датчика
+  unsigned long seriesDropped; // сколько раз показания датчика не попали в лог - не нашлось места в таблице серий
+  int16_t lastKeyframeSlot; // за какой отрезок LOG_INDEX_STEP последний раз писали опорный кадр
+  void GatherCompressedLogInfo(const DS3231Time& tm); // пишет кадр сжатого лога
+#endif
+#endif
 #ifdef ADD_LOG_HEADER  
   void TryAddFileHeader();
 #endif  
@@ -47,9 +112,20 @@ class LogModule : public AbstractModule // модуль логгирования
 
   // HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA\r\n
   void WriteLogLine(const String& hhmm, const String& moduleName, const String& sensorType, const String& sensorIdx, const String& sensorData);
+
+  void PrintSDStats(const __FlashStringHelper* name, LogWriteBuffer& buffer); // дописывает в ответ статистику записи на карту
+
+#ifdef LOG_WRITE_INDEX
+  int16_t lastIndexSlot; // за какой отрезок LOG_INDEX_STEP последний раз писали индекс
+  void WriteIndexEntry(const DS3231Time& tm); // пишет в индекс смещение порции показаний, если начался новый отрезок
+#endif
+
+  // отдаёт в поток показания за один день, попадающие в промежуток минут, пока не кончится budget.
+  // Если кончился - в budget.ResumeMinute минута, с которой читать дальше
+  void SendRangeDay(Stream* out, uint16_t year, uint8_t month, uint8_t day, uint16_t fromMinute, uint16_t toMinute, ModuleStates type, int16_t sensorIndex, LogRangeBudget& budget);
   
   public:
-    LogModule() : AbstractModule("LOG") {}
+    LogModule() : AbstractModule("LOG"), logBuffer(logFile), actionBuffer(actionFile) {}
 
     bool ExecCommand(const Command& command, bool wantAnswer);
     void Setup();
@@ -0,0 +1,196 @@
+#include "LogRollups.h"
+
+#ifdef LOG_WRITE_ROLLUPS
+
+#include "ModuleController.h"
+#include <SD.h>
+
+// состояния, по которым считаются итоги - те же, что пишутся в лог
+static const ModuleStates ROLLUP_STATES[] = {StateTemperature, StateHumidity, StateLuminosity, StateWaterFlowIncremental, StateSoilMoisture, StatePH};
+#define ROLLUP_STATES_COUNT (sizeof(ROLLUP_STATES)/sizeof(ROLLUP_STATES[0]))
+
+LogRollups::LogRollups()
+{
+  sensorsCount = 0;
+  dropped = 0;
+  hour = -1;
+}
+RollupSensor* LogRollups::GetSensor(uint8_t moduleIndex, uint8_t type, uint8_t sensorIndex)
+{
+  for(uint8_t i=0;i<sensorsCount;i++)
+  {
+    RollupSensor& s = sensors[i];
+    if(s.ModuleIndex == moduleIndex && s.Type == type && s.SensorIndex == sensorIndex)
+      return &s;
+  }
+
+  RollupSensor* s = NULL;
+  if(sensorsCount < LOG_ROLLUP_MAX_SENSORS)
+    s = &(sensors[sensorsCount++]);
+  else
+  {
+    // места нет - занимаем место датчика, у которого за эти сутки нет показаний (его уже нет в системе)
+    for(uint8_t i=0;i<sensorsCount;i++)
+    {
+      if(!sensors[i].Hour.Count && !sensors[i].Day.Count)
+      {
+        s = &(sensors[i]);
+        break;
+      }
+    }
+  }
+
+  if(!s) // датчиков больше, чем мест под итоги
+  {
+    dropped++;
+    return NULL;
+  }
+
+  memset(s,0,sizeof(RollupSensor));
+  s->ModuleIndex = moduleIndex;
+  s->Type = type;
+  s->SensorIndex = sensorIndex;
+
+  return s;
+}
+void LogRollups::AddSample(RollupStats& stats, long value)
+{
+  if(!stats.Count || value < stats.Min)
+    stats.Min = value;
+
+  if(!stats.Count || value > stats.Max)
+    stats.Max = value;
+
+  stats.Sum += value;
+  stats.Count++;
+}
+char* LogRollups::PrintValue(char* out, uint8_t type, long value)
+{
+  switch(type)
+  {
+    case StateLuminosity:
+    case StateWaterFlowIncremental:
+      return out + sprintf_P(out,(const char*) F(",%ld"),value);
+
+    default: // сотые доли, печатаем как в логе
+      return out + sprintf_P(out,(const char*) F(",\"%d,%02u\""),(int) (value/100),(unsigned) (value < 0 ? -(value % 100) : value % 100));
+  }
+}
+void LogRollups::WritePeriod(bool daily)
+{
+  // logs/YYYYMMDD.HR или logs/YYYYMM.DAY
+  char fileName[20];
+  if(daily)
+    sprintf_P(fileName,(const char*) F("%S/%04u%02u.DAY"),(const char*) LOGS_DIRECTORY,year,month);
+  else
+    sprintf_P(fileName,(const char*) F("%S/%04u%02u%02u.HR"),(const char*) LOGS_DIRECTORY,year,month,day);
+
+  File f = SD.open(fileName,FILE_WRITE);
+
+  for(uint8_t i=0;i<sensorsCount;i++)
+  {
+    RollupSensor& s = sensors[i];
+    RollupStats& stats = daily ? s.Day : s.Hour;
+
+    if(f && stats.Count)
+    {
+      AbstractModule* m = MainController->GetModule(s.ModuleIndex);
+
+      char* out = SD_BUFFER;
+      out += sprintf_P(out,(const char*) F("%02u.%02u.%04u"),day,month,year);
+      if(!daily)
+        out += sprintf_P(out,(const char*) F(" %02u:00"),hour);
+
+      out += sprintf_P(out,(const char*) F(",%s,"),m ? m->GetID() : "");
+
+      // тип датчика - как в логе
+      switch(s.Type)
+      {
+        case StateTemperature: strcpy_P(out,(const char*) LOG_TEMP_TYPE); break;
+        case StateHumidity: strcpy_P(out,(const char*) LOG_HUMIDITY_TYPE); break;
+        case StateLuminosity: strcpy_P(out,(const char*) LOG_LUMINOSITY_TYPE); break;
+        case StateWaterFlowIncremental: strcpy_P(out,(const char*) LOG_WATERFLOW_TYPE); break;
+        case StateSoilMoisture: strcpy_P(out,(const char*) LOG_SOIL_TYPE); break;
+        default: strcpy_P(out,(const char*) LOG_PH_TYPE); break;
+      }
+      out += strlen(out);
+
+      out += sprintf_P(out,(const char*) F(",%u"),s.SensorIndex);
+      out = PrintValue(out,s.Type,stats.Min);
+      out = PrintValue(out,s.Type,stats.Max);
+      out = PrintValue(out,s.Type,(long) (stats.Sum/stats.Count));
+      out += sprintf_P(out,(const char*) F(",%u\r\n"),stats.Count);
+
+      f.write((const uint8_t*) SD_BUFFER,out - SD_BUFFER);
+    }
+
+    memset(&stats,0,sizeof(RollupStats));
+  } // for
+
+  if(f)
+    f.close();
+
+  yield(); // т.к. запись на SD-карту у нас может занимать какое-то время - дёргаем кооперативный режим
+}
+void LogRollups::Update(const DS3231Time& tm, AbstractModule* logModule)
+{
+  if(hour != -1)
+  {
+    bool dayChanged = tm.dayOfMonth != day || tm.month != month || tm.year != year;
+
+    if(dayChanged || tm.hour != hour) // час закончился - пишем его итоги
+      WritePeriod(false);
+
+    if(dayChanged) // и сутки тоже
+      WritePeriod(true);
+  }
+
+  year = tm.year;
+  month = tm.month;
+  day = tm.dayOfMonth;
+  hour = tm.hour;
+
+  size_t cnt = MainController->GetModulesCount();
+  for(size_t i=0;i<cnt;i++)
+  {
+    AbstractModule* m = MainController->GetModule(i);
+    if(m == logModule)
+      continue;
+
+    for(uint8_t j=0;j<ROLLUP_STATES_COUNT;j++)
+    {
+      ModuleStates state = ROLLUP_STATES[j];
+      uint8_t stateCnt = m->State.GetStateCount(state);
+
+      for(uint8_t stateIdx = 0; stateIdx < stateCnt;stateIdx++)
+      {
+        OneState* os = m->State.GetStateByOrder(state,stateIdx);
+        if(!os || !os->HasData()) // нет показаний - в итоги не идут
+          continue;
+
+        RollupSensor* s = GetSensor(i,state,os->GetIndex());
+        if(!s)
+          continue;
+
+        long value;
+        if(state == StateLuminosity)
+          value = os->GetLuminosity();
+        else
+        if(state == StateWaterFlowIncremental)
+          value = (long) os->GetWaterFlow();
+        else
+        {
+          // в сотых долях, чтобы не терять точность при усреднении
+          Temperature t = os->GetTemperature();
+          value = t.Value*100L;
+          value += t.Value < 0 ? -((long) t.Fract) : t.Fract;
+        }
+
+        AddSample(s->Hour,value);
+        AddSample(s->Day,value);
+      } // for
+    } // for
+  } // for
+}
+
+#endif // LOG_WRITE_ROLLUPS
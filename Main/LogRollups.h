@@ -0,0 +1,73 @@
+#ifndef _LOG_ROLLUPS_H
+#define _LOG_ROLLUPS_H
+
+#include <Arduino.h>
+#include "Globals.h"
+
+#ifdef LOG_WRITE_ROLLUPS
+
+#include "AbstractModule.h"
+#include "DS3231Support.h"
+
+/*
+ * Итоги показаний по часам и суткам. На каждом проходе логгирования показания всех датчиков,
+ * которые пишутся в лог, добавляются к текущим итогам часа и суток. Когда час (сутки) сменился,
+ * итоги за прошедший час дописываются в файл logs/YYYYMMDD.HR, за прошедшие сутки - в logs/YYYYMM.DAY.
+ * Строка итогов:
+ *   DD.MM.YYYY HH:00,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,MIN,MAX,AVG,COUNT  - часовые итоги
+ *   DD.MM.YYYY,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,MIN,MAX,AVG,COUNT        - суточные итоги
+ * Значения - в том же виде, что и в логе (температура и подобные - "градусы,сотые" в кавычках).
+ * Итоги недописанного часа и суток при перезагрузке теряются.
+ */
+
+typedef struct
+{
+  long Min;
+  long Max;
+  int64_t Sum; // сумма показаний, за сутки расход воды в long не помещается
+  uint16_t Count; // сколько показаний учтено, 0 - показаний не было
+
+} RollupStats; // итоги за период
+
+typedef struct
+{
+  uint8_t ModuleIndex; // индекс модуля в системе
+  uint8_t Type; // ModuleStates
+  uint8_t SensorIndex;
+
+  RollupStats Hour;
+  RollupStats Day;
+
+} RollupSensor; // итоги одного датчика
+
+class LogRollups
+{
+  private:
+
+    RollupSensor sensors[LOG_ROLLUP_MAX_SENSORS];
+    uint8_t sensorsCount;
+    unsigned long dropped; // сколько раз показания датчика не попали в итоги - не нашлось места
+
+    // за какой час копятся итоги
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    int8_t hour; // -1 - итоги ещё не копились
+
+    RollupSensor* GetSensor(uint8_t moduleIndex, uint8_t type, uint8_t sensorIndex); // ищет датчик, при необходимости - добавляет
+    void AddSample(RollupStats& stats, long value);
+    void WritePeriod(bool daily); // дописывает итоги в файл и обнуляет их
+    char* PrintValue(char* out, uint8_t type, long value);
+
+  public:
+    LogRollups();
+
+    void Update(const DS3231Time& tm, AbstractModule* logModule); // добавляет показания датчиков всех модулей, кроме модуля логгирования
+
+    uint8_t GetSensorsCount() {return sensorsCount;}
+    unsigned long GetDropped() {return dropped;}
+};
+
+#endif // LOG_WRITE_ROLLUPS
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef _LOG_SERIES_CODEC_H
+#define _LOG_SERIES_CODEC_H
+
+/*
+ * Сжатый двоичный лог (LOG_BINARY_FORMAT вместе с LOG_COMPRESS_SERIES, версия формата 2).
+ * Файл без Arduino-зависимостей: его же подключает утилита SOFT/LogConverter на компьютере.
+ *
+ * После заголовка файла (см. LogModule.h) идут кадры, по кадру на проход логгирования:
+ *   маркер (1)       - LOG_SERIES_KEYFRAME или LOG_SERIES_DELTAFRAME
+ *   минута суток (2) - младшим байтом вперёд
+ *   коды серий       - только в обычном кадре: по varint на каждую известную серию, в порядке таблицы серий:
+ *                      0 - показаний нет, иначе zigzag(изменение показаний с прошлого раза) + 1
+ *   кол-во новых серий (varint), для каждой: индекс модуля (1), тип состояния (1), индекс датчика (1), zigzag(показания) (varint)
+ * Серия - показания одного датчика. Опорный кадр (keyframe) начинает таблицу серий заново, поэтому с него
+ * можно читать файл, не читая предыдущих кадров. Контроллер пишет опорный кадр в начале каждого отрезка
+ * LOG_INDEX_STEP минут - индекс времени лога указывает на них.
+ * Показания температуры, влажности, влажности почвы и pH хранятся в сотых долях, остальные - как есть.
+ * Показания одного кадра отдаются в порядке таблицы серий: датчик, у которого не было показаний в опорном кадре,
+ * попадает в конец таблицы, поэтому внутри прохода строки могут идти не в том порядке, что в текстовом логе.
+ * varint - 7 бит на байт, младшие первыми, старший бит - "дальше есть ещё байт".
+ */
+
+#include <stdint.h>
+
+#define LOG_SERIES_KEYFRAME 0xFF
+#define LOG_SERIES_DELTAFRAME 0xFE
+#define LOG_SERIES_VERSION 2
+
+#ifndef LOG_SERIES_MAX
+#define LOG_SERIES_MAX 24 // сколько серий помещается в таблицу
+#endif
+
+#define LOG_VARINT_MAX_SIZE 5 // байт на varint из 32 бит
+
+typedef struct
+{
+  uint8_t ModuleIndex;
+  uint8_t Type; // ModuleStates
+  uint8_t SensorIndex;
+  int32_t Last; // последние записанные (прочитанные) показания
+
+} LogSeries; // серия показаний одного датчика
+
+typedef struct
+{
+  LogSeries Series[LOG_SERIES_MAX];
+  uint8_t Count;
+
+} LogSeriesTable;
+
+static inline uint32_t LogZigZag(int32_t v) // маленькие по модулю числа - в маленькие беззнаковые
+{
+  return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31);
+}
+static inline int32_t LogUnZigZag(uint32_t v)
+{
+  return (int32_t) (v >> 1) ^ -(int32_t) (v & 1);
+}
+static inline uint8_t LogPutVarint(uint8_t* out, uint32_t v) // возвращает кол-во записанных байт
+{
+  uint8_t len = 0;
+  while(v >= 0x80)
+  {
+    out[len++] = (uint8_t) (v | 0x80);
+    v >>= 7;
+  }
+  out[len++] = (uint8_t) v;
+  return len;
+}
+
+typedef int (*LogReadByte)(void* ctx); // читает байт, -1 - данные кончились
+
+static inline int LogGetVarint(LogReadByte readByte, void* ctx, uint32_t* v) // 0 - данные кончились посреди числа
+{
+  uint32_t result = 0;
+  uint8_t shift;
+  for(shift = 0; shift < 35; shift += 7)
+  {
+    int b = readByte(ctx);
+    if(b < 0)
+      return 0;
+
+    result |= (uint32_t) (b & 0x7F) << shift;
+    if(!(b & 0x80))
+    {
+      *v = result;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// получает показания серии из прочитанного кадра, present == 0 - в этом кадре показаний серии нет
+typedef void (*LogSampleSink)(void* ctx, uint16_t minuteOfDay, const LogSeries* series, uint8_t present);
+
+/*
+ * Читает один кадр и отдаёт показания всех его серий в sink.
+ * Возвращает 1 - кадр прочитан, 0 - файл кончился, -1 - данные испорчены или чтение началось не с опорного кадра.
+ */
+static inline int LogDecodeFrame(LogSeriesTable* table, LogReadByte readByte, void* ctx, uint16_t* minuteOfDay, LogSampleSink sink, void* sinkCtx)
+{
+  uint8_t i, oldCount;
+  uint32_t v, newCount;
+  int lo, hi;
+
+  int marker = readByte(ctx);
+  if(marker < 0)
+    return 0;
+
+  if(marker == LOG_SERIES_KEYFRAME)
+    table->Count = 0;
+  else
+  if(marker != LOG_SERIES_DELTAFRAME || table->Count == 0xFF) // 0xFF - таблицы ещё нет, опорного кадра не было
+    return -1;
+
+  lo = readByte(ctx);
+  hi = readByte(ctx);
+  if(lo < 0 || hi < 0)
+    return -1;
+
+  *minuteOfDay = (uint16_t) (lo | (hi << 8));
+
+  oldCount = table->Count;
+  for(i=0;i<oldCount;i++)
+  {
+    LogSeries* s = &(table->Series[i]);
+    if(!LogGetVarint(readByte,ctx,&v))
+      return -1;
+
+    if(v)
+      s->Last += LogUnZigZag(v - 1);
+
+    sink(sinkCtx,*minuteOfDay,s,v ? 1 : 0);
+  }
+
+  if(!LogGetVarint(readByte,ctx,&newCount) || newCount > (uint32_t) (LOG_SERIES_MAX - oldCount))
+    return -1;
+
+  for(i=0;i<newCount;i++)
+  {
+    LogSeries* s = &(table->Series[table->Count]);
+    int m = readByte(ctx), t = readByte(ctx), idx = readByte(ctx);
+    if(m < 0 || t < 0 || idx < 0 || !LogGetVarint(readByte,ctx,&v))
+      return -1;
+
+    s->ModuleIndex = (uint8_t) m;
+    s->Type = (uint8_t) t;
+    s->SensorIndex = (uint8_t) idx;
+    s->Last = LogUnZigZag(v);
+    table->Count++;
+
+    sink(sinkCtx,*minuteOfDay,s,1);
+  }
+
+  return 1;
+}
+
+static inline void LogSeriesReset(LogSeriesTable* table) // перед чтением файла: пока не встретится опорный кадр, читать нечего
+{
+  table->Count = 0xFF;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#include "LogWriteBuffer.h"
+
+#ifdef USE_LOG_WRITE_BUFFER
+uint8_t LogWriteBuffer::buffer[LOG_WRITE_BUFFER_SIZE];
+LogWriteBuffer* LogWriteBuffer::owner = NULL;
+#endif
+
+LogWriteBuffer::LogWriteBuffer(File& f) : file(f)
+{
+  ResetStats();
+
+#ifdef USE_LOG_WRITE_BUFFER
+  used = 0;
+  capacity = LOG_WRITE_BUFFER_SIZE;
+  unsynced = false;
+  dirtyTime = 0;
+#endif
+}
+void LogWriteBuffer::ResetStats()
+{
+  memset(&stats,0,sizeof(stats));
+}
+void LogWriteBuffer::Account(unsigned long startTime)
+{
+  unsigned long elapsed = micros() - startTime;
+  stats.TotalTime += elapsed;
+  if(elapsed > stats.MaxTime)
+    stats.MaxTime = elapsed;
+}
+void LogWriteBuffer::FileWrite(const uint8_t* data, size_t len)
+{
+  unsigned long startTime = micros();
+  file.write(data,len);
+  Account(startTime);
+
+  stats.Writes++;
+  stats.Bytes += len;
+}
+void LogWriteBuffer::FileFlush()
+{
+  unsigned long startTime = micros();
+  file.flush();
+  Account(startTime);
+
+  stats.Flushes++;
+}
+void LogWriteBuffer::Begin()
+{
+#ifdef USE_LOG_WRITE_BUFFER
+  used = 0;
+  unsynced = false;
+  dirtyTime = 0;
+
+  // дописываем в конец файла, первая порция - только до границы сектора, дальше - целыми секторами
+  capacity = LOG_WRITE_BUFFER_SIZE - (file.size() % LOG_WRITE_BUFFER_SIZE);
+#endif
+}
+void LogWriteBuffer::Write(const uint8_t* data, size_t len)
+{
+  if(!file)
+    return;
+
+#ifdef USE_LOG_WRITE_BUFFER
+  if(owner != this) // в буфере данные другого файла - пусть сперва заберёт их
+  {
+    if(owner)
+      owner->Spill();
+    owner = this;
+  }
+
+  while(len)
+  {
+    uint16_t toCopy = capacity - used;
+    if(toCopy > len)
+      toCopy = len;
+
+    memcpy(buffer + used,data,toCopy);
+    used += toCopy;
+    data += toCopy;
+    len -= toCopy;
+
+    if(used == capacity) // сектор набрали - отдаём его в файл целиком, размер файла обновится при сбросе
+    {
+      FileWrite(buffer,used);
+      used = 0;
+      capacity = LOG_WRITE_BUFFER_SIZE;
+      unsynced = true;
+    }
+  } // while
+#else
+  FileWrite(data,len);
+#endif
+}
+void LogWriteBuffer::Commit()
+{
+#ifndef USE_LOG_WRITE_BUFFER
+  Flush();
+#endif
+}
+void LogWriteBuffer::Flush()
+{
+  if(!file)
+    return;
+
+#ifdef USE_LOG_WRITE_BUFFER
+  Spill();
+
+  if(!unsynced)
+    return;
+
+  unsynced = false;
+  dirtyTime = 0;
+#endif
+
+  FileFlush();
+}
+#ifdef USE_LOG_WRITE_BUFFER
+void LogWriteBuffer::Spill()
+{
+  if(!used)
+    return;
+
+  FileWrite(buffer,used);
+  capacity -= used; // до границы сектора осталось меньше
+  if(!capacity)
+    capacity = LOG_WRITE_BUFFER_SIZE;
+
+  used = 0;
+  unsynced = true;
+}
+#endif
+void LogWriteBuffer::Close()
+{
+  if(!file)
+    return;
+
+  Flush();
+  file.close();
+}
+void LogWriteBuffer::Update(uint16_t dt)
+{
+#ifdef USE_LOG_WRITE_BUFFER
+  if(!used && !unsynced)
+    return;
+
+  dirtyTime += dt;
+  if(dirtyTime >= LOG_FLUSH_INTERVAL) // данные лежат слишком долго
+    Flush();
+#else
+  UNUSED(dt);
+#endif
+}
+unsigned long LogWriteBuffer::GetTimeToFlush()
+{
+#ifdef USE_LOG_WRITE_BUFFER
+  if(!used && !unsynced)
+    return 0xFFFFFFFF;
+
+  return dirtyTime >= LOG_FLUSH_INTERVAL ? 0 : LOG_FLUSH_INTERVAL - dirtyTime;
+#else
+  return 0xFFFFFFFF;
+#endif
+}
+uint32_t LogWriteBuffer::GetSize()
+{
+  if(!file)
+    return 0;
+
+  return file.size() + GetPending();
+}
+uint16_t LogWriteBuffer::GetPending()
+{
+#ifdef USE_LOG_WRITE_BUFFER
+  return used;
+#else
+  return 0;
+#endif
+}
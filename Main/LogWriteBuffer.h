@@ -0,0 +1,72 @@
+#ifndef _LOG_WRITE_BUFFER_H
+#define _LOG_WRITE_BUFFER_H
+
+#include <Arduino.h>
+#include "Globals.h"
+#include <SD.h>
+
+/*
+ * Отложенная запись в файл на SD-карте.
+ * Каждый flush заставляет карту переписать недописанный сектор данных и сектор каталога с размером файла,
+ * а запись на карту может занимать десятки миллисекунд. Поэтому данные копятся в буфере размером в сектор
+ * и уходят в файл целым сектором, выровненным по границе сектора файла. На карту (с обновлением размера файла)
+ * данные сбрасываются не реже, чем раз в LOG_FLUSH_INTERVAL, - это максимум того, что теряется при пропадании питания,
+ * - и перед закрытием файла.
+ * Буфер один на все файлы: когда пишет другой файл, накопленное прежним уходит в его файл (без сброса на карту).
+ * Лог пишется раз в LOGGING_INTERVAL, действия - реже, так что буфер переходит из рук в руки редко.
+ * Без USE_LOG_WRITE_BUFFER буфера нет, каждый Commit сразу сбрасывает данные на карту, как раньше.
+ * И в том, и в другом случае считается статистика обращений к карте (CTGET=LOG|SDSTAT).
+ */
+
+typedef struct
+{
+  unsigned long Writes; // записей в файл
+  unsigned long Flushes; // сбросов на карту
+  unsigned long Bytes; // байт записано
+  unsigned long TotalTime; // суммарное время записей и сбросов, мкс
+  unsigned long MaxTime; // самое долгое обращение к карте, мкс
+
+} SDWriteStats; // статистика записи на карту
+
+class LogWriteBuffer
+{
+  private:
+
+    File& file;
+    SDWriteStats stats;
+
+#ifdef USE_LOG_WRITE_BUFFER
+    static uint8_t buffer[LOG_WRITE_BUFFER_SIZE]; // общий буфер сектора
+    static LogWriteBuffer* owner; // чьи данные сейчас в буфере
+    void Spill(); // отдаёт накопленное в файл, освобождая буфер
+
+    uint16_t used; // сколько байт лежит в буфере
+    uint16_t capacity; // сколько байт можно накопить до границы сектора файла
+    bool unsynced; // в файл писали, но на карту не сбрасывали
+    unsigned long dirtyTime; // сколько мс данные лежат несброшенными
+#endif
+
+    void FileWrite(const uint8_t* data, size_t len);
+    void FileFlush();
+    void Account(unsigned long startTime);
+
+  public:
+    LogWriteBuffer(File& f);
+
+    void Begin(); // файл только что открыт на дозапись
+    void Write(const uint8_t* data, size_t len);
+    void Write(const String& str) { Write((const uint8_t*) str.c_str(),str.length()); }
+    void Commit(); // запись закончена: без буфера - сразу на карту, с буфером - на карту по заполнению сектора или таймеру
+    void Flush(); // всё накопленное - на карту немедленно
+    void Close(); // сбрасывает данные и закрывает файл
+
+    void Update(uint16_t dt); // отсчитывает время до сброса по таймеру
+    unsigned long GetTimeToFlush(); // сколько мс осталось до сброса по таймеру, 0xFFFFFFFF - сбрасывать нечего
+    uint16_t GetPending(); // сколько байт ещё не попало на карту
+    uint32_t GetSize(); // размер файла вместе с данными в буфере
+
+    const SDWriteStats& GetStats() { return stats; }
+    void ResetStats();
+};
+
+#endif
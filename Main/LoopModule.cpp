@@ -80,12 +80,12 @@ uint8_t paramsCount = command.GetArgsCount(); // сколько параметр
         PublishSingleton = UNKNOWN_MODULE;
         
       MainController->Publish(this,command); // публикуем
-      return false;
+      return NULL;
     }
     // добавляем новую связь
     lnk = new LoopLink;
     if(!lnk)
-      return false;
+      return NULL;
 
       lnk->linkedModule = regModule;
       vec.push_back(lnk);
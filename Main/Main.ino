@@ -5,6 +5,8 @@
 #endif
 
 #include "CommandBuffer.h"
+#include "CommandQueue.h"
+#include "UARTLineBuffer.h"
 #include "CommandParser.h"
 #include "ModuleController.h"
 #include "AlertModule.h"
@@ -146,22 +148,24 @@ TempSensors tempSensors;
 #ifdef USE_SMS_MODULE
 // модуль управления по SMS
  SMSModule smsModule;
- String smsReceiveBuff;
+ uint8_t smsReceiveRing[GSM_RX_RING_SIZE];
+ UARTLineBuffer smsReceiveBuff(smsReceiveRing,GSM_RX_RING_SIZE,GSM_MAX_LINE_LENGTH);
  
 void GSM_EVENT_FUNC()
 {
   char ch;
-  while(GSM_SERIAL.available())
+  while(smsReceiveBuff.Available())
   {
-    ch = GSM_SERIAL.read();
+    ch = smsReceiveBuff.Read();
 
     if(ch == '\r')
       continue;
     
     if(ch == '\n')
     {
-      smsModule.ProcessAnswerLine(smsReceiveBuff);
-      smsReceiveBuff = F("");
+      if(!smsReceiveBuff.IsOverflowed()) // не поместившуюся строку не разбираем, только считаем
+        smsModule.ProcessAnswerLine(smsReceiveBuff.GetLine());
+      smsReceiveBuff.ClearLine();
     }
     else
     {
@@ -172,7 +176,7 @@ void GSM_EVENT_FUNC()
           smsModule.ProcessAnswerLine(F(">"));
         }
         else
-          smsReceiveBuff += ch;
+          smsReceiveBuff.Append(ch);
     }
 
     
@@ -252,31 +256,49 @@ TimerModule timerModule;
 #ifdef USE_WIFI_MODULE
 // модуль работы по Wi-Fi
 WiFiModule wifiModule;
-String wiFiReceiveBuff;
+uint8_t wiFiReceiveRing[WIFI_RX_RING_SIZE];
+UARTLineBuffer wiFiReceiveBuff(wiFiReceiveRing,WIFI_RX_RING_SIZE,WIFI_MAX_LINE_LENGTH);
+
+uint16_t wiFiIPDDataLeft = 0; // сколько байт данных пакета +IPD ещё не принято
 
 void WIFI_EVENT_FUNC()
 {
   char ch;
-  while(WIFI_SERIAL.available())
+  while(wiFiReceiveBuff.Available())
   {
-    ch = WIFI_SERIAL.read();
+    ch = wiFiReceiveBuff.Read();
 
+    if(wiFiIPDDataLeft)
+    {
+      // данные пакета +IPD принимаем как есть, по длине из заголовка: в них могут быть и \r\n,
+      // и любые байты бинарной команды
+      wiFiReceiveBuff.Append(ch);
+      if(!--wiFiIPDDataLeft)
+      {
+        // не поместившийся пакет отбрасываем целиком: данных в нём меньше, чем сказано в заголовке
+        if(!wiFiReceiveBuff.IsOverflowed())
+          wifiModule.ProcessAnswerLine(wiFiReceiveBuff.GetLine());
+        wiFiReceiveBuff.ClearLine();
+      }
+      continue;
+    }
    
     if(ch == '\r')
       continue;
     
     if(ch == '\n')
     {    
-        if(wiFiReceiveBuff.startsWith(F("+IPD")))
+        if(wiFiReceiveBuff.StartsWith(F("+IPD")))
         {
           // Не убираем переводы строки, когда пришёл пакет с данными, поскольку \r\n может придти прямо в пакете данных.
           // Т.к. у нас \r\n служит признаком окончания команды - значит, мы должны учитывать эти символы в пакете,
           // и не можем самовоизвольно их отбрасывать.
-          wiFiReceiveBuff += NEWLINE; 
+          wiFiReceiveBuff.AddNewLine(); 
         }
           
-        wifiModule.ProcessAnswerLine(wiFiReceiveBuff);
-        wiFiReceiveBuff = F("");
+        if(!wiFiReceiveBuff.IsOverflowed())
+          wifiModule.ProcessAnswerLine(wiFiReceiveBuff.GetLine());
+        wiFiReceiveBuff.ClearLine();
     }
     else
     {     
@@ -286,7 +308,18 @@ void WIFI_EVENT_FUNC()
           wifiModule.ProcessAnswerLine(F(">"));
         }
         else
-          wiFiReceiveBuff += ch;
+        {
+          wiFiReceiveBuff.Append(ch);
+
+          if(ch == ':' && wiFiReceiveBuff.StartsWith(F("+IPD,")))
+          {
+            // заголовок +IPD,ID клиента,длина: принят - дальше идут данные пакета
+            const String& line = wiFiReceiveBuff.GetLine();
+            int lenIdx = line.lastIndexOf(',');
+            if(lenIdx != -1)
+              wiFiIPDDataLeft = (uint16_t) atoi(line.c_str() + lenIdx + 1);
+          }
+        }
     }
   
     
@@ -296,6 +329,22 @@ void WIFI_EVENT_FUNC()
 
 #endif
 
+#if defined(USE_WIFI_MODULE) || defined(USE_SMS_MODULE)
+// прерывание по сравнению таймера 0: millis() ядра работает по переполнению того же таймера,
+// поэтому оно срабатывает раз в 1024 мкс при любом значении OCR0A. Перекладываем принятое ядром
+// в свои кольца, чтобы байты от модулей не терялись, пока loop занят чем-то долгим.
+ISR(TIMER0_COMPA_vect)
+{
+  #ifdef USE_WIFI_MODULE
+  wiFiReceiveBuff.Receive(WIFI_SERIAL);
+  #endif
+
+  #ifdef USE_SMS_MODULE
+  smsReceiveBuff.Receive(GSM_SERIAL);
+  #endif
+}
+#endif
+
 ZeroStreamListener zeroStreamModule;
 AlertModule alertsModule;
    
@@ -337,6 +386,10 @@ void setup()
 { 
   Serial.begin(SERIAL_BAUD_RATE); // запускаем Serial на нужной скорости
 
+  #if defined(USE_WIFI_MODULE) || defined(USE_SMS_MODULE)
+  TIMSK0 |= _BV(OCIE0A); // принятое от модулей Wi-Fi и GSM выгребаем в прерывании таймера 0
+  #endif
+
   // настраиваем все железки
   controller.Setup();
    
@@ -362,7 +415,7 @@ void setup()
   #endif
 
   #ifdef USE_SMS_MODULE
-  smsReceiveBuff.reserve(100);
+  smsReceiveBuff.Reserve();
   controller.RegisterModule(&smsModule);
   #endif
 
@@ -424,7 +477,7 @@ void setup()
   #endif
 
   #ifdef USE_WIFI_MODULE
-  wiFiReceiveBuff.reserve(100);
+  wiFiReceiveBuff.Reserve();
   controller.RegisterModule(&wifiModule);
   #endif 
 
@@ -495,28 +548,12 @@ void loop()
     lastMillis = curMillis; // сохраняем последнее значение вызова millis()
     
 
-  // смотрим, есть ли входящие команды
-   if(commandsFromSerial.HasCommand())
-   {
-    // есть новая команда
-    Command cmd;
-    if(commandParser.ParseCommand(commandsFromSerial.GetCommand(), cmd))
-    {
-       Stream* answerStream = commandsFromSerial.GetStream();
-      // разобрали, назначили поток, с которого пришла команда
-        cmd.SetIncomingStream(answerStream);
+  // смотрим, есть ли входящие команды. Пока предыдущая команда ждёт в очереди - новые не вычитываем
+   if(!commandsFromSerial.IsQueued() && commandsFromSerial.HasCommand())
+    CommandsQueue.Enqueue(&commandsFromSerial);
 
-      // запустили команду в обработку
-       controller.ProcessModuleCommand(cmd);
- 
-    } // if
-    else
-    {
-      // что-то пошло не так, игнорируем команду
-    } // else
-    
-    commandsFromSerial.ClearCommand(); // очищаем полученную команду
-   } // if
+   // выполняем команды из общей очереди, не больше, чем положено за один проход
+   CommandsQueue.Process(COMMANDS_PER_LOOP);
     
     // обновляем состояние всех зарегистрированных модулей
    controller.UpdateModules(dt,ModuleUpdateProcessed);
@@ -13,7 +13,45 @@ ModuleController::ModuleController() : cParser(NULL)
 {
   reservationResolver = NULL;
   PublishSingleton.Text.reserve(SHARED_BUFFER_LENGTH); // 500 байт для ответа от модуля должно хватить.
+
+#ifdef USE_UPDATE_PROFILER
+  ResetProfile(loopProfile);
+#endif
+}
+#ifdef USE_UPDATE_PROFILER
+void ModuleController::ResetProfile(UpdateProfile& p)
+{
+  p.MinTime = 0xFFFFFFFF;
+  p.AvgTime = 0;
+  p.MaxTime = 0;
+  p.OverBudget = 0;
+}
+void ModuleController::ResetProfiles()
+{
+  ResetProfile(loopProfile);
+  
+  size_t sz = profiles.size();
+  for(size_t i=0;i<sz;i++)
+    ResetProfile(profiles[i]);
 }
+void ModuleController::AddProfileTime(UpdateProfile& p, unsigned long time, unsigned long budget)
+{
+  // скользящее среднее с весом 1/8, первый замер берём как есть
+  if(p.MinTime == 0xFFFFFFFF)
+    p.AvgTime = time;
+  else
+    p.AvgTime = p.AvgTime - (p.AvgTime >> 3) + (time >> 3);
+
+  if(time < p.MinTime)
+    p.MinTime = time;
+
+  if(time > p.MaxTime)
+    p.MaxTime = time;
+
+  if(time > budget && p.OverBudget < 0xFFFF)
+    p.OverBudget++;
+}
+#endif
 #ifdef USE_DS3231_REALTIME_CLOCK
 DS3231Clock& ModuleController::GetClock()
 {
@@ -42,9 +80,10 @@ void ModuleController::Setup()
 
 #ifdef USE_DS3231_REALTIME_CLOCK
 _rtc.begin();
+Calendar.Begin(); // время для модулей, работающих по расписанию, - уже при их настройке
 #endif
 
-#if  defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE)
+#if  defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE) || defined(USE_ALERT_RULES_ON_SD)
   sdCardInitFlag = SD.begin(SDCARD_CS_PIN); // пробуем инициализировать SD-модуль
 #endif
   
@@ -71,6 +110,20 @@ void ModuleController::RegisterModule(AbstractModule* mod)
   {
     mod->Setup(); // настраиваем
     modules.push_back(mod);
+
+    // вставляем модуль в отсортированный по ID список, сохраняя порядок
+    sortedModules.push_back(mod);
+    for(size_t i=sortedModules.size()-1; i > 0 && strcmp(sortedModules[i-1]->GetID(),mod->GetID()) > 0; i--)
+    {
+      sortedModules[i] = sortedModules[i-1];
+      sortedModules[i-1] = mod;
+    } // for
+
+    #ifdef USE_UPDATE_PROFILER
+    UpdateProfile p;
+    ResetProfile(p);
+    profiles.push_back(p);
+    #endif
   }
 }
 
@@ -87,22 +140,24 @@ void ModuleController::PublishToCommandStream(AbstractModule* module,const Comma
     Serial.println(String(F("No ps, but have answer: ")) + PublishSingleton.Text);
 #endif    
     PublishSingleton.Busy = false; // освобождаем структуру
+    PublishSingleton.OutStream = NULL;
     return;
   }
 
-     ps->print(PublishSingleton.Status ? OK_ANSWER : ERR_ANSWER);
-     ps->print(COMMAND_DELIMITER);
+    // ошибка после того, как начало успешного ответа уже ушло, - отдельной строкой со своим заголовком
+    if(PublishSingleton.HeaderSent && !PublishSingleton.Status)
+      PublishSingleton.RestartAnswer();
 
-    if(PublishSingleton.AddModuleIDToAnswer && module) // надо добавить имя модуля в ответ
-    {
-       ps->print(module->GetID());
-       ps->print(PARAM_DELIMITER);
-    }
+    // в потоковом режиме заголовок мог уже уйти вместе с началом ответа, тогда досылаем только хвост
+    if(!PublishSingleton.HeaderSent)
+      PublishSingleton.WriteHeader(ps,module);
     
      ps->println(PublishSingleton.Text);
 
    
    PublishSingleton.Busy = false; // освобождаем структуру
+   PublishSingleton.OutStream = NULL;
+   PublishSingleton.HeaderSent = false;
 }
 
 void ModuleController::CallRemoteModuleCommand(AbstractModule* mod, const String& command)
@@ -125,13 +180,29 @@ void ModuleController::Publish(AbstractModule* module,const Command& sourceComma
 }
 AbstractModule* ModuleController::GetModuleByID(const String& id)
 {
-  size_t sz = modules.size();
-  for(size_t i=0;i<sz;i++)
-  { 
-    AbstractModule* mod = modules[i];
-    if(!strcmp(mod->GetID(),id.c_str()) )
+  return GetModuleByID(id.c_str());
+}
+AbstractModule* ModuleController::GetModuleByID(const char* id)
+{
+  // двоичный поиск по отсортированному списку модулей
+  int16_t low = 0;
+  int16_t high = sortedModules.size() - 1;
+  
+  while(low <= high)
+  {
+    int16_t mid = (low + high)/2;
+    AbstractModule* mod = sortedModules[mid];
+    int cmp = strcmp(id,mod->GetID());
+    
+    if(!cmp)
       return mod;
-  } // for
+
+    if(cmp < 0)
+      high = mid - 1;
+    else
+      low = mid + 1;
+  } // while
+  
   return NULL;
 }
 
@@ -167,22 +238,72 @@ CHECK_PUBLISH_CONSISTENCY;
  PublishSingleton.Reset(); // очищаем структуру для публикации
  PublishSingleton.Busy = true; // говорим, что структура занята для публикации
  mod->ExecCommand(c,c.GetIncomingStream() != NULL); // выполняем его команду
+ mod->WakeUp(); // команда могла изменить состояние модуля - даём ему обработать это на ближайшей итерации
  
 }
 
 void ModuleController::UpdateModules(uint16_t dt, CallbackUpdateFunc func)
-{  
+{
+#if defined(LOOP_TIMINGS_DEBUG) || defined(USE_UPDATE_PROFILER)
+  unsigned long loopTotal = 0; // сколько заняли обновления всех модулей, мкс
+#endif
+
+#ifdef LOOP_TIMINGS_DEBUG
+  Serial.print(F("LOOP dt="));
+  Serial.print(dt);
+#endif
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+  Calendar.Update(dt); // читаем часы и будим тех, у кого по расписанию что-то меняется
+#endif
+
   size_t sz = modules.size();
   for(size_t i=0;i<sz;i++)
-  { 
+  {
     AbstractModule* mod = modules[i];
-   
+
+    // модули, которым ещё рано обновляться, пропускаем целиком - прошедшее время
+    // накапливается и будет передано им при следующем обновлении
+    uint16_t updateDt;
+    if(!mod->IsUpdateDue(dt,updateDt))
+      continue;
+
+#if defined(LOOP_TIMINGS_DEBUG) || defined(USE_UPDATE_PROFILER)
+    unsigned long updateStart = micros();
+#endif
+
       // ОБНОВЛЯЕМ СОСТОЯНИЕ МОДУЛЕЙ
-      mod->Update(dt);
+      mod->Update(updateDt);
 
     if(func) // вызываем функцию после обновления каждого модуля
       func(mod);
-  
+
+#if defined(LOOP_TIMINGS_DEBUG) || defined(USE_UPDATE_PROFILER)
+    unsigned long updateTime = micros() - updateStart;
+    loopTotal += updateTime;
+#endif
+
+#ifdef USE_UPDATE_PROFILER
+    AddProfileTime(profiles[i],updateTime,PROFILER_MODULE_BUDGET);
+#endif
+
+#ifdef LOOP_TIMINGS_DEBUG
+    // время печати в порт в замер не входит - выводим уже после подсчёта
+    Serial.print(' ');
+    Serial.print(mod->GetID());
+    Serial.print('=');
+    Serial.print(updateTime);
+#endif
+
   } // for
+
+#ifdef USE_UPDATE_PROFILER
+  AddProfileTime(loopProfile,loopTotal,PROFILER_LOOP_BUDGET);
+#endif
+
+#ifdef LOOP_TIMINGS_DEBUG
+  Serial.print(F(" TOTAL="));
+  Serial.println(loopTotal);
+#endif
 }
 
@@ -10,6 +10,7 @@
 
 #ifdef USE_DS3231_REALTIME_CLOCK
 #include "DS3231Support.h"
+#include "Calendar.h"
 #endif
 
 #ifdef USE_LOG_MODULE
@@ -23,10 +24,24 @@ typedef Vector<AbstractModule*> ModulesVec;
 
 typedef void (*CallbackUpdateFunc)(AbstractModule* mod);
 
+#ifdef USE_UPDATE_PROFILER
+typedef struct
+{
+  unsigned long MinTime; // минимальное время обновления, мкс
+  unsigned long AvgTime; // скользящее среднее времени обновления, мкс
+  unsigned long MaxTime; // максимальное время обновления, мкс
+  uint16_t OverBudget; // сколько раз превысили бюджет на обновление
+  
+} UpdateProfile; // статистика времени обновления модуля
+
+typedef Vector<UpdateProfile> UpdateProfilesVec;
+#endif
+
 class ModuleController
 {
  private:
   ModulesVec modules; // список зарегистрированных модулей
+  ModulesVec sortedModules; // те же модули, отсортированные по ID - для двоичного поиска модуля по имени
   
   CommandParser* cParser; // парсер текстовых команд
 
@@ -42,10 +57,17 @@ class ModuleController
   LogModule* logWriter;
 #endif
 
-#if defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE)
+#if defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE) || defined(USE_ALERT_RULES_ON_SD)
   bool sdCardInitFlag;
 #endif
 
+#ifdef USE_UPDATE_PROFILER
+  UpdateProfilesVec profiles; // статистика обновления модулей, по индексу модуля
+  UpdateProfile loopProfile; // статистика обновления всех модулей за одну итерацию loop
+  void ResetProfile(UpdateProfile& p);
+  void AddProfileTime(UpdateProfile& p, unsigned long time, unsigned long budget);
+#endif
+
   void PublishToCommandStream(AbstractModule* module,const Command& sourceCommand); // публикация в поток команды
 
 public:
@@ -61,7 +83,7 @@ public:
 
   bool HasSDCard() 
   {
-#if  defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE)
+#if  defined(USE_WIFI_MODULE) || defined(USE_LOG_MODULE) || defined(USE_SMS_MODULE) || defined(USE_ALERT_RULES_ON_SD)
     return sdCardInitFlag;
 #else
     return false;
@@ -84,11 +106,18 @@ public:
   size_t GetModulesCount() {return modules.size(); }
   AbstractModule* GetModule(size_t idx) {return modules[idx]; }
   AbstractModule* GetModuleByID(const String& id);
+  AbstractModule* GetModuleByID(const char* id);
 
   void RegisterModule(AbstractModule* mod);
   void ProcessModuleCommand(const Command& c, AbstractModule* thisModule=NULL);
   
   void UpdateModules(uint16_t dt, CallbackUpdateFunc func);
+
+  #ifdef USE_UPDATE_PROFILER
+  UpdateProfile* GetModuleProfile(size_t idx) {return &(profiles[idx]); } // статистика обновления модуля по его индексу
+  UpdateProfile* GetLoopProfile() {return &loopProfile; } // статистика обновления всех модулей за итерацию loop
+  void ResetProfiles(); // сбрасывает всю статистику обновления
+  #endif
   
   void CallRemoteModuleCommand(AbstractModule* mod, const String& command); // вызывает команду с другой коробочки
 
@@ -201,6 +201,9 @@ void NextionModule::Setup()
 
   rotationTimer = NEXTION_ROTATION_INTERVAL;
   currentSensorIndex = -1;
+  displayedState = NULL;
+  displayedStateChanged = false;
+  StateChanges.Subscribe(this); // обновляем экран ожидания, как только изменятся показания на нём
   
   isDisplaySleep = false;
   bInited = false;
@@ -387,10 +390,30 @@ void NextionModule::Update(uint16_t dt)
     rotationTimer = 0;
     displayNextSensorData(1);
   }
+  else
+  if(displayedStateChanged) // показания на экране устарели - выводим их заново, не дожидаясь ротации
+    displayNextSensorData(0);
   
 }
+void NextionModule::OnStateChanged(OneState* state)
+{
+  if(state == displayedState)
+    displayedStateChanged = true;
+}
+void NextionModule::OnStateRemoved(OneState* state)
+{
+  if(state != displayedState)
+    return;
+
+  // датчика на экране ожидания больше нет - переходим к следующему
+  displayedState = NULL;
+  displayedStateChanged = false;
+  rotationTimer = NEXTION_ROTATION_INTERVAL;
+}
 void NextionModule::displayNextSensorData(int8_t dir)
 {
+  displayedStateChanged = false;
+  
   if(isDisplaySleep)
     return;
 
@@ -443,6 +466,8 @@ void NextionModule::displayNextSensorData(int8_t dir)
     return;
   }
 
+  displayedState = os;
+
 
    //Тут получаем актуальные данные от датчиков
    switch(wsi.sensorType)
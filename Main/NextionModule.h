@@ -15,7 +15,7 @@
  } NextionWaitScreenInfo; // структура для хранения информации, которую необходимо показывать на экране ожидания
 
 
-class NextionModule : public AbstractModule // модуль управления дисплеем Nextion
+class NextionModule : public AbstractModule, public StateChangeListener // модуль управления дисплеем Nextion
 {
   private:
   
@@ -43,6 +43,8 @@ class NextionModule : public AbstractModule // модуль управления
 
     void displayNextSensorData(int8_t dir=1);
     int8_t currentSensorIndex;
+    OneState* displayedState; // показания какого датчика на экране ожидания
+    bool displayedStateChanged; // показания датчика на экране ожидания изменились
   
   public:
     NextionModule() : AbstractModule("NXT") {}
@@ -54,6 +56,9 @@ class NextionModule : public AbstractModule // модуль управления
     void SetSleep(bool bSleep);
     void StringReceived(const char* str);
 
+    virtual void OnStateChanged(OneState* state);
+    virtual void OnStateRemoved(OneState* state);
+
 };
 
 
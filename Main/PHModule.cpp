@@ -699,7 +699,7 @@ void PhModule::Update(uint16_t dt)
               PH_DEBUG_OUT(F("Target pH: "), phTarget);
             #endif
 
-            if(accumulatedData >= (phTarget - phHisteresis) && accumulatedData <= (phTarget + phHisteresis))
+            if((long) accumulatedData >= ((long) phTarget - phHisteresis) && (long) accumulatedData <= ((long) phTarget + phHisteresis))
             {
               // находимся в пределах гистерезиса
             #ifdef PH_DEBUG
@@ -93,13 +93,14 @@ bool  PinModule::ExecCommand(const Command& command, bool wantAnswer)
        uint8_t pinNumber = strNum.toInt();
        uint8_t currentState = GetPinState(pinNumber);
        
+       PublishSingleton.Status = true;
+
        if(wantAnswer) // чтобы не работать с памятью, когда от нас не ждут ответа
        {
+        PublishSingleton.BeginStream(this,command); // отдаём ответ в поток по мере формирования
         PublishSingleton = strNum;
         PublishSingleton << PARAM_DELIMITER << (currentState == HIGH ? STATE_ON : STATE_OFF);
        }
-        
-       PublishSingleton.Status = true;
     }
     
 
@@ -236,6 +236,8 @@ void ReservationModule::Update(uint16_t dt)
 
   }
 
+  SleepFor(0xFFFF); // больше нам обновляться незачем
+
 }
 
 bool  ReservationModule::ExecCommand(const Command& command, bool wantAnswer)
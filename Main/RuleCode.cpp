@@ -0,0 +1,800 @@
+#include "RuleCode.h"
+#include "ModuleController.h"
+
+#if ALERT_RULE_STACK_DEPTH > 8
+#error ALERT_RULE_STACK_DEPTH IS LIMITED to 8 !!!
+#endif
+
+void RuleCodeWriter::Write(uint8_t b)
+{
+  if(length >= ALERT_RULE_MAX_CODE_LENGTH)
+  {
+    failed = true;
+    return;
+  }
+
+  code[length++] = b;
+}
+void RuleCodeWriter::Push()
+{
+  if(++depth > ALERT_RULE_STACK_DEPTH)
+    failed = true;
+}
+void RuleCodeWriter::Pop(uint8_t cnt)
+{
+  if(depth < cnt)
+  {
+    failed = true;
+    depth = 0;
+    return;
+  }
+
+  depth -= cnt;
+}
+void RuleCodeWriter::Sensor(uint8_t target, uint8_t sensorIndex)
+{
+  Write(RC_SENSOR);
+  Write(target);
+  Write(sensorIndex);
+  Push();
+}
+void RuleCodeWriter::Pin(uint8_t pin)
+{
+  Write(RC_PIN);
+  Write(pin);
+  Push();
+}
+void RuleCodeWriter::Const(long value)
+{
+  // пишем константу в самом коротком виде
+  if(value >= -128 && value <= 127)
+  {
+    Write(RC_CONST8);
+    Write((uint8_t) value);
+  }
+  else
+  if(value >= -32768L && value <= 32767L)
+  {
+    Write(RC_CONST16);
+    Write(value & 0xFF);
+    Write((value >> 8) & 0xFF);
+  }
+  else
+  {
+    Write(RC_CONST32);
+    for(uint8_t i=0;i<4;i++)
+      Write((value >> (i*8)) & 0xFF);
+  }
+
+  Push();
+}
+void RuleCodeWriter::Op(uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case RC_OPEN_TEMP:
+    case RC_CLOSE_TEMP:
+    case RC_TRUE:
+    break;
+
+    case RC_LT:
+    case RC_LE:
+    case RC_GT:
+    case RC_GE:
+    case RC_EQ:
+    case RC_AND:
+    case RC_OR:
+      Pop(2);
+    break;
+
+    case RC_NOT:
+      Pop(1);
+    break;
+
+    case RC_IN_RANGE:
+      Pop(3);
+    break;
+
+    default:
+      failed = true;
+      return;
+  } // switch
+
+  Write(opcode);
+  Push();
+}
+void RuleCodeWriter::Hysteresis()
+{
+  if(latchesUsed >= RC_MAX_LATCHES)
+  {
+    failed = true;
+    return;
+  }
+
+  Pop(3);
+  Write(RC_HYST);
+  Write(latchesUsed++);
+  Push();
+}
+
+static uint8_t RuleTargetFromName(const char* name)
+{
+  if(!strcmp_P(name,(const char*) PROP_TEMP))
+    return rtTemp;
+  if(!strcmp_P(name,(const char*) PROP_LIGHT))
+    return rtLuminosity;
+  if(!strcmp_P(name,(const char*) PROP_HUMIDITY))
+    return rtHumidity;
+  if(!strcmp_P(name,(const char*) PROP_PIN))
+    return rtPinState;
+  if(!strcmp_P(name,(const char*) PROP_SOIL))
+    return rtSoilMoisture;
+  if(!strcmp_P(name,(const char*) PROP_PH))
+    return rtPH;
+
+  return rtUnknown;
+}
+void RuleTargetName(uint8_t target, String& out)
+{
+  switch(target)
+  {
+    case rtTemp: out += PROP_TEMP; break;
+    case rtLuminosity: out += PROP_LIGHT; break;
+    case rtHumidity: out += PROP_HUMIDITY; break;
+    case rtPinState: out += PROP_PIN; break;
+    case rtSoilMoisture: out += PROP_SOIL; break;
+    case rtPH: out += PROP_PH; break;
+    default: out += PROP_NONE; break;
+  }
+}
+static ModuleStates RuleTargetState(uint8_t target)
+{
+  switch(target)
+  {
+    case rtTemp: return StateTemperature;
+    case rtLuminosity: return StateLuminosity;
+    case rtHumidity: return StateHumidity;
+    case rtSoilMoisture: return StateSoilMoisture;
+    case rtPH: return StatePH;
+    default: return StateUnknown;
+  }
+}
+static const __FlashStringHelper* RuleCompareName(uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case RC_LT: return LESS_THAN;
+    case RC_LE: return LESS_OR_EQUAL_THAN;
+    case RC_GT: return GREATER_THAN;
+    case RC_GE: return GREATER_OR_EQUAL_THAN;
+    default: return F("=");
+  }
+}
+
+bool RuleCompileCondition(RuleCodeWriter& writer, const char* target, uint8_t sensorIndex, const char* operand, const char* value)
+{
+  uint8_t t = RuleTargetFromName(target);
+  if(t == rtUnknown) // нет того, за чем следим, правило работает только по времени
+  {
+    writer.Op(RC_TRUE);
+    return writer.IsValid();
+  }
+
+  uint8_t compare = RC_LT;
+  if(!strcmp_P(operand,(const char*) GREATER_THAN))
+    compare = RC_GT;
+  else if(!strcmp_P(operand,(const char*) LESS_OR_EQUAL_THAN))
+    compare = RC_LE;
+  else if(!strcmp_P(operand,(const char*) GREATER_OR_EQUAL_THAN))
+    compare = RC_GE;
+
+  bool openTemp = !strcmp_P(value,(const char*) T_OPEN_MACRO);
+  bool closeTemp = !strcmp_P(value,(const char*) T_CLOSE_MACRO);
+  long dataAlert = atol(value);
+
+  if(t == rtLuminosity && dataAlert == -2)
+  {
+    // специальное значение, означающее "работать без датчика освещённости"
+    writer.Op(RC_TRUE);
+    return writer.IsValid();
+  }
+
+  if(t == rtPinState)
+  {
+    // на пине может быть только 0 или 1, поэтому операнды > и <= не имеют смысла,
+    // вместо них используем >= и <
+    writer.Pin(sensorIndex);
+    writer.Const(dataAlert);
+    writer.Op((compare == RC_LT || compare == RC_LE) ? RC_LT : RC_GE);
+    return writer.IsValid();
+  }
+
+  writer.Sensor(t,sensorIndex);
+
+  if(t == rtTemp && openTemp) // подставляем температуру из настроек только для температуры
+    writer.Op(RC_OPEN_TEMP);
+  else
+  if(t == rtTemp && closeTemp)
+    writer.Op(RC_CLOSE_TEMP);
+  else
+    writer.Const(t == rtTemp ? (int8_t) dataAlert : dataAlert);
+
+  writer.Op(compare);
+  return writer.IsValid();
+}
+
+static bool ParseExpression(RuleCodeWriter& writer, const char*& p, uint8_t nesting);
+
+static bool ParseValue(RuleCodeWriter& writer, const char*& p)
+{
+  if(!strncmp_P(p,(const char*) T_OPEN_MACRO,4))
+  {
+    p += 4;
+    writer.Op(RC_OPEN_TEMP);
+    return true;
+  }
+
+  if(!strncmp_P(p,(const char*) T_CLOSE_MACRO,4))
+  {
+    p += 4;
+    writer.Op(RC_CLOSE_TEMP);
+    return true;
+  }
+
+  char* end;
+  long value = strtol(p,&end,10);
+  if(end == p)
+    return false;
+
+  p = end;
+  writer.Const(value);
+  return true;
+}
+static bool ParseBounds(RuleCodeWriter& writer, const char*& p, char closing)
+{
+  // нижняя и верхняя граница через двоеточие
+  if(!ParseValue(writer,p) || *p != ':')
+    return false;
+
+  p++;
+  if(!ParseValue(writer,p) || *p != closing)
+    return false;
+
+  p++;
+  return true;
+}
+static bool ParseCondition(RuleCodeWriter& writer, const char*& p)
+{
+  char name[10];
+  uint8_t nameLen = 0;
+  while(*p >= 'A' && *p <= 'Z' && nameLen < sizeof(name)-1)
+    name[nameLen++] = *p++;
+  name[nameLen] = 0;
+
+  uint8_t target = RuleTargetFromName(name);
+  if(target == rtUnknown || *p < '0' || *p > '9')
+    return false;
+
+  uint8_t sensorIndex = (uint8_t) strtol(p,(char**) &p,10);
+
+  if(target == rtPinState)
+    writer.Pin(sensorIndex);
+  else
+    writer.Sensor(target,sensorIndex);
+
+  switch(*p)
+  {
+    case '[': // диапазон
+      p++;
+      if(!ParseBounds(writer,p,']'))
+        return false;
+      writer.Op(RC_IN_RANGE);
+      return true;
+
+    case '{': // гистерезис
+      p++;
+      if(!ParseBounds(writer,p,'}'))
+        return false;
+      writer.Hysteresis();
+      return true;
+
+    case '<':
+    case '>':
+    {
+      bool less = (*p == '<');
+      p++;
+      bool orEqual = (*p == '=');
+      if(orEqual)
+        p++;
+
+      if(!ParseValue(writer,p))
+        return false;
+
+      writer.Op(less ? (orEqual ? RC_LE : RC_LT) : (orEqual ? RC_GE : RC_GT));
+      return true;
+    }
+
+    case '=':
+      p++;
+      if(!ParseValue(writer,p))
+        return false;
+      writer.Op(RC_EQ);
+      return true;
+  } // switch
+
+  return false;
+}
+static bool ParseFactor(RuleCodeWriter& writer, const char*& p, uint8_t nesting)
+{
+  if(*p == '!')
+  {
+    p++;
+    if(!ParseFactor(writer,p,nesting))
+      return false;
+
+    writer.Op(RC_NOT);
+    return true;
+  }
+
+  if(*p == '(')
+  {
+    p++;
+    if(!ParseExpression(writer,p,nesting+1) || *p != ')')
+      return false;
+
+    p++;
+    return true;
+  }
+
+  return ParseCondition(writer,p);
+}
+static bool ParseTerm(RuleCodeWriter& writer, const char*& p, uint8_t nesting)
+{
+  if(!ParseFactor(writer,p,nesting))
+    return false;
+
+  while(*p == '&')
+  {
+    p++;
+    if(!ParseFactor(writer,p,nesting))
+      return false;
+
+    writer.Op(RC_AND);
+  }
+
+  return true;
+}
+static bool ParseExpression(RuleCodeWriter& writer, const char*& p, uint8_t nesting)
+{
+  if(nesting > ALERT_RULE_STACK_DEPTH) // глубже стек всё равно не позволит
+    return false;
+
+  if(!ParseTerm(writer,p,nesting))
+    return false;
+
+  while(*p == ',')
+  {
+    p++;
+    if(!ParseTerm(writer,p,nesting))
+      return false;
+
+    writer.Op(RC_OR);
+  }
+
+  return true;
+}
+bool RuleCompileExpression(RuleCodeWriter& writer, const char* expression)
+{
+  const char* p = expression;
+  if(!ParseExpression(writer,p,0) || *p)
+    writer.Fail();
+
+  return writer.IsValid();
+}
+
+static uint8_t RuleArgsLength(uint8_t opcode) // сколько байт аргументов у операции, 0xFF - неизвестная операция
+{
+  switch(opcode)
+  {
+    case RC_SENSOR: return 2;
+    case RC_PIN:
+    case RC_CONST8:
+    case RC_HYST:
+      return 1;
+    case RC_CONST16: return 2;
+    case RC_CONST32: return 4;
+
+    case RC_OPEN_TEMP:
+    case RC_CLOSE_TEMP:
+    case RC_LT:
+    case RC_LE:
+    case RC_GT:
+    case RC_GE:
+    case RC_EQ:
+    case RC_IN_RANGE:
+    case RC_AND:
+    case RC_OR:
+    case RC_NOT:
+    case RC_TRUE:
+      return 0;
+  }
+
+  return 0xFF;
+}
+static long RuleReadConst(const uint8_t* args, uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case RC_CONST8: return (int8_t) args[0];
+    case RC_CONST16: return (int16_t) (args[0] | (args[1] << 8));
+    default: return (unsigned long) args[0] | ((unsigned long) args[1] << 8) | ((unsigned long) args[2] << 16) | ((unsigned long) args[3] << 24);
+  }
+}
+bool RuleCodeVerify(const uint8_t* code, uint8_t length)
+{
+  if(!code || !length)
+    return false;
+
+  uint8_t depth = 0;
+  uint8_t pc = 0;
+  while(pc < length)
+  {
+    uint8_t opcode = code[pc++];
+    uint8_t argsLen = RuleArgsLength(opcode);
+    if(argsLen == 0xFF || pc + argsLen > length)
+      return false;
+
+    if(opcode == RC_HYST && code[pc] >= RC_MAX_LATCHES)
+      return false;
+
+    pc += argsLen;
+
+    uint8_t pops = 0;
+    switch(opcode)
+    {
+      case RC_LT: case RC_LE: case RC_GT: case RC_GE: case RC_EQ: case RC_AND: case RC_OR:
+        pops = 2;
+      break;
+      case RC_NOT:
+        pops = 1;
+      break;
+      case RC_IN_RANGE: case RC_HYST:
+        pops = 3;
+      break;
+    }
+
+    if(depth < pops)
+      return false;
+
+    depth = depth - pops + 1;
+    if(depth > ALERT_RULE_STACK_DEPTH)
+      return false;
+  } // while
+
+  return depth == 1;
+}
+
+void RuleCodePrint(const uint8_t* code, uint8_t length, String& out)
+{
+  // простые условия печатаем в старом формате, чтобы их можно было отредактировать как раньше
+  if(length == 1 && code[0] == RC_TRUE)
+  {
+    out += PROP_NONE;
+    out += F("|0|>|0");
+    return;
+  }
+
+  if(length >= 5 && (code[0] == RC_SENSOR || code[0] == RC_PIN))
+  {
+    uint8_t valuePos = code[0] == RC_SENSOR ? 3 : 2;
+    uint8_t valueOp = code[valuePos];
+    uint8_t argsLen = RuleArgsLength(valueOp);
+    uint8_t comparePos = valuePos + 1 + argsLen;
+    bool isValue = (valueOp >= RC_CONST8 && valueOp <= RC_CLOSE_TEMP);
+
+    if(isValue && comparePos == length - 1 && code[comparePos] >= RC_LT && code[comparePos] <= RC_GE)
+    {
+      RuleTargetName(code[0] == RC_SENSOR ? code[1] : (uint8_t) rtPinState,out);
+      out += PARAM_DELIMITER;
+      out += code[0] == RC_SENSOR ? code[2] : code[1];
+      out += PARAM_DELIMITER;
+      out += RuleCompareName(code[comparePos]);
+      out += PARAM_DELIMITER;
+
+      if(valueOp == RC_OPEN_TEMP)
+        out += T_OPEN_MACRO;
+      else
+      if(valueOp == RC_CLOSE_TEMP)
+        out += T_CLOSE_MACRO;
+      else
+        out += RuleReadConst(code + valuePos + 1,valueOp);
+
+      return;
+    }
+  } // if
+
+  // составное условие - восстанавливаем текстовую запись из байт-кода
+  String parts[ALERT_RULE_STACK_DEPTH];
+  uint8_t sp = 0;
+  uint8_t pc = 0;
+
+  while(pc < length)
+  {
+    uint8_t opcode = code[pc++];
+    const uint8_t* args = code + pc;
+    pc += RuleArgsLength(opcode);
+
+    switch(opcode)
+    {
+      case RC_SENSOR:
+        parts[sp] = String();
+        RuleTargetName(args[0],parts[sp]);
+        parts[sp++] += args[1];
+      break;
+
+      case RC_PIN:
+        parts[sp] = PROP_PIN;
+        parts[sp++] += args[0];
+      break;
+
+      case RC_CONST8:
+      case RC_CONST16:
+      case RC_CONST32:
+        parts[sp++] = String(RuleReadConst(args,opcode));
+      break;
+
+      case RC_OPEN_TEMP:
+        parts[sp++] = T_OPEN_MACRO;
+      break;
+
+      case RC_CLOSE_TEMP:
+        parts[sp++] = T_CLOSE_MACRO;
+      break;
+
+      case RC_LT:
+      case RC_LE:
+      case RC_GT:
+      case RC_GE:
+      case RC_EQ:
+        sp--;
+        parts[sp-1] += RuleCompareName(opcode);
+        parts[sp-1] += parts[sp];
+      break;
+
+      case RC_IN_RANGE:
+      case RC_HYST:
+        sp -= 2;
+        parts[sp-1] += opcode == RC_IN_RANGE ? '[' : '{';
+        parts[sp-1] += parts[sp];
+        parts[sp-1] += ':';
+        parts[sp-1] += parts[sp+1];
+        parts[sp-1] += opcode == RC_IN_RANGE ? ']' : '}';
+      break;
+
+      case RC_AND:
+      case RC_OR:
+        sp--;
+        parts[sp-1] = String('(') + parts[sp-1];
+        parts[sp-1] += opcode == RC_AND ? '&' : ',';
+        parts[sp-1] += parts[sp];
+        parts[sp-1] += ')';
+      break;
+
+      case RC_NOT:
+        parts[sp-1] = String('!') + parts[sp-1];
+      break;
+
+      case RC_TRUE:
+        parts[sp++] = PROP_NONE;
+      break;
+    } // switch
+  } // while
+
+  out += F("EXPR|0|_|");
+  if(sp)
+    out += parts[0];
+}
+
+static long RuleReadState(OneState* os, bool& hasData)
+{
+  if(os->GetType() == StateLuminosity)
+  {
+    long lum = os->GetLuminosity();
+    hasData = (lum != NO_LUMINOSITY_DATA);
+    return lum;
+  }
+
+  int8_t value = os->GetTemperature().Value; // температура, влажность, влажность почвы и pH хранятся одинаково
+  hasData = (value != NO_TEMPERATURE_DATA);
+  return value;
+}
+bool RuleIsWatched(const RuleWatchedStates& watched, const OneState* state)
+{
+  for(size_t i=0;i<watched.size();i++)
+  {
+    if(watched[i] == state)
+      return true;
+  }
+
+  return false;
+}
+static bool RuleLoadSensor(RuleCodeContext& context, uint8_t target, uint8_t sensorIndex, long& value, bool& hasData)
+{
+  ModuleStates state = RuleTargetState(target);
+  if(state == StateUnknown)
+    return false;
+
+  OneState* os = context.module->State.GetState(state,sensorIndex);
+  if(!os)
+  {
+    context.volatileAlert = true; // датчик может появиться позже (дельты, универсальные модули) - проверяем каждый раз
+    return false;
+  }
+
+  if(!RuleIsWatched(context.watchedStates,os) && !context.watchedStates.push_back(os)) // датчиков в условии больше, чем можем отследить
+    context.volatileAlert = true;
+
+  value = RuleReadState(os,hasData);
+  if(!hasData) // нет датчика на линии
+  {
+    context.volatileAlert = true; // показания резервного датчика мы не отслеживаем
+
+    // пытаемся найти резервирование
+    OneState* reservedState = MainController->GetReservedState(context.module,state,sensorIndex);
+    if(reservedState)
+    {
+      value = RuleReadState(reservedState,hasData);
+      hasData = true;
+    }
+  }
+
+  return true;
+}
+bool RuleCodeExecute(const uint8_t* code, uint8_t length, RuleCodeContext& context)
+{
+  context.watchedStates.Clear();
+  context.volatileAlert = false;
+
+  if(!code || !context.module)
+    return false;
+
+  long stack[ALERT_RULE_STACK_DEPTH];
+  uint8_t noData = 0; // биты значений на стеке, для которых нет показаний
+  uint8_t sp = 0;
+  uint8_t pc = 0;
+
+  while(pc < length)
+  {
+    uint8_t opcode = code[pc++];
+    switch(opcode)
+    {
+      case RC_SENSOR:
+      {
+        long value;
+        bool hasData;
+        if(!RuleLoadSensor(context,code[pc],code[pc+1],value,hasData))
+        {
+          context.volatileAlert = true; // датчик может появиться позже
+          return false;
+        }
+        pc += 2;
+
+        stack[sp] = value;
+        bitWrite(noData,sp,!hasData);
+        sp++;
+      }
+      break;
+
+      case RC_PIN:
+      {
+        uint8_t pin = code[pc++];
+        pinMode(pin,INPUT);
+        stack[sp] = digitalRead(pin); // читаем из пина его значение
+        bitClear(noData,sp);
+        sp++;
+        context.volatileAlert = true;
+      }
+      break;
+
+      case RC_CONST8:
+      case RC_CONST16:
+      case RC_CONST32:
+        stack[sp] = RuleReadConst(code + pc,opcode);
+        bitClear(noData,sp);
+        sp++;
+        pc += RuleArgsLength(opcode);
+      break;
+
+      case RC_OPEN_TEMP:
+      case RC_CLOSE_TEMP:
+        stack[sp] = opcode == RC_OPEN_TEMP ? MainController->GetSettings()->GetOpenTemp() : MainController->GetSettings()->GetCloseTemp();
+        bitClear(noData,sp);
+        sp++;
+        context.volatileAlert = true; // настройки могут поменяться в любой момент
+      break;
+
+      case RC_LT:
+      case RC_LE:
+      case RC_GT:
+      case RC_GE:
+      case RC_EQ:
+      {
+        sp--;
+        long a = stack[sp-1];
+        long b = stack[sp];
+        bool result;
+
+        if(bitRead(noData,sp-1) || bitRead(noData,sp)) // без показаний правило может следить только за их отсутствием
+          result = (a == b);
+        else
+        switch(opcode)
+        {
+          case RC_LT: result = a < b; break;
+          case RC_LE: result = a <= b; break;
+          case RC_GT: result = a > b; break;
+          case RC_GE: result = a >= b; break;
+          default: result = a == b; break;
+        }
+
+        stack[sp-1] = result;
+        bitClear(noData,sp-1);
+      }
+      break;
+
+      case RC_IN_RANGE:
+      case RC_HYST:
+      {
+        sp -= 2;
+        long value = stack[sp-1];
+        long low = stack[sp];
+        long high = stack[sp+1];
+        bool result = false;
+
+        if(!bitRead(noData,sp-1))
+        {
+          if(opcode == RC_IN_RANGE)
+            result = (value >= low && value <= high);
+          else
+          {
+            uint8_t latch = code[pc];
+            if(value >= high)
+              bitSet(*context.latches,latch);
+            else
+            if(value <= low)
+              bitClear(*context.latches,latch);
+
+            result = bitRead(*context.latches,latch);
+          }
+        }
+
+        if(opcode == RC_HYST)
+          pc++;
+
+        stack[sp-1] = result;
+        bitClear(noData,sp-1);
+      }
+      break;
+
+      case RC_AND:
+      case RC_OR:
+        sp--;
+        stack[sp-1] = opcode == RC_AND ? (stack[sp-1] && stack[sp]) : (stack[sp-1] || stack[sp]);
+      break;
+
+      case RC_NOT:
+        stack[sp-1] = !stack[sp-1];
+      break;
+
+      case RC_TRUE:
+        stack[sp] = 1;
+        bitClear(noData,sp);
+        sp++;
+      break;
+
+      default: // байт-код проверен при загрузке, сюда попасть не должны
+        return false;
+    } // switch
+  } // while
+
+  return sp == 1 && stack[0];
+}
@@ -0,0 +1,134 @@
+#ifndef _RULE_CODE_H
+#define _RULE_CODE_H
+
+#include <Arduino.h>
+#include "Globals.h"
+#include "AbstractModule.h"
+#include "TinyVector.h"
+
+/*
+ * Условия правил алертов компилируются в байт-код при создании или загрузке правила
+ * и выполняются маленьким стековым интерпретатором.
+ *
+ * Байт-код - в обратной польской записи, стек - из ALERT_RULE_STACK_DEPTH значений long:
+ *   RC_SENSOR t i  - показания датчика вида t (RuleTarget) с индексом i у связанного модуля,
+ *                    при отсутствии показаний берутся показания резервного датчика
+ *   RC_PIN p       - уровень на пине p
+ *   RC_CONST8 v    - константа, 1 байт со знаком
+ *   RC_CONST16 v   - константа, 2 байта со знаком, младший первым
+ *   RC_CONST32 v   - константа, 4 байта, младший первым
+ *   RC_OPEN_TEMP   - температура открытия из настроек
+ *   RC_CLOSE_TEMP  - температура закрытия из настроек
+ *   RC_LT, RC_LE, RC_GT, RC_GE, RC_EQ - сравнение двух верхних значений
+ *   RC_IN_RANGE    - значение, нижняя и верхняя граница - попадание в диапазон включительно
+ *   RC_HYST n      - значение, нижняя и верхняя граница - гистерезис: истина с верхней границы,
+ *                    ложь с нижней, между ними - прежнее состояние (хранится в бите n защёлок правила)
+ *   RC_AND, RC_OR, RC_NOT - логика
+ *   RC_TRUE        - истина (правило без датчика, работает только по времени)
+ *
+ * Если датчика нет совсем, правило не срабатывает. Если у датчика нет показаний и нет резерва,
+ * сравнение истинно только на равенство "нет данных" - так было и до байт-кода, правилом
+ * можно следить за отсутствием показаний.
+ *
+ * Текстовая запись составного условия (вид датчика EXPR в команде RULE_ADD):
+ *   условие  := ВИД индекс (оператор значение | '[' значение ':' значение ']' | '{' значение ':' значение '}')
+ *   оператор := < | <= | > | >= | =
+ *   значение := число | %TO% | %TC%
+ *   '[' ']' - диапазон, '{' '}' - гистерезис, '!' - НЕ, '&' - И, ',' - ИЛИ, скобки - группировка.
+ * Например: TEMP0{20:25}&!HUMIDITY1>80 - открыться при 25 градусах, закрыться при 20, но не при влажности выше 80.
+ * Датчики берутся у модуля, указанного в правиле (для примера выше - HUMIDITY, у него есть и температура, и влажность).
+ */
+
+typedef enum
+{
+  rtUnknown,
+  rtTemp, // за температурой следим
+  rtLuminosity, // за освещенностью следим
+  rtHumidity, // за влажностью следим
+  rtPinState, // следим за статусом пина
+  rtSoilMoisture, // следим за влажностью почвы
+  rtPH // следим за pH
+
+} RuleTarget; // за чем следит правило
+
+#define RC_SENSOR 0x01
+#define RC_PIN 0x02
+#define RC_CONST8 0x03
+#define RC_CONST16 0x04
+#define RC_CONST32 0x05
+#define RC_OPEN_TEMP 0x06
+#define RC_CLOSE_TEMP 0x07
+#define RC_LT 0x10
+#define RC_LE 0x11
+#define RC_GT 0x12
+#define RC_GE 0x13
+#define RC_EQ 0x14
+#define RC_IN_RANGE 0x15
+#define RC_HYST 0x16
+#define RC_AND 0x20
+#define RC_OR 0x21
+#define RC_NOT 0x22
+#define RC_TRUE 0x23
+
+#define RC_MAX_LATCHES 8 // защёлок гистерезиса на правило (биты одного байта)
+
+// собирает байт-код, попутно считая глубину стека
+class RuleCodeWriter
+{
+  private:
+    uint8_t code[ALERT_RULE_MAX_CODE_LENGTH];
+    uint8_t length;
+    uint8_t depth; // сколько значений на стеке после выполнения записанного кода
+    uint8_t latchesUsed;
+    bool failed;
+
+    void Write(uint8_t b);
+    void Push(); // код кладёт значение на стек
+    void Pop(uint8_t cnt); // код снимает значения со стека
+
+  public:
+    RuleCodeWriter() : length(0), depth(0), latchesUsed(0), failed(false) {}
+
+    void Sensor(uint8_t target, uint8_t sensorIndex);
+    void Pin(uint8_t pin);
+    void Const(long value);
+    void Op(uint8_t opcode); // операции без аргументов: сравнения, логика, RC_OPEN_TEMP, RC_CLOSE_TEMP, RC_TRUE
+    void Hysteresis();
+    void Fail() { failed = true; }
+
+    bool IsValid() const { return !failed && depth == 1; } // код собрался и оставляет на стеке ровно результат
+    const uint8_t* GetCode() const { return code; }
+    uint8_t GetLength() const { return length; }
+};
+
+void RuleTargetName(uint8_t target, String& out); // дописывает имя вида датчика, как оно пишется в команде
+
+// компилирует условие в старом формате команды RULE_ADD: вид датчика, индекс, операнд, значение
+bool RuleCompileCondition(RuleCodeWriter& writer, const char* target, uint8_t sensorIndex, const char* operand, const char* value);
+
+// компилирует составное условие в текстовой записи
+bool RuleCompileExpression(RuleCodeWriter& writer, const char* expression);
+
+// проверяет байт-код, прочитанный из EEPROM: известные операции, аргументы на месте, глубина стека в пределах
+bool RuleCodeVerify(const uint8_t* code, uint8_t length);
+
+// печатает условие для просмотра правила: "вид|индекс|операнд|значение" для простых условий,
+// которые можно записать в старом формате, и "EXPR|0|_|запись" - для составных
+void RuleCodePrint(const uint8_t* code, uint8_t length, String& out);
+
+typedef FixedVector<OneState*,ALERT_RULE_MAX_WATCHED_STATES> RuleWatchedStates; // датчики, за изменениями которых следит правило
+bool RuleIsWatched(const RuleWatchedStates& watched, const OneState* state);
+
+typedef struct
+{
+  AbstractModule* module; // модуль, с датчиками которого работает правило
+  uint8_t* latches; // защёлки гистерезиса правила
+
+  RuleWatchedStates watchedStates; // датчики, показания которых читало условие
+  bool volatileAlert; // результат зависит не только от показаний watchedStates
+
+} RuleCodeContext; // окружение выполнения байт-кода
+
+bool RuleCodeExecute(const uint8_t* code, uint8_t length, RuleCodeContext& context); // выполняет байт-код, возвращает результат условия
+
+#endif
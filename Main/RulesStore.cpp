@@ -0,0 +1,242 @@
+#include "RulesStore.h"
+
+#ifdef USE_ALERT_RULES_ON_SD
+
+RulesStore::RulesStore()
+{
+  rulesCount = 0;
+}
+File RulesStore::Open(bool forWrite)
+{
+  char fileName[13] = {0};
+  strcpy_P(fileName,(const char*) ALERT_RULES_FILE);
+
+  // пишем в произвольное место файла, поэтому без O_APPEND
+  return SD.open(fileName,forWrite ? (O_READ | O_WRITE | O_CREAT) : FILE_READ);
+}
+const char* RulesStore::GetField(const char* text, uint8_t field)
+{
+  while(field--)
+  {
+    text = strchr(text,'|');
+    if(!text)
+      return "";
+
+    text++;
+  }
+
+  return text;
+}
+void RulesStore::IndexRule(uint16_t idx, uint8_t flags, const char* text)
+{
+  const char* startTime = GetField(text,RULES_STORE_START_FIELD);
+
+  // время начала, продолжительность и маска дней идут подряд
+  index[idx].StartTime = (uint16_t) atoi(startTime);
+  index[idx].WorkTime = (uint16_t) atol(GetField(startTime,1));
+  index[idx].DayMask = (uint8_t) atoi(GetField(startTime,2));
+  index[idx].Enabled = (flags & RULES_STORE_FLAG_ENABLED) ? 1 : 0;
+}
+bool RulesStore::ReadSlot(File& f, uint16_t idx, uint8_t& flags, char* text)
+{
+  if(!f.seek((uint32_t) idx*ALERT_RULES_SD_SLOT_SIZE))
+    return false;
+
+  int b = f.read();
+  if(b < 0)
+    return false;
+
+  flags = b;
+
+  if(f.read(text,RULES_STORE_TEXT_SIZE) != RULES_STORE_TEXT_SIZE)
+    return false;
+
+  text[RULES_STORE_TEXT_SIZE-1] = 0;
+  return true;
+}
+bool RulesStore::WriteSlot(File& f, uint16_t idx, uint8_t flags, const char* text)
+{
+  if(!f.seek((uint32_t) idx*ALERT_RULES_SD_SLOT_SIZE))
+    return false;
+
+  f.write(flags);
+
+  // пишем слот целиком, чтобы файл всегда был кратен размеру слота
+  size_t len = strlen(text);
+  for(uint8_t i=0;i<RULES_STORE_TEXT_SIZE;i++)
+    f.write(i < len ? (uint8_t) text[i] : 0);
+
+  return true;
+}
+bool RulesStore::Begin()
+{
+  rulesCount = 0;
+
+  File f = Open(false);
+  if(!f) // файла ещё нет - правил нет
+    return true;
+
+  uint16_t cnt = f.size()/ALERT_RULES_SD_SLOT_SIZE;
+  if(cnt > MAX_SD_ALERT_RULES)
+    cnt = MAX_SD_ALERT_RULES;
+
+  char text[RULES_STORE_TEXT_SIZE];
+  uint8_t flags;
+  for(uint16_t i=0;i<cnt;i++)
+  {
+    if(!ReadSlot(f,i,flags,text) || !text[0]) // пустой слот - правила кончились
+      break;
+
+    IndexRule(i,flags,text);
+    rulesCount++;
+  } // for
+
+  f.close();
+  return true;
+}
+bool RulesStore::Read(uint16_t idx, char* text)
+{
+  if(idx >= rulesCount)
+    return false;
+
+  File f = Open(false);
+  if(!f)
+    return false;
+
+  uint8_t flags;
+  bool result = ReadSlot(f,idx,flags,text);
+  f.close();
+
+  return result;
+}
+int16_t RulesStore::Find(const char* name, size_t nameLen)
+{
+  File f = Open(false);
+  if(!f)
+    return -1;
+
+  char text[RULES_STORE_TEXT_SIZE];
+  uint8_t flags;
+  int16_t result = -1;
+
+  for(uint16_t i=0;i<rulesCount;i++)
+  {
+    if(!ReadSlot(f,i,flags,text))
+      break;
+
+    const char* ruleName = GetField(text,RULES_STORE_NAME_FIELD);
+    if(!strncmp(ruleName,name,nameLen) && ruleName[nameLen] == '|')
+    {
+      result = i;
+      break;
+    }
+  } // for
+
+  f.close();
+  return result;
+}
+bool RulesStore::Put(const char* text)
+{
+  if(strlen(text) >= RULES_STORE_TEXT_SIZE) // не влезает в слот
+    return false;
+
+  // имя правила - до следующего разделителя
+  const char* nameBegin = GetField(text,RULES_STORE_NAME_FIELD);
+  const char* nameEnd = strchr(nameBegin,'|');
+  if(!nameEnd || nameEnd == nameBegin)
+    return false;
+
+  int16_t idx = Find(nameBegin,nameEnd - nameBegin);
+  uint8_t flags = RULES_STORE_FLAG_ENABLED;
+
+  if(idx < 0) // новое правило - в конец
+  {
+    if(rulesCount >= MAX_SD_ALERT_RULES)
+      return false;
+
+    idx = rulesCount;
+  }
+  else
+  if(!index[idx].Enabled) // заменяем правило - включённость сохраняем
+    flags = 0;
+
+  File f = Open(true);
+  if(!f)
+    return false;
+
+  bool result = WriteSlot(f,idx,flags,text);
+  f.close();
+
+  if(result)
+  {
+    IndexRule(idx,flags,text);
+    if(idx == rulesCount)
+      rulesCount++;
+  }
+
+  return result;
+}
+bool RulesStore::SetEnabled(uint16_t idx, bool enabled)
+{
+  if(idx >= rulesCount)
+    return false;
+
+  File f = Open(true);
+  if(!f)
+    return false;
+
+  // флаги - первый байт слота, остальное не трогаем
+  bool result = f.seek((uint32_t) idx*ALERT_RULES_SD_SLOT_SIZE);
+  if(result)
+    f.write((uint8_t) (enabled ? RULES_STORE_FLAG_ENABLED : 0));
+
+  f.close();
+
+  if(result)
+    index[idx].Enabled = enabled ? 1 : 0;
+
+  return result;
+}
+bool RulesStore::Delete(uint16_t idx)
+{
+  if(idx >= rulesCount)
+    return false;
+
+  File f = Open(true);
+  if(!f)
+    return false;
+
+  char text[RULES_STORE_TEXT_SIZE];
+  uint8_t flags;
+
+  for(uint16_t i=idx+1;i<rulesCount;i++)
+  {
+    // не смогли сдвинуть - правило i осталось на месте и продублировано в слоте i-1, индекс повторяет то же,
+    // количество правил не трогаем: ни одно правило не потеряно
+    if(!ReadSlot(f,i,flags,text) || !WriteSlot(f,i-1,flags,text))
+    {
+      f.close();
+      return false;
+    }
+
+    index[i-1] = index[i];
+  } // for
+
+  rulesCount--;
+
+  // укорачивать файл библиотека SD не умеет, поэтому освободившийся последний слот делаем пустым
+  WriteSlot(f,rulesCount,0,"");
+  f.close();
+
+  return true;
+}
+void RulesStore::Clear()
+{
+  char fileName[13] = {0};
+  strcpy_P(fileName,(const char*) ALERT_RULES_FILE);
+  SD.remove(fileName);
+
+  rulesCount = 0;
+}
+
+#endif // USE_ALERT_RULES_ON_SD
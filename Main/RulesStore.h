@@ -0,0 +1,68 @@
+#ifndef _RULES_STORE_H
+#define _RULES_STORE_H
+
+#include <Arduino.h>
+#include "Globals.h"
+
+#ifdef USE_ALERT_RULES_ON_SD
+
+#include <SD.h>
+
+/*
+ * Хранилище правил алертов на SD-карте.
+ * Файл ALERT_RULES_FILE разбит на слоты по ALERT_RULES_SD_SLOT_SIZE байт, правило N - в слоте N.
+ * В слоте: первый байт - флаги (включено ли правило), дальше - текст правила с завершающим нулём,
+ * в том же виде, в каком оно пришло в команде: RULE_ADD|имя|модуль|...|CTSET=МОДУЛЬ|аргументы.
+ * Слот с пустым текстом означает конец списка правил (файл при удалении правил не укорачивается).
+ * В памяти держится только индекс - время работы и включённость каждого правила, чтобы без чтения
+ * с карты понять, какие правила работают в текущее время.
+ */
+
+typedef struct
+{
+  uint16_t StartTime : 15; // начало работы (минут от начала суток)
+  uint16_t Enabled : 1;
+  uint16_t WorkTime; // продолжительность работы, минут
+  uint8_t DayMask; // маска дней недели, когда работает правило
+
+} RulesStoreEntry; // запись индекса правил
+
+#define RULES_STORE_FLAG_ENABLED 1
+#define RULES_STORE_NAME_FIELD 1 // номер поля с именем правила в тексте
+#define RULES_STORE_START_FIELD 7 // номер поля с началом работы
+#define RULES_STORE_TEXT_SIZE (ALERT_RULES_SD_SLOT_SIZE - 1)
+#define RULES_STORE_NO_IDX 0xFFFF // индекс, которого нет в хранилище
+
+class RulesStore
+{
+  private:
+
+    RulesStoreEntry index[MAX_SD_ALERT_RULES];
+    uint16_t rulesCount;
+
+    File Open(bool forWrite);
+    bool ReadSlot(File& f, uint16_t idx, uint8_t& flags, char* text);
+    bool WriteSlot(File& f, uint16_t idx, uint8_t flags, const char* text);
+    void IndexRule(uint16_t idx, uint8_t flags, const char* text);
+
+  public:
+    RulesStore();
+
+    bool Begin(); // читает файл с правилами и строит индекс, false - если с картой работать нельзя
+
+    uint16_t GetCount() { return rulesCount; }
+    const RulesStoreEntry& GetEntry(uint16_t idx) { return index[idx]; }
+
+    bool Read(uint16_t idx, char* text); // читает текст правила, text - не меньше RULES_STORE_TEXT_SIZE байт
+    int16_t Find(const char* name, size_t nameLen); // ищет правило по имени, -1 - если не нашли
+    bool Put(const char* text); // добавляет правило или заменяет правило с тем же именем
+    bool SetEnabled(uint16_t idx, bool enabled);
+    bool Delete(uint16_t idx); // удаляет правило, все правила за ним сдвигаются к голове. false - не удалось, количество правил не меняется
+    void Clear(); // удаляет все правила
+
+    static const char* GetField(const char* text, uint8_t field); // возвращает начало поля текста правила, поля разделены '|'
+};
+
+#endif // USE_ALERT_RULES_ON_SD
+
+#endif
@@ -91,6 +91,20 @@ void SMSModule::ProcessAnswerLine(const String& line)
   }
 
 
+  // входящее SMS модем выдаёт в любой момент, в том числе посреди отсылки нашего SMS
+  if(waitForSMSInNextLine) // дождались входящего SMS
+  {
+    waitForSMSInNextLine = false;
+    ProcessIncomingSMS(line);
+    return;
+  }
+
+  if(line.startsWith(F("+CMT:")))
+  {
+    waitForSMSInNextLine = true;
+    return;
+  }
+
   bool okFound = false;
 
   switch(currentAction)
@@ -324,20 +338,8 @@ void SMSModule::ProcessAnswerLine(const String& line)
 
     case smaIdle:
     {
-      if(waitForSMSInNextLine) // дождались входящего SMS
-      {
-        waitForSMSInNextLine = false;
-        ProcessIncomingSMS(line);
-      }
-      
       if(line.startsWith(F("+CLIP:")))
         ProcessIncomingCall(line);
-      else
-      if(line.startsWith(F("+CMT:")))
-        waitForSMSInNextLine = true;
-       
-    
-
     }
     break;
   } // switch  
@@ -542,26 +544,8 @@ void SMSModule::ProcessIncomingSMS(const String& line) // обрабатывае
             Serial.print(F("command to execute = "));
             Serial.println(commandToExecute);
           #endif  
-            // парсим команду
-            CommandParser* cParser = MainController->GetCommandParser();
-            Command cmd;
-            if(cParser->ParseCommand(commandToExecute,cmd))
-            {
-          #ifdef GSM_DEBUG_MODE
-            Serial.println(F("Command parsed, execute it..."));
-          #endif                
-              // команду разобрали, можно исполнять
-              customSMSCommandAnswer = "";
-              cmd.SetIncomingStream(this);
-              MainController->ProcessModuleCommand(cmd);
-
-              // теперь получаем ответ
-              if(!answerMessage.length())
-                SendSMS(customSMSCommandAnswer);
-              else
-                SendSMS(answerMessage);
-              
-            } // if
+            // команду выполним в порядке общей очереди команд, там же и пошлём ответ
+            QueueSMS(commandToExecute,answerMessage);
     
             return; // возвращаемся, т.к. мы сами пошлём СМС с текстом, отличным от ОК
           } // if(smsFile)
@@ -585,7 +569,7 @@ void SMSModule::ProcessIncomingSMS(const String& line) // обрабатывае
   }
 
   if(shouldSendSMS) // надо послать СМС с ответом "ОК"
-    SendSMS(OK_ANSWER);
+    QueueSMS(String(),OK_ANSWER);
 
 
   
@@ -597,6 +581,89 @@ size_t SMSModule::write(uint8_t toWr)
  return 1; 
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+void SMSModule::QueueSMS(const String& command, const String& answer)
+{
+  if(queuedSMSCount >= SMS_COMMANDS_QUEUE_LENGTH)
+  {
+  #ifdef GSM_DEBUG_MODE
+    Serial.println(F("SMS commands queue is full, answer BUSY."));
+  #endif
+    busyAnswerQueued = true; // команду не теряем молча - просим повторить позже
+  }
+  else
+  {
+    queuedSMSCommands[queuedSMSCount] = command;
+    queuedSMSAnswers[queuedSMSCount] = answer;
+    queuedSMSCount++;
+  }
+
+  if(!IsQueued())
+    CommandsQueue.Enqueue(this);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void SMSModule::ExecuteQueuedCommand()
+{
+  // SMS отсылается в несколько шагов, а текст для отсылки у нас один - пока модем не закончил
+  // с прошлым SMS, ответ на следующую команду послать не сможем, ждём своей очереди ещё раз.
+  // Без регистрации в сети ждать нечего - SendSMS ответ всё равно не пошлёт.
+  if(isModuleRegistered && (currentAction != smaIdle || actionsQueue.size()))
+  {
+    CommandsQueue.Enqueue(this);
+    return;
+  }
+
+  if(busyAnswerQueued)
+  {
+    busyAnswerQueued = false;
+    SendSMS(SMS_BUSY_ANSWER);
+
+    if(queuedSMSCount)
+      CommandsQueue.Enqueue(this);
+    return;
+  }
+
+  if(!queuedSMSCount)
+    return;
+
+  // парсим команду
+  CommandParser* cParser = MainController->GetCommandParser();
+  Command cmd;
+  if(!queuedSMSCommands[0].length()) // команды нет - только ответ (ОК, статистика)
+    SendSMS(queuedSMSAnswers[0]);
+  else
+  if(cParser->ParseCommand(queuedSMSCommands[0],cmd))
+  {
+#ifdef GSM_DEBUG_MODE
+  Serial.println(F("Command parsed, execute it..."));
+#endif                
+    // команду разобрали, можно исполнять
+    customSMSCommandAnswer = "";
+    cmd.SetIncomingStream(this);
+    MainController->ProcessModuleCommand(cmd);
+
+    // теперь получаем ответ
+    if(!queuedSMSAnswers[0].length())
+      SendSMS(customSMSCommandAnswer);
+    else
+      SendSMS(queuedSMSAnswers[0]);
+    
+  } // if
+
+  // сдвигаем очередь к голове
+  queuedSMSCount--;
+  for(uint8_t i=0;i<queuedSMSCount;i++)
+  {
+    queuedSMSCommands[i] = queuedSMSCommands[i+1];
+    queuedSMSAnswers[i] = queuedSMSAnswers[i+1];
+  }
+
+  queuedSMSCommands[queuedSMSCount] = F("");
+  queuedSMSAnswers[queuedSMSCount] = F("");
+
+  if(queuedSMSCount) // остались ещё команды - встаём в конец очереди, пропуская вперёд другие источники
+    CommandsQueue.Enqueue(this);
+}
+//--------------------------------------------------------------------------------------------------------------------------------
 void SMSModule::ProcessIncomingCall(const String& line) // обрабатываем входящий звонок
 {
   // приходит строка вида
@@ -848,8 +915,9 @@ void SMSModule::ProcessQueuedWindowCommand(uint16_t dt)
 
         // теперь проверяем ответ. Если окна не в движении - нам вернётся OPEN или CLOSED последним параметром.
         // только в этом случае мы можем исполнять команду
-        const char* strPtr = PublishSingleton.Text.c_str();
-        int16_t idx = PublishSingleton.Text.lastIndexOf(PARAM_DELIMITER);
+        const String& answer = ModuleInterop.GetData(); // ответ целиком, PublishSingleton.Text мог уйти в поток по частям
+        const char* strPtr = answer.c_str();
+        int16_t idx = answer.lastIndexOf(PARAM_DELIMITER);
         if(idx != -1)
         {
           strPtr += idx + 1;
@@ -945,7 +1013,7 @@ void SMSModule::SendStatToCaller(const String& phoneNum)
       Serial.println(F("Command CTGET=STATE|WINDOW|0 parsed, execute it..."));
     #endif
 
-    const char* strPtr = PublishSingleton.Text.c_str();
+    const char* strPtr = ModuleInterop.GetData().c_str();
      if(strstr_P(strPtr,(const char*) STATE_OPEN))
         sms += W_OPEN;
       else
@@ -955,7 +1023,7 @@ void SMSModule::SendStatToCaller(const String& phoneNum)
      sms += NEWLINE;
  
     #ifdef GSM_DEBUG_MODE
-      Serial.print(F("Receive answer from STATE: ")); Serial.println(PublishSingleton.Text);
+      Serial.print(F("Receive answer from STATE: ")); Serial.println(ModuleInterop.GetData());
     #endif
   }
     // получаем состояние полива
@@ -967,7 +1035,7 @@ void SMSModule::SendStatToCaller(const String& phoneNum)
       Serial.println(F("Command CTGET=WATER parsed, execute it..."));
     #endif
 
-    const char* strPtr = PublishSingleton.Text.c_str();
+    const char* strPtr = ModuleInterop.GetData().c_str();
     if(strstr_P(strPtr,(const char*) STATE_OFF))
       sms += WTR_OFF;
     else
@@ -975,8 +1043,8 @@ void SMSModule::SendStatToCaller(const String& phoneNum)
           
   }
 
-  // тут отсылаем SMS
-  SendSMS(sms);
+  // SMS отсылаем в порядке очереди - модем может быть занят отсылкой предыдущего
+  QueueSMS(String(),sms);
 
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 #include "AbstractModule.h"
 #include "Settings.h"
 #include "TinyVector.h"
+#include "CommandQueue.h"
 
 typedef enum
 {
@@ -25,7 +26,7 @@ typedef enum
 
 typedef Vector<SMSActions> SMSActionsVector;
 
-class SMSModule : public AbstractModule, public Stream // модуль поддержки управления по SMS
+class SMSModule : public AbstractModule, public Stream, public CommandSource // модуль поддержки управления по SMS
 {
   private:
     GlobalSettings* Settings;
@@ -52,9 +53,16 @@ class SMSModule : public AbstractModule, public Stream // модуль подд
     void ProcessIncomingSMS(const String& line); // обрабатываем входящее СМС
 
     String customSMSCommandAnswer;
+
+    // команды из SMS, ждущие выполнения в общей очереди команд, по порядку прихода
+    String queuedSMSCommands[SMS_COMMANDS_QUEUE_LENGTH]; // пустая команда - надо только послать ответ
+    String queuedSMSAnswers[SMS_COMMANDS_QUEUE_LENGTH]; // сообщения, которые надо послать после выполнения команд
+    uint8_t queuedSMSCount;
+    bool busyAnswerQueued; // очередь была заполнена - надо ответить SMS_BUSY_ANSWER
+    void QueueSMS(const String& command, const String& answer); // ставит команду и ответ на неё в очередь
         
   public:
-    SMSModule() : AbstractModule("SMS") {}
+    SMSModule() : AbstractModule("SMS"), queuedSMSCount(0), busyAnswerQueued(false) {}
 
     bool ExecCommand(const Command& command, bool wantAnswer);
     void Setup();
@@ -64,6 +72,8 @@ class SMSModule : public AbstractModule, public Stream // модуль подд
     void SendSMS(const String& sms);
 
     void ProcessAnswerLine(const String& line);
+
+    virtual void ExecuteQueuedCommand();
     volatile bool WaitForSMSWelcome; // флаг, что мы ждём приглашения на отсыл SMS - > (плохое ООП, негодное :) )
 
     virtual int available(){ return false; };
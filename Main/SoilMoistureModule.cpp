@@ -24,7 +24,10 @@ void SoilMoistureModule::Update(uint16_t dt)
   
   lastUpdateCall += dt;
   if(lastUpdateCall < SOIL_MOISTURE_UPDATE_INTERVAL) // обновляем согласно настроенному интервалу
+  {
+    SleepFor(SOIL_MOISTURE_UPDATE_INTERVAL - lastUpdateCall); // до этого времени нас можно не обновлять
     return;
+  }
   else
     lastUpdateCall = 0; 
     
@@ -1,12 +1,13 @@
 #include "StatModule.h"
 #include "ModuleController.h"
+#include "UARTLineBuffer.h"
 
 // выводит свободную память
 int freeRam() 
 {
   extern int __heap_start, *__brkval;
   int v;
-  return (int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+  return (int) ((size_t) &v - (__brkval == 0 ? (size_t) &__heap_start : (size_t) __brkval));
 }
 
 
@@ -65,6 +66,34 @@ bool  StatModule::ExecCommand(const Command& command, bool wantAnswer)
             PublishSingleton << PARAM_DELIMITER <<  (unsigned long) uptime/1000;
           }
         }
+        else
+        if(t == POOL_COMMAND) // запросили занятость пула состояний датчиков
+        {
+          PublishSingleton.Status = true;
+          if(wantAnswer) 
+          {
+            PublishSingleton = POOL_COMMAND;
+            PublishSingleton << PARAM_DELIMITER << OneState::GetPoolUsed() << PARAM_DELIMITER << OneState::GetPoolPeak()
+            << PARAM_DELIMITER << STATE_POOL_SIZE << PARAM_DELIMITER << OneState::GetPoolFailed();
+          }
+        }
+        else
+        if(t == UART_COMMAND) // запросили статистику приёма по UART
+        {
+          PublishSingleton.Status = true;
+          if(wantAnswer) 
+          {
+            PublishSingleton = UART_COMMAND;
+          #ifdef USE_WIFI_MODULE
+            PublishSingleton << PARAM_DELIMITER << F("WIFI,") << wiFiReceiveBuff.GetLinesCount() << F(",") 
+            << wiFiReceiveBuff.GetLostCount() << F(",") << wiFiReceiveBuff.GetRXFullCount() << F(",") << wiFiReceiveBuff.GetOverflowCount();
+          #endif
+          #ifdef USE_SMS_MODULE
+            PublishSingleton << PARAM_DELIMITER << F("GSM,") << smsReceiveBuff.GetLinesCount() << F(",") 
+            << smsReceiveBuff.GetLostCount() << F(",") << smsReceiveBuff.GetRXFullCount() << F(",") << smsReceiveBuff.GetOverflowCount();
+          #endif
+          }
+        }
      #ifdef USE_DS3231_REALTIME_CLOCK   
         else if(t == CURDATETIME_COMMAND)
         {
@@ -9,6 +9,9 @@ TCPClient::TCPClient()
   isConnected = false;
   commandHolder = F("");
   hasFullCommand = false; 
+#ifdef USE_BINARY_PROTOCOL
+  hasBinaryFrame = false;
+#endif
   Clear();
 }
 TCPClient::~TCPClient()
@@ -33,12 +36,29 @@ void TCPClient::Update()
 {
   if(hasFullCommand)
   {
-    // есть полная команда, надо её обработать
-    Prepare(commandHolder.c_str()); 
-    commandHolder = F(""); // подготавливаем команду
+    // есть полная команда, её обработаем, когда до нас дойдёт общая очередь команд
+    CommandsQueue.Enqueue(this);
+  }
+}
+void TCPClient::ExecuteQueuedCommand()
+{
+  if(!hasFullCommand)
+    return;
 
-    hasFullCommand = false; // сбрасываем флаг наличия полной команды
+#ifdef USE_BINARY_PROTOCOL
+  if(hasBinaryFrame)
+  {
+    PrepareBinary(); // бинарная команда сама разбирается и отвечает кадрами
+    hasBinaryFrame = false;
+    hasFullCommand = false;
+    return;
   }
+#endif
+    
+  Prepare(commandHolder.c_str()); 
+  commandHolder = F(""); // подготавливаем команду
+
+  hasFullCommand = false; // сбрасываем флаг наличия полной команды
 }
 void TCPClient::CommandRequested(int dataLen, const char* command)
 {
@@ -46,6 +66,25 @@ void TCPClient::CommandRequested(int dataLen, const char* command)
     return;
     
   int ln = 0;
+
+#ifdef USE_BINARY_PROTOCOL
+  // бинарный кадр может начаться только вместо текстовой команды, не посреди неё. В кадре могут
+  // быть любые байты, поэтому пакет +IPD принимается как есть, по длине (см. WIFI_EVENT_FUNC)
+  while(ln < dataLen && (frame.IsReceiving() || (!commandHolder.length() && (uint8_t) *command == BIN_FRAME_START)))
+  {
+    bool received = frame.Feed(*command);
+    ln++;
+    command++;
+
+    if(received)
+    {
+      hasBinaryFrame = true;
+      hasFullCommand = true; // кадр принят, остаток пакета игнорируем
+      return;
+    }
+  } // while
+#endif
+
   while(ln < dataLen)
   {
     if(*command == '\r') // если прямо в пакете нашли \r - значит, команда получена полностью, иначе - будем ждать следующего пакета
@@ -109,6 +148,24 @@ bool TCPClient::Prepare(const char* command)
    WriteErrorToFile();
  }
 
+  return PreparePackets();
+}
+#ifdef USE_BINARY_PROTOCOL
+bool TCPClient::PrepareBinary()
+{
+  if(HasPacket())
+    return false;
+
+  Clear();
+  CloseSDFile();
+
+  frame.Execute(this); // кадры ответа пишутся туда же, куда и текстовый ответ - в кеш и файл
+
+  return PreparePackets();
+}
+#endif
+bool TCPClient::PreparePackets()
+{
    // теперь считаем длину данных
   contentLength = cachedData.length();
 
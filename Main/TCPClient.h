@@ -2,9 +2,14 @@
 #define _TCP_CLIENT_H
 #include "Globals.h"
 #include "ModuleController.h"
+#include "CommandQueue.h"
 #include <SD.h>
 #include <Arduino.h>
 
+#ifdef USE_BINARY_PROTOCOL
+#include "BinaryProtocol.h"
+#endif
+
 // класс обработки запроса, посланного по TCP/IP на ESP8266. Подготавливает данные,
 // настраивает кол-во пакетов для отсылки, отсылает очередной пакет по приглашению.
 // ничего не знает о статусах соединения, надо дёргать SetConnected вручную.
@@ -18,7 +23,7 @@
 
 #define CACHE_LENGTH 256 // сколько байт кешировать в ответе
 
-class TCPClient : public Stream
+class TCPClient : public Stream, public CommandSource
 {
   private:
 
@@ -41,6 +46,13 @@ class TCPClient : public Stream
     String commandHolder; // сюда складываем команду
     bool hasFullCommand; // флаг, что приняли всю команду
     bool Prepare(const char* command); // подготавливаем данные для отправки
+    bool PreparePackets(); // считаем пакеты для отсылки того, что ответил модуль
+
+#ifdef USE_BINARY_PROTOCOL
+    BinaryFrameReader frame; // бинарная команда с клиента
+    bool hasBinaryFrame;
+    bool PrepareBinary(); // выполняем бинарную команду и готовим к отправке её ответ
+#endif
 
     void OpenSDFile();
     void CloseSDFile();
@@ -55,9 +67,12 @@ class TCPClient : public Stream
     void Setup(uint8_t clientID, uint16_t maxPacketLength) {tcpClientID = clientID; MAX_PACKET_LENGTH = maxPacketLength;}
 
     // обновляем внутреннее состояние клиента в вызове Update модуля, в котором работает клиент. Как только клиент получит полный пакет данных - он
-    // обработает команду, сложит весь ответ в промежуточный файл и будет готов к передаче (HasPacket будет возвращать true).
+    // встанет в общую очередь команд. Когда до него дойдёт очередь, он обработает команду, сложит весь ответ в промежуточный файл
+    // и будет готов к передаче (HasPacket будет возвращать true).
     void Update(); 
 
+    virtual void ExecuteQueuedCommand();
+
 
     bool IsConnected(){return isConnected;} // клиент законнекчен?
     void SetConnected(bool c); // устанавливаем флаг соединения клиента
@@ -9,6 +9,7 @@ PeriodicTimer::PeriodicTimer()
   isHoldOnTimer = true;
   tTimer = 0;
   lastPinState = 0xFF;
+  dayActive = true;
   memset(&Settings,0,sizeof(Settings));
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -40,6 +41,8 @@ void PeriodicTimer::Off()
 //--------------------------------------------------------------------------------------------------------------------------------
 void PeriodicTimer::Init()
 {
+  UpdateDay();
+  
   if(Settings.Pin)
   {
     pinMode(Settings.Pin, OUTPUT);
@@ -51,6 +54,14 @@ void PeriodicTimer::Init()
   }
 }
 //--------------------------------------------------------------------------------------------------------------------------------
+void PeriodicTimer::UpdateDay()
+{
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    // день недели берём у календаря, часы не читаем
+    dayActive = (Settings.DayMaskAndEnable & (1 << (Calendar.GetTime().dayOfWeek-1)));
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
 bool PeriodicTimer::IsActive()
 {
   bool en = (Settings.DayMaskAndEnable & 128);
@@ -59,10 +70,8 @@ bool PeriodicTimer::IsActive()
     // нет часов реального времени в прошивке, работаем просто по флагу "Таймер включён"
     return en;
   #else
-    // модуль часов реального времени есть в прошивке, проверяем маску дней недели
-    DS3231Clock watch =  MainController->GetClock();
-    DS3231Time t =   watch.getTime();
-    return en && (Settings.DayMaskAndEnable & (1 << (t.dayOfWeek-1)));
+    // модуль часов реального времени есть в прошивке, маска дней недели пересчитывается в полночь по будильнику календаря
+    return en && dayActive;
   #endif
 }
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -139,7 +148,28 @@ void TimerModule::Setup()
   
   for(byte i=0;i<NUM_TIMERS;i++)
     timers[i].Init();
+
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    ScheduleDayChange();
+  #endif
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+#ifdef USE_DS3231_REALTIME_CLOCK
+void TimerModule::ScheduleDayChange()
+{
+  Calendar.SetAlarm(this,0,Calendar.MinutesUntil(0,Calendar.GetMinuteOfDay()));
+}
+//--------------------------------------------------------------------------------------------------------------------------------
+void TimerModule::OnCalendarEvent(uint8_t tag)
+{
+  UNUSED(tag);
+  
+  for(byte i=0;i<NUM_TIMERS;i++)
+    timers[i].UpdateDay();
+
+  ScheduleDayChange();
 }
+#endif
 //--------------------------------------------------------------------------------------------------------------------------------
 void TimerModule::Update(uint16_t dt)
 { 
@@ -2,6 +2,7 @@
 #define _TIMER_MODULE_H
 
 #include "AbstractModule.h"
+#include "Calendar.h"
 //--------------------------------------------------------------------------------------------------------------------------------
 #define NUM_TIMERS 4 // кол-во таймеров
 //--------------------------------------------------------------------------------------------------------------------------------
@@ -28,6 +29,7 @@ class PeriodicTimer
 
   bool IsActive(); // возвращает true, если таймер активен
   void Init(); // инициализирует таймер
+  void UpdateDay(); // пересчитывает, работает ли таймер в текущий день недели
 
   void On();
   void Off();
@@ -37,9 +39,13 @@ private:
   unsigned long tTimer; // таймер последнего обновления
   bool isHoldOnTimer; // если true - то ждём истечения периода включения, иначе - истечение периода выключения
   byte lastPinState; 
+  bool dayActive; // текущий день недели есть в маске дней таймера
 };
 //--------------------------------------------------------------------------------------------------------------------------------
 class TimerModule : public AbstractModule // модуль таймеров
+#ifdef USE_DS3231_REALTIME_CLOCK
+, public CalendarListener
+#endif
 {
   private:
 
@@ -47,6 +53,10 @@ class TimerModule : public AbstractModule // модуль таймеров
   void SaveTimers();
 
   PeriodicTimer timers[NUM_TIMERS]; // наши таймеры
+
+#ifdef USE_DS3231_REALTIME_CLOCK
+  void ScheduleDayChange(); // заводит будильник на полночь - маска дней недели проверяется только тогда
+#endif
   
   public:
     TimerModule() : AbstractModule("TMR") {}
@@ -55,6 +65,10 @@ class TimerModule : public AbstractModule // модуль таймеров
     void Setup();
     void Update(uint16_t dt);
 
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    virtual void OnCalendarEvent(uint8_t tag); // начался новый день недели
+  #endif
+
 };
 
 
@@ -3,78 +3,285 @@
 
 #include <Arduino.h>
 
-// Minimal class to replace std::vector
+// Placement new with its own signature, so we don't depend on <new> being shipped with the core
+struct VectorPlacement {};
+inline void* operator new(size_t, VectorPlacement, void* where) { return where; }
+inline void operator delete(void*, VectorPlacement, void*) {}
+
+template<typename Data>
+inline Data&& VectorMove(Data& x) { return static_cast<Data&&>(x); } // std::move replacement
+
+// Inline storage for N elements, no storage at all when N == 0 (empty base, takes no space)
+template<typename Data, size_t N>
+struct VectorInlineBuffer
+{
+    Data* inlineData() { return (Data*) d_inline; }
+    const Data* inlineData() const { return (const Data*) d_inline; }
+    alignas(Data) uint8_t d_inline[N*sizeof(Data)];
+};
+
 template<typename Data>
-class Vector {
+struct VectorInlineBuffer<Data,0>
+{
+    Data* inlineData() { return 0; }
+    const Data* inlineData() const { return 0; }
+};
+
+// Minimal class to replace std::vector.
+// First InlineCapacity elements live inside the object itself, the heap is used only beyond that.
+// Elements are constructed, copied and destroyed as objects, not as raw memory.
+template<typename Data, size_t InlineCapacity = 0>
+class Vector : private VectorInlineBuffer<Data,InlineCapacity> {
 
     size_t d_size; // Stores no. of actually stored objects
     size_t d_capacity; // Stores allocated capacity
-    Data *d_data; // Stores data this is this "heap" we need a function that returns a pointer to this value, to print it
+    Data *d_data; // Points to the inline buffer or to the heap block
+
 public:
-    Vector() : d_size(0), d_capacity(0), d_data(0) {}; // Default constructor
+    Vector() : d_size(0), d_capacity(InlineCapacity), d_data(this->inlineData()) {}; // Default constructor
 
-    Vector(Vector const &other) : d_size(other.d_size), d_capacity(other.d_capacity), d_data(0) //for when you set 1 vector = to another
+    Vector(Vector const &other) : d_size(0), d_capacity(InlineCapacity), d_data(this->inlineData())
     {
-        d_data = (Data *)malloc(d_capacity*sizeof(Data));
-        memcpy(d_data, other.d_data, d_size*sizeof(Data));
+        copyFrom(other);
     }; // Copy constuctor
 
-    ~Vector() //this gets called
+    Vector(Vector &&other) : d_size(0), d_capacity(InlineCapacity), d_data(this->inlineData())
+    {
+        moveFrom(other);
+    }; // Move constructor
+
+    ~Vector()
     {
-        free(d_data);
+        destroyAll();
+        freeHeap();
     }; // Destructor
 
     Vector &operator=(Vector const &other)
     {
-        free(d_data);
-        d_size = other.d_size;
-        d_capacity = other.d_capacity;
-        d_data = (Data *)malloc(d_capacity*sizeof(Data));
-        memcpy(d_data, other.d_data, d_size*sizeof(Data));
+        if(this != &other)
+        {
+            destroyAll();
+            copyFrom(other);
+        }
         return *this;
-    }; // Needed for memory management
+    };
 
-    void push_back(Data const &x)
+    Vector &operator=(Vector &&other)
     {
-        if (d_capacity == d_size) //when he pushes data onto the heap, he checks to see if the storage is full
-            resize();  //if full - resize
+        if(this != &other)
+        {
+            destroyAll();
+            freeHeap();
+            moveFrom(other);
+        }
+        return *this;
+    };
+
+    bool push_back(Data const &x)
+    {
+        if (d_capacity == d_size)
+            return grow(d_size + 1, &x); // grow() constructs x itself, x may live in our own storage
 
-        d_data[d_size++] = x;
-    }; // Adds new value. If needed, allocates more space
+        ::new (VectorPlacement(), &d_data[d_size]) Data(x);
+        d_size++;
+        return true;
+    }; // Adds new value. If needed, allocates more space. Returns false if out of memory
 
-    void pop() // extract the last element by simple decrease the write pointer
+    bool push_back(Data &&x)
+    {
+        if (d_capacity == d_size)
+            return grow(d_size + 1, &x, true);
+
+        ::new (VectorPlacement(), &d_data[d_size]) Data(VectorMove(x));
+        d_size++;
+        return true;
+    };
+
+    void pop() // extract the last element
     {
         if(d_size)
-          --d_size;
+          d_data[--d_size].~Data();
     };
 
-    void Clear() //here
+    void Clear() // removes all elements and gives the heap block back
     {
-        if(d_data)
-          memset(d_data, 0, d_size);
-        d_capacity = 0;
-        d_size = 0;
-        free(d_data);
-        d_data = NULL;
+        destroyAll();
+        freeHeap();
+    }
+
+    bool reserve(size_t newCapacity) // makes room for newCapacity elements in advance
+    {
+        if(newCapacity <= d_capacity)
+            return true;
+
+        return grow(newCapacity, 0);
     }
 
     size_t size() const { return d_size; }; // Size getter
+    size_t capacity() const { return d_capacity; };
 
     Data const &operator[](size_t idx) const { return d_data[idx]; }; // Const getter
 
     Data &operator[](size_t idx) { return d_data[idx]; }; // Changeable getter
 
-    Data *pData() { return (Data*)d_data; }
+    Data *pData() { return d_data; }
 
 private:
-    void resize()
+
+    bool isInline() const { return d_data == this->inlineData(); }
+
+    void destroyAll()
+    {
+        while(d_size)
+            d_data[--d_size].~Data();
+    }
+
+    void freeHeap() // call only when there are no elements
+    {
+        if(!isInline())
+            free(d_data);
+
+        d_data = this->inlineData();
+        d_capacity = InlineCapacity;
+    }
+
+    void copyFrom(Vector const &other)
+    {
+        if(!reserve(other.d_size))
+            return;
+
+        for(size_t i=0;i<other.d_size;i++)
+            ::new (VectorPlacement(), &d_data[i]) Data(other.d_data[i]);
+
+        d_size = other.d_size;
+    }
+
+    void moveFrom(Vector &other)
+    {
+        if(!other.isInline()) // take the heap block as is
+        {
+            d_data = other.d_data;
+            d_size = other.d_size;
+            d_capacity = other.d_capacity;
+
+            other.d_data = other.inlineData();
+            other.d_size = 0;
+            other.d_capacity = InlineCapacity;
+            return;
+        }
+
+        for(size_t i=0;i<other.d_size;i++)
+            ::new (VectorPlacement(), &d_data[i]) Data(VectorMove(other.d_data[i]));
+
+        d_size = other.d_size;
+        other.destroyAll();
+    }
+
+    // Moves elements to a bigger block. If toAdd is passed, it is constructed at the end of the new block
+    // before the old one is released, so push_back of our own element stays correct.
+    bool grow(size_t minCapacity, const Data* toAdd, bool moveAdded = false)
     {
-        d_capacity = d_capacity ? d_capacity * 2 : 1;
-        Data *newdata = (Data *)malloc(d_capacity*sizeof(Data)); //allocates new memory
-        memcpy(newdata, d_data, d_size * sizeof(Data));  //copies all the old memory over
-        free(d_data);                                          //free old
+        size_t newCapacity = d_capacity ? d_capacity * 2 : 4;
+        if(newCapacity < minCapacity)
+            newCapacity = minCapacity;
+
+        Data *newdata = (Data *)malloc(newCapacity*sizeof(Data));
+        if(!newdata)
+            return false;
+
+        if(toAdd)
+        {
+            if(moveAdded)
+                ::new (VectorPlacement(), &newdata[d_size]) Data(VectorMove(*const_cast<Data*>(toAdd)));
+            else
+                ::new (VectorPlacement(), &newdata[d_size]) Data(*toAdd);
+        }
+
+        for(size_t i=0;i<d_size;i++)
+        {
+            ::new (VectorPlacement(), &newdata[i]) Data(VectorMove(d_data[i]));
+            d_data[i].~Data();
+        }
+
+        size_t cnt = d_size + (toAdd ? 1 : 0);
+        d_size = 0;
+        freeHeap();
+
         d_data = newdata;
-    };// Allocates double the old space
+        d_capacity = newCapacity;
+        d_size = cnt;
+        return true;
+    };
+};
+
+// Vector with fixed capacity, never touches the heap. push_back returns false when full.
+template<typename Data, size_t Capacity>
+class FixedVector : private VectorInlineBuffer<Data,Capacity> {
+
+    size_t d_size;
+
+public:
+    FixedVector() : d_size(0) {};
+
+    FixedVector(FixedVector const &other) : d_size(0)
+    {
+        copyFrom(other);
+    };
+
+    ~FixedVector()
+    {
+        Clear();
+    };
+
+    FixedVector &operator=(FixedVector const &other)
+    {
+        if(this != &other)
+        {
+            Clear();
+            copyFrom(other);
+        }
+        return *this;
+    };
+
+    bool push_back(Data const &x)
+    {
+        if(d_size >= Capacity)
+            return false;
+
+        ::new (VectorPlacement(), &this->inlineData()[d_size]) Data(x);
+        d_size++;
+        return true;
+    };
+
+    void pop()
+    {
+        if(d_size)
+            this->inlineData()[--d_size].~Data();
+    };
+
+    void Clear()
+    {
+        while(d_size)
+            this->inlineData()[--d_size].~Data();
+    };
+
+    size_t size() const { return d_size; };
+    size_t capacity() const { return Capacity; };
+
+    Data const &operator[](size_t idx) const { return this->inlineData()[idx]; };
+
+    Data &operator[](size_t idx) { return this->inlineData()[idx]; };
+
+    Data *pData() { return this->inlineData(); }
+
+private:
+    void copyFrom(FixedVector const &other)
+    {
+        for(size_t i=0;i<other.d_size;i++)
+            ::new (VectorPlacement(), &this->inlineData()[i]) Data(other[i]);
+
+        d_size = other.d_size;
+    }
 };
 
 #endif
@@ -0,0 +1,115 @@
+#include "UARTLineBuffer.h"
+
+UARTLineBuffer::UARTLineBuffer(uint8_t* ringBuffer, uint16_t ringLen, uint16_t maxLen) : ring(ringBuffer), ringSize(ringLen)
+, ringHead(0), ringTail(0), maxLength(maxLen), overflowed(false), linesCount(0), lostCount(0), rxFullCount(0), overflowCount(0)
+{
+}
+
+void UARTLineBuffer::Receive(HardwareSerial& serial)
+{
+  // кольцевой буфер ядра вмещает на один байт меньше своего размера. Если он заполнен -
+  // прерывание приёма выкидывает все последующие байты, и часть данных могла потеряться.
+  int cnt = serial.available();
+  if(cnt >= SERIAL_RX_BUFFER_SIZE - 1)
+    rxFullCount++;
+
+  while(cnt-- > 0)
+  {
+    uint8_t ch = serial.read();
+    uint16_t next = ringHead + 1;
+    if(next >= ringSize)
+      next = 0;
+
+    if(next == ringTail) // кольцо заполнено, loop не успевает выгребать
+    {
+      lostCount++;
+      continue;
+    }
+
+    ring[ringHead] = ch;
+    ringHead = next;
+  } // while
+}
+
+int UARTLineBuffer::Available()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  int cnt = ringHead >= ringTail ? ringHead - ringTail : ringSize - ringTail + ringHead;
+  SREG = oldSREG;
+
+  return cnt;
+}
+
+int UARTLineBuffer::Read()
+{
+  int ch = -1;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  if(ringHead != ringTail)
+  {
+    ch = ring[ringTail];
+    uint16_t next = ringTail + 1;
+    ringTail = next >= ringSize ? 0 : next;
+  }
+  SREG = oldSREG;
+
+  return ch;
+}
+
+void UARTLineBuffer::Append(char ch)
+{
+  if(overflowed) // строка уже не поместилась, ждём её конца
+    return;
+
+  if(line.length() >= maxLength)
+  {
+    overflowed = true;
+    return;
+  }
+
+  line += ch;
+}
+
+void UARTLineBuffer::AddNewLine()
+{
+  if(!overflowed)
+    line += NEWLINE;
+}
+
+bool UARTLineBuffer::StartsWith(const __FlashStringHelper* prefix)
+{
+  return !strncmp_P(line.c_str(),(const char*) prefix,strlen_P((const char*) prefix));
+}
+
+void UARTLineBuffer::ClearLine()
+{
+  if(overflowed)
+    overflowCount++;
+  else
+    linesCount++;
+
+  overflowed = false;
+  line = F("");
+}
+
+unsigned long UARTLineBuffer::GetLostCount()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long cnt = lostCount;
+  SREG = oldSREG;
+
+  return cnt;
+}
+
+unsigned long UARTLineBuffer::GetRXFullCount()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long cnt = rxFullCount;
+  SREG = oldSREG;
+
+  return cnt;
+}
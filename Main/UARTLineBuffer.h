@@ -0,0 +1,61 @@
+#ifndef _UART_LINE_BUFFER_H
+#define _UART_LINE_BUFFER_H
+
+#include <Arduino.h>
+#include "Globals.h"
+
+// класс для приёма строк от модулей по UART (Wi-Fi, GSM).
+// Кольцевой буфер ядра вмещает всего SERIAL_RX_BUFFER_SIZE байт, и если loop надолго занят
+// (запись на SD, опрос датчиков) - байты теряются. Поэтому в прерывании таймера 0 (раз в 1024 мкс)
+// принятое ядром перекладывается в своё кольцо побольше, а строки собираются из него уже в loop.
+// Строка собирается в заранее зарезервированной памяти: длиннее maxLength - отбрасывается целиком и считается.
+class UARTLineBuffer
+{
+private:
+  // приёмное кольцо: пишет в него только прерывание (ringHead), читает только loop (ringTail)
+  volatile uint8_t* ring;
+  uint16_t ringSize;
+  volatile uint16_t ringHead;
+  volatile uint16_t ringTail;
+
+  String line; // собираемая строка
+  uint16_t maxLength; // максимальная длина строки
+  bool overflowed; // строка не поместилась, ждём её конца
+
+  unsigned long linesCount; // сколько строк собрано
+  volatile unsigned long lostCount; // сколько байт потеряно из-за заполненного кольца
+  volatile unsigned long rxFullCount; // сколько раз находили приёмный буфер ядра заполненным (возможна потеря байт)
+  unsigned long overflowCount; // сколько строк отброшено из-за длины
+
+public:
+  UARTLineBuffer(uint8_t* ringBuffer, uint16_t ringLen, uint16_t maxLen);
+
+  void Receive(HardwareSerial& serial); // вызывается из прерывания: перекладывает принятое ядром в кольцо
+  int Available(); // сколько байт ждёт в кольце
+  int Read(); // байт из кольца, -1 - если пусто
+
+  void Reserve() {line.reserve(maxLength + 2);} // резервирует память под строку, +2 под перевод строки
+  void Append(char ch); // добавляем символ к строке
+  void AddNewLine(); // добавляем к строке перевод строки (для пакетов +IPD)
+
+  bool StartsWith(const __FlashStringHelper* prefix); // начинается ли строка с переданного префикса
+  const String& GetLine() {return line;}
+  bool IsOverflowed() {return overflowed;} // строка не поместилась - её нельзя обрабатывать, только очистить
+  void ClearLine(); // строка обработана, начинаем собирать следующую
+
+  unsigned long GetLinesCount() {return linesCount;}
+  unsigned long GetOverflowCount() {return overflowCount;}
+  unsigned long GetLostCount();
+  unsigned long GetRXFullCount();
+
+};
+
+#ifdef USE_WIFI_MODULE
+extern UARTLineBuffer wiFiReceiveBuff; // строки от модуля Wi-Fi
+#endif
+
+#ifdef USE_SMS_MODULE
+extern UARTLineBuffer smsReceiveBuff; // строки от GSM-модема
+#endif
+
+#endif
@@ -749,6 +749,32 @@ NextionUniClient::NextionUniClient()
 {
   updateTimer = 0;
   tempChanged = false;
+  listening = false;
+  sensorsChanged = true;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+bool NextionUniClient::IsShown(OneState* state)
+{
+  // модуль у состояния не спросить - сверяем вид и индекс, совпадение у другого модуля даст только лишнюю запись
+  for(byte i=0;UNI_NX_SENSORS_DATA[i].sensorType > 0;i++)
+  {
+    if(UNI_NX_SENSORS_DATA[i].sensorType == state->GetType() && UNI_NX_SENSORS_DATA[i].sensorIndex == state->GetIndex())
+      return true;
+  }
+
+  return false;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void NextionUniClient::OnStateChanged(OneState* state)
+{
+  if(IsShown(state))
+    sensorsChanged = true;
+}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+void NextionUniClient::OnStateRemoved(OneState* state)
+{
+  if(IsShown(state))
+    sensorsChanged = true; // датчик пропадёт с экрана при следующей записи
 }
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 void NextionUniClient::Register(UniRawScratchpad* scratchpad)
@@ -763,6 +789,9 @@ void NextionUniClient::Update(UniRawScratchpad* scratchpad, bool isModuleOnline,
   if(!isModuleOnline) // не надо ничего делать
     return;
 
+  if(!listening) // подписываемся при первом обмене, к этому времени все глобальные объекты уже созданы
+    listening = StateChanges.Subscribe(this);
+
   // сначала проверяем, чего там у нас нажато в дисплее
   UniNextionScratchpad ourScratch;
   memcpy(&ourScratch,scratchpad->data,sizeof(UniNextionScratchpad));
@@ -930,22 +959,29 @@ void NextionUniClient::Update(UniRawScratchpad* scratchpad, bool isModuleOnline,
     tempChanged = false;
   }
 
+  // состояние контроллера и настройки сверяем с тем, что сейчас в дисплее, - так же заметим и его перезапуск
+  byte status = 0;
+  bitWrite(status,0, WORK_STATUS.GetStatus(WINDOWS_STATUS_BIT));
+  bitWrite(status,1, WORK_STATUS.GetStatus(WINDOWS_MODE_BIT));
+  bitWrite(status,2, WORK_STATUS.GetStatus(WATER_STATUS_BIT));
+  bitWrite(status,3, WORK_STATUS.GetStatus(WATER_MODE_BIT));
+  bitWrite(status,4, WORK_STATUS.GetStatus(LIGHT_STATUS_BIT));
+  bitWrite(status,5, WORK_STATUS.GetStatus(LIGHT_MODE_BIT));
+
+  GlobalSettings* sett = MainController->GetSettings();
+  bool statusChanged = (ourScratch.controllerStatus & 0x3F) != status || ourScratch.openTemperature != sett->GetOpenTemp()
+    || ourScratch.closeTemperature != sett->GetCloseTemp();
+
   // теперь проверяем, надо ли нам записывать настройки немедленно
    unsigned long curMillis = millis();
-   bool needToWrite = (changesCount > 0) || (curMillis - updateTimer > 1000);
+   bool needToWrite = (changesCount > 0) || statusChanged || sensorsChanged || (!listening && curMillis - updateTimer > 1000);
    if(needToWrite)
    {
     // надо записать текущее положение дел в Nextion
       updateTimer = curMillis;
+      sensorsChanged = false;
 
-      bitWrite(ourScratch.controllerStatus,0, WORK_STATUS.GetStatus(WINDOWS_STATUS_BIT));
-      bitWrite(ourScratch.controllerStatus,1, WORK_STATUS.GetStatus(WINDOWS_MODE_BIT));
-      bitWrite(ourScratch.controllerStatus,2, WORK_STATUS.GetStatus(WATER_STATUS_BIT));
-      bitWrite(ourScratch.controllerStatus,3, WORK_STATUS.GetStatus(WATER_MODE_BIT));
-      bitWrite(ourScratch.controllerStatus,4, WORK_STATUS.GetStatus(LIGHT_STATUS_BIT));
-      bitWrite(ourScratch.controllerStatus,5, WORK_STATUS.GetStatus(LIGHT_MODE_BIT));
-
-      GlobalSettings* sett = MainController->GetSettings();
+      ourScratch.controllerStatus = (ourScratch.controllerStatus & ~0x3F) | status;
       ourScratch.openTemperature = sett->GetOpenTemp();
       ourScratch.closeTemperature = sett->GetCloseTemp();
 
@@ -1276,15 +1312,17 @@ bool UniRegDispatcher::AddUniSensor(UniSensorType type, uint8_t sensorIndex)
           // здесь sensorIndex больше либо равен currentTemperatureCount, следовательно, мы не попадаем в диапазон
           uint8_t to_add = (sensorIndex - currentTemperatureCount) + 1;
 
-          for(uint8_t cntr = 0; cntr < to_add; cntr++)
+          uint8_t added = 0;
+          for(; added < to_add; added++)
           {
-            temperatureModule->State.AddState(StateTemperature,hardCodedTemperatureCount + currentTemperatureCount + cntr);
+            if(!temperatureModule->State.AddState(StateTemperature,hardCodedTemperatureCount + currentTemperatureCount + added)) // пул состояний исчерпан
+              break;
           } // for
 
-          // сохраняем кол-во добавленных
-          currentTemperatureCount += to_add;
+          // сохраняем кол-во добавленных - только тех, под которые есть состояния
+          currentTemperatureCount += added;
           
-        return true;
+        return (added == to_add);
       } // if(temperatureModule)
       else
         return false;
@@ -1299,16 +1337,24 @@ bool UniRegDispatcher::AddUniSensor(UniSensorType type, uint8_t sensorIndex)
           // здесь sensorIndex больше либо равен currentHumidityCount, следовательно, мы не попадаем в диапазон
           uint8_t to_add = (sensorIndex - currentHumidityCount) + 1;
 
-          for(uint8_t cntr = 0; cntr < to_add; cntr++)
+          uint8_t added = 0;
+          for(; added < to_add; added++)
           {
-            humidityModule->State.AddState(StateTemperature,hardCodedHumidityCount + currentHumidityCount + cntr);
-            humidityModule->State.AddState(StateHumidity,hardCodedHumidityCount + currentHumidityCount + cntr);
+            uint8_t idx = hardCodedHumidityCount + currentHumidityCount + added;
+            if(!humidityModule->State.AddState(StateTemperature,idx)) // пул состояний исчерпан
+              break;
+
+            if(!humidityModule->State.AddState(StateHumidity,idx)) // датчик влажности без пары состояний не регистрируем
+            {
+              humidityModule->State.RemoveState(StateTemperature,idx);
+              break;
+            }
           } // for
 
-          // сохраняем кол-во добавленных
-          currentHumidityCount += to_add;
+          // сохраняем кол-во добавленных - только тех, под которые есть состояния
+          currentHumidityCount += added;
           
-        return true;
+        return (added == to_add);
         
       }
       else
@@ -1324,15 +1370,17 @@ bool UniRegDispatcher::AddUniSensor(UniSensorType type, uint8_t sensorIndex)
           // здесь sensorIndex больше либо равен currentLuminosityCount, следовательно, мы не попадаем в диапазон
           uint8_t to_add = (sensorIndex - currentLuminosityCount) + 1;
 
-          for(uint8_t cntr = 0; cntr < to_add; cntr++)
+          uint8_t added = 0;
+          for(; added < to_add; added++)
           {
-            luminosityModule->State.AddState(StateLuminosity,hardCodedLuminosityCount + currentLuminosityCount + cntr);
+            if(!luminosityModule->State.AddState(StateLuminosity,hardCodedLuminosityCount + currentLuminosityCount + added)) // пул состояний исчерпан
+              break;
           } // for
 
-          // сохраняем кол-во добавленных
-          currentLuminosityCount += to_add;
+          // сохраняем кол-во добавленных - только тех, под которые есть состояния
+          currentLuminosityCount += added;
           
-        return true;
+        return (added == to_add);
       }    
       else
         return false;
@@ -1347,15 +1395,17 @@ bool UniRegDispatcher::AddUniSensor(UniSensorType type, uint8_t sensorIndex)
           // здесь sensorIndex больше либо равен currentSoilMoistureCount, следовательно, мы не попадаем в диапазон
           uint8_t to_add = (sensorIndex - currentSoilMoistureCount) + 1;
 
-          for(uint8_t cntr = 0; cntr < to_add; cntr++)
+          uint8_t added = 0;
+          for(; added < to_add; added++)
           {
-            soilMoistureModule->State.AddState(StateSoilMoisture,hardCodedSoilMoistureCount + currentSoilMoistureCount + cntr);
+            if(!soilMoistureModule->State.AddState(StateSoilMoisture,hardCodedSoilMoistureCount + currentSoilMoistureCount + added)) // пул состояний исчерпан
+              break;
           } // for
 
-          // сохраняем кол-во добавленных
-          currentSoilMoistureCount += to_add;
+          // сохраняем кол-во добавленных - только тех, под которые есть состояния
+          currentSoilMoistureCount += added;
           
-        return true;
+        return (added == to_add);
       } 
       else
         return false;
@@ -1371,15 +1421,17 @@ bool UniRegDispatcher::AddUniSensor(UniSensorType type, uint8_t sensorIndex)
           // здесь sensorIndex больше либо равен currentPHCount, следовательно, мы не попадаем в диапазон
           uint8_t to_add = (sensorIndex - currentPHCount) + 1;
 
-          for(uint8_t cntr = 0; cntr < to_add; cntr++)
+          uint8_t added = 0;
+          for(; added < to_add; added++)
           {
-            phModule->State.AddState(StatePH,hardCodedPHCount + currentPHCount + cntr);
+            if(!phModule->State.AddState(StatePH,hardCodedPHCount + currentPHCount + added)) // пул состояний исчерпан
+              break;
           } // for
 
-          // сохраняем кол-во добавленных
-          currentPHCount += to_add;
+          // сохраняем кол-во добавленных - только тех, под которые есть состояния
+          currentPHCount += added;
           
-        return true;
+        return (added == to_add);
       } 
       else
         return false;
@@ -1505,9 +1557,11 @@ void UniRegDispatcher::RestoreState()
     uint8_t cntr = 0;    
     while(cntr < currentTemperatureCount)
     {
-      temperatureModule->State.AddState(StateTemperature, hardCodedTemperatureCount + cntr);
+      if(!temperatureModule->State.AddState(StateTemperature, hardCodedTemperatureCount + cntr)) // пул состояний исчерпан - остальные датчики не восстанавливаем
+        break;
       cntr++;
     }
+    currentTemperatureCount = cntr;
     
   } // if(temperatureModule)
 
@@ -1516,10 +1570,17 @@ void UniRegDispatcher::RestoreState()
     uint8_t cntr = 0;
     while(cntr < currentHumidityCount)
     {
-      humidityModule->State.AddState(StateTemperature, hardCodedHumidityCount + cntr);
-      humidityModule->State.AddState(StateHumidity, hardCodedHumidityCount + cntr);
+      if(!humidityModule->State.AddState(StateTemperature, hardCodedHumidityCount + cntr)) // пул состояний исчерпан - остальные датчики не восстанавливаем
+        break;
+
+      if(!humidityModule->State.AddState(StateHumidity, hardCodedHumidityCount + cntr))
+      {
+        humidityModule->State.RemoveState(StateTemperature, hardCodedHumidityCount + cntr);
+        break;
+      }
       cntr++;
     }
+    currentHumidityCount = cntr;
     
   } // if(humidityModule)
 
@@ -1528,9 +1589,11 @@ void UniRegDispatcher::RestoreState()
     uint8_t cntr = 0;
     while(cntr < currentLuminosityCount)
     {
-      luminosityModule->State.AddState(StateLuminosity, hardCodedLuminosityCount + cntr);
+      if(!luminosityModule->State.AddState(StateLuminosity, hardCodedLuminosityCount + cntr)) // пул состояний исчерпан - остальные датчики не восстанавливаем
+        break;
       cntr++;
     }
+    currentLuminosityCount = cntr;
     
   } // if(luminosityModule)  
 
@@ -1539,9 +1602,11 @@ if(soilMoistureModule)
     uint8_t cntr = 0;
     while(cntr < currentSoilMoistureCount)
     {
-      soilMoistureModule->State.AddState(StateSoilMoisture, hardCodedSoilMoistureCount + cntr);
+      if(!soilMoistureModule->State.AddState(StateSoilMoisture, hardCodedSoilMoistureCount + cntr)) // пул состояний исчерпан - остальные датчики не восстанавливаем
+        break;
       cntr++;
     }
+    currentSoilMoistureCount = cntr;
     
   } // if(soilMoistureModule) 
 
@@ -1550,9 +1615,11 @@ if(soilMoistureModule)
     uint8_t cntr = 0;
     while(cntr < currentPHCount)
     {
-      phModule->State.AddState(StatePH, hardCodedPHCount + cntr);
+      if(!phModule->State.AddState(StatePH, hardCodedPHCount + cntr)) // пул состояний исчерпан - остальные датчики не восстанавливаем
+        break;
       cntr++;
     }
+    currentPHCount = cntr;
     
   } // if(phModule)  
 
@@ -329,17 +329,26 @@ struct UniNextionWaitScreenData
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 #ifdef USE_UNI_NEXTION_MODULE
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
-class NextionUniClient : public AbstractUniClient
+// скратчпад пишется в выносной дисплей, только когда на нём что-то устарело: нажали кнопку, поменялось
+// состояние контроллера или настройки, изменились показания датчика с экрана ожидания
+class NextionUniClient : public AbstractUniClient, public StateChangeListener
 {
   public:
     NextionUniClient();
     virtual void Register(UniRawScratchpad* scratchpad);
     virtual void Update(UniRawScratchpad* scratchpad, bool isModuleOnline, UniScratchpadSource receivedThrough);
 
+    virtual void OnStateChanged(OneState* state);
+    virtual void OnStateRemoved(OneState* state);
+
   private:
 
     unsigned long updateTimer;
     bool tempChanged;
+    bool listening; // подписались на изменения показаний, если нет - пишем показания раз в секунду, как раньше
+    bool sensorsChanged; // показания датчиков на экране ожидания устарели
+
+    bool IsShown(OneState* state);
   
 };
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -17,8 +17,7 @@ void WateringModule::Setup()
   
    #ifdef USE_DS3231_REALTIME_CLOCK
     bIsRTClockPresent = true; // есть часы реального времени
-    DS3231Clock watch =  MainController->GetClock();
-    DS3231Time t =   watch.getTime();
+    const DS3231Time& t = Calendar.GetTime();
   #else
     bIsRTClockPresent = false; // нет часов реального времени
   #endif 
@@ -102,6 +101,7 @@ void WateringModule::Setup()
   lastDOW = t.dayOfWeek; // запоминаем прошлый день недели
   currentDOW = t.dayOfWeek; // запоминаем текущий день недели
   currentHour = t.hour; // запоминаем текущий час
+  scheduleDue = true; // будильник календаря заведём при первом обновлении
   
   #else
 
@@ -390,6 +390,44 @@ void WateringModule::HoldPumpState(bool anyChannelActive)
 }
 #endif
 
+#ifdef USE_DS3231_REALTIME_CLOCK
+void WateringModule::ScheduleNextCheck()
+{
+  // поливать можно или нельзя начинает только с часа начала полива или с новым днём недели,
+  // закончить полив - по отработанному времени, поэтому будильник нужен только на эти минуты
+  uint16_t nowMinute = Calendar.GetMinuteOfDay();
+  uint16_t nextChange = Calendar.MinutesUntil(0,nowMinute);
+
+  uint8_t startHour = settings->GetStartWateringTime();
+  if(startHour < 24)
+  {
+    uint16_t change = Calendar.MinutesUntil(startHour*60,nowMinute);
+    if(change < nextChange)
+      nextChange = change;
+  }
+
+  #if WATER_RELAYS_COUNT > 0
+  for(uint8_t i=0;i<WATER_RELAYS_COUNT;i++)
+  {
+    startHour = settings->GetChannelStartWateringTime(i);
+    if(startHour < 24)
+    {
+      uint16_t change = Calendar.MinutesUntil(startHour*60,nowMinute);
+      if(change < nextChange)
+        nextChange = change;
+    }
+  } // for
+  #endif
+
+  Calendar.SetAlarm(this,0,nextChange);
+}
+void WateringModule::OnCalendarEvent(uint8_t tag)
+{
+  UNUSED(tag);
+  scheduleDue = true;
+}
+#endif
+
 void WateringModule::Update(uint16_t dt)
 { 
 #ifdef USE_WATERING_MANUAL_MODE_DIODE
@@ -412,10 +450,11 @@ SAVE_STATUS(WATER_MODE_BIT,workMode == wwmAutomatic ? 1 : 0); // сохраня
 
   #ifdef USE_DS3231_REALTIME_CLOCK
 
-    // обновляем состояние часов
-    DS3231Clock watch =  MainController->GetClock();
-    DS3231Time t =   watch.getTime();
-
+  // день недели и час меняются только по будильнику календаря, до него время не проверяем
+  if(scheduleDue)
+  {
+    scheduleDue = false;
+    const DS3231Time& t = Calendar.GetTime();
 
     if(currentDOW != t.dayOfWeek)
     {
@@ -432,6 +471,9 @@ SAVE_STATUS(WATER_MODE_BIT,workMode == wwmAutomatic ? 1 : 0); // сохраня
 
     currentDOW = t.dayOfWeek; // сохраняем текущий день недели
     currentHour = t.hour; // сохраняем текущий час
+
+    ScheduleNextCheck();
+  } // if(scheduleDue)
        
   #else
 
@@ -569,6 +611,10 @@ bool  WateringModule::ExecCommand(const Command& command, bool wantAnswer)
               // сохраняем настройки
               settings->Save();
 
+              #ifdef USE_DS3231_REALTIME_CLOCK
+              scheduleDue = true; // час начала полива мог поменяться - перезаводим будильник
+              #endif
+
               if(wateringOption == wateringOFF) // если выключено автоуправление поливом
               {
                 workMode = wwmManual; // переходим в ручной режим работы
@@ -617,6 +663,10 @@ bool  WateringModule::ExecCommand(const Command& command, bool wantAnswer)
                   settings->SetChannelWateringWeekDays(channelIdx,wDays);
                   settings->SetChannelWateringTime(channelIdx,wTime);
                   settings->SetChannelStartWateringTime(channelIdx,sTime);
+
+                  #ifdef USE_DS3231_REALTIME_CLOCK
+                  scheduleDue = true; // час начала полива канала мог поменяться - перезаводим будильник
+                  #endif
                   
                   PublishSingleton.Status = true;
                   PublishSingleton = WATER_CHANNEL_SETTINGS; 
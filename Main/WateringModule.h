@@ -4,6 +4,7 @@
 #include "AbstractModule.h"
 #include "Globals.h"
 #include "InteropStream.h"
+#include "Calendar.h"
 
 
 typedef enum
@@ -33,6 +34,9 @@ public:
 }; 
 
 class WateringModule : public AbstractModule // модуль управления поливом
+#ifdef USE_DS3231_REALTIME_CLOCK
+, public CalendarListener
+#endif
 {
   private:
 
@@ -59,6 +63,10 @@ class WateringModule : public AbstractModule // модуль управлени
   uint8_t currentDOW; // текущий день недели
   uint8_t currentHour; // текущий час
   bool bIsRTClockPresent; // флаг наличия модуля часов реального времени
+#ifdef USE_DS3231_REALTIME_CLOCK
+  bool scheduleDue; // наступил час начала полива или новый день - надо перечитать время календаря
+  void ScheduleNextCheck(); // заводит будильник на ближайший час начала полива или полночь
+#endif
 #ifdef USE_WATERING_MANUAL_MODE_DIODE
   BlinkModeInterop blinker;
 #endif
@@ -78,6 +86,10 @@ class WateringModule : public AbstractModule // модуль управлени
     void Setup();
     void Update(uint16_t dt);
 
+  #ifdef USE_DS3231_REALTIME_CLOCK
+    virtual void OnCalendarEvent(uint8_t tag); // начался час полива какого-то канала или новый день недели
+  #endif
+
 };
 
 
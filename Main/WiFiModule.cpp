@@ -1,6 +1,7 @@
 #include "WiFiModule.h"
 #include "ModuleController.h"
 #include "InteropStream.h"
+#include "UARTLineBuffer.h"
 
 #define WIFI_DEBUG_WRITE(s,ca) { Serial.print(String(F("[CA] ")) + String((ca)) + String(F(": ")));  Serial.println((s)); }
 #define CHECK_QUEUE_TAIL(v) { if(!actionsQueue.size()) {Serial.println(F("[QUEUE IS EMPTY!]"));} else { if(actionsQueue[actionsQueue.size()-1]!=(v)){Serial.print(F("NOT RIGHT TAIL, WAITING: ")); Serial.print((v)); Serial.print(F(", ACTUAL: "));Serial.println(actionsQueue[actionsQueue.size()-1]); } } }
@@ -759,9 +760,9 @@ bool  WiFiModule::ExecCommand(const Command& command, bool wantAnswer)
           if(apIpDone && staIpDone) // получили оба IP
             break;
             
-          while(WIFI_SERIAL.available())
+          while(wiFiReceiveBuff.Available()) // принятое от модуля лежит в приёмном буфере, см. UARTLineBuffer
           {
-            ch = WIFI_SERIAL.read();
+            ch = wiFiReceiveBuff.Read();
         
             if(ch == '\r')
               continue;
@@ -88,6 +88,21 @@ void ZeroStreamListener::Update(uint16_t dt)
 
 }
 
+#ifdef USE_UPDATE_PROFILER
+// пишем в поток статистику обновления в виде ,MIN,AVG,MAX,OVER_BUDGET
+static void PrintUpdateProfile(UpdateProfile* p, Stream* outStream)
+{
+  outStream->print(',');
+  outStream->print(p->MinTime == 0xFFFFFFFF ? 0 : p->MinTime); // замеров ещё не было
+  outStream->print(',');
+  outStream->print(p->AvgTime);
+  outStream->print(',');
+  outStream->print(p->MaxTime);
+  outStream->print(',');
+  outStream->print(p->OverBudget);
+}
+#endif
+
 void ZeroStreamListener::PrintSensorsValues(uint8_t totalCount,ModuleStates wantedState,AbstractModule* module, Stream* outStream)
 {
   if(!totalCount) // нечего писать
@@ -355,11 +370,44 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
           } // wantAnswer
           
         } // STATUS_COMMAND     
+        #ifdef USE_UPDATE_PROFILER
+        else if(t == PROFILE_COMMAND) // статистика времени обновления модулей
+        {
+          if(wantAnswer)
+          {
+            // ответ может быть длинным, поэтому пишем прямо в поток, в виде
+            // OK=PROFILE|LOOP,MIN,AVG,MAX,OVER|MODULE_ID,MIN,AVG,MAX,OVER|...
+            canPublish = false;
+            Stream* pStream = command.GetIncomingStream();
+            pStream->print(OK_ANSWER);
+            pStream->print(COMMAND_DELIMITER);
+            pStream->print(PROFILE_COMMAND);
+
+            pStream->print(PARAM_DELIMITER);
+            pStream->print(PROFILE_LOOP_NAME);
+            PrintUpdateProfile(MainController->GetLoopProfile(),pStream);
+
+            size_t modulesCount = MainController->GetModulesCount();
+            for(size_t i=0;i<modulesCount;i++)
+            {
+              yield(); // немного даём поработать другим модулям
+              
+              pStream->print(PARAM_DELIMITER);
+              pStream->print(MainController->GetModule(i)->GetID());
+              PrintUpdateProfile(MainController->GetModuleProfile(i),pStream);
+            } // for
+
+            pStream->print(NEWLINE);
+            
+          } // wantAnswer
+        } // PROFILE_COMMAND
+        #endif // USE_UPDATE_PROFILER
         else if(t == REGISTERED_MODULES_COMMAND) // пролистать зарегистрированные модули
         {
           PublishSingleton.AddModuleIDToAnswer = false;
           PublishSingleton.Status = true;
           PublishSingleton = F("");
+          bool first = true; // ответ уходит в поток по частям, поэтому по длине Text первый ли модуль, не понять
           size_t cnt = MainController->GetModulesCount();
           for(size_t i=0;i<cnt;i++)
           {
@@ -367,10 +415,11 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
 
             if(mod != this)
             {
-              if(PublishSingleton.Text.length())
+              if(!first)
                 PublishSingleton << PARAM_DELIMITER;
               
               PublishSingleton << mod->GetID();
+              first = false;
              
             }// if
               
@@ -422,6 +471,16 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
           PublishSingleton.Status = true;
         
         } // AUTO
+        #ifdef USE_UPDATE_PROFILER
+        else
+        if(t == PROFILE_COMMAND) // CTSET=0|PROFILE - сбросить статистику обновления модулей
+        {
+          MainController->ResetProfiles();
+          PublishSingleton.Status = true;
+          PublishSingleton = PROFILE_COMMAND;
+          PublishSingleton << PARAM_DELIMITER << REG_DEL;
+        } // PROFILE_COMMAND
+        #endif
                 
       } // if
       else
@@ -433,7 +492,7 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
        {
           // ищем уже зарегистрированный
           String reqID = command.GetArg(1);
-          AbstractModule* mod = c->GetModuleByID(reqID);
+          AbstractModule* mod = MainController->GetModuleByID(reqID);
           if(mod)
           {
             // модуль уже зарегистрирован
@@ -443,8 +502,8 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
           else
           {
             // регистрируем новый модуль
-            RemoteModule* remMod = new RemoteModule(reqID); 
-            c->RegisterModule(remMod);
+            RemoteModule* remMod = new RemoteModule(strdup(reqID.c_str())); // модуль живёт до перезагрузки, его ID - тоже
+            MainController->RegisterModule(remMod);
             PublishSingleton.Status = true;
             PublishSingleton = REG_SUCC; 
             PublishSingleton << PARAM_DELIMITER << reqID;
@@ -603,6 +662,7 @@ bool  ZeroStreamListener::ExecCommand(const Command& command, bool wantAnswer)
             
              DS3231Clock cl = MainController->GetClock();
              cl.setTime(sec.toInt(),minute.toInt(),hour.toInt(),dow,dayint,monthint,yearint);
+             Calendar.Refresh(); // время перевели - пусть календарь перечитает часы сразу
 
              PublishSingleton.Status = true;
              PublishSingleton = REG_SUCC;
@@ -0,0 +1,58 @@
+// прогон прошивки на рабочей станции: setup() и заданное число итераций loop() с симулированным временем.
+// Собирается с LOOP_TIMINGS_DEBUG, поэтому на каждой итерации в Serial (сюда - в stdout) печатается
+// время ModuleController::UpdateModules и каждого AbstractModule::Update(dt), мкс рабочей станции.
+// В конце прогона выполняется CTGET=0|PROFILE - сводка min/avg/max по модулям.
+//
+//   greenhouse_loop [-n итераций] [-t мс между итерациями] [-sd каталог SD-карты]
+
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+#include "arduino/HostSim.h"
+
+void setup();
+void loop();
+
+int main(int argc, char** argv)
+{
+  unsigned long iterations = 1000;
+  unsigned long tickMillis = 10;
+  const char* sdDir = NULL;
+
+  for(int i=1;i<argc;i++)
+  {
+    if(!strcmp(argv[i],"-n") && i + 1 < argc)
+      iterations = strtoul(argv[++i],NULL,10);
+    else if(!strcmp(argv[i],"-t") && i + 1 < argc)
+      tickMillis = strtoul(argv[++i],NULL,10);
+    else if(!strcmp(argv[i],"-sd") && i + 1 < argc)
+      sdDir = argv[++i];
+    else
+    {
+      fprintf(stderr,"usage: %s [-n iterations] [-t tick_ms] [-sd sd_card_dir]\n",argv[0]);
+      return 1;
+    }
+  }
+
+  HostSDSetRoot(sdDir);
+  HostSerialEcho(0,stdout);
+
+  setup();
+
+  for(unsigned long i=0;i<iterations;i++)
+  {
+    loop();
+    HostAdvanceMicros(tickMillis*1000ULL); // между итерациями проходит симулированное время
+  }
+
+  HostSerialFeed(0,"CTGET=0|PROFILE\r\n");
+  for(int i=0;i<10;i++)
+  {
+    HostAdvanceMicros(10000);
+    loop();
+  }
+
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,3 @@
+// скетч Main.ino для сборки под Linux - собираем его как обычный файл C++
+#include <Arduino.h>
+#include "../Main.ino"
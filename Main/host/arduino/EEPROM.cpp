@@ -0,0 +1,9 @@
+#include "EEPROM.h"
+#include "HostSim.h"
+
+EEPROMClass EEPROM;
+
+void HostEEPROMClear()
+{
+  memset(EEPROM.data,0xFF,sizeof(EEPROM.data));
+}
@@ -0,0 +1,41 @@
+#ifndef _HOST_EEPROM_H
+#define _HOST_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_EEPROM_SIZE 4096 // EEPROM меги
+
+// EEPROM - массив в памяти, при старте все байты 0xFF, как у чистой меги
+class EEPROMClass
+{
+  public:
+    uint8_t data[HOST_EEPROM_SIZE];
+
+    EEPROMClass() { memset(data,0xFF,sizeof(data)); }
+
+    uint8_t read(int idx) { return (idx >= 0 && idx < HOST_EEPROM_SIZE) ? data[idx] : 0xFF; }
+    void write(int idx, uint8_t val) { if(idx >= 0 && idx < HOST_EEPROM_SIZE) data[idx] = val; }
+    void update(int idx, uint8_t val) { write(idx,val); }
+    uint16_t length() { return HOST_EEPROM_SIZE; }
+
+    template<typename T> T& get(int idx, T& t)
+    {
+      uint8_t* p = (uint8_t*) &t;
+      for(size_t i=0;i<sizeof(T);i++)
+        p[i] = read(idx + (int) i);
+      return t;
+    }
+
+    template<typename T> const T& put(int idx, const T& t)
+    {
+      const uint8_t* p = (const uint8_t*) &t;
+      for(size_t i=0;i<sizeof(T);i++)
+        write(idx + (int) i,p[i]);
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _HOST_ETHERNET_H
+#define _HOST_ETHERNET_H
+
+// W5100 без сети: сервер не принимает соединений, DHCP не отвечает
+#include "Arduino.h"
+
+class IPAddress : public Printable
+{
+  private:
+    uint8_t octets[4];
+
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) { octets[0] = a; octets[1] = b; octets[2] = c; octets[3] = d; }
+    uint8_t operator[](int idx) const { return octets[idx]; }
+
+    virtual size_t printTo(Print& p) const
+    {
+      size_t n = 0;
+      for(int i=0;i<4;i++)
+      {
+        if(i)
+          n += p.print('.');
+        n += p.print(octets[i],DEC);
+      }
+      return n;
+    }
+};
+
+class EthernetClient : public Stream
+{
+  public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    virtual size_t write(uint8_t c) { (void) c; return 1; }
+    using Print::write;
+    virtual void flush() {}
+
+    uint8_t connected() { return 0; }
+    void stop() {}
+    uint8_t getSocketNumber() { return 0; }
+    operator bool() { return false; }
+};
+
+class EthernetServer
+{
+  public:
+    EthernetServer(uint16_t port) { (void) port; }
+    void begin() {}
+    EthernetClient available() { return EthernetClient(); }
+};
+
+class EthernetClass
+{
+  public:
+    int begin(uint8_t* mac) { (void) mac; return 0; }
+    void begin(uint8_t* mac, IPAddress ip) { (void) mac; localAddress = ip; }
+    int maintain() { return 0; }
+    IPAddress localIP() { return localAddress; }
+
+  private:
+    IPAddress localAddress;
+};
+
+extern EthernetClass Ethernet;
+
+#endif
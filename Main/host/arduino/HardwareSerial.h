@@ -0,0 +1,74 @@
+#ifndef _HOST_HARDWARE_SERIAL_H
+#define _HOST_HARDWARE_SERIAL_H
+
+#include <string>
+#include <deque>
+#include "Stream.h"
+
+// размер приёмного кольцевого буфера ядра, как у Arduino Mega
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+
+// UART меги. Входящие байты "идут по проводу" со скоростью порта и попадают
+// в кольцевой буфер ядра из прерывания приёма (см. HostSim.cpp). Если буфер
+// полон - байт теряется, как и на железе. Исходящие байты копятся в tx.
+class HardwareSerial : public Stream
+{
+  private:
+    uint8_t portNumber;
+    unsigned long baudRate;
+
+    uint8_t rxBuffer[SERIAL_RX_BUFFER_SIZE];
+    volatile uint16_t rxHead;
+    volatile uint16_t rxTail;
+
+    struct WireByte
+    {
+      unsigned long long arrival; // когда байт будет принят целиком, мкс
+      uint8_t data;
+    };
+    std::deque<WireByte> wire; // байты, ещё не дошедшие до приёмника
+    unsigned long long wireFreeAt; // когда освободится линия для следующего байта
+
+    std::string tx;
+    FILE* echo;
+
+    unsigned long rxDropped; // потеряно байт из-за переполнения буфера ядра
+    unsigned long rxReceived;
+
+  public:
+    HardwareSerial(uint8_t port);
+
+    void begin(unsigned long baud, uint8_t config = 0) { (void) config; baudRate = baud; }
+    void end() {}
+    operator bool() { return true; }
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    virtual void flush() {}
+
+    // прерывание приёма: кладёт байт в кольцевой буфер ядра
+    void _rx_complete_irq(uint8_t c);
+
+    // для симулятора
+    uint8_t GetPort() { return portNumber; }
+    unsigned long GetBaudRate() { return baudRate; }
+    void Feed(const uint8_t* data, size_t len, unsigned long long now);
+    bool HasWireByte(unsigned long long until, unsigned long long& when);
+    void DeliverWireByte();
+    std::string TakeOutput();
+    void SetEcho(FILE* f) { echo = f; }
+    unsigned long GetRXDropped() { return rxDropped; }
+    unsigned long GetRXReceived() { return rxReceived; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+
+#endif
@@ -0,0 +1,527 @@
+#include "Arduino.h"
+#include "HostSim.h"
+#include <chrono>
+#include <stdarg.h>
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// регистры
+//--------------------------------------------------------------------------------------------------------------------------------
+volatile uint8_t SREG = 0x80;
+volatile uint8_t TIMSK0 = _BV(TOIE0); // прерывание по переполнению занято millis() ядра
+volatile uint8_t OCR0A = 0;
+volatile uint8_t OCR0B = 0;
+volatile uint8_t UCSR0A = _BV(TXC0);
+volatile uint8_t UCSR1A = _BV(TXC1);
+volatile uint8_t UCSR2A = _BV(TXC2);
+volatile uint8_t UCSR3A = _BV(TXC3);
+
+// границы кучи avr-libc: freeRam() считает по ним свободную память меги, на рабочей станции это число смысла не имеет
+int __heap_start = 0;
+int* __brkval = 0;
+
+// обработчик есть, только если прошивка его определила
+extern "C" void TIMER0_COMPA_vect(void) __attribute__((weak));
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// время
+//--------------------------------------------------------------------------------------------------------------------------------
+#define TIMER0_TICK_MICROS 1024 // таймер 0 меги на 16 МГц переполняется (и проходит сравнение) раз в 1024 мкс
+
+static bool useRealClock = true;
+static unsigned long long simOffset = 0; // накопленное симулированное время, мкс
+static unsigned long long nextTimerTick = TIMER0_TICK_MICROS;
+static bool inPump = false;
+
+// конструкторы глобальных объектов прошивки уже читают millis(), поэтому точка отсчёта
+// заводится при первом обращении, а не при статической инициализации этого файла
+static std::chrono::steady_clock::time_point& RealStart()
+{
+  static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return start;
+}
+
+static unsigned long long RealElapsed()
+{
+  return (unsigned long long) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - RealStart()).count();
+}
+
+static unsigned long long RawNow()
+{
+  return simOffset + (useRealClock ? RealElapsed() : 0);
+}
+
+static HardwareSerial* const ports[] = {&Serial, &Serial1, &Serial2, &Serial3};
+#define HOST_PORTS_COUNT (sizeof(ports)/sizeof(ports[0]))
+
+static bool InterruptsEnabled()
+{
+  return (SREG & 0x80) != 0;
+}
+
+static bool HasPendingRX()
+{
+  for(size_t i=0;i<HOST_PORTS_COUNT;i++)
+    if(ports[i]->available())
+      return true;
+
+  return false;
+}
+
+// доставляем по порядку все события до момента now: приём байт по UART и тики таймера 0
+static void Pump(unsigned long long now)
+{
+  if(inPump || !InterruptsEnabled())
+    return;
+
+  inPump = true;
+
+  while(true)
+  {
+    HardwareSerial* nextPort = NULL;
+    unsigned long long nextByte = now + 1;
+
+    for(size_t i=0;i<HOST_PORTS_COUNT;i++)
+    {
+      unsigned long long when;
+      if(ports[i]->HasWireByte(now,when) && when < nextByte)
+      {
+        nextByte = when;
+        nextPort = ports[i];
+      }
+    }
+
+    // прерывание TIMER0_COMPA в прошивке только выгребает UART - пока в портах пусто,
+    // его вызов ничего не меняет, и такие тики пропускаем разом (важно при больших скачках времени)
+    if(nextTimerTick <= now && (!nextPort || nextTimerTick < nextByte))
+    {
+      if(TIMER0_COMPA_vect && (TIMSK0 & _BV(OCIE0A)) && HasPendingRX())
+      {
+        nextTimerTick += TIMER0_TICK_MICROS;
+        TIMER0_COMPA_vect();
+        continue;
+      }
+
+      unsigned long long skipTo = nextPort ? nextByte - 1 : now;
+      nextTimerTick += ((skipTo - nextTimerTick)/TIMER0_TICK_MICROS + 1)*TIMER0_TICK_MICROS;
+    }
+
+    if(!nextPort)
+      break;
+
+    nextPort->DeliverWireByte();
+  }
+
+  inPump = false;
+}
+
+void HostUseRealClock(bool use)
+{
+  if(use == useRealClock)
+    return;
+
+  if(useRealClock)
+    simOffset += RealElapsed(); // замораживаем набежавшее реальное время
+
+  RealStart() = std::chrono::steady_clock::now();
+  useRealClock = use;
+}
+
+void HostAdvanceMicros(unsigned long long us)
+{
+  simOffset += us;
+  Pump(RawNow());
+}
+
+unsigned long long HostNowMicros()
+{
+  // без реальных часов каждое чтение времени сдвигает его на микросекунду -
+  // иначе циклы ожидания вида while(millis() - start < timeout) никогда не закончатся
+  if(!useRealClock)
+    simOffset++;
+
+  unsigned long long now = RawNow();
+  Pump(now);
+  return now;
+}
+
+unsigned long micros()
+{
+  return (unsigned long) HostNowMicros();
+}
+
+unsigned long millis()
+{
+  return (unsigned long) (HostNowMicros()/1000);
+}
+
+void delay(unsigned long ms)
+{
+  // как в ядре: пока ждём - отдаём время yield()
+  unsigned long long until = RawNow() + ms*1000ULL;
+  while(RawNow() < until)
+  {
+    unsigned long long left = until - RawNow();
+    HostAdvanceMicros(left < 1000 ? left : 1000);
+    yield();
+  }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  HostAdvanceMicros(us);
+}
+
+void cli()
+{
+  SREG &= ~0x80;
+}
+
+void sei()
+{
+  SREG |= 0x80;
+  Pump(RawNow());
+}
+
+void interrupts()
+{
+  sei();
+}
+
+void noInterrupts()
+{
+  cli();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// пины
+//--------------------------------------------------------------------------------------------------------------------------------
+static uint8_t digitalState[NUM_DIGITAL_PINS] = {0};
+static int analogState[NUM_DIGITAL_PINS] = {0};
+static volatile uint8_t portInput = 0; // линия прижата к земле - DHT читает таймаут
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin < NUM_DIGITAL_PINS && mode == INPUT_PULLUP)
+    digitalState[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if(pin < NUM_DIGITAL_PINS)
+    digitalState[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS ? digitalState[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  if(pin < A0)
+    pin += A0;
+
+  return pin < NUM_DIGITAL_PINS ? analogState[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+  digitalWrite(pin,val > 127 ? HIGH : LOW);
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+  (void) bitOrder;
+  digitalWrite(dataPin,val & 1);
+  digitalWrite(clockPin,LOW);
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin)
+{
+  return (uint8_t) _BV(pin % 8);
+}
+
+uint8_t digitalPinToPort(uint8_t pin)
+{
+  return pin / 8;
+}
+
+volatile uint8_t* portInputRegister(uint8_t port)
+{
+  (void) port;
+  return &portInput;
+}
+
+int digitalPinToInterrupt(uint8_t pin)
+{
+  switch(pin)
+  {
+    case 2: return 0;
+    case 3: return 1;
+    case 21: return 2;
+    case 20: return 3;
+    case 19: return 4;
+    case 18: return 5;
+  }
+  return -1;
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+  (void) interruptNum;
+  (void) userFunc;
+  (void) mode;
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+  (void) interruptNum;
+}
+
+void HostSetAnalog(uint8_t pin, int value)
+{
+  if(pin < A0)
+    pin += A0;
+
+  if(pin < NUM_DIGITAL_PINS)
+    analogState[pin] = value;
+}
+
+void HostSetDigital(uint8_t pin, int value)
+{
+  digitalWrite(pin,value);
+}
+
+int HostGetDigital(uint8_t pin)
+{
+  return digitalRead(pin);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// разное из ядра и avr-libc
+//--------------------------------------------------------------------------------------------------------------------------------
+long random(long howbig)
+{
+  return howbig > 0 ? rand() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+  srand((unsigned int) seed);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+char* ultoa(unsigned long value, char* str, int base)
+{
+  String s(value,(unsigned char) base);
+  strcpy(str,s.c_str());
+  return str;
+}
+
+char* ltoa(long value, char* str, int base)
+{
+  String s(value,(unsigned char) base);
+  strcpy(str,s.c_str());
+  return str;
+}
+
+char* utoa(unsigned int value, char* str, int base)
+{
+  return ultoa(value,str,base);
+}
+
+char* itoa(int value, char* str, int base)
+{
+  return ltoa(value,str,base);
+}
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout)
+{
+  sprintf(sout,"%*.*f",width,prec,val);
+  return sout;
+}
+
+// %S (строка из флеша в avr-libc) превращаем в %s
+static void FixProgmemFormat(const char* format, char* out, size_t outSize)
+{
+  size_t w = 0;
+  for(const char* p = format; *p && w < outSize - 1; p++)
+  {
+    out[w++] = *p;
+    if(*p != '%')
+      continue;
+
+    // переписываем флаги, ширину и точность как есть
+    while(p[1] && strchr("-+ #0123456789.l",p[1]) && w < outSize - 1)
+      out[w++] = *++p;
+
+    if(p[1] == 'S' && w < outSize - 1)
+    {
+      out[w++] = 's';
+      p++;
+    }
+    else if(p[1] == '%' && w < outSize - 1)
+      out[w++] = *++p;
+  }
+  out[w] = 0;
+}
+
+int sprintf_P(char* buf, const char* format, ...)
+{
+  char fmt[256];
+  FixProgmemFormat(format,fmt,sizeof(fmt));
+
+  va_list args;
+  va_start(args,format);
+  int result = vsprintf(buf,fmt,args);
+  va_end(args);
+  return result;
+}
+
+int snprintf_P(char* buf, size_t size, const char* format, ...)
+{
+  char fmt[256];
+  FixProgmemFormat(format,fmt,sizeof(fmt));
+
+  va_list args;
+  va_start(args,format);
+  int result = vsnprintf(buf,size,fmt,args);
+  va_end(args);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// UART
+//--------------------------------------------------------------------------------------------------------------------------------
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+HardwareSerial Serial3(3);
+
+HardwareSerial::HardwareSerial(uint8_t port) : portNumber(port), baudRate(9600), rxHead(0), rxTail(0)
+, wireFreeAt(0), echo(NULL), rxDropped(0), rxReceived(0)
+{
+}
+
+int HardwareSerial::available()
+{
+  return ((unsigned int)(SERIAL_RX_BUFFER_SIZE + rxHead - rxTail)) % SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek()
+{
+  if(rxHead == rxTail)
+    return -1;
+
+  return rxBuffer[rxTail];
+}
+
+int HardwareSerial::read()
+{
+  if(rxHead == rxTail)
+    return -1;
+
+  uint8_t c = rxBuffer[rxTail];
+  rxTail = (uint16_t) ((rxTail + 1) % SERIAL_RX_BUFFER_SIZE);
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  tx += (char) c;
+
+  if(echo)
+    fputc(c,echo);
+
+  return 1;
+}
+
+void HardwareSerial::_rx_complete_irq(uint8_t c)
+{
+  rxReceived++;
+
+  uint16_t i = (uint16_t) ((rxHead + 1) % SERIAL_RX_BUFFER_SIZE);
+
+  // как в ядре: если буфер полон - байт выкидываем
+  if(i == rxTail)
+  {
+    rxDropped++;
+    return;
+  }
+
+  rxBuffer[rxHead] = c;
+  rxHead = i;
+}
+
+void HardwareSerial::Feed(const uint8_t* data, size_t len, unsigned long long now)
+{
+  // 10 бит на байт: старт, 8 бит данных, стоп
+  unsigned long long byteTime = (10000000ULL + baudRate - 1)/baudRate;
+
+  if(wireFreeAt < now)
+    wireFreeAt = now;
+
+  for(size_t i=0;i<len;i++)
+  {
+    wireFreeAt += byteTime;
+    WireByte b = {wireFreeAt, data[i]};
+    wire.push_back(b);
+  }
+}
+
+bool HardwareSerial::HasWireByte(unsigned long long until, unsigned long long& when)
+{
+  if(wire.empty() || wire.front().arrival > until)
+    return false;
+
+  when = wire.front().arrival;
+  return true;
+}
+
+void HardwareSerial::DeliverWireByte()
+{
+  uint8_t c = wire.front().data;
+  wire.pop_front();
+  _rx_complete_irq(c);
+}
+
+std::string HardwareSerial::TakeOutput()
+{
+  std::string result;
+  result.swap(tx);
+  return result;
+}
+
+HardwareSerial& HostSerialPort(uint8_t port)
+{
+  return *ports[port % HOST_PORTS_COUNT];
+}
+
+void HostSerialFeed(uint8_t port, const uint8_t* data, size_t len)
+{
+  HostSerialPort(port).Feed(data,len,RawNow());
+}
+
+void HostSerialFeed(uint8_t port, const char* data)
+{
+  HostSerialFeed(port,(const uint8_t*) data,strlen(data));
+}
+
+std::string HostSerialTakeOutput(uint8_t port)
+{
+  return HostSerialPort(port).TakeOutput();
+}
+
+void HostSerialEcho(uint8_t port, FILE* f)
+{
+  HostSerialPort(port).SetEcho(f);
+}
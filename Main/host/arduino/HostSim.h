@@ -0,0 +1,53 @@
+#ifndef _HOST_SIM_H
+#define _HOST_SIM_H
+
+// управление симулятором для сборки прошивки под Linux: время, UART, SD, часы, пины.
+//
+// Время: micros() = симулированное смещение + (если включено) реальное время процесса.
+// С реальными часами замеры micros() внутри прошивки показывают настоящую стоимость
+// кода на рабочей станции; без них время идёт только через HostAdvanceMicros и delay()
+// (плюс 1 мкс на каждое чтение времени, чтобы циклы ожидания заканчивались), и тесты
+// детерминированы. При каждом ходе времени по порядку доставляются байты, "идущие по
+// проводу" в UART, и срабатывает прерывание TIMER0_COMPA (раз в 1024 мкс), если прошивка
+// его включила.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+class HardwareSerial;
+
+void HostUseRealClock(bool use); // по умолчанию - включено
+void HostAdvanceMicros(unsigned long long us); // симулированный ход времени без вызова yield (стоит loop, блокирующее чтение и т.п.)
+unsigned long long HostNowMicros();
+
+HardwareSerial& HostSerialPort(uint8_t port);
+void HostSerialFeed(uint8_t port, const char* data); // отправить байты в порт, они придут со скоростью порта, начиная с текущего момента
+void HostSerialFeed(uint8_t port, const uint8_t* data, size_t len);
+std::string HostSerialTakeOutput(uint8_t port); // забрать всё, что прошивка отправила в порт
+void HostSerialEcho(uint8_t port, FILE* f); // дублировать отправленное в порт в файл (stdout)
+
+void HostSDSetRoot(const char* dir); // каталог, изображающий SD-карту. Без него SD.begin() возвращает false
+const char* HostSDGetRoot();
+
+typedef struct
+{
+  unsigned long BytesWritten; // сколько байт записано в файлы
+  unsigned long BlockWrites; // сколько раз записан блок (сектор 512 байт) на карту
+  unsigned long Flushes; // сколько раз вызван flush
+  unsigned long Opens; // сколько раз открыт файл
+} HostSDStats;
+
+HostSDStats& HostSDGetStats();
+void HostSDResetStats();
+
+void HostRTCSet(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+void HostSetAnalog(uint8_t pin, int value);
+void HostSetDigital(uint8_t pin, int value); // уровень, который внешняя схема держит на входе
+int HostGetDigital(uint8_t pin);
+
+void HostEEPROMClear(); // EEPROM как новая - все байты 0xFF
+
+#endif
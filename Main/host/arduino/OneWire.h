@@ -0,0 +1,38 @@
+#ifndef _HOST_ONEWIRE_H
+#define _HOST_ONEWIRE_H
+
+#include <stdint.h>
+
+// шина 1-Wire без устройств: reset() не видит импульса присутствия, чтение даёт 0xFF
+class OneWire
+{
+  public:
+    OneWire(uint8_t pin) { (void) pin; }
+
+    uint8_t reset() { return 0; }
+    void write(uint8_t v, uint8_t power = 0) { (void) v; (void) power; }
+    uint8_t read() { return 0xFF; }
+    void select(const uint8_t* rom) { (void) rom; }
+    void skip() {}
+
+    // CRC8 Dallas/Maxim, как в библиотеке OneWire
+    static uint8_t crc8(const uint8_t* addr, uint8_t len)
+    {
+      uint8_t crc = 0;
+      while(len--)
+      {
+        uint8_t inbyte = *addr++;
+        for(uint8_t i = 8; i; i--)
+        {
+          uint8_t mix = (crc ^ inbyte) & 0x01;
+          crc >>= 1;
+          if(mix)
+            crc ^= 0x8C;
+          inbyte >>= 1;
+        }
+      }
+      return crc;
+    }
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "Print.h"
+#include <stdio.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t n = 0;
+  while(size--)
+  {
+    if(!write(*buffer++))
+      break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+  String s(n,base);
+  return print(s);
+}
+
+size_t Print::printSigned(long n, int base)
+{
+  if(base == DEC)
+  {
+    String s(n,(unsigned char) base);
+    return print(s);
+  }
+
+  // как и в ядре - отрицательные числа не в десятичной системе печатаем как беззнаковые
+  return printNumber((unsigned long) n,(uint8_t) base);
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+  char buf[64];
+  snprintf(buf,sizeof(buf),"%.*f",digits,number);
+  return write(buf);
+}
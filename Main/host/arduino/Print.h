@@ -0,0 +1,50 @@
+#ifndef _HOST_PRINT_H
+#define _HOST_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+class Print;
+
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print
+{
+  private:
+    size_t printNumber(unsigned long n, uint8_t base);
+    size_t printSigned(long n, int base);
+    size_t printFloat(double number, uint8_t digits);
+
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str ? write((const uint8_t*) str,strlen(str)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*) buffer,size); }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* str) { return write((const char*) str); }
+    size_t print(const String& str) { return write(str.c_str(),str.length()); }
+    size_t print(const char* str) { return write(str); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(unsigned char n, int base = DEC) { return printNumber(n,base); }
+    size_t print(int n, int base = DEC) { return printSigned(n,base); }
+    size_t print(unsigned int n, int base = DEC) { return printNumber(n,base); }
+    size_t print(long n, int base = DEC) { return printSigned(n,base); }
+    size_t print(unsigned long n, int base = DEC) { return printNumber(n,base); }
+    size_t print(double n, int digits = 2) { return printFloat(n,digits); }
+    size_t print(const Printable& x) { return x.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template<typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template<typename T> size_t println(T value, int format) { size_t n = print(value,format); return n + println(); }
+};
+
+#endif
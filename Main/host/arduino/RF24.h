@@ -0,0 +1,34 @@
+#ifndef _HOST_RF24_H
+#define _HOST_RF24_H
+
+#include <stdint.h>
+
+// радиомодуль nRF24L01 не подключён: begin() возвращает false, эфир пуст
+typedef enum { RF24_PA_MIN = 0, RF24_PA_LOW, RF24_PA_HIGH, RF24_PA_MAX, RF24_PA_ERROR } rf24_pa_dbm_e;
+typedef enum { RF24_1MBPS = 0, RF24_2MBPS, RF24_250KBPS } rf24_datarate_e;
+typedef enum { RF24_CRC_DISABLED = 0, RF24_CRC_8, RF24_CRC_16 } rf24_crclength_e;
+
+class RF24
+{
+  public:
+    RF24(uint8_t cePin, uint8_t csPin) { (void) cePin; (void) csPin; }
+
+    bool begin() { return false; }
+    void setDataRate(rf24_datarate_e) {}
+    void setPALevel(uint8_t) {}
+    void setChannel(uint8_t) {}
+    void setRetries(uint8_t, uint8_t) {}
+    void setPayloadSize(uint8_t) {}
+    void setCRCLength(rf24_crclength_e) {}
+    void setAutoAck(bool) {}
+    void openWritingPipe(uint64_t) {}
+    void openReadingPipe(uint8_t, uint64_t) {}
+    void startListening() {}
+    void stopListening() {}
+    bool available(uint8_t* pipe = 0) { (void) pipe; return false; }
+    void read(void* buf, uint8_t len) { (void) buf; (void) len; }
+    bool write(const void* buf, uint8_t len) { (void) buf; (void) len; return false; }
+    void printDetails() {}
+};
+
+#endif
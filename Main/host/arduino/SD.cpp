@@ -0,0 +1,313 @@
+#include "Arduino.h"
+#include "SD.h"
+#include "HostSim.h"
+#include <ctype.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SD_BLOCK_SIZE 512
+
+SDClass SD;
+
+static std::string sdRoot;
+static HostSDStats sdStats = {0,0,0,0};
+
+void HostSDSetRoot(const char* dir)
+{
+  sdRoot = dir ? dir : "";
+}
+
+const char* HostSDGetRoot()
+{
+  return sdRoot.c_str();
+}
+
+HostSDStats& HostSDGetStats()
+{
+  return sdStats;
+}
+
+void HostSDResetStats()
+{
+  memset(&sdStats,0,sizeof(sdStats));
+}
+
+static std::string HostPath(const char* path)
+{
+  std::string result = sdRoot;
+  if(*path != '/')
+    result += '/';
+
+  for(const char* p = path; *p; p++)
+    result += (char) toupper((unsigned char) *p);
+
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+File::Handle::~Handle()
+{
+  if(f)
+  {
+    WriteBack();
+    fclose(f);
+  }
+}
+
+void File::Handle::WriteBack()
+{
+  if(dirty)
+  {
+    sdStats.BlockWrites++;
+    dirty = false;
+  }
+
+  if(sizeChanged)
+  {
+    sdStats.BlockWrites++; // запись каталога с новым размером файла
+    sizeChanged = false;
+  }
+}
+
+void File::Handle::BeginRead()
+{
+  if(lastWrite)
+  {
+    fseek(f,0,SEEK_CUR);
+    lastWrite = false;
+  }
+}
+
+File::File(FILE* f, const char* path, uint8_t mode) : h(new Handle())
+{
+  h->f = f;
+  h->append = (mode & O_APPEND) != 0;
+  h->writable = (mode & O_WRITE) != 0;
+
+  const char* slash = strrchr(path,'/');
+  const char* base = slash ? slash + 1 : path;
+  size_t i = 0;
+  for(;base[i] && i < sizeof(h->name) - 1;i++)
+    h->name[i] = (char) toupper((unsigned char) base[i]);
+  h->name[i] = 0;
+}
+
+size_t File::write(const uint8_t* buf, size_t size)
+{
+  if(!h || !h->f || !h->writable)
+    return 0;
+
+  if(h->append)
+    fseek(h->f,0,SEEK_END);
+
+  long pos = ftell(h->f);
+  long endBefore = (long) this->size();
+  fseek(h->f,pos,SEEK_SET);
+
+  size_t written = fwrite(buf,1,size,h->f);
+  h->lastWrite = true;
+  sdStats.BytesWritten += written;
+
+  // какие блоки задела запись: все, кроме последнего, уходят на карту по ходу записи
+  if(written)
+  {
+    long firstBlock = pos / SD_BLOCK_SIZE;
+    long lastBlock = (pos + (long) written - 1) / SD_BLOCK_SIZE;
+
+    if(h->cachedBlock != firstBlock && h->dirty)
+      sdStats.BlockWrites++;
+
+    sdStats.BlockWrites += (unsigned long) (lastBlock - firstBlock);
+    h->cachedBlock = lastBlock;
+    h->dirty = true;
+
+    if(pos + (long) written > endBefore)
+      h->sizeChanged = true;
+  }
+
+  return written;
+}
+
+int File::available()
+{
+  if(!h || !h->f)
+    return 0;
+
+  long pos = ftell(h->f);
+  return (int) (size() - (uint32_t) pos);
+}
+
+int File::read()
+{
+  if(!h || !h->f)
+    return -1;
+
+  h->BeginRead();
+  int c = fgetc(h->f);
+  return c == EOF ? -1 : c;
+}
+
+int File::peek()
+{
+  if(!h || !h->f)
+    return -1;
+
+  h->BeginRead();
+  int c = fgetc(h->f);
+  if(c == EOF)
+    return -1;
+
+  ungetc(c,h->f);
+  return c;
+}
+
+int File::read(void* buf, uint16_t nbyte)
+{
+  if(!h || !h->f)
+    return -1;
+
+  h->BeginRead();
+  return (int) fread(buf,1,nbyte,h->f);
+}
+
+void File::flush()
+{
+  if(!h || !h->f)
+    return;
+
+  sdStats.Flushes++;
+  h->WriteBack();
+  fflush(h->f);
+}
+
+bool File::seek(uint32_t pos)
+{
+  if(!h || !h->f)
+    return false;
+
+  if(pos > size())
+    return false;
+
+  return fseek(h->f,(long) pos,SEEK_SET) == 0;
+}
+
+uint32_t File::position()
+{
+  if(!h || !h->f)
+    return 0;
+
+  return (uint32_t) ftell(h->f);
+}
+
+uint32_t File::size()
+{
+  if(!h || !h->f)
+    return 0;
+
+  long pos = ftell(h->f);
+  fseek(h->f,0,SEEK_END);
+  long sz = ftell(h->f);
+  fseek(h->f,pos,SEEK_SET);
+  return (uint32_t) sz;
+}
+
+void File::close()
+{
+  if(!h || !h->f)
+    return;
+
+  h->WriteBack();
+  fclose(h->f);
+  h->f = NULL;
+  h.reset();
+}
+
+char* File::name()
+{
+  static char empty[1] = {0};
+  return h ? h->name : empty;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+bool SDClass::begin(uint8_t csPin)
+{
+  (void) csPin;
+
+  struct stat st;
+  return !sdRoot.empty() && stat(sdRoot.c_str(),&st) == 0 && S_ISDIR(st.st_mode);
+}
+
+File SDClass::open(const char* path, uint8_t mode)
+{
+  if(sdRoot.empty())
+    return File();
+
+  std::string full = HostPath(path);
+
+  struct stat st;
+  bool exists = stat(full.c_str(),&st) == 0;
+  if(exists && S_ISDIR(st.st_mode))
+    return File();
+
+  FILE* f = NULL;
+  if(!(mode & O_WRITE))
+    f = exists ? fopen(full.c_str(),"rb") : NULL;
+  else if(!exists)
+    f = (mode & O_CREAT) ? fopen(full.c_str(),"w+b") : NULL;
+  else
+    f = fopen(full.c_str(),(mode & O_TRUNC) ? "w+b" : "r+b");
+
+  if(!f)
+    return File();
+
+  sdStats.Opens++;
+
+  // как в SD-библиотеке: открытый на запись файл позиционируется в конец
+  if(mode & O_APPEND)
+    fseek(f,0,SEEK_END);
+
+  return File(f,path,mode);
+}
+
+bool SDClass::exists(const char* path)
+{
+  if(sdRoot.empty())
+    return false;
+
+  struct stat st;
+  return stat(HostPath(path).c_str(),&st) == 0;
+}
+
+bool SDClass::mkdir(const char* path)
+{
+  if(sdRoot.empty())
+    return false;
+
+  // как в SD-библиотеке - создаём все каталоги по пути
+  std::string full = HostPath(path);
+  for(size_t i = sdRoot.length() + 1; i <= full.length(); i++)
+  {
+    if(i == full.length() || full[i] == '/')
+      ::mkdir(full.substr(0,i).c_str(),0755);
+  }
+
+  struct stat st;
+  return stat(full.c_str(),&st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool SDClass::remove(const char* path)
+{
+  if(sdRoot.empty())
+    return false;
+
+  return ::unlink(HostPath(path).c_str()) == 0;
+}
+
+bool SDClass::rmdir(const char* path)
+{
+  if(sdRoot.empty())
+    return false;
+
+  return ::rmdir(HostPath(path).c_str()) == 0;
+}
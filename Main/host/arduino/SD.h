@@ -0,0 +1,96 @@
+#ifndef _HOST_SD_H
+#define _HOST_SD_H
+
+// SD-карта на каталоге рабочей станции (см. HostSDSetRoot). Имена, как и на FAT в формате 8.3,
+// регистронезависимы - на диске все пути приводятся к верхнему регистру.
+// Запись на карту моделируется блоками по 512 байт с одним блоком кэша на файл, как в SdFat:
+// блок уходит на карту при переходе записи в другой блок, при flush и при закрытии
+// (flush вдобавок переписывает запись каталога). Счётчики - в HostSDGetStats().
+
+#include <stdio.h>
+#include <memory>
+#include "Stream.h"
+
+#define O_READ 0x01
+#define O_WRITE 0x02
+#ifndef O_RDWR
+#define O_RDWR (O_READ | O_WRITE)
+#endif
+#ifndef O_APPEND
+#define O_APPEND 0x04
+#endif
+#ifndef O_CREAT
+#define O_CREAT 0x10
+#endif
+#ifndef O_TRUNC
+#define O_TRUNC 0x40
+#endif
+
+#define FILE_READ O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+class File : public Stream
+{
+  private:
+    struct Handle
+    {
+      FILE* f;
+      char name[13];
+      bool append;
+      bool writable;
+      long cachedBlock; // какой блок сейчас в кэше
+      bool dirty; // блок в кэше изменён и ещё не записан
+      bool sizeChanged; // размер менялся - при flush обновляем запись каталога
+      bool lastWrite; // последней операцией была запись - перед чтением stdio требует fseek
+
+      Handle() : f(NULL), append(false), writable(false), cachedBlock(-1), dirty(false), sizeChanged(false), lastWrite(false) { name[0] = 0; }
+      void BeginRead();
+      ~Handle();
+      void WriteBack();
+    };
+    std::shared_ptr<Handle> h;
+
+  public:
+    File() {}
+    File(FILE* f, const char* path, uint8_t mode);
+
+    virtual size_t write(uint8_t c) { return write(&c,1); }
+    virtual size_t write(const uint8_t* buf, size_t size);
+    using Print::write;
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual void flush();
+
+    int read(void* buf, uint16_t nbyte);
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    char* name();
+    bool isDirectory() { return false; }
+
+    operator bool() { return h && h->f; }
+};
+
+typedef File SDFile;
+
+class SDClass
+{
+  public:
+    bool begin(uint8_t csPin = 4);
+    File open(const char* path, uint8_t mode = FILE_READ);
+    File open(const String& path, uint8_t mode = FILE_READ) { return open(path.c_str(),mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rmdir(const char* path);
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,3 @@
+#ifndef _HOST_SPI_H
+#define _HOST_SPI_H
+#endif
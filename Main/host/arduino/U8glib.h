@@ -0,0 +1,52 @@
+#ifndef _HOST_U8GLIB_H
+#define _HOST_U8GLIB_H
+
+#include <stdint.h>
+#include <string.h>
+
+class __FlashStringHelper;
+
+// дисплей ST7920 128x64 без вывода: рисование ничего не делает, ширина строки - 6 точек на символ
+#define U8G_PROGMEM
+#define U8G_FONT_SECTION(name)
+
+typedef uint8_t u8g_uint_t;
+typedef uint8_t u8g_fntpgm_uint8_t;
+
+class U8GLIB
+{
+  public:
+    void setFont(const u8g_fntpgm_uint8_t* font) { (void) font; }
+    void setColorIndex(uint8_t color) { (void) color; }
+    void setRot180() {}
+    void undoRotation() {}
+    void setFontPosTop() {}
+    void firstPage() {}
+    uint8_t nextPage() { return 0; }
+    void sleepOn() {}
+    void sleepOff() {}
+
+    u8g_uint_t getStrWidth(const char* s) { return (u8g_uint_t) (strlen(s)*6); }
+    u8g_uint_t getWidth() { return 128; }
+    u8g_uint_t getHeight() { return 64; }
+
+    u8g_uint_t getStrWidth(const __FlashStringHelper* s) { return getStrWidth((const char*) s); }
+
+    u8g_uint_t drawStr(u8g_uint_t x, u8g_uint_t y, const char* s) { (void) x; (void) y; return getStrWidth(s); }
+    u8g_uint_t drawStr(u8g_uint_t x, u8g_uint_t y, const __FlashStringHelper* s) { return drawStr(x,y,(const char*) s); }
+    void drawHLine(u8g_uint_t x, u8g_uint_t y, u8g_uint_t w) { (void) x; (void) y; (void) w; }
+    void drawVLine(u8g_uint_t x, u8g_uint_t y, u8g_uint_t h) { (void) x; (void) y; (void) h; }
+    void drawLine(u8g_uint_t x1, u8g_uint_t y1, u8g_uint_t x2, u8g_uint_t y2) { (void) x1; (void) y1; (void) x2; (void) y2; }
+    void drawFrame(u8g_uint_t x, u8g_uint_t y, u8g_uint_t w, u8g_uint_t h) { (void) x; (void) y; (void) w; (void) h; }
+    void drawBox(u8g_uint_t x, u8g_uint_t y, u8g_uint_t w, u8g_uint_t h) { (void) x; (void) y; (void) w; (void) h; }
+    void drawXBMP(u8g_uint_t x, u8g_uint_t y, u8g_uint_t w, u8g_uint_t h, const uint8_t* bitmap) { (void) x; (void) y; (void) w; (void) h; (void) bitmap; }
+};
+
+class U8GLIB_ST7920_128X64_1X : public U8GLIB
+{
+  public:
+    U8GLIB_ST7920_128X64_1X(uint8_t sck, uint8_t mosi, uint8_t cs, uint8_t reset = 255) { (void) sck; (void) mosi; (void) cs; (void) reset; }
+    U8GLIB_ST7920_128X64_1X(uint8_t cs, uint8_t reset = 255) { (void) cs; (void) reset; }
+};
+
+#endif
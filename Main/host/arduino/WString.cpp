@@ -0,0 +1,214 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+
+static std::string NumberToString(unsigned long value, unsigned char base)
+{
+  if(base < 2)
+    base = 10;
+
+  char buf[sizeof(unsigned long)*8 + 1];
+  char* p = buf + sizeof(buf) - 1;
+  *p = 0;
+
+  do
+  {
+    unsigned long digit = value % base;
+    *--p = (char) (digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while(value);
+
+  return p;
+}
+
+static std::string SignedToString(long value, unsigned char base)
+{
+  if(base == 10 && value < 0)
+    return "-" + NumberToString(0UL - (unsigned long) value,base);
+
+  return NumberToString((unsigned long) value,base);
+}
+
+String::String(unsigned char value, unsigned char base) : s(NumberToString(value,base)) {}
+String::String(int value, unsigned char base) : s(SignedToString(value,base)) {}
+String::String(unsigned int value, unsigned char base) : s(NumberToString(value,base)) {}
+String::String(long value, unsigned char base) : s(SignedToString(value,base)) {}
+String::String(unsigned long value, unsigned char base) : s(NumberToString(value,base)) {}
+
+String::String(float value, unsigned char decimalPlaces)
+{
+  char buf[40];
+  snprintf(buf,sizeof(buf),"%.*f",decimalPlaces,(double) value);
+  s = buf;
+}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+  char buf[40];
+  snprintf(buf,sizeof(buf),"%.*f",decimalPlaces,value);
+  s = buf;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const
+{
+  if(offset > s.length())
+    return false;
+
+  return s.compare(offset,prefix.s.length(),prefix.s) == 0;
+}
+
+bool String::endsWith(const String& suffix) const
+{
+  if(suffix.s.length() > s.length())
+    return false;
+
+  return s.compare(s.length() - suffix.s.length(),suffix.s.length(),suffix.s) == 0;
+}
+
+char& String::operator[](unsigned int index)
+{
+  static char dummy;
+
+  if(index >= s.length())
+  {
+    dummy = 0;
+    return dummy;
+  }
+
+  return s[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const
+{
+  if(!bufsize || !buf)
+    return;
+
+  if(index >= s.length())
+  {
+    buf[0] = 0;
+    return;
+  }
+
+  unsigned int n = s.length() - index;
+  if(n > bufsize - 1)
+    n = bufsize - 1;
+
+  memcpy(buf,s.c_str() + index,n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  if(fromIndex >= s.length())
+    return -1;
+
+  size_t pos = s.find(ch,fromIndex);
+  return pos == std::string::npos ? -1 : (int) pos;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const
+{
+  if(fromIndex >= s.length())
+    return -1;
+
+  size_t pos = s.find(str.s,fromIndex);
+  return pos == std::string::npos ? -1 : (int) pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+  size_t pos = s.rfind(ch);
+  return pos == std::string::npos ? -1 : (int) pos;
+}
+
+int String::lastIndexOf(const String& str) const
+{
+  size_t pos = s.rfind(str.s);
+  return pos == std::string::npos ? -1 : (int) pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+  if(beginIndex > endIndex)
+  {
+    unsigned int tmp = endIndex;
+    endIndex = beginIndex;
+    beginIndex = tmp;
+  }
+
+  String result;
+  if(beginIndex >= s.length())
+    return result;
+
+  if(endIndex > s.length())
+    endIndex = s.length();
+
+  result.s = s.substr(beginIndex,endIndex - beginIndex);
+  return result;
+}
+
+void String::replace(char find, char replace)
+{
+  for(size_t i=0;i<s.length();i++)
+    if(s[i] == find)
+      s[i] = replace;
+}
+
+void String::replace(const String& find, const String& replace)
+{
+  if(!find.s.length())
+    return;
+
+  size_t pos = 0;
+  while((pos = s.find(find.s,pos)) != std::string::npos)
+  {
+    s.replace(pos,find.s.length(),replace.s);
+    pos += replace.s.length();
+  }
+}
+
+void String::toLowerCase()
+{
+  for(size_t i=0;i<s.length();i++)
+    s[i] = (char) tolower((unsigned char) s[i]);
+}
+
+void String::toUpperCase()
+{
+  for(size_t i=0;i<s.length();i++)
+    s[i] = (char) toupper((unsigned char) s[i]);
+}
+
+void String::trim()
+{
+  size_t b = 0;
+  while(b < s.length() && isspace((unsigned char) s[b]))
+    b++;
+
+  size_t e = s.length();
+  while(e > b && isspace((unsigned char) s[e-1]))
+    e--;
+
+  s = s.substr(b,e - b);
+}
+
+String operator+(const String& lhs, const String& rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const char* lhs, const String& rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const __FlashStringHelper* lhs, const String& rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
@@ -0,0 +1,123 @@
+#ifndef _HOST_WSTRING_H
+#define _HOST_WSTRING_H
+
+// String из ядра Arduino поверх std::string - для сборки прошивки под Linux.
+// Семантика повторяет ядро: числа при сложении и += дописываются в десятичном виде,
+// char и unsigned char различаются.
+
+#include <string>
+#include <type_traits>
+#include <stdlib.h>
+#include <string.h>
+#include "avr/pgmspace.h"
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(PSTR(string_literal)))
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String
+{
+  private:
+    std::string s;
+
+  public:
+    String(const char* cstr = "") : s(cstr ? cstr : "") {}
+    String(const String& str) : s(str.s) {}
+    String(const __FlashStringHelper* str) : s(str ? (const char*) str : "") {}
+    explicit String(char c) : s(1,c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    String& operator=(const String& rhs) { s = rhs.s; return *this; }
+    String& operator=(const char* cstr) { s = cstr ? cstr : ""; return *this; }
+    String& operator=(const __FlashStringHelper* str) { s = str ? (const char*) str : ""; return *this; }
+
+    // прошивка местами присваивает строке число (в ядре это собирается только с -fpermissive),
+    // здесь такое присваивание пишет число в десятичном виде
+    template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    String& operator=(T value) { return *this = String(value); }
+
+    explicit operator bool() const { return true; } // как StringIfHelper в ядре: буфер строки всегда выделен
+
+    unsigned char reserve(unsigned int size) { s.reserve(size); return 1; }
+    unsigned int length() const { return s.length(); }
+    const char* c_str() const { return s.c_str(); }
+
+    unsigned char concat(const String& str) { s += str.s; return 1; }
+    unsigned char concat(const char* cstr) { if(cstr) s += cstr; return 1; }
+    unsigned char concat(const __FlashStringHelper* str) { if(str) s += (const char*) str; return 1; }
+    unsigned char concat(char c) { s += c; return 1; }
+    unsigned char concat(unsigned char num) { return concat(String(num)); }
+    unsigned char concat(int num) { return concat(String(num)); }
+    unsigned char concat(unsigned int num) { return concat(String(num)); }
+    unsigned char concat(long num) { return concat(String(num)); }
+    unsigned char concat(unsigned long num) { return concat(String(num)); }
+    unsigned char concat(float num) { return concat(String(num)); }
+    unsigned char concat(double num) { return concat(String(num)); }
+
+    template<typename T> String& operator+=(T rhs) { concat(rhs); return *this; }
+    String& operator+=(const String& rhs) { concat(rhs); return *this; }
+
+    bool equals(const String& str) const { return s == str.s; }
+    bool equals(const char* cstr) const { return s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String& str) const { return !strcasecmp(s.c_str(),str.s.c_str()); }
+    int compareTo(const String& str) const { return strcmp(s.c_str(),str.s.c_str()); }
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+    bool operator>(const String& rhs) const { return compareTo(rhs) > 0; }
+
+    bool startsWith(const String& prefix) const { return s.compare(0,prefix.s.length(),prefix.s) == 0; }
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if(index < s.length()) s[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const { getBytes((unsigned char*) buf,bufsize,index); }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String& str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String& str) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex,s.length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index) { if(index < s.length()) s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if(index < s.length()) s.erase(index,count); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const __FlashStringHelper* lhs, const String& rhs);
+
+template<typename T> String operator+(const String& lhs, T rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+#endif
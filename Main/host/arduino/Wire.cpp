@@ -0,0 +1,166 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "HostSim.h"
+#include <time.h>
+
+#define DS3231_ADDRESS 0x68
+#define BH1750_ADDRESS_1 0x23
+#define BH1750_ADDRESS_2 0x5C
+#define BH1750_RAW_VALUE 1200 // сырые показания датчика освещённости, 1000 люкс
+
+TwoWire Wire;
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// часы DS3231: время = установленное + прошедшее симулированное
+//--------------------------------------------------------------------------------------------------------------------------------
+static time_t rtcBase = 1500000000; // 14.07.2017 02:40:00 UTC
+static unsigned long long rtcBaseMicros = 0;
+static uint8_t rtcRegister = 0; // с какого регистра читаем
+
+static uint8_t ToBCD(int val)
+{
+  return (uint8_t) ((val/10*16) + (val%10));
+}
+
+static int FromBCD(uint8_t val)
+{
+  return (val/16*10) + (val%16);
+}
+
+static time_t RTCNow()
+{
+  return rtcBase + (time_t) ((HostNowMicros() - rtcBaseMicros)/1000000ULL);
+}
+
+static void RTCSetFromTm(struct tm& t)
+{
+  rtcBase = timegm(&t);
+  rtcBaseMicros = HostNowMicros();
+}
+
+void HostRTCSet(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+  struct tm t;
+  memset(&t,0,sizeof(t));
+  t.tm_year = year - 1900;
+  t.tm_mon = month - 1;
+  t.tm_mday = day;
+  t.tm_hour = hour;
+  t.tm_min = minute;
+  t.tm_sec = second;
+  RTCSetFromTm(t);
+}
+
+static uint8_t RTCReadRegister(uint8_t reg)
+{
+  time_t now = RTCNow();
+  struct tm t;
+  gmtime_r(&now,&t);
+
+  switch(reg)
+  {
+    case 0: return ToBCD(t.tm_sec);
+    case 1: return ToBCD(t.tm_min);
+    case 2: return ToBCD(t.tm_hour);
+    case 3: return ToBCD(t.tm_wday == 0 ? 7 : t.tm_wday); // понедельник - 1
+    case 4: return ToBCD(t.tm_mday);
+    case 5: return ToBCD(t.tm_mon + 1);
+    case 6: return ToBCD(t.tm_year % 100);
+    case 0x11: return 25; // температура, 25.00 градусов
+    case 0x12: return 0;
+  }
+  return 0;
+}
+
+static void RTCWrite(const uint8_t* data, uint8_t len)
+{
+  if(!len)
+    return;
+
+  rtcRegister = data[0];
+  if(len < 8 || rtcRegister != 0) // запись только указателя регистра
+    return;
+
+  struct tm t;
+  memset(&t,0,sizeof(t));
+  t.tm_sec = FromBCD(data[1]);
+  t.tm_min = FromBCD(data[2]);
+  t.tm_hour = FromBCD(data[3]);
+  t.tm_mday = FromBCD(data[5]);
+  t.tm_mon = FromBCD(data[6]) - 1;
+  t.tm_year = FromBCD(data[7]) + 100;
+  RTCSetFromTm(t);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+TwoWire::TwoWire() : txAddress(0), txLength(0), rxLength(0), rxIndex(0)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  txAddress = address;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if(txLength >= sizeof(txBuffer))
+    return 0;
+
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity)
+{
+  for(size_t i=0;i<quantity;i++)
+    if(!write(data[i]))
+      return i;
+
+  return quantity;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  (void) sendStop;
+
+  switch(txAddress)
+  {
+    case DS3231_ADDRESS:
+      RTCWrite(txBuffer,txLength);
+      return 0;
+
+    case BH1750_ADDRESS_1:
+    case BH1750_ADDRESS_2:
+      return 0;
+  }
+
+  return 2; // адрес не ответил
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+  rxLength = 0;
+  rxIndex = 0;
+
+  if(quantity > sizeof(rxBuffer))
+    quantity = sizeof(rxBuffer);
+
+  switch(address)
+  {
+    case DS3231_ADDRESS:
+      for(uint8_t i=0;i<quantity;i++)
+        rxBuffer[rxLength++] = RTCReadRegister(rtcRegister + i);
+      return rxLength;
+
+    case BH1750_ADDRESS_1:
+    case BH1750_ADDRESS_2:
+      rxBuffer[rxLength++] = highByte(BH1750_RAW_VALUE);
+      if(quantity > 1)
+        rxBuffer[rxLength++] = lowByte(BH1750_RAW_VALUE);
+      return rxLength;
+  }
+
+  return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef _HOST_WIRE_H
+#define _HOST_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// шина I2C. На шине висят модели часов DS3231 (0x68) и датчиков освещённости BH1750 (0x23, 0x5C),
+// остальные адреса не отвечают.
+class TwoWire
+{
+  private:
+    uint8_t txAddress;
+    uint8_t txBuffer[32];
+    uint8_t txLength;
+
+    uint8_t rxBuffer[32];
+    uint8_t rxLength;
+    uint8_t rxIndex;
+
+  public:
+    TwoWire();
+
+    void begin() {}
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t) address); }
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t) address,(uint8_t) quantity); }
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t quantity);
+    int available() { return rxLength - rxIndex; }
+    int read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef _HOST_AVR_INTERRUPT_H
+#define _HOST_AVR_INTERRUPT_H
+
+#include "io.h"
+
+// обработчики прерываний - обычные функции, симулятор вызывает их по мере хода времени
+#define ISR(vector, ...) extern "C" void vector(void)
+
+extern "C" void TIMER0_COMPA_vect(void);
+
+void cli();
+void sei();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _HOST_AVR_IO_H
+#define _HOST_AVR_IO_H
+
+// регистры ATmega2560, которые трогает прошивка. Это обычные переменные,
+// симулятор смотрит на них там, где от них зависит поведение (TIMSK0).
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t SREG;
+
+// таймер 0 (millis) и его прерывания по сравнению
+extern volatile uint8_t TIMSK0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR0B;
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+
+// статусные регистры UART: передача в симуляторе завершается мгновенно
+extern volatile uint8_t UCSR0A;
+extern volatile uint8_t UCSR1A;
+extern volatile uint8_t UCSR2A;
+extern volatile uint8_t UCSR3A;
+#define TXC0 6
+#define TXC1 6
+#define TXC2 6
+#define TXC3 6
+
+#endif
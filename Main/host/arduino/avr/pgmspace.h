@@ -0,0 +1,36 @@
+#ifndef _HOST_AVR_PGMSPACE_H
+#define _HOST_AVR_PGMSPACE_H
+
+// заглушка avr/pgmspace.h для сборки под Linux: флеш-памяти отдельно нет,
+// PROGMEM-данные лежат в обычной памяти и читаются напрямую.
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(addr)) // читаем элемент с типом массива - в том числе указатели из таблиц строк
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define pgm_read_dword(addr) (*(addr))
+
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcat_P strcat
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strstr_P strstr
+#define memcpy_P memcpy
+
+// в avr-libc %S в форматной строке - строка из флеша, в glibc - широкая строка, поэтому формат правим перед печатью
+int sprintf_P(char* buf, const char* format, ...);
+int snprintf_P(char* buf, size_t size, const char* format, ...);
+
+#endif
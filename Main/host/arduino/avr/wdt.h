@@ -0,0 +1,10 @@
+#ifndef _HOST_AVR_WDT_H
+#define _HOST_AVR_WDT_H
+
+#define WDTO_8S 9
+
+inline void wdt_enable(int) {}
+inline void wdt_disable() {}
+inline void wdt_reset() {}
+
+#endif
@@ -0,0 +1,2 @@
+// настройки по умолчанию со статистикой срабатывания правил алертов (CTGET=ALERT|STATS)
+#define USE_ALERT_RULES_STATS
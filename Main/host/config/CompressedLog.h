@@ -0,0 +1,3 @@
+// сжатый двоичный лог: показания пишутся кадрами изменений (LogSeriesCodec.h)
+#define LOG_BINARY_FORMAT
+#define LOG_COMPRESS_SERIES
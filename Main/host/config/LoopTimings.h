@@ -0,0 +1,3 @@
+// максимальная конфигурация с выводом времени обновления модулей на каждой итерации loop
+#include "Max.h"
+#define LOOP_TIMINGS_DEBUG
@@ -0,0 +1,13 @@
+// максимальная конфигурация: всё, что можно включить одновременно
+// (Wi-Fi вместо W5100 и LCD вместо Nextion - как в Globals.h; лог - двоичный первой версии,
+// сжатый лог собирается отдельно, CompressedLog.h; отладочные режимы не включаются - они мешают конфигуратору)
+#define USE_SMS_MODULE
+#define USE_ALERT_RULES_ON_SD
+#define USE_REMOTE_MODULES
+#define ADD_LOG_HEADER
+#define LOG_CNANGE_NAME_TO_IDX
+#define LOG_CHANGE_TYPE_TO_IDX
+#define WRITE_ABSENT_SENSORS_DATA
+#define LOG_BINARY_FORMAT
+#define LOG_WRITE_ROLLUPS
+#define USE_ALERT_RULES_STATS
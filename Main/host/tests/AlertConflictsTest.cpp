@@ -0,0 +1,80 @@
+// разрешение конфликтов правил: кольца в графе связей разрываются только среди сработавших правил
+#include "HostTest.h"
+#include "Globals.h"
+
+static void Raise(bool a, bool b, bool c)
+{
+  HostSetDigital(40,a ? HIGH : LOW);
+  HostSetDigital(41,b ? HIGH : LOW);
+  HostSetDigital(42,c ? HIGH : LOW);
+  HostRunLoops(200); // 2 секунды - несколько обновлений модуля правил
+}
+
+// сколько обновлений правило было запрещено связанными - из CTGET=ALERT|STATS: имя,проверок,истинно,запрещено
+static long Suppressed(const char* name)
+{
+  std::string answer = HostCommand("CTGET=ALERT|STATS");
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<2;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+static void ResetOutputs()
+{
+  Raise(false,false,false);
+  HostCommand("CTSET=PIN|50|OFF");
+  HostCommand("CTSET=PIN|51|OFF");
+  HostCommand("CTSET=PIN|52|OFF");
+}
+
+int main()
+{
+  HostBoot();
+
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+
+  // A не работает при сработавшем C, B - при A, C - при B: в графе кольцо
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|A|STATE|PIN|40|>=|1|0|0|127|C|CTSET=PIN|50|ON").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|B|STATE|PIN|41|>=|1|0|0|127|A|CTSET=PIN|51|ON").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|C|STATE|PIN|42|>=|1|0|0|127|B|CTSET=PIN|52|ON").find("OK") == 0);
+  ResetOutputs();
+
+  // сработали A и B: среди них кольца нет, A работает и запрещает B
+  Raise(true,true,false);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(HostGetDigital(51),LOW);
+  CHECK_EQ(HostGetDigital(52),LOW);
+  ResetOutputs();
+
+  // сработали B и C: C запрещено
+  Raise(false,true,true);
+  CHECK_EQ(HostGetDigital(50),LOW);
+  CHECK_EQ(HostGetDigital(51),HIGH);
+  CHECK_EQ(HostGetDigital(52),LOW);
+  ResetOutputs();
+
+  // сработали все три: кольцо разрывается, как и при проверке цепочек по одной - C запрещено, A и B работают
+  Raise(true,true,true);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(HostGetDigital(51),HIGH);
+  CHECK_EQ(HostGetDigital(52),LOW);
+
+  // набор сработавших правил не меняется, конфликты не пересчитываются, но запрещённое правило
+  // считается запрещённым на каждом обновлении модуля
+  CHECK(HostCommand("CTSET=ALERT|STATS").find("OK") == 0);
+  const long updates = 10;
+  HostRunLoops(updates*ALERT_UPDATE_INTERVAL/10);
+  long suppressed = Suppressed("C");
+  CHECK(suppressed >= updates - 1 && suppressed <= updates + 1);
+  CHECK_EQ(Suppressed("A"),0);
+  CHECK_EQ(Suppressed("B"),0);
+
+  return HostTestResult();
+}
@@ -0,0 +1,91 @@
+// фильтр дребезга правил считает только настоящие прогоны условия: пока новый результат не устоялся,
+// правило перепроверяется, а устоявшееся правило без изменений показаний не проверяется вовсе
+#include "HostTest.h"
+#include "ModuleController.h"
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup() { State.AddState(StateTemperature,0); State.AddState(StateTemperature,1); }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(int8_t value, uint8_t idx = 0)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+};
+
+// поле статистики правила из CTGET=ALERT|STATS: 0 - проверок, 1 - истинно
+static long StatsField(const char* name, int field)
+{
+  std::string answer = HostCommand("CTGET=ALERT|STATS");
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(3100); // фрамуги доезжают до места - после этого правила отправляют команды заново
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  sensor.SetTemperature(20);
+
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|D|TEST|TEMP|0|>|25~3:0:0|0|0|127|_|CTSET=PIN|50|ON").find("OK") == 0);
+  HostCommand("CTSET=PIN|50|OFF");
+  HostRunLoops(200);
+  CHECK_EQ(HostGetDigital(50),LOW);
+
+  // выброс на одну проверку правило не переключает
+  sensor.SetTemperature(30);
+  HostRunLoops(50); // одно обновление модуля правил
+  sensor.SetTemperature(20);
+  HostRunLoops(300);
+  CHECK_EQ(HostGetDigital(50),LOW);
+
+  // показания поменялись один раз и держатся: правило перепроверяется, пока три прогона подряд не дадут новый результат
+  long evaluations = StatsField("D",0);
+  sensor.SetTemperature(30);
+  HostRunLoops(300);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(StatsField("D",0) - evaluations,3);
+
+  // правило устоялось - без изменений показаний условие больше не прогоняется
+  evaluations = StatsField("D",0);
+  HostRunLoops(500);
+  CHECK_EQ(StatsField("D",0),evaluations);
+
+  // правило с двумя датчиками тоже не прогоняется без изменений и перепроверяется при изменении любого из них
+  sensor.SetTemperature(10,1);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|E|TEST|EXPR|0|_|TEMP0>25&TEMP1<5|0|0|127|_|CTSET=PIN|51|ON").find("OK") == 0);
+  HostRunLoops(300);
+  evaluations = StatsField("E",0);
+  HostRunLoops(500);
+  CHECK_EQ(StatsField("E",0),evaluations);
+
+  sensor.SetTemperature(0,1);
+  HostRunLoops(300);
+  CHECK_EQ(StatsField("E",0) - evaluations,1);
+  CHECK_EQ(HostGetDigital(51),HIGH);
+
+  evaluations = StatsField("E",0);
+  sensor.SetTemperature(31);
+  HostRunLoops(300);
+  CHECK_EQ(StatsField("E",0) - evaluations,1);
+
+  return HostTestResult();
+}
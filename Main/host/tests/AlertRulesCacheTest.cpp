@@ -0,0 +1,182 @@
+// правила на SD-карте: при обновлении набора правил в памяти оставшиеся правила не пересобираются
+// (сохраняют статистику и то, что уже сработали), читаются с карты только вошедшие в набор; правила,
+// не поместившиеся в память, пишутся в лог действий; замер стоимости loop() с полной картой правил
+#include "HostTest.h"
+#include <chrono>
+#include <vector>
+#include "Globals.h"
+
+// сколько команд отправило правило - из CTGET=ALERT|STATS, -1 - правила нет в памяти
+static long Dispatched(const char* name)
+{
+  std::string answer = HostCommand("CTGET=ALERT|STATS");
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  // имя,проверок,истинно,запрещено,команд
+  pos += key.length();
+  for(int i=0;i<3;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+// поле записи модуля из CTGET=0|PROFILE: 0 - мин, 1 - ср, 2 - макс
+static long ProfileField(const std::string& answer, const char* name, int field)
+{
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+// имена правил из записей RULE_SKIPPED в логе действий за день
+static std::vector<std::string> SkippedRules(const char* fileName)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,(std::string("CTGET=LOG|ACTION|") + fileName + "\r\n").c_str());
+  HostRunLoops(200);
+  std::string answer = HostSerialTakeOutput(0);
+
+  std::vector<std::string> names;
+  size_t pos = 0;
+  while((pos = answer.find("RULE_SKIPPED|",pos)) != std::string::npos)
+  {
+    pos += 13;
+    names.push_back(answer.substr(pos,answer.find_first_of("\"\r\n",pos) - pos));
+  }
+  return names;
+}
+
+// средняя стоимость итерации loop() на рабочей станции, мкс
+static double LoopCost(unsigned long loops)
+{
+  HostUseRealClock(true);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  HostRunLoops(loops);
+  double us = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now() - start).count();
+  HostUseRealClock(false);
+  return us/loops;
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(3100); // фрамуги доезжают до места (DEF_OPEN_INTERVAL) - правила после этого отправляют команды заново
+  HostRTCSet(2017,6,1,11,58,0);
+
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|A|STATE|PIN|40|>=|1|0|0|127|_|CTSET=PIN|50|ON").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|B|STATE|PIN|41|>=|1|0|0|127|_|CTSET=PIN|51|ON").find("OK") == 0);
+
+  HostSetDigital(40,HIGH);
+  HostRunLoops(200);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(Dispatched("A"),1);
+  double cost2 = LoopCost(1000);
+
+  // новое правило с окном 12:00-12:01: набор правил перечитывается, но A остаётся тем же -
+  // помнит, что уже сработало, и команду повторно не отправляет
+  HostCommand("CTSET=PIN|50|OFF");
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|W|STATE|PIN|42|>=|1|720|1|127|_|CTSET=PIN|52|ON").find("OK") == 0);
+  HostRunLoops(200);
+  CHECK_EQ(HostGetDigital(50),LOW);
+  CHECK_EQ(Dispatched("A"),1);
+  CHECK_EQ(Dispatched("W"),-1);
+
+  // наступило время работы W: с карты читается только оно
+  HostSetDigital(42,HIGH);
+  HostRTCSet(2017,6,1,11,59,50);
+  HostSDResetStats();
+  HostRunLoops(2000);
+  CHECK_EQ(HostSDGetStats().Opens,1);
+  CHECK_EQ(HostGetDigital(52),HIGH);
+  CHECK_EQ(Dispatched("A"),1);
+  CHECK_EQ(Dispatched("W"),1);
+
+  // удаление правила перед A и W: индексы на карте съезжают, правила в памяти остаются
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|B").find("OK") == 0);
+  HostSDResetStats();
+  HostRunLoops(200);
+  CHECK_EQ(HostSDGetStats().Opens,0);
+  CHECK_EQ(Dispatched("A"),1);
+  CHECK_EQ(Dispatched("W"),1);
+  CHECK_EQ(Dispatched("B"),-1);
+
+  // заменённое правило собирается заново
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|A|STATE|PIN|40|>=|1|0|0|127|_|CTSET=PIN|53|ON").find("OK") == 0);
+  HostRunLoops(200);
+  CHECK_EQ(HostGetDigital(53),HIGH);
+  CHECK_EQ(Dispatched("A"),1);
+  CHECK_EQ(Dispatched("W"),1);
+
+  // правил, работающих сейчас, больше, чем влезает в память, - RULES_CNT говорит, сколько не влезло
+  for(int i=0;i<MAX_ALERT_RULES;i++)
+  {
+    char cmd[100];
+    sprintf(cmd,"CTSET=ALERT|RULE_ADD|R%d|STATE|PIN|43|>=|1|0|0|127|_|CTSET=PIN|54|ON",i);
+    CHECK(HostCommand(cmd).find("OK") == 0);
+  }
+  HostRunLoops(200);
+
+  char expected[50];
+  sprintf(expected,"OK=ALERT|RULES_CNT|%d|%d|2",MAX_ALERT_RULES+2,MAX_ALERT_RULES);
+  CHECK(HostCommand("CTGET=ALERT|RULES_CNT") == expected);
+  CHECK_EQ(Dispatched("A"),1);
+
+  // какие именно правила не поместились - видно в логе действий: это правила, которых нет в памяти
+  std::vector<std::string> skipped = SkippedRules("20170601.LOG");
+  CHECK(skipped.size() >= 2);
+  for(size_t i=0;i<skipped.size();i++)
+    CHECK_EQ(Dispatched(skipped[i].c_str()),-1);
+
+  // окно W закрылось - набор поменялся, не поместившиеся пишутся заново (теперь одно правило);
+  // следующая смена минуты набор не меняет и в лог не пишет
+  HostRTCSet(2017,6,1,12,10,0);
+  HostRunLoops(200);
+  size_t logged = SkippedRules("20170601.LOG").size();
+  CHECK_EQ(logged,skipped.size() + 1);
+  HostRTCSet(2017,6,1,12,11,0);
+  HostRunLoops(200);
+  CHECK_EQ(SkippedRules("20170601.LOG").size(),logged);
+
+  // замер: цена итерации loop() с полной памятью правил против двух правил
+  double costMax = LoopCost(1000);
+
+  // карта заполнена правилами до MAX_SD_ALERT_RULES: остальные работают ночью, в память не попадают
+  for(int i=MAX_ALERT_RULES+2;i<MAX_SD_ALERT_RULES;i++)
+  {
+    char cmd[100];
+    sprintf(cmd,"CTSET=ALERT|RULE_ADD|N%d|STATE|PIN|44|>=|1|180|1|127|_|CTSET=PIN|55|ON",i);
+    CHECK(HostCommand(cmd).find("OK") == 0);
+  }
+  HostRunLoops(200);
+  sprintf(expected,"OK=ALERT|RULES_CNT|%d|%d|1",MAX_SD_ALERT_RULES,MAX_ALERT_RULES);
+  CHECK(HostCommand("CTGET=ALERT|RULES_CNT") == expected);
+
+  double costFull = LoopCost(1000);
+
+  // смена минуты: набор правил выбирается заново по индексу всех правил на карте - самое долгое обновление модуля правил
+  HostUseRealClock(true);
+  HostCommand("CTSET=0|PROFILE");
+  HostRTCSet(2017,6,1,12,20,0);
+  HostRunLoops(200);
+  std::string profile = HostCommand("CTGET=0|PROFILE");
+  HostUseRealClock(false);
+  CHECK(ProfileField(profile,"ALERT",2) >= 0);
+
+  printf("loop(): %.1f us with 2 rules, %.1f us with %d rules, %.1f us with %d rules on the card\n",
+    cost2,costMax,MAX_ALERT_RULES,costFull,MAX_SD_ALERT_RULES);
+  printf("ALERT update at a minute change with %d rules on the card: avg %ld us, max %ld us\n",
+    MAX_SD_ALERT_RULES,ProfileField(profile,"ALERT",1),ProfileField(profile,"ALERT",2));
+
+  return HostTestResult();
+}
@@ -0,0 +1,105 @@
+// записанные шумные показания у порога (tests/data/NoisyTemperature.csv) прогоняются через две пары правил
+// вкл./выкл.: без фильтра и с фильтром дребезга и минимального времени в состоянии. Сравниваются отправленные
+// команды (Dispatched из CTGET=ALERT|STATS): фильтр должен убрать дребезг, но переключения по самим колебаниям остаются
+#include "HostTest.h"
+#include "ModuleController.h"
+#include <vector>
+
+#define SAMPLE_TICKS 50 // показания - раз в 5 секунд, шаг loop - 100 мс
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup() { State.AddState(StateTemperature,0); }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(int8_t value, uint8_t fract)
+    {
+      Temperature t(value,fract);
+      State.UpdateState(StateTemperature,0,(void*)&t);
+    }
+};
+
+// поле статистики правила из CTGET=ALERT|STATS: 0 - проверок, 1 - истинно, 2 - подавлено, 3 - отправлено
+static long StatsField(const char* name, int field)
+{
+  std::string answer = HostCommand("CTGET=ALERT|STATS");
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+// температура в сотых долях градуса, по строке на показание
+static std::vector<int> LoadTrace(const char* fileName)
+{
+  std::vector<int> trace;
+  FILE* f = fopen((std::string(HOST_TEST_DATA) + "/" + fileName).c_str(),"r");
+  CHECK(f != NULL);
+  if(!f)
+    return trace;
+
+  char line[512];
+  while(fgets(line,sizeof(line),f))
+  {
+    if(*line == '#')
+      continue;
+
+    const char* value = strchr(line,',');
+    if(value)
+      trace.push_back((int) (atof(value + 1)*100 + 0.5));
+  }
+  fclose(f);
+  return trace;
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(3100); // фрамуги доезжают до места - после этого правила отправляют команды заново
+
+  std::vector<int> trace = LoadTrace("NoisyTemperature.csv");
+  CHECK_EQ(trace.size(),1440);
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  sensor.SetTemperature(20,0);
+
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|R1|TEST|TEMP|0|>|25|0|0|127|_|CTSET=PIN|50|ON").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|R0|TEST|TEMP|0|<=|25|0|0|127|_|CTSET=PIN|50|OFF").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|F1|TEST|TEMP|0|>|25~3:60:60|0|0|127|_|CTSET=PIN|51|ON").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|F0|TEST|TEMP|0|<=|25~3:60:60|0|0|127|_|CTSET=PIN|51|OFF").find("OK") == 0);
+  HostRunLoops(100,100);
+  CHECK(HostCommand("CTSET=ALERT|STATS").find("OK") == 0);
+
+  for(size_t i=0;i<trace.size();i++)
+  {
+    sensor.SetTemperature(trace[i]/100,trace[i]%100);
+    HostRunLoops(SAMPLE_TICKS,100);
+  }
+
+  long raw = StatsField("R1",3) + StatsField("R0",3);
+  long filtered = StatsField("F1",3) + StatsField("F0",3);
+
+  // колебания 25+-3 градуса с периодом в час - за два часа четыре перехода через порог, без фильтра - на каждом десятки
+  CHECK(raw > 40);
+  CHECK(filtered >= 4);
+  CHECK(filtered*3 < raw);
+
+  // оба выхода в итоге в одном состоянии
+  CHECK_EQ(HostGetDigital(50),HostGetDigital(51));
+
+  printf("noisy trace, %u samples: %ld commands dispatched without the filter, %ld with ~3:60:60\n",(unsigned) trace.size(),raw,filtered);
+
+  return HostTestResult();
+}
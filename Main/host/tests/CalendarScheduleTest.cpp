@@ -0,0 +1,52 @@
+// таймеры и полив работают по будильникам календаря: маска дней недели таймера пересчитывается в полночь,
+// полив начинается в час начала полива, а не по проверке времени на каждом обновлении
+#include "HostTest.h"
+#include "Globals.h"
+
+#define TIMER_PIN 55
+
+static const uint8_t WATER_PINS[] = { WATER_RELAYS_PINS };
+
+// видели ли на пине уровень level за loops итераций
+static bool SeenLevel(uint8_t pin, uint8_t level, unsigned long loops)
+{
+  bool seen = false;
+  for(unsigned long i=0;i<loops;i++)
+  {
+    HostRunLoops(1);
+    if(HostGetDigital(pin) == level)
+      seen = true;
+  }
+  return seen;
+}
+
+int main()
+{
+  HostBoot();
+
+  // понедельник, без минуты полночь: время перевели - календарь будит всех подписчиков
+  HostRTCSet(2017,6,5,23,59,0);
+  HostRunLoops(200);
+
+  // таймер только по вторникам, секунда включён - секунда выключен
+  CHECK(HostCommand("CTSET=TMR|130|55|1|1|0|0|0|0|0|0|0|0|0|0|0|0").find("OK") == 0);
+  CHECK(!SeenLevel(TIMER_PIN,TIMER_ON,5000));
+
+  // наступил вторник - таймер заработал по будильнику на полночь
+  CHECK(SeenLevel(TIMER_PIN,TIMER_ON,1500));
+
+  // полив по вторникам с 12 часов, одна минута
+  HostRTCSet(2017,6,6,11,59,0);
+  HostRunLoops(200);
+  CHECK(HostCommand("CTSET=WATER|T_SETT|1|2|1|12|0").find("OK") == 0);
+  CHECK(!SeenLevel(WATER_PINS[0],RELAY_ON,5000));
+
+  // наступил час начала полива - каналы включились по будильнику, через минуту выключились по отработанному времени
+  HostRunLoops(1500);
+  CHECK_EQ(HostGetDigital(WATER_PINS[0]),RELAY_ON);
+  CHECK_EQ(HostGetDigital(WATER_PINS[WATER_RELAYS_COUNT-1]),RELAY_ON);
+  HostRunLoops(6100);
+  CHECK_EQ(HostGetDigital(WATER_PINS[0]),RELAY_OFF);
+
+  return HostTestResult();
+}
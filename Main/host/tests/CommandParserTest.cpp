@@ -0,0 +1,81 @@
+// разбор команд: без выделений памяти, буферы команд - из общего пула; замер стоимости разбора
+#include "HostTest.h"
+#include "CommandParser.h"
+#include <chrono>
+#include <new>
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t sz)
+{
+  allocations++;
+  void* p = malloc(sz ? sz : 1);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t sz) { return operator new(sz); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+int main()
+{
+  CommandParser parser;
+  String commands[] =
+  {
+    "CTGET=0|PING",
+    "CTSET=PIN|13|T",
+    "CTSET=ALERT|RULE_ADD|N1|STATE|TEMP|1|>=|25|0|0|127|_|CTSET=STATE|WINDOW|ALL|OPEN",
+    "CTGET=STAT|DATETIME",
+  };
+  const int commandsCnt = sizeof(commands)/sizeof(commands[0]);
+  const unsigned long rounds = 100000;
+
+  // разбор без выделений памяти
+  unsigned long before = allocations;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  unsigned long argsTotal = 0;
+  for(unsigned long i=0;i<rounds;i++)
+  {
+    Command cmd;
+    CHECK(parser.ParseCommand(commands[i % commandsCnt],cmd));
+    argsTotal += cmd.GetArgsCount();
+  }
+  double ns = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count();
+  CHECK_EQ(allocations - before,0);
+  printf("ParseCommand: %.0f ns per command, %lu args, sizeof(Command) = %u\n",ns/rounds,argsTotal,(unsigned) sizeof(Command));
+
+  // команды внутри команд: буферы пула не пересекаются, сверх пула - из кучи
+  {
+    Command outer;
+    parser.ParseCommand(commands[2],outer);
+    {
+      Command inner;
+      parser.ParseCommand(commands[1],inner);
+
+      before = allocations;
+      Command deepest;
+      CHECK_EQ(allocations - before,COMMAND_BUFFERS_COUNT > 2 ? 0 : 1);
+      parser.ParseCommand(commands[0],deepest);
+
+      CHECK(!strcmp(deepest.GetTargetModuleID(),"0"));
+      CHECK(!strcmp(deepest.GetArg(0),"PING"));
+      CHECK(!strcmp(inner.GetTargetModuleID(),"PIN"));
+      CHECK(!strcmp(inner.GetArg(1),"T"));
+    }
+    CHECK(!strcmp(outer.GetTargetModuleID(),"ALERT"));
+    CHECK_EQ(outer.GetArgsCount(),15);
+    CHECK(!strcmp(outer.GetArg(14),"OPEN"));
+  }
+
+  // буферы вернулись в пул
+  before = allocations;
+  {
+    Command a, b;
+  }
+  CHECK_EQ(allocations - before,0);
+
+  return HostTestResult();
+}
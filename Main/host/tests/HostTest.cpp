@@ -0,0 +1,81 @@
+#include "HostTest.h"
+#include <unistd.h>
+
+int hostTestFailures = 0;
+static char sdDir[64] = {0};
+
+const char* HostTestSDDir()
+{
+  return sdDir;
+}
+
+static void RemoveSDDir()
+{
+  if(!*sdDir)
+    return;
+
+  std::string cmd = std::string("rm -rf '") + sdDir + "'";
+  if(system(cmd.c_str()) != 0)
+    fprintf(stderr,"cannot remove %s\n",sdDir);
+}
+
+void HostBoot(bool withSD)
+{
+  HostUseRealClock(false);
+
+  if(withSD)
+  {
+    strcpy(sdDir,"/tmp/greenhouse_sd_XXXXXX");
+    if(!mkdtemp(sdDir))
+    {
+      perror("mkdtemp");
+      exit(2);
+    }
+    atexit(RemoveSDDir);
+    HostSDSetRoot(sdDir);
+  }
+
+  setup();
+  HostSerialTakeOutput(0); // приветствие при старте тестам не нужно
+}
+
+void HostRunLoops(unsigned long count, unsigned long tickMillis)
+{
+  for(unsigned long i=0;i<count;i++)
+  {
+    loop();
+    HostAdvanceMicros(tickMillis*1000ULL);
+  }
+}
+
+std::string HostCommand(const char* command, unsigned long maxLoops)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,command);
+  HostSerialFeed(0,"\r\n");
+
+  std::string answer;
+  for(unsigned long i=0;i<maxLoops;i++)
+  {
+    HostRunLoops(1);
+    answer += HostSerialTakeOutput(0);
+
+    size_t eol = answer.find("\r\n");
+    if(eol != std::string::npos)
+      return answer.substr(0,eol);
+  }
+
+  return answer;
+}
+
+int HostTestResult()
+{
+  if(hostTestFailures)
+  {
+    fprintf(stderr,"%d check(s) failed\n",hostTestFailures);
+    return 1;
+  }
+
+  printf("all checks passed\n");
+  return 0;
+}
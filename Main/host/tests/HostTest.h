@@ -0,0 +1,35 @@
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+// общие помощники тестов сборки под Linux. Каждый тест - отдельная программа:
+// глобальные объекты прошивки живут один раз на процесс.
+
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Arduino.h>
+#include "../arduino/HostSim.h"
+
+void setup();
+void loop();
+
+extern int hostTestFailures;
+
+#define CHECK(cond) do { if(!(cond)) { hostTestFailures++; fprintf(stderr,"%s:%d: CHECK failed: %s\n",__FILE__,__LINE__,#cond); } } while(0)
+#define CHECK_EQ(a,b) do { long long _a = (long long)(a), _b = (long long)(b); if(_a != _b) { hostTestFailures++; fprintf(stderr,"%s:%d: CHECK_EQ failed: %s == %lld, %s == %lld\n",__FILE__,__LINE__,#a,_a,#b,_b); } } while(0)
+
+// запускает прошивку: детерминированное время, пустая SD-карта во временном каталоге (если withSD)
+void HostBoot(bool withSD = true);
+
+// крутит loop(), между итерациями проходит tickMillis симулированного времени
+void HostRunLoops(unsigned long count, unsigned long tickMillis = 10);
+
+// отправляет команду в Serial и ждёт строку ответа (до maxLoops итераций loop), возвращает её без перевода строки
+std::string HostCommand(const char* command, unsigned long maxLoops = 200);
+
+// каталог временной SD-карты
+const char* HostTestSDDir();
+
+int HostTestResult(); // печатает итог и возвращает код выхода для ctest
+
+#endif
@@ -0,0 +1,221 @@
+// двоичный лог первой версии (записи фиксированного размера, без сжатия): файл - заголовок и записи
+// по LOG_BINARY_RECORD_SIZE байт, CTGET=LOG|FILE|имя|CSV и CTGET=LOG|RANGE отдают его строками текстового лога,
+// имена модулей берутся из заголовка файла - файл, записанный при другом списке модулей, читается как был записан
+#include "HostTest.h"
+#include "ModuleController.h"
+#include "LogModule.h"
+#include <vector>
+#include <sys/stat.h>
+
+#if !defined(LOG_BINARY_FORMAT) || defined(LOG_COMPRESS_SERIES)
+#error LogBinaryTest needs the uncompressed binary log
+#endif
+
+#define TEST_SENSORS 22 // проход лога не кратен LOG_RANGE_MAX_RECORDS: запрос кончается посреди показаний температуры
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup()
+    {
+      for(uint8_t i=0;i<TEST_SENSORS;i++)
+        State.AddState(StateTemperature,i);
+      State.AddState(StateLuminosity,0);
+    }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetValues(int pass)
+    {
+      for(uint8_t i=0;i<TEST_SENSORS;i++)
+      {
+        Temperature t(i ? 10 + (i + pass) % 20 : -5,25); // датчик 0 - ниже нуля
+        State.UpdateState(StateTemperature,i,(void*)&t);
+      }
+      long lum = 1000 + pass;
+      State.UpdateState(StateLuminosity,0,(void*)&lum);
+    }
+};
+
+static std::vector<std::string> SplitLines(const std::string& s)
+{
+  std::vector<std::string> lines;
+  size_t pos = 0, end;
+  while((end = s.find("\r\n",pos)) != std::string::npos)
+  {
+    lines.push_back(s.substr(pos,end - pos));
+    pos = end + 2;
+  }
+  return lines;
+}
+
+static std::vector<std::string> Query(const std::string& command)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,(command + "\r\n").c_str());
+  HostRunLoops(200);
+  return SplitLines(HostSerialTakeOutput(0));
+}
+
+static bool Contains(const std::vector<std::string>& lines, const std::string& line)
+{
+  for(size_t i=0;i<lines.size();i++)
+  {
+    if(lines[i] == line)
+      return true;
+  }
+  return false;
+}
+
+// RANGE по страницам, пока в ответе MORE
+static std::vector<std::string> QueryRange(const std::string& from, const std::string& to, const std::string& tail, int& pages)
+{
+  std::vector<std::string> result;
+  std::string pageFrom = from;
+  pages = 0;
+
+  while(pages < 50)
+  {
+    pages++;
+    std::vector<std::string> lines = Query("CTGET=LOG|RANGE|" + pageFrom + "|" + to + "|" + tail);
+    CHECK(lines.size() > 1 && lines[0] == "OK=FOLLOW");
+    if(lines.size() < 2)
+      break;
+
+    std::string last = lines.back();
+    result.insert(result.end(),lines.begin() + 1,lines.end() - 1);
+
+    if(last.find("OK=LOG|MORE|") != 0)
+    {
+      CHECK(last == "OK=LOG|END_OF_FILE");
+      break;
+    }
+    pageFrom = last.substr(12);
+  }
+
+  return result;
+}
+
+// строки CSV файла за минуты from..to, нужного типа, с датой впереди - как их отдаёт RANGE
+static void AppendFromCSV(std::vector<std::string>& out, const std::vector<std::string>& csv, const char* date, const char* from, const char* to, const char* type)
+{
+  for(size_t i=0;i<csv.size();i++)
+  {
+    const std::string& line = csv[i];
+    if(line.length() < 6 || line[2] != ':' || line.substr(0,5) < from || line.substr(0,5) > to)
+      continue;
+
+    size_t typePos = line.find(',',6) + 1;
+    if(!line.compare(typePos,2,type))
+      out.push_back(std::string(date) + "," + line);
+  }
+}
+
+static void PutWord(std::string& s, uint16_t v) { s += (char) (v & 0xFF); s += (char) (v >> 8); }
+
+// запись первой версии: минута, модуль, тип, датчик, показания
+static void PutRecord(std::string& s, uint16_t minute, uint8_t module, uint8_t type, uint8_t sensor, uint32_t value)
+{
+  PutWord(s,minute);
+  s += (char) module;
+  s += (char) type;
+  s += (char) sensor;
+  PutWord(s,value & 0xFFFF);
+  PutWord(s,value >> 16);
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+
+  // три часа показаний через полночь, проход лога - раз в 5 минут
+  HostRTCSet(2017,6,1,22,30,0);
+  for(int pass=0;pass<36;pass++)
+  {
+    sensor.SetValues(pass);
+    HostRunLoops(300,1000);
+  }
+
+  // RANGE по двоичному логу - так же по страницам
+  int pages = 0;
+  std::vector<std::string> range = QueryRange("01.06.2017 23:00","02.06.2017 01:00","RT",pages);
+  CHECK(pages > 2);
+
+  // файл - заголовок и целые записи
+  std::string path = std::string(HostTestSDDir()) + "/LOGS/20170601.BIN";
+  struct stat st;
+  CHECK(!stat(path.c_str(),&st));
+  FILE* f = fopen(path.c_str(),"rb");
+  std::string file;
+  if(f)
+  {
+    char buff[512];
+    size_t readed;
+    while((readed = fread(buff,1,sizeof(buff),f)) > 0)
+      file.append(buff,readed);
+    fclose(f);
+  }
+  CHECK(file.compare(0,4,LOG_BINARY_SIGNATURE) == 0);
+  CHECK_EQ((uint8_t) file[4],LOG_BINARY_VERSION);
+  CHECK_EQ((uint8_t) file[5],LOG_BINARY_RECORD_SIZE);
+
+  size_t headerSize = 11;
+  for(uint8_t i=0;i<(uint8_t) file[10];i++)
+    headerSize += 3 + (uint8_t) file[headerSize + 2];
+  CHECK_EQ((file.size() - headerSize) % LOG_BINARY_RECORD_SIZE,0);
+
+  // CSV: показания TEST в виде текстового лога
+  std::vector<std::string> csv = Query("CTGET=LOG|FILE|20170601.BIN|CSV");
+  CHECK(!csv.empty() && csv[0] == "OK=FOLLOW");
+  CHECK(Contains(csv,"23:00,TEST,RT,0,\"-5,25\""));
+  CHECK(Contains(csv,"23:00,TEST,RL,0,1006"));
+  CHECK_EQ(csv.size() - 2,(file.size() - headerSize)/LOG_BINARY_RECORD_SIZE); // строка на запись
+
+  std::vector<std::string> nextCsv = Query("CTGET=LOG|FILE|20170602.BIN|CSV");
+  std::vector<std::string> expected;
+  AppendFromCSV(expected,csv,"01.06.2017","23:00","23:59","RT");
+  AppendFromCSV(expected,nextCsv,"02.06.2017","00:00","01:00","RT");
+  CHECK(expected.size() > LOG_RANGE_MAX_RECORDS);
+  CHECK(range == expected);
+
+  // файл прошлого запуска: тогда под индексом 0 был модуль OLDMOD, под индексом 40 - GONE, которого сейчас нет
+  std::string old(LOG_BINARY_SIGNATURE);
+  old += (char) LOG_BINARY_VERSION;
+  old += (char) LOG_BINARY_RECORD_SIZE;
+  PutWord(old,2017);
+  old += (char) 5;
+  old += (char) 1;
+  old += (char) 2;
+  old += std::string("\x00\x01\x06OLDMOD",9);
+  old += std::string("\x28\x04\x04GONE",7);
+  PutRecord(old,600,0,StateTemperature,1,0x00000B15); // 21,11
+  PutRecord(old,600,40,StateLuminosity,0,123456);
+  PutRecord(old,605,3,StateTemperature,0,0x00000A14); // модуля 3 в заголовке нет - отдаётся индекс
+
+  f = fopen((std::string(HostTestSDDir()) + "/LOGS/20170501.BIN").c_str(),"wb");
+  CHECK(f != NULL);
+  if(f)
+  {
+    fwrite(old.data(),1,old.size(),f);
+    fclose(f);
+  }
+
+  std::vector<std::string> oldCsv = Query("CTGET=LOG|FILE|20170501.BIN|CSV");
+  CHECK_EQ(oldCsv.size(),5);
+  CHECK(Contains(oldCsv,"10:00,OLDMOD,RT,1,\"21,11\""));
+  CHECK(Contains(oldCsv,"10:00,GONE,RL,0,123456"));
+  CHECK(Contains(oldCsv,"10:05,3,RT,0,\"20,10\""));
+
+  std::vector<std::string> oldRange = Query("CTGET=LOG|RANGE|01.05.2017 00:00|01.05.2017 23:59|RL");
+  CHECK(Contains(oldRange,"01.05.2017,10:00,GONE,RL,0,123456"));
+
+  printf("binary log: %u bytes for %u records, RANGE: %u lines in %d requests\n",(unsigned) file.size(),
+    (unsigned) ((file.size() - headerSize)/LOG_BINARY_RECORD_SIZE),(unsigned) range.size(),pages);
+
+  return HostTestResult();
+}
@@ -0,0 +1,152 @@
+// CTGET=LOG|RANGE: за один запрос читается не больше LOG_RANGE_MAX_RECORDS записей из промежутка,
+// остальное отдаётся следующими запросами с времени из ответа MORE. Склеенные ответы совпадают
+// с выборкой из целых файлов лога - без повторов и пропусков, в том числе на стыке суток
+#include "HostTest.h"
+#include "ModuleController.h"
+#include <vector>
+
+#define TEST_SENSORS 22 // проход лога не кратен LOG_RANGE_MAX_RECORDS: запрос кончается посреди показаний температуры
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup()
+    {
+      for(uint8_t i=0;i<TEST_SENSORS;i++)
+        State.AddState(StateTemperature,i);
+    }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetValues(int pass)
+    {
+      for(uint8_t i=0;i<TEST_SENSORS;i++)
+      {
+        Temperature t(10 + (i + pass) % 20,0);
+        State.UpdateState(StateTemperature,i,(void*)&t);
+      }
+    }
+};
+
+static std::vector<std::string> SplitLines(const std::string& s)
+{
+  std::vector<std::string> lines;
+  size_t pos = 0, end;
+  while((end = s.find("\r\n",pos)) != std::string::npos)
+  {
+    lines.push_back(s.substr(pos,end - pos));
+    pos = end + 2;
+  }
+  return lines;
+}
+
+// отправляет команду и забирает всё, что прошивка ответила
+static std::vector<std::string> Query(const std::string& command)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,(command + "\r\n").c_str());
+  HostRunLoops(200);
+  return SplitLines(HostSerialTakeOutput(0));
+}
+
+// строки файла лога за день (logs/YYYYMMDD.LOG) за минуты from..to, нужного типа, с датой впереди - как их отдаёт RANGE
+static void AppendFromFile(std::vector<std::string>& out, const char* date, const char* fileName, const char* from, const char* to, const char* type, int index)
+{
+  std::vector<std::string> lines = Query(std::string("CTGET=LOG|FILE|") + fileName);
+  for(size_t i=0;i<lines.size();i++)
+  {
+    const std::string& line = lines[i];
+    if(line.length() < 6 || line[2] != ':' || line[5] != ',' || line.substr(0,5) < from || line.substr(0,5) > to)
+      continue;
+
+    // HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA
+    size_t typePos = line.find(',',6) + 1;
+    if(line.compare(typePos,2,type) || (index >= 0 && atoi(line.c_str() + typePos + 3) != index))
+      continue;
+
+    out.push_back(std::string(date) + "," + line);
+  }
+}
+
+// RANGE по страницам: пока в ответе MORE - запрашиваем остальное; pages - сколько понадобилось запросов
+static std::vector<std::string> QueryRange(const std::string& from, const std::string& to, const std::string& tail, int& pages)
+{
+  std::vector<std::string> result;
+  std::string pageFrom = from;
+  pages = 0;
+
+  while(pages < 50)
+  {
+    pages++;
+    std::vector<std::string> lines = Query("CTGET=LOG|RANGE|" + pageFrom + "|" + to + "|" + tail);
+    CHECK(!lines.empty() && lines[0] == "OK=FOLLOW");
+    if(lines.empty())
+      break;
+
+    // чтение за один запрос ограничено: записей - не больше LOG_RANGE_MAX_RECORDS и одного прохода лога сверху
+    CHECK(lines.size() <= LOG_RANGE_MAX_RECORDS + TEST_SENSORS + 10);
+
+    std::string last = lines.back();
+    result.insert(result.end(),lines.begin() + 1,lines.end() - 1);
+
+    if(last.find("OK=LOG|MORE|") != 0)
+    {
+      CHECK(last == "OK=LOG|END_OF_FILE");
+      break;
+    }
+
+    std::string resume = last.substr(12);
+    CHECK(resume > pageFrom || resume.substr(0,10) != pageFrom.substr(0,10)); // продвинулись вперёд
+    pageFrom = resume;
+  }
+
+  return result;
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+
+  // три часа показаний через полночь, проход лога - раз в 5 минут
+  HostRTCSet(2017,6,1,22,30,0);
+  for(int pass=0;pass<36;pass++)
+  {
+    sensor.SetValues(pass);
+    HostRunLoops(300,1000);
+  }
+
+  // температура всех датчиков с 23:00 до 01:00 - больше, чем читается за один запрос
+  int pages = 0;
+  std::vector<std::string> range = QueryRange("01.06.2017 23:00","02.06.2017 01:00","RT",pages);
+  CHECK(pages > 2);
+
+  // один датчик: строк меньше, но записей из промежутка читается столько же - и запросов столько же
+  int indexPages = 0;
+  std::vector<std::string> oneSensor = QueryRange("01.06.2017 23:00","02.06.2017 01:00","RT|3",indexPages);
+  CHECK_EQ(indexPages,pages);
+
+  // неверный промежуток
+  std::vector<std::string> bad = Query("CTGET=LOG|RANGE|02.06.2017 01:00|01.06.2017 23:00|RT");
+  CHECK(!bad.empty() && bad.back().find("ER=") == 0);
+
+  // то же самое, выбранное из целых файлов (FILE закрывает текущий лог, поэтому - в конце)
+  std::vector<std::string> expected, expectedOne;
+  AppendFromFile(expected,"01.06.2017","20170601.LOG","23:00","23:59","RT",-1);
+  AppendFromFile(expected,"02.06.2017","20170602.LOG","00:00","01:00","RT",-1);
+  AppendFromFile(expectedOne,"01.06.2017","20170601.LOG","23:00","23:59","RT",3);
+  AppendFromFile(expectedOne,"02.06.2017","20170602.LOG","00:00","01:00","RT",3);
+
+  CHECK(expected.size() > LOG_RANGE_MAX_RECORDS);
+  CHECK(range == expected);
+  CHECK(oneSensor == expectedOne);
+  CHECK(!expectedOne.empty());
+
+  printf("RANGE: %u lines in %d requests, one sensor: %u lines\n",(unsigned) range.size(),pages,(unsigned) oneSensor.size());
+
+  return HostTestResult();
+}
@@ -0,0 +1,128 @@
+// итоги по часам и суткам: места хватает на все датчики, какие могут быть в контроллере (по пулу состояний),
+// место пропавшего датчика занимается, когда у него за сутки нет показаний; CTGET=LOG|ROLLUPS говорит,
+// сколько датчиков в итогах и сколько раз показания не попали в итоги
+#include "HostTest.h"
+#include "ModuleController.h"
+
+#define OVERFLOW 2 // на сколько датчиков с показаниями за сутки больше, чем мест под итоги
+#define NEW_INDEX 200 // индексы датчиков, появившихся взамен
+
+class SensorModule : public AbstractModule
+{
+  public:
+    uint8_t Count; // сколько датчиков удалось завести - сколько осталось места в пуле состояний
+
+    SensorModule() : AbstractModule("TEST"), Count(0) {}
+
+    void Setup()
+    {
+      while(State.AddState(StateTemperature,Count))
+        Count++;
+    }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(uint8_t idx, int8_t value)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+
+    void SetAll(int pass)
+    {
+      for(uint8_t i=0;i<State.GetStateCount(StateTemperature);i++)
+        SetTemperature(State.GetStateByOrder(StateTemperature,i)->GetIndex(),10 + pass % 20);
+    }
+};
+
+// поле ответа CTGET=LOG|ROLLUPS: 0 - датчиков в итогах, 1 - максимум, 2 - не попало в итоги
+static long RollupsField(int field)
+{
+  std::string answer = HostCommand("CTGET=LOG|ROLLUPS");
+  std::string prefix = "OK=LOG|ROLLUPS|";
+  if(answer.find(prefix) != 0)
+    return -1;
+
+  size_t pos = prefix.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find('|',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+// файл итогов целиком
+static std::string ReadFile(const char* fileName)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,(std::string("CTGET=LOG|FILE|") + fileName + "\r\n").c_str());
+  HostRunLoops(200);
+  return HostSerialTakeOutput(0);
+}
+
+// крутит проходы лога (раз в LOGGING_INTERVAL), перед каждым - новые показания
+static void RunPasses(SensorModule& sensor, int passes)
+{
+  for(int pass=0;pass<passes;pass++)
+  {
+    sensor.SetAll(pass);
+    HostRunLoops(300,1000);
+  }
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  CHECK(sensor.Count > 0);
+  CHECK_EQ(RollupsField(1),STATE_POOL_SIZE);
+
+  // час показаний всех датчиков - в итогах все, ничего не потеряно
+  HostRTCSet(2017,6,1,22,30,0);
+  RunPasses(sensor,12);
+
+  CHECK(RollupsField(0) >= sensor.Count);
+  CHECK(RollupsField(0) <= RollupsField(1));
+  CHECK_EQ(RollupsField(2),0);
+
+  std::string hours = ReadFile("20170601.HR");
+  CHECK(hours.find("OK=FOLLOW") == 0);
+  for(uint8_t i=0;i<sensor.Count;i++)
+  {
+    char line[40];
+    sprintf(line,"01.06.2017 22:00,TEST,RT,%d,",i);
+    CHECK(hours.find(line) != std::string::npos);
+  }
+
+  // посреди суток часть датчиков заменили другими: у старых за эти сутки уже есть показания,
+  // их места не освобождаются - новые занимают свободные места, а кому не хватило - в итоги не попадают
+  uint8_t replaced = RollupsField(1) - RollupsField(0) + OVERFLOW;
+  CHECK(replaced <= sensor.Count);
+  for(uint8_t i=0;i<replaced;i++)
+    sensor.State.RemoveState(StateTemperature,i);
+  for(uint8_t i=0;i<replaced;i++)
+    CHECK(sensor.State.AddState(StateTemperature,NEW_INDEX + i) != NULL);
+
+  RunPasses(sensor,6); // до полуночи
+  long dropped = RollupsField(2);
+  CHECK_EQ(dropped,OVERFLOW*6);
+
+  // после полуночи старые датчики без показаний - их места занимают новые
+  RunPasses(sensor,13); // итоги часа пишутся проходом следующего часа
+  CHECK_EQ(RollupsField(2),dropped);
+
+  std::string nextDay = ReadFile("20170602.HR");
+  for(uint8_t i=0;i<replaced;i++)
+  {
+    char line[40];
+    sprintf(line,"02.06.2017 00:00,TEST,RT,%d,",NEW_INDEX + i);
+    CHECK(nextDay.find(line) != std::string::npos);
+    sprintf(line,"02.06.2017 00:00,TEST,RT,%d,",i);
+    CHECK(nextDay.find(line) == std::string::npos);
+  }
+
+  printf("rollups: %u TEST sensors, %ld sensors of %ld, %ld dropped\n",(unsigned) sensor.Count,RollupsField(0),RollupsField(1),dropped);
+
+  return HostTestResult();
+}
@@ -0,0 +1,85 @@
+// сжатый лог: таблица серий вмещает все датчики, какие могут быть в контроллере (по пулу состояний),
+// показания ни одного датчика не теряются; CTGET=LOG|SERIES говорит, сколько серий в таблице и сколько не попало в лог
+#include "HostTest.h"
+#include "ModuleController.h"
+
+class SensorModule : public AbstractModule
+{
+  public:
+    uint8_t Count; // сколько датчиков удалось завести - сколько осталось места в пуле состояний
+
+    SensorModule() : AbstractModule("TEST"), Count(0) {}
+
+    void Setup()
+    {
+      while(State.AddState(StateTemperature,Count))
+        Count++;
+    }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(uint8_t idx, int8_t value)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+};
+
+// поле ответа CTGET=LOG|SERIES: 0 - серий в таблице, 1 - максимум, 2 - не попало в лог
+static long SeriesField(int field)
+{
+  std::string answer = HostCommand("CTGET=LOG|SERIES");
+  std::string prefix = "OK=LOG|SERIES|";
+  if(answer.find(prefix) != 0)
+    return -1;
+
+  size_t pos = prefix.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find('|',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  CHECK(sensor.Count > 0);
+
+  HostRTCSet(2017,6,1,0,0,0);
+  for(int pass=0;pass<4;pass++)
+  {
+    for(uint8_t i=0;i<sensor.Count;i++)
+      sensor.SetTemperature(i,10 + (i + pass) % 20);
+    HostRunLoops(300,1000); // проход лога раз в LOGGING_INTERVAL
+  }
+
+  // все датчики - в таблице, ничего не потеряно
+  long series = SeriesField(0);
+  CHECK(series >= sensor.Count);
+  CHECK(series <= SeriesField(1));
+  CHECK_EQ(SeriesField(2),0);
+
+  // и в логе: последний проход содержит показания каждого датчика TEST
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,"CTGET=LOG|FILE|20170601.BIN|CSV\r\n");
+  HostRunLoops(200);
+  std::string csv = HostSerialTakeOutput(0);
+  CHECK(csv.find("OK=FOLLOW") == 0);
+
+  size_t lastPass = csv.rfind("\r\n00:");
+  CHECK(lastPass != std::string::npos);
+  std::string time = csv.substr(lastPass + 2,5);
+  for(uint8_t i=0;i<sensor.Count;i++)
+  {
+    char line[40];
+    sprintf(line,"%s,TEST,RT,%d,",time.c_str(),i);
+    CHECK(csv.find(line) != std::string::npos);
+  }
+
+  printf("compressed log: %u TEST sensors, %ld series of %ld\n",(unsigned) sensor.Count,series,SeriesField(1));
+
+  return HostTestResult();
+}
@@ -0,0 +1,143 @@
+// запись лога через общий буфер сектора: лог и файл действий, пишущиеся вперемешку, не портят друг друга;
+// замер - сколько блоков переписывает карта за сутки с буфером и без него (каждый проход лога сразу на карту)
+#include "HostTest.h"
+#include "ModuleController.h"
+#include <SD.h>
+
+#define SENSORS_COUNT 4
+#define ACTIONS_COUNT 50
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup() { for(uint8_t i=0;i<SENSORS_COUNT;i++) State.AddState(StateTemperature,i); }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(uint8_t idx, int8_t value)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+};
+
+static std::string ReadFile(const char* path)
+{
+  std::string result;
+  File f = SD.open(path);
+  if(!f)
+    return result;
+
+  int ch;
+  while((ch = f.read()) != -1)
+    result += (char) ch;
+
+  f.close();
+  return result;
+}
+
+// сколько блоков переписала бы карта, если бы каждый проход (строки с одним временем) сразу сбрасывался на неё
+static unsigned long UnbufferedBlockWrites(const std::string& log)
+{
+  SD.remove("replay.log");
+  File f = SD.open("replay.log",FILE_WRITE);
+
+  HostSDResetStats();
+  size_t passStart = 0;
+  while(passStart < log.length())
+  {
+    std::string time = log.substr(passStart,6); // ЧЧ:ММ,
+    size_t passEnd = passStart;
+    while(passEnd < log.length() && log.compare(passEnd,6,time) == 0)
+    {
+      size_t eol = log.find('\n',passEnd);
+      passEnd = eol == std::string::npos ? log.length() : eol + 1;
+    }
+
+    f.write((const uint8_t*) log.data() + passStart,passEnd - passStart);
+    f.flush();
+    passStart = passEnd;
+  }
+  unsigned long blocks = HostSDGetStats().BlockWrites;
+
+  f.close();
+  SD.remove("replay.log");
+  return blocks;
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  HostRTCSet(2017,6,1,0,0,0);
+  HostRunLoops(10,1000);
+  HostSDResetStats();
+
+  // сутки: показания меняются, между записями лога пишутся действия
+  int actions = 0;
+  for(int minute=0;minute<23*60;minute+=2)
+  {
+    for(uint8_t i=0;i<SENSORS_COUNT;i++)
+      sensor.SetTemperature(i,20 + (minute/7 + i) % 10);
+
+    if(actions < ACTIONS_COUNT && minute % 26 == 0)
+      MainController->Log(&sensor,String(F("ACTION")) + actions++);
+
+    HostRunLoops(120,1000);
+  }
+  CHECK_EQ(actions,ACTIONS_COUNT);
+  CHECK(HostCommand("CTSET=LOG|FLUSH").find("OK") == 0);
+  unsigned long buffered = HostSDGetStats().BlockWrites;
+
+  // действия - все и по порядку
+  std::string actionLog = ReadFile("actions/20170601.log");
+  size_t pos = 0;
+  for(int i=0;i<ACTIONS_COUNT;i++)
+  {
+    char expected[20];
+    sprintf(expected,",TEST,ACTION%d\r\n",i);
+    pos = actionLog.find(expected,pos);
+    CHECK(pos != std::string::npos);
+    if(pos == std::string::npos)
+      break;
+  }
+
+  // лог: строки целые, время не убывает, в каждом проходе - все датчики, чужих данных нет
+  std::string log = ReadFile("logs/20170601.log");
+  CHECK(log.length() > 0);
+  std::string lastTime;
+  size_t lines = 0, passes = 0, sensorLines = 0;
+  for(size_t lineStart=0;lineStart<log.length();)
+  {
+    size_t eol = log.find('\n',lineStart);
+    CHECK(eol != std::string::npos);
+    if(eol == std::string::npos)
+      break;
+
+    std::string line = log.substr(lineStart,eol - lineStart);
+    CHECK(line.length() > 6 && line[2] == ':' && line[5] == ',');
+    CHECK(line.substr(0,5) >= lastTime);
+    CHECK(line.find("ACTION") == std::string::npos);
+    if(line.substr(0,5) != lastTime)
+      passes++;
+    if(line.find(",TEST,") != std::string::npos)
+      sensorLines++;
+    lastTime = line.substr(0,5);
+    lineStart = eol + 1;
+    lines++;
+  }
+
+  CHECK(passes > 0);
+  CHECK_EQ(sensorLines,passes*SENSORS_COUNT);
+
+  unsigned long unbuffered = UnbufferedBlockWrites(log) + UnbufferedBlockWrites(actionLog);
+  CHECK(buffered < unbuffered);
+  printf("log: %u bytes, %u lines, %d actions; SD block writes per day: %lu buffered, %lu unbuffered\n",
+    (unsigned) log.length(),(unsigned) lines,ACTIONS_COUNT,buffered,unbuffered);
+
+  return HostTestResult();
+}
@@ -0,0 +1,93 @@
+// профилировщик обновления модулей: мин/ср/макс и превышения бюджета по каждому модулю и по всей итерации,
+// замер настоящей стоимости обновления модулей прошивки на рабочей станции
+#include "HostTest.h"
+#include "ModuleController.h"
+
+#define FAST_UPDATE 500 // мкс
+#define SLOW_UPDATE (PROFILER_MODULE_BUDGET + 1000)
+#define SLOW_EVERY 4 // каждое какое обновление - долгое
+
+class SlowModule : public AbstractModule
+{
+  public:
+    unsigned long Updates;
+    unsigned long SlowUpdates;
+    bool Paused; // только быстрые обновления - пока идёт команда, счёт долгих не меняется
+    bool Idle; // время не тратит - не мешает замеру модулей прошивки
+
+    SlowModule() : AbstractModule("SLOW"), Updates(0), SlowUpdates(0), Paused(true), Idle(false) {}
+
+    void Setup() {}
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void Update(uint16_t dt)
+    {
+      UNUSED(dt);
+      if(Idle)
+        return;
+
+      if(++Updates % SLOW_EVERY || Paused)
+        HostAdvanceMicros(FAST_UPDATE);
+      else
+      {
+        HostAdvanceMicros(SLOW_UPDATE);
+        SlowUpdates++;
+      }
+    }
+};
+
+// поле записи модуля из CTGET=0|PROFILE: 0 - мин, 1 - ср, 2 - макс, 3 - превышений
+static long ProfileField(const std::string& answer, const char* name, int field)
+{
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<field;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+int main()
+{
+  HostBoot();
+
+  SlowModule slow;
+  MainController->RegisterModule(&slow);
+
+  // симулированное время: в замер попадает ровно то, что "потратил" модуль, плюс чтения micros()
+  CHECK(HostCommand("CTSET=0|PROFILE").find("OK") == 0);
+  slow.Paused = false;
+  HostRunLoops(400);
+  slow.Paused = true;
+
+  std::string answer = HostCommand("CTGET=0|PROFILE");
+  CHECK(answer.find("OK=PROFILE|LOOP,") == 0);
+  CHECK(ProfileField(answer,"SLOW",0) >= FAST_UPDATE && ProfileField(answer,"SLOW",0) < FAST_UPDATE + 50);
+  CHECK(ProfileField(answer,"SLOW",2) >= SLOW_UPDATE && ProfileField(answer,"SLOW",2) < SLOW_UPDATE + 50);
+  long avg = ProfileField(answer,"SLOW",1);
+  CHECK(avg > FAST_UPDATE && avg < SLOW_UPDATE);
+  CHECK(slow.SlowUpdates > 0);
+  CHECK_EQ(ProfileField(answer,"SLOW",3),slow.SlowUpdates);
+  CHECK(ProfileField(answer,"LOOP",2) >= SLOW_UPDATE);
+
+  // сброс статистики
+  CHECK(HostCommand("CTSET=0|PROFILE").find("OK") == 0);
+  answer = HostCommand("CTGET=0|PROFILE");
+  CHECK_EQ(ProfileField(answer,"SLOW",3),0);
+  CHECK(ProfileField(answer,"SLOW",2) < SLOW_UPDATE);
+
+  // замер на настоящих часах: стоимость обновления модулей прошивки на рабочей станции, мкс
+  slow.Idle = true;
+  HostUseRealClock(true);
+  HostCommand("CTSET=0|PROFILE");
+  HostRunLoops(1000);
+  answer = HostCommand("CTGET=0|PROFILE");
+  HostUseRealClock(false);
+  printf("%s\n",answer.c_str());
+
+  return HostTestResult();
+}
@@ -0,0 +1,117 @@
+// длинные списки, для которых модуль включил потоковый режим, уходят в поток по мере формирования и не копятся
+// в PublishSingleton.Text целиком; ошибка после начала такого ответа приходит отдельной строкой ER=.
+// Остальные ответы, как и раньше, уходят одной строкой с окончательным статусом
+#include "HostTest.h"
+#include "ModuleController.h"
+
+#define ITEMS_COUNT 40
+
+class ListModule : public AbstractModule
+{
+  public:
+    size_t MaxText; // сколько максимум копилось в Text при формировании ответа
+
+    ListModule() : AbstractModule("LIST"), MaxText(0) {}
+
+    void Setup() {}
+    void Update(uint16_t dt) { UNUSED(dt); }
+
+    bool ExecCommand(const Command& command, bool wantAnswer)
+    {
+      UNUSED(wantAnswer);
+      String mode = command.GetArg(0);
+      bool stream = command.GetArgsCount() < 2; // второй аргумент PLAIN - без потокового режима
+      if(stream)
+        PublishSingleton.BeginStream(this,command);
+
+      if(mode == F("LATE")) // статус выставляется после вывода - ответ копится целиком
+      {
+        PublishSingleton = F("LATE");
+        AddItems();
+        PublishSingleton.Status = true;
+      }
+      else
+      {
+        PublishSingleton.Status = true;
+        PublishSingleton = F("ITEMS");
+        AddItems();
+
+        if(mode == F("FAIL")) // ошибка, когда начало ответа уже ушло
+        {
+          PublishSingleton.Status = false;
+          PublishSingleton = F("FAILED");
+        }
+      }
+
+      MainController->Publish(this,command);
+      return true;
+    }
+
+  private:
+    void AddItems()
+    {
+      for(int i=0;i<ITEMS_COUNT;i++)
+      {
+        PublishSingleton << PARAM_DELIMITER << F("item") << i;
+        if(PublishSingleton.Text.length() > MaxText)
+          MaxText = PublishSingleton.Text.length();
+      }
+    }
+};
+
+// все строки, пришедшие в Serial в ответ на команду
+static std::string RunCommand(const char* command)
+{
+  HostSerialTakeOutput(0);
+  HostSerialFeed(0,command);
+  HostSerialFeed(0,"\r\n");
+  HostRunLoops(20);
+  return HostSerialTakeOutput(0);
+}
+
+static std::string ExpectedItems()
+{
+  std::string items;
+  for(int i=0;i<ITEMS_COUNT;i++)
+    items += "|item" + std::to_string(i);
+  return items;
+}
+
+int main()
+{
+  HostBoot();
+
+  ListModule list;
+  MainController->RegisterModule(&list);
+
+  // длинный ответ - одна строка с одним заголовком, но в памяти копилось не больше порции
+  std::string answer = RunCommand("CTGET=LIST|OK");
+  CHECK(answer == "OK=LIST|ITEMS" + ExpectedItems() + "\r\n");
+  CHECK(list.MaxText < PUBLISH_STREAM_CHUNK + 10);
+
+  // ошибка после начала ответа: начатая строка завершена, ошибка - своей строкой
+  answer = RunCommand("CTGET=LIST|FAIL");
+  CHECK(answer.find("OK=LIST|ITEMS|item0") == 0);
+  size_t eol = answer.find("\r\n");
+  CHECK(eol != std::string::npos);
+  CHECK(answer.substr(eol + 2) == "ER=LIST|FAILED\r\n");
+
+  // статус неизвестен, пока ответ формируется, - ответ отдаётся целиком с правильным заголовком
+  list.MaxText = 0;
+  answer = RunCommand("CTGET=LIST|LATE");
+  CHECK(answer == "OK=LIST|LATE" + ExpectedItems() + "\r\n");
+  CHECK(list.MaxText > PUBLISH_STREAM_CHUNK);
+
+  // модуль не включал потоковый режим: ответ целиком, поздняя ошибка - единственной строкой ER=
+  list.MaxText = 0;
+  answer = RunCommand("CTGET=LIST|OK|PLAIN");
+  CHECK(answer == "OK=LIST|ITEMS" + ExpectedItems() + "\r\n");
+  CHECK(list.MaxText > PUBLISH_STREAM_CHUNK);
+
+  answer = RunCommand("CTGET=LIST|FAIL|PLAIN");
+  CHECK(answer == "ER=LIST|FAILED\r\n");
+
+  printf("max buffered answer: %u bytes streamed, %u bytes whole\n",(unsigned) PUBLISH_STREAM_CHUNK,(unsigned) list.MaxText);
+
+  return HostTestResult();
+}
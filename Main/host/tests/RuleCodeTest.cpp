@@ -0,0 +1,321 @@
+// байт-код условий правил: разбор текстовой записи (приоритеты, '!', диапазон, гистерезис, ошибки),
+// проверка байт-кода из EEPROM, печать условия и обратный разбор напечатанного, сохранение правил в EEPROM
+#include "HostTest.h"
+#include "ModuleController.h"
+#include "RuleCode.h"
+#include <EEPROM.h>
+#include <string.h>
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup() {}
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(uint8_t idx, int8_t value)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+};
+
+static bool SameCode(const RuleCodeWriter& a, const RuleCodeWriter& b)
+{
+  return a.GetLength() == b.GetLength() && !memcmp(a.GetCode(),b.GetCode(),a.GetLength());
+}
+
+static std::string Print(const RuleCodeWriter& writer)
+{
+  String out;
+  RuleCodePrint(writer.GetCode(),writer.GetLength(),out);
+  return out.c_str();
+}
+
+static bool Execute(const char* expression, SensorModule& module, uint8_t& latches)
+{
+  RuleCodeWriter writer;
+  CHECK(RuleCompileExpression(writer,expression));
+
+  RuleCodeContext context;
+  context.module = &module;
+  context.latches = &latches;
+  return RuleCodeExecute(writer.GetCode(),writer.GetLength(),context);
+}
+
+// сколько датчиков отслеживает условие, -1 - условие проверяется всегда
+static int Watched(const RuleCodeWriter& writer, SensorModule& module)
+{
+  CHECK(writer.IsValid());
+
+  uint8_t latches = 0;
+  RuleCodeContext context;
+  context.module = &module;
+  context.latches = &latches;
+  RuleCodeExecute(writer.GetCode(),writer.GetLength(),context);
+  return context.volatileAlert ? -1 : (int) context.watchedStates.size();
+}
+static int Watched(const char* expression, SensorModule& module)
+{
+  RuleCodeWriter writer;
+  CHECK(RuleCompileExpression(writer,expression));
+  return Watched(writer,module);
+}
+
+// составное условие печатается и разбирается обратно в тот же байт-код
+static void CheckRoundTrip(const char* expression)
+{
+  RuleCodeWriter writer;
+  CHECK(RuleCompileExpression(writer,expression));
+
+  std::string printed = Print(writer);
+  const std::string prefix = "EXPR|0|_|";
+  CHECK(printed.find(prefix) == 0);
+
+  RuleCodeWriter reparsed;
+  CHECK(RuleCompileExpression(reparsed,printed.c_str() + prefix.length()));
+  CHECK(SameCode(writer,reparsed));
+  CHECK(Print(reparsed) == printed);
+}
+
+int main()
+{
+  HostBoot();
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  sensor.State.AddState(StateTemperature,0);
+  sensor.State.AddState(StateTemperature,1);
+
+  // ',' (ИЛИ) слабее '&' (И): A,B&C - это A,(B&C)
+  {
+    RuleCodeWriter writer;
+    CHECK(RuleCompileExpression(writer,"TEMP0>20,TEMP1>20&TEMP1<5"));
+
+    RuleCodeWriter expected;
+    expected.Sensor(rtTemp,0); expected.Const(20); expected.Op(RC_GT);
+    expected.Sensor(rtTemp,1); expected.Const(20); expected.Op(RC_GT);
+    expected.Sensor(rtTemp,1); expected.Const(5); expected.Op(RC_LT);
+    expected.Op(RC_AND);
+    expected.Op(RC_OR);
+    CHECK(expected.IsValid());
+    CHECK(SameCode(writer,expected));
+
+    uint8_t latches = 0;
+    sensor.SetTemperature(0,25);
+    sensor.SetTemperature(1,10);
+    CHECK(Execute("TEMP0>20,TEMP1>20&TEMP1<5",sensor,latches));
+    CHECK(!Execute("(TEMP0>20,TEMP1>20)&TEMP1<5",sensor,latches));
+  }
+
+  // '!' относится к ближайшему условию или скобке
+  {
+    RuleCodeWriter writer;
+    CHECK(RuleCompileExpression(writer,"!TEMP0>20&TEMP1<5"));
+
+    RuleCodeWriter expected;
+    expected.Sensor(rtTemp,0); expected.Const(20); expected.Op(RC_GT); expected.Op(RC_NOT);
+    expected.Sensor(rtTemp,1); expected.Const(5); expected.Op(RC_LT);
+    expected.Op(RC_AND);
+    CHECK(SameCode(writer,expected));
+
+    uint8_t latches = 0;
+    sensor.SetTemperature(0,25);
+    sensor.SetTemperature(1,10);
+    CHECK(!Execute("!TEMP0>20",sensor,latches));
+    CHECK(Execute("!!TEMP0>20",sensor,latches));
+    CHECK(Execute("!(TEMP0>20&TEMP1<5)",sensor,latches));
+  }
+
+  // диапазон - включительно, гистерезис - по защёлке правила, у каждого гистерезиса своя
+  {
+    uint8_t latches = 0;
+    sensor.SetTemperature(0,18);
+    CHECK(Execute("TEMP0[18:25]",sensor,latches));
+    sensor.SetTemperature(0,26);
+    CHECK(!Execute("TEMP0[18:25]",sensor,latches));
+
+    const char* hyst = "TEMP0{20:25}";
+    sensor.SetTemperature(0,22);
+    CHECK(!Execute(hyst,sensor,latches));
+    sensor.SetTemperature(0,25);
+    CHECK(Execute(hyst,sensor,latches));
+    CHECK_EQ(latches,1);
+    sensor.SetTemperature(0,22);
+    CHECK(Execute(hyst,sensor,latches));
+    sensor.SetTemperature(0,20);
+    CHECK(!Execute(hyst,sensor,latches));
+    CHECK_EQ(latches,0);
+
+    RuleCodeWriter writer;
+    CHECK(RuleCompileExpression(writer,"TEMP0{20:25}&TEMP1{1:2}"));
+    CHECK_EQ(writer.GetCode()[8],0); // номер защёлки первого гистерезиса
+    CHECK_EQ(writer.GetCode()[17],1);
+
+    sensor.SetTemperature(1,2);
+    sensor.SetTemperature(0,30);
+    latches = 0;
+    CHECK(Execute("TEMP0{20:25}&TEMP1{1:2}",sensor,latches));
+    CHECK_EQ(latches,3);
+  }
+
+  // за каждым датчиком условия следим по изменениям, один и тот же датчик отслеживается один раз
+  {
+    for(uint8_t i=2;i<=ALERT_RULE_MAX_WATCHED_STATES;i++)
+    {
+      sensor.State.AddState(StateTemperature,i);
+      sensor.SetTemperature(i,10); // у датчика без показаний следим ещё и за резервным - проверяем всегда
+    }
+
+    CHECK_EQ(Watched("TEMP0>20",sensor),1);
+    CHECK_EQ(Watched("TEMP0>20&TEMP1<5",sensor),2);
+    CHECK_EQ(Watched("TEMP0>20,TEMP0<5",sensor),1);
+    CHECK_EQ(Watched("TEMP0>20&PIN3=1",sensor),-1); // пин изменений не сообщает
+
+    // в записи помещается не больше ALERT_RULE_MAX_WATCHED_STATES сравнений - все они отслеживаются
+    std::string all;
+    for(uint8_t i=0;i<ALERT_RULE_MAX_WATCHED_STATES;i++)
+    {
+      if(i)
+        all += ",";
+      all += "TEMP" + std::to_string(i) + "<0";
+    }
+    CHECK_EQ(Watched(all.c_str(),sensor),ALERT_RULE_MAX_WATCHED_STATES);
+
+    // байт-код без сравнений может читать больше датчиков, чем отслеживается
+    RuleCodeWriter many;
+    many.Sensor(rtTemp,0);
+    for(uint8_t i=1;i<=ALERT_RULE_MAX_WATCHED_STATES;i++)
+    {
+      many.Sensor(rtTemp,i);
+      many.Op(RC_AND);
+    }
+    CHECK(RuleCodeVerify(many.GetCode(),many.GetLength()));
+    CHECK_EQ(Watched(many,sensor),-1);
+
+    for(uint8_t i=2;i<=ALERT_RULE_MAX_WATCHED_STATES;i++)
+      sensor.State.RemoveState(StateTemperature,i);
+  }
+
+  // ошибки записи
+  {
+    const char* malformed[] = {
+      "", "TEMP", "TEMP0", "TEMP0>", "TEMP0>>1", "TEMP0=<1", "FOO0>1", "temp0>1", "TEMP0>1 ",
+      "TEMP0>1&", "TEMP0>1,", "&TEMP0>1", "TEMP0>1TEMP1>1", "(TEMP0>1", "TEMP0>1)", "()", "!",
+      "TEMP0[1:2", "TEMP0[1]", "TEMP0[1:2}", "TEMP0{1}", "TEMP0{1:}", "TEMP0>%TX%",
+      "(((((((((TEMP0>1)))))))))", // вложенность глубже стека
+      "TEMP0>100000&TEMP1>100000&TEMP2>100000&TEMP3>100000" // байт-код длиннее ALERT_RULE_MAX_CODE_LENGTH
+    };
+
+    for(size_t i=0;i<sizeof(malformed)/sizeof(malformed[0]);i++)
+    {
+      RuleCodeWriter writer;
+      if(RuleCompileExpression(writer,malformed[i]))
+      {
+        hostTestFailures++;
+        fprintf(stderr,"compiled malformed expression \"%s\"\n",malformed[i]);
+      }
+    }
+  }
+
+  // проверка байт-кода, прочитанного из EEPROM
+  {
+    RuleCodeWriter writer;
+    CHECK(RuleCompileExpression(writer,"TEMP0{20:25}&!PIN3=1"));
+    CHECK(RuleCodeVerify(writer.GetCode(),writer.GetLength()));
+
+    CHECK(!RuleCodeVerify(NULL,0));
+    CHECK(!RuleCodeVerify(writer.GetCode(),0));
+    CHECK(!RuleCodeVerify(writer.GetCode(),writer.GetLength()-1)); // на стеке остаётся больше одного значения
+    CHECK(!RuleCodeVerify(writer.GetCode(),2)); // аргументы обрезаны
+
+    const uint8_t unknownOp[] = { RC_CONST8, 1, 0x7F };
+    CHECK(!RuleCodeVerify(unknownOp,sizeof(unknownOp)));
+
+    const uint8_t underflow[] = { RC_CONST8, 1, RC_AND };
+    CHECK(!RuleCodeVerify(underflow,sizeof(underflow)));
+
+    const uint8_t twoValues[] = { RC_CONST8, 1, RC_CONST8, 2 };
+    CHECK(!RuleCodeVerify(twoValues,sizeof(twoValues)));
+
+    const uint8_t badLatch[] = { RC_CONST8, 1, RC_CONST8, 0, RC_CONST8, 2, RC_HYST, RC_MAX_LATCHES };
+    CHECK(!RuleCodeVerify(badLatch,sizeof(badLatch)));
+
+    uint8_t goodLatch[sizeof(badLatch)];
+    memcpy(goodLatch,badLatch,sizeof(badLatch));
+    goodLatch[sizeof(goodLatch)-1] = RC_MAX_LATCHES - 1;
+    CHECK(RuleCodeVerify(goodLatch,sizeof(goodLatch)));
+
+    uint8_t deep[ALERT_RULE_STACK_DEPTH*2 + 2];
+    for(uint8_t i=0;i<sizeof(deep);i+=2)
+    {
+      deep[i] = RC_CONST8;
+      deep[i+1] = i;
+    }
+    CHECK(!RuleCodeVerify(deep,sizeof(deep))); // стек глубже ALERT_RULE_STACK_DEPTH
+  }
+
+  // печать: простые условия - в старом формате, составные - текстовой записью, которая разбирается обратно
+  {
+    RuleCodeWriter simple;
+    CHECK(RuleCompileCondition(simple,"TEMP",1,">","23"));
+    CHECK(Print(simple) == "TEMP|1|>|23");
+
+    RuleCodeWriter openTemp;
+    CHECK(RuleCompileCondition(openTemp,"TEMP",0,"<=","%TO%"));
+    CHECK(Print(openTemp) == "TEMP|0|<=|%TO%");
+
+    RuleCodeWriter noSensor;
+    CHECK(RuleCompileCondition(noSensor,"_",0,">","0"));
+    CHECK(Print(noSensor).find("|0|>|0") != std::string::npos);
+
+    CheckRoundTrip("TEMP0>20,TEMP1>20&TEMP1<5");
+    CheckRoundTrip("!TEMP0>20&PIN3=1");
+    CheckRoundTrip("TEMP0{20:25}&!HUMIDITY1>80");
+    CheckRoundTrip("(TEMP0[18:25],LIGHT0<-500)&SOIL2>=40000");
+    CheckRoundTrip("!(PH0<=%TO%,TEMP1=%TC%)");
+    CheckRoundTrip("TEMP0=5");
+  }
+
+  // правила, не помещающиеся в EEPROM до настроек pH, не сохраняются, и настройки pH не портятся
+  {
+    CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+    CHECK(HostCommand("CTSET=ALERT|SAVE").find("OK") == 0);
+
+    uint8_t phSettings[8];
+    for(uint8_t i=0;i<sizeof(phSettings);i++)
+      phSettings[i] = EEPROM.read(PH_SETTINGS_EEPROM_ADDR + i);
+
+    std::string longCommand = "CTSET=WATER|T_SETT"; // неразобранная команда хранится целиком
+    for(int i=0;i<20;i++)
+      longCommand += "|ARG" + std::to_string(i);
+
+    bool saved = true;
+    uint8_t added = 0;
+    while(saved && added < MAX_ALERT_RULES)
+    {
+      std::string rule = "CTSET=ALERT|RULE_ADD|R" + std::to_string(added) + "|TEST|TEMP|0|>|25|0|0|127|_|" + longCommand;
+      CHECK(HostCommand(rule.c_str()).find("OK") == 0);
+      added++;
+
+      std::string answer = HostCommand("CTSET=ALERT|SAVE");
+      saved = answer.find("OK") == 0;
+      if(!saved)
+        CHECK(answer.find("NO_ROOM") != std::string::npos);
+    }
+    CHECK(!saved);
+    CHECK(added > 1);
+
+    for(uint8_t i=0;i<sizeof(phSettings);i++)
+      CHECK_EQ(EEPROM.read(PH_SETTINGS_EEPROM_ADDR + i),phSettings[i]);
+
+    // после отказа правила в памяти остаются, а удаление лишнего снова даёт сохранить
+    std::string last = "CTSET=ALERT|RULE_DELETE|R" + std::to_string(added-1);
+    CHECK(HostCommand(last.c_str()).find("OK") == 0);
+    CHECK(HostCommand("CTSET=ALERT|SAVE").find("OK") == 0);
+  }
+
+  return HostTestResult();
+}
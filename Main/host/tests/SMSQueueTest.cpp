@@ -0,0 +1,183 @@
+// команды из файлов SMS, пришедшие подряд, в том числе пока модем отсылает ответ, выполняются по очереди
+// и ни одна не теряется молча: сверх SMS_COMMANDS_QUEUE_LENGTH отправитель получает ответ SMS_BUSY_ANSWER
+#include "HostTest.h"
+#include "Globals.h"
+#include "PDUClasses.h"
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+
+#define GSM_PORT 1
+#define PHONE "+79180000000"
+
+unsigned int hash_str(const char* s);
+
+static std::string modemInput; // что прошивка отправила модему, ещё не разобранное
+static std::vector<std::string> sentSMS; // PDU отосланных SMS
+static bool holdSMS = false; // модем не даёт приглашения на отсылку SMS, пока не отпустят
+static bool welcomeHeld = false;
+
+// модем: на команды отвечает OK, регистрирован в сети, SMS отсылает сразу
+static void ModemStep()
+{
+  modemInput += HostSerialTakeOutput(GSM_PORT);
+
+  while(true)
+  {
+    size_t eol = modemInput.find("\r\n");
+    size_t ctrlZ = modemInput.find('\x1A');
+
+    if(ctrlZ != std::string::npos && (eol == std::string::npos || ctrlZ < eol)) // данные SMS
+    {
+      sentSMS.push_back(modemInput.substr(0,ctrlZ));
+      modemInput.erase(0,ctrlZ + 1);
+      HostSerialFeed(GSM_PORT,"\r\n+CMGS: 1\r\n\r\nOK\r\n");
+      continue;
+    }
+
+    if(eol == std::string::npos)
+      break;
+
+    std::string line = modemInput.substr(0,eol);
+    modemInput.erase(0,eol + 2);
+
+    if(line == "AT+CPAS")
+      HostSerialFeed(GSM_PORT,"+CPAS: 0\r\n");
+    else if(line == "AT+CREG?")
+      HostSerialFeed(GSM_PORT,"+CREG: 0,1\r\n");
+    else if(line.find("AT+CMGS=") == 0)
+    {
+      if(holdSMS)
+        welcomeHeld = true;
+      else
+        HostSerialFeed(GSM_PORT,"> ");
+    }
+    else if(line.find("AT") == 0)
+      HostSerialFeed(GSM_PORT,"OK\r\n");
+  }
+}
+
+static void Run(unsigned long loops)
+{
+  for(unsigned long i=0;i<loops;i++)
+  {
+    HostRunLoops(1);
+    ModemStep();
+
+    if(welcomeHeld && !holdSMS)
+    {
+      welcomeHeld = false;
+      HostSerialFeed(GSM_PORT,"> ");
+    }
+  }
+}
+
+static std::string Hex(uint8_t b)
+{
+  char buf[3];
+  sprintf(buf,"%02X",b);
+  return buf;
+}
+
+// входящее SMS с номера PHONE в семибитной кодировке
+static std::string MakePDU(const std::string& text)
+{
+  std::string number = std::string(PHONE + 1) + "F";
+  std::string pdu = "00" "04" + Hex(strlen(PHONE) - 1) + "91";
+  for(size_t i=0;i+1<number.length();i+=2)
+  {
+    pdu += number[i+1];
+    pdu += number[i];
+  }
+
+  pdu += "00" "00" "71601021000000";
+  pdu += Hex(text.length());
+
+  unsigned int acc = 0;
+  int bits = 0;
+  for(size_t i=0;i<text.length();i++)
+  {
+    acc |= (unsigned int) (text[i] & 0x7F) << bits;
+    bits += 7;
+    while(bits >= 8)
+    {
+      pdu += Hex(acc & 0xFF);
+      acc >>= 8;
+      bits -= 8;
+    }
+  }
+  if(bits)
+    pdu += Hex(acc & 0xFF);
+
+  return pdu;
+}
+
+// файл на SD с ответом и командой для SMS с текстом text (имена на карте - в верхнем регистре)
+static void WriteSMSFile(const std::string& text, const std::string& answer, const std::string& command)
+{
+  std::string dir = std::string(HostTestSDDir()) + "/SMS";
+  mkdir(dir.c_str(),0755);
+
+  char name[32];
+  sprintf(name,"/%u.SMS",hash_str(text.c_str()));
+  FILE* f = fopen((dir + name).c_str(),"wb");
+  fprintf(f,"%s\r\n%s\r\n",answer.c_str(),command.c_str());
+  fclose(f);
+}
+
+int main()
+{
+  HostBoot();
+  CHECK(HostCommand("CTSET=0|PHONE|" PHONE).find("OK") == 0);
+  Run(2000); // модем настраивается и регистрируется в сети
+
+  // первая команда выполняется сразу, её ответ застревает в модеме, следующие ждут в очереди
+  const int smsCount = SMS_COMMANDS_QUEUE_LENGTH + 2;
+  std::string burst;
+  for(int i=0;i<smsCount;i++)
+  {
+    std::string text = "cmd" + std::to_string(i);
+    WriteSMSFile(text,"done" + std::to_string(i),"CTSET=PIN|" + std::to_string(50 + i) + "|ON");
+
+    std::string pdu = MakePDU(text);
+    burst += "+CMT: ," + std::to_string(pdu.length()/2 - 1) + "\r\n" + pdu + "\r\n";
+  }
+
+  sentSMS.clear();
+  holdSMS = true;
+  HostSerialFeed(GSM_PORT,burst.c_str()); // SMS приходят подряд, пока модем занят отсылкой первого ответа
+  Run(500);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(HostGetDigital(51),LOW);
+  CHECK(sentSMS.empty());
+
+  holdSMS = false;
+  Run(2000);
+
+  // команды в пределах очереди выполнены все, лишняя - нет
+  for(int i=0;i<=SMS_COMMANDS_QUEUE_LENGTH;i++)
+    CHECK_EQ(HostGetDigital(50 + i),HIGH);
+  CHECK_EQ(HostGetDigital(50 + SMS_COMMANDS_QUEUE_LENGTH + 1),LOW);
+
+  // на каждую команду ушёл свой ответ, на не влезшую - "занят"
+  CHECK_EQ(sentSMS.size(),smsCount);
+  CHECK(sentSMS[0] == PDU.Encode(PHONE,"done0",true).Message.c_str()); // ответы - в порядке выполнения команд
+  std::string busy = PDU.Encode(PHONE,String(SMS_BUSY_ANSWER),true).Message.c_str();
+  int busyCount = 0;
+  for(size_t i=0;i<sentSMS.size();i++)
+  {
+    if(sentSMS[i] == busy)
+      busyCount++;
+
+    for(int j=0;j<=SMS_COMMANDS_QUEUE_LENGTH;j++)
+    {
+      std::string answer = PDU.Encode(PHONE,String(("done" + std::to_string(j)).c_str()),true).Message.c_str();
+      if(sentSMS[i] == answer)
+        sentSMS[i] = "answered";
+    }
+  }
+  CHECK_EQ(busyCount,1);
+  CHECK_EQ(std::count(sentSMS.begin(),sentSMS.end(),std::string("answered")),SMS_COMMANDS_QUEUE_LENGTH + 1);
+
+  return HostTestResult();
+}
@@ -0,0 +1,170 @@
+// модули, попросившие SleepFor, не обновляются до срока: прошедшее время копится и целиком приходит в dt,
+// копилка насыщается на 65535 мс, команда модулю будит его на ближайшей итерации; замер стоимости
+// итерации loop на рабочей станции с пропуском спящих модулей и без него
+#include "HostTest.h"
+#include "ModuleController.h"
+
+class SleeperModule : public AbstractModule
+{
+  public:
+    unsigned long Updates;
+    unsigned long TotalDt; // сумма всех dt, пришедших в Update
+    uint16_t LastDt;
+    unsigned long LastUpdateAt, PrevUpdateAt; // millis() последнего и предыдущего обновлений
+    uint16_t Interval; // сколько просить спать после каждого обновления
+    unsigned long UpdatesAtCommand;
+
+    SleeperModule() : AbstractModule("SLEEPER"), Updates(0), TotalDt(0), LastDt(0), LastUpdateAt(0), PrevUpdateAt(0),
+      Interval(0), UpdatesAtCommand(0) {}
+
+    // в dt пришло всё время с предыдущего обновления: dt считается по millis() в начале итерации,
+    // а обновление идёт чуть позже - допускаем расхождение на миллисекунду
+    bool DtIsElapsed() { return labs((long) LastDt - (long) (LastUpdateAt - PrevUpdateAt)) <= 1; }
+
+    void Setup() {}
+
+    void Update(uint16_t dt)
+    {
+      Updates++;
+      TotalDt += dt;
+      LastDt = dt;
+      PrevUpdateAt = LastUpdateAt;
+      LastUpdateAt = millis();
+      SleepFor(Interval);
+    }
+
+    bool ExecCommand(const Command& command, bool wantAnswer)
+    {
+      UNUSED(command);
+      UNUSED(wantAnswer);
+      UpdatesAtCommand = Updates;
+      PublishSingleton.Status = true;
+      PublishSingleton = F("PONG");
+      MainController->Publish(this,command);
+      return true;
+    }
+
+    void Sleep(uint16_t ms) { SleepFor(ms); }
+};
+
+// поле записи LOOP из CTGET=0|PROFILE: 0 - мин, 1 - ср, 2 - макс
+static long LoopField(const std::string& answer, int field)
+{
+  size_t pos = answer.find("|LOOP,");
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += 6;
+  for(int i=0;i<field;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+// крутит loop на настоящих часах, wakeAll - обновлять все модули на каждой итерации, как без SleepFor
+static std::string MeasureLoop(unsigned long loops, bool wakeAll)
+{
+  HostUseRealClock(true);
+  HostCommand("CTSET=0|PROFILE");
+  for(unsigned long i=0;i<loops;i++)
+  {
+    if(wakeAll)
+    {
+      for(size_t m=0;m<MainController->GetModulesCount();m++)
+        MainController->GetModule(m)->WakeUp();
+    }
+    loop();
+  }
+  std::string answer = HostCommand("CTGET=0|PROFILE");
+  HostUseRealClock(false);
+  return answer;
+}
+
+int main()
+{
+  HostBoot();
+
+  SleeperModule sleeper;
+  MainController->RegisterModule(&sleeper);
+
+  // без SleepFor модуль обновляется на каждой итерации
+  HostRunLoops(10);
+  CHECK_EQ(sleeper.Updates,10);
+
+  // спит 100 мс при шаге 10 мс: одно обновление на 10 итераций, в dt - всё накопленное время
+  // (итерация loop сама занимает немного симулированного времени, поэтому шаг - чуть больше 10 мс)
+  sleeper.Interval = 100;
+  HostRunLoops(1);
+  unsigned long updates = sleeper.Updates;
+  unsigned long totalDt = sleeper.TotalDt;
+  unsigned long updateAt = sleeper.LastUpdateAt;
+  HostRunLoops(1000);
+  CHECK(sleeper.Updates - updates >= 95 && sleeper.Updates - updates <= 100);
+  CHECK(sleeper.LastDt >= 100 && sleeper.LastDt < 110);
+  CHECK(sleeper.DtIsElapsed());
+  CHECK(labs((long) (sleeper.TotalDt - totalDt) - (long) (sleeper.LastUpdateAt - updateAt)) <= 1); // время не теряется и не удваивается
+
+  // срок не кратен шагу - обновление на первой итерации после срока
+  sleeper.Interval = 95;
+  HostRunLoops(1);
+  updates = sleeper.Updates;
+  totalDt = sleeper.TotalDt;
+  updateAt = sleeper.LastUpdateAt;
+  HostRunLoops(1000);
+  CHECK(sleeper.Updates - updates >= 95 && sleeper.Updates - updates <= 100);
+  CHECK(sleeper.LastDt >= 95 && sleeper.LastDt < 110);
+  CHECK(sleeper.DtIsElapsed());
+  CHECK(labs((long) (sleeper.TotalDt - totalDt) - (long) (sleeper.LastUpdateAt - updateAt)) <= 1);
+
+  // копилка насыщается: больше 65535 мс в dt не передаётся, и модуль со сроком 65535 мс просыпается
+  {
+    SleeperModule direct;
+    uint16_t updateDt = 0;
+    direct.Sleep(0xFFFF);
+    CHECK(!direct.IsUpdateDue(60000,updateDt));
+    CHECK(direct.IsUpdateDue(60000,updateDt));
+    CHECK_EQ(updateDt,0xFFFF);
+
+    direct.Sleep(0xFFFF);
+    CHECK(!direct.IsUpdateDue(0xFFFF - 1,updateDt));
+    CHECK(direct.IsUpdateDue(1,updateDt));
+    CHECK_EQ(updateDt,0xFFFF);
+
+    // срок сбрасывается обновлением: без нового SleepFor модуль обновляется на каждой итерации
+    CHECK(direct.IsUpdateDue(10,updateDt));
+    CHECK_EQ(updateDt,10);
+  }
+
+  // команда будит спящий модуль: он обновляется в той же итерации и получает всё накопленное время
+  sleeper.Interval = 0xFFFF;
+  sleeper.WakeUp();
+  HostRunLoops(1);
+  updates = sleeper.Updates;
+  HostRunLoops(50);
+  CHECK_EQ(sleeper.Updates,updates);
+  CHECK(HostCommand("CTGET=SLEEPER|PING").find("PONG") != std::string::npos);
+  CHECK_EQ(sleeper.Updates,sleeper.UpdatesAtCommand + 1);
+  CHECK(sleeper.LastDt >= 500);
+  CHECK(sleeper.DtIsElapsed());
+
+  // WakeUp без команды - то же самое
+  updates = sleeper.Updates;
+  HostRunLoops(10);
+  CHECK_EQ(sleeper.Updates,updates);
+  sleeper.WakeUp();
+  HostRunLoops(1);
+  CHECK_EQ(sleeper.Updates,updates + 1);
+  CHECK(sleeper.LastDt >= 100);
+  CHECK(sleeper.DtIsElapsed());
+
+  // замер на настоящих часах: итерация loop со спящими модулями и с обновлением всех модулей каждый раз, мкс
+  sleeper.Interval = 0;
+  HostRunLoops(500); // модули прошли первые обновления
+  std::string skipping = MeasureLoop(2000,false);
+  std::string everyLoop = MeasureLoop(2000,true);
+  CHECK(LoopField(skipping,1) >= 0 && LoopField(everyLoop,1) >= 0);
+  printf("LOOP with SleepFor: avg %ld us, max %ld us\n",LoopField(skipping,1),LoopField(skipping,2));
+  printf("LOOP updating every module: avg %ld us, max %ld us\n",LoopField(everyLoop,1),LoopField(everyLoop,2));
+
+  return HostTestResult();
+}
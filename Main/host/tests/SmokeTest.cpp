@@ -0,0 +1,19 @@
+// прошивка стартует на заглушках и отвечает на команды из Serial
+#include "HostTest.h"
+
+int main()
+{
+  HostBoot();
+
+  HostRunLoops(100);
+
+  std::string answer = HostCommand("CTGET=0|PING");
+  CHECK(answer.find("PONG") != std::string::npos);
+
+  // часы идут по симулированному времени
+  HostRTCSet(2017,6,1,12,0,0);
+  answer = HostCommand("CTGET=STAT|DATETIME");
+  CHECK(answer.find("01.06.2017") != std::string::npos);
+
+  return HostTestResult();
+}
@@ -0,0 +1,69 @@
+// удаление состояния (CTSET=DELTA|DEL): подписчики узнают о нём до удаления и забывают указатель,
+// правило, следившее за удалённым датчиком, перепроверяется и подхватывает датчик, когда он появится снова
+#include "HostTest.h"
+#include "ModuleController.h"
+
+class SensorModule : public AbstractModule
+{
+  public:
+    SensorModule() : AbstractModule("TEST") {}
+
+    void Setup() { State.AddState(StateTemperature,0); State.AddState(StateTemperature,1); }
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+
+    void SetTemperature(uint8_t idx, int8_t value)
+    {
+      Temperature t(value,0);
+      State.UpdateState(StateTemperature,idx,(void*)&t);
+    }
+};
+
+// сколько команд отправило правило - из CTGET=ALERT|STATS: имя,проверок,истинно,запрещено,команд
+static long Dispatched(const char* name)
+{
+  std::string answer = HostCommand("CTGET=ALERT|STATS");
+  std::string key = std::string("|") + name + ",";
+  size_t pos = answer.find(key);
+  if(pos == std::string::npos)
+    return -1;
+
+  pos += key.length();
+  for(int i=0;i<3;i++)
+    pos = answer.find(',',pos) + 1;
+
+  return atol(answer.c_str() + pos);
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(3100); // фрамуги доезжают до места - после этого правила отправляют команды заново
+
+  SensorModule sensor;
+  MainController->RegisterModule(&sensor);
+  sensor.SetTemperature(0,30);
+  sensor.SetTemperature(1,20);
+
+  CHECK(HostCommand("CTSET=DELTA|ADD|TEMP|TEST|0|TEST|1").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_DELETE|ALL").find("OK") == 0);
+  CHECK(HostCommand("CTSET=ALERT|RULE_ADD|D|DELTA|TEMP|0|>|5|0|0|127|_|CTSET=PIN|50|ON").find("OK") == 0);
+  HostRunLoops(600); // дельта пересчитывается раз в DELTA_UPDATE_INTERVAL
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(Dispatched("D"),1);
+
+  // дельты удалены: правило, следившее за состоянием дельты, не держит указатель на удалённое
+  HostCommand("CTSET=PIN|50|OFF");
+  CHECK(HostCommand("CTSET=DELTA|DEL").find("OK") == 0);
+  CHECK(HostCommand("CTGET=DELTA|CNT") == "OK=DELTA|CNT|0");
+  HostRunLoops(200);
+  CHECK_EQ(HostGetDigital(50),LOW);
+
+  // то же состояние появилось снова - правило его подхватывает и срабатывает заново
+  CHECK(HostCommand("CTSET=DELTA|ADD|TEMP|TEST|0|TEST|1").find("OK") == 0);
+  HostRunLoops(600);
+  CHECK_EQ(HostGetDigital(50),HIGH);
+  CHECK_EQ(Dispatched("D"),2);
+
+  return HostTestResult();
+}
@@ -0,0 +1,144 @@
+// TinyVector: элементы - объекты (конструируются, копируются, разрушаются), первые элементы - внутри вектора,
+// рост удвоением; замер стоимости push_back для вектора в куче, с reserve и со встроенным буфером
+#include "HostTest.h"
+#include "TinyVector.h"
+#include <chrono>
+
+struct Tracked
+{
+  static int Alive; // сколько объектов сейчас живёт
+  int Value;
+
+  Tracked(int v = 0) : Value(v) { Alive++; }
+  Tracked(const Tracked& rhs) : Value(rhs.Value) { Alive++; }
+  Tracked(Tracked&& rhs) : Value(rhs.Value) { rhs.Value = -1; Alive++; }
+  ~Tracked() { Alive--; }
+};
+int Tracked::Alive = 0;
+
+template<typename V>
+static bool IsInside(V& v)
+{
+  const char* p = (const char*) v.pData();
+  return p >= (const char*) &v && p < (const char*) (&v + 1);
+}
+
+// сколько раз менялась ёмкость за count добавлений
+template<typename V>
+static int Regrowths(V& v, int count)
+{
+  int regrowths = 0;
+  for(int i=0;i<count;i++)
+  {
+    size_t cap = v.capacity();
+    CHECK(v.push_back(i));
+    if(v.capacity() != cap)
+      regrowths++;
+  }
+  return regrowths;
+}
+
+// средняя стоимость push_back, нс: rounds раз наполняем новый вектор count элементами
+template<typename V>
+static double PushCost(int count, unsigned long rounds, bool reserve)
+{
+  unsigned long sum = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(unsigned long r=0;r<rounds;r++)
+  {
+    V v;
+    if(reserve)
+      v.reserve(count);
+    for(int i=0;i<count;i++)
+      v.push_back(i);
+    sum += v[count-1];
+  }
+  double ns = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count();
+  CHECK_EQ(sum,(unsigned long) (count-1)*rounds);
+  return ns/(rounds*count);
+}
+
+int main()
+{
+  // элементы конструируются и разрушаются как объекты
+  {
+    Vector<Tracked> v;
+    for(int i=0;i<100;i++)
+      CHECK(v.push_back(Tracked(i)));
+    CHECK_EQ(Tracked::Alive,100);
+
+    Vector<Tracked> copy(v);
+    CHECK_EQ(Tracked::Alive,200);
+    CHECK_EQ(copy[99].Value,99);
+
+    Vector<Tracked> moved(static_cast<Vector<Tracked>&&>(copy)); // блок в куче забирается целиком
+    CHECK_EQ(Tracked::Alive,200);
+    CHECK_EQ(copy.size(),0);
+    CHECK_EQ(moved[50].Value,50);
+
+    // добавление своего же элемента при росте
+    while(v.size() < v.capacity())
+      v.push_back(Tracked(0));
+    CHECK(v.push_back(v[7]));
+    CHECK_EQ(v[v.size()-1].Value,7);
+
+    v.Clear();
+    CHECK_EQ(v.size(),0);
+    CHECK_EQ(v.capacity(),0);
+  }
+  CHECK_EQ(Tracked::Alive,0);
+
+  // без встроенного буфера вектор не больше прежнего, со встроенным - первые элементы не в куче
+  CHECK_EQ(sizeof(Vector<int>),sizeof(size_t)*2 + sizeof(int*));
+  {
+    Vector<int,8> v;
+    for(int i=0;i<8;i++)
+      v.push_back(i);
+    CHECK(IsInside(v));
+    CHECK_EQ(v.capacity(),8);
+
+    v.push_back(8);
+    CHECK(!IsInside(v));
+    CHECK_EQ(v[8],8);
+    CHECK_EQ(v[0],0);
+
+    Vector<int,8> small;
+    small.push_back(1);
+    Vector<int,8> movedSmall(static_cast<Vector<int,8>&&>(small));
+    CHECK(IsInside(movedSmall));
+    CHECK_EQ(movedSmall[0],1);
+  }
+
+  // рост удвоением: на 1000 элементов - 9 перевыделений (4..1024), с reserve - ни одного
+  {
+    Vector<int> v;
+    CHECK_EQ(Regrowths(v,1000),9);
+
+    Vector<int> reserved;
+    CHECK(reserved.reserve(1000));
+    CHECK_EQ(Regrowths(reserved,1000),0);
+  }
+
+  // FixedVector в кучу не ходит: сверх ёмкости push_back возвращает false
+  {
+    FixedVector<int,4> v;
+    for(int i=0;i<4;i++)
+      CHECK(v.push_back(i));
+    CHECK(!v.push_back(4));
+    CHECK_EQ(v.size(),4);
+    CHECK(IsInside(v));
+  }
+
+  // замер
+  const unsigned long rounds = 20000;
+  double heapSmall = PushCost<Vector<int> >(16,rounds,false);
+  double reservedSmall = PushCost<Vector<int> >(16,rounds,true);
+  double inlineSmall = PushCost<Vector<int,16> >(16,rounds,false);
+  double heapLarge = PushCost<Vector<int> >(1000,rounds/50,false);
+  double reservedLarge = PushCost<Vector<int> >(1000,rounds/50,true);
+
+  printf("push_back, 16 elements: %.1f ns heap, %.1f ns reserved, %.1f ns inline\n",heapSmall,reservedSmall,inlineSmall);
+  printf("push_back, 1000 elements: %.1f ns heap, %.1f ns reserved\n",heapLarge,reservedLarge);
+
+  return HostTestResult();
+}
@@ -0,0 +1,95 @@
+// приём от модулей Wi-Fi и GSM, пока loop стоит 200 мс: байты выгребаются в прерывании таймера 0
+// в приёмные кольца, буфер ядра (64 байта) не переполняется; слишком длинные строки отбрасываются и считаются
+#include "HostTest.h"
+#include "UARTLineBuffer.h"
+
+#define WIFI_PORT 2
+#define GSM_PORT 1
+#define STALL_MICROS 200000ULL
+
+// burst из lines строк длиной lineLen (с переводом строки)
+static std::string MakeBurst(int lines, int lineLen)
+{
+  std::string burst;
+  for(int i=0;i<lines;i++)
+  {
+    burst += std::string(lineLen - 2,'A' + (i % 26));
+    burst += "\r\n";
+  }
+  return burst;
+}
+
+static void CheckStall(UARTLineBuffer& buff, uint8_t port, const std::string& burst, int lines)
+{
+  unsigned long linesBefore = buff.GetLinesCount();
+  unsigned long lostBefore = buff.GetLostCount();
+  unsigned long droppedBefore = HostSerialPort(port).GetRXDropped();
+
+  HostSerialFeed(port,burst.c_str());
+  HostAdvanceMicros(STALL_MICROS); // всё приходит, пока loop стоит
+  HostRunLoops(10);
+
+  CHECK_EQ(buff.GetLinesCount() - linesBefore,lines);
+  CHECK_EQ(buff.GetLostCount() - lostBefore,0);
+  CHECK_EQ(HostSerialPort(port).GetRXDropped() - droppedBefore,0);
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(100);
+
+  // пачка почти во всё кольцо
+  CheckStall(wiFiReceiveBuff,WIFI_PORT,MakeBurst(12,42),12);
+  CheckStall(smsReceiveBuff,GSM_PORT,MakeBurst(6,42),6);
+
+  // больше кольца: лишнее считается потерянным, буфер ядра всё равно не переполняется
+  unsigned long lostBefore = wiFiReceiveBuff.GetLostCount();
+  HostSerialFeed(WIFI_PORT,std::string(1000,'B').c_str());
+  HostAdvanceMicros(STALL_MICROS);
+  HostRunLoops(10);
+  CHECK_EQ(wiFiReceiveBuff.GetLostCount() - lostBefore,1000 - (WIFI_RX_RING_SIZE - 1));
+  CHECK_EQ(HostSerialPort(WIFI_PORT).GetRXDropped(),0);
+  HostSerialFeed(WIFI_PORT,"\r\n");
+  HostRunLoops(10);
+
+  // строка длиннее WIFI_MAX_LINE_LENGTH не собирается дальше зарезервированного и отбрасывается целиком
+  unsigned long linesBefore = wiFiReceiveBuff.GetLinesCount();
+  unsigned long overflowBefore = wiFiReceiveBuff.GetOverflowCount();
+  std::string longLine(700,'C');
+  for(size_t pos=0;pos<longLine.length();pos+=100)
+  {
+    HostSerialFeed(WIFI_PORT,longLine.substr(pos,100).c_str());
+    HostRunLoops(5);
+  }
+  CHECK(wiFiReceiveBuff.IsOverflowed());
+  CHECK_EQ(wiFiReceiveBuff.GetLine().length(),WIFI_MAX_LINE_LENGTH);
+
+  HostSerialFeed(WIFI_PORT,"\r\nready\r\n");
+  HostRunLoops(5);
+  CHECK_EQ(wiFiReceiveBuff.GetOverflowCount() - overflowBefore,1);
+  CHECK_EQ(wiFiReceiveBuff.GetLinesCount() - linesBefore,1);
+  CHECK(!wiFiReceiveBuff.IsOverflowed());
+
+  // не поместившийся пакет +IPD пропускается по длине из заголовка: переводы строк в его данных
+  // строками не считаются, следующая строка принимается как обычно
+  linesBefore = wiFiReceiveBuff.GetLinesCount();
+  std::string ipdData = std::string(150,'D') + "\r\n" + std::string(148,'E');
+  HostSerialFeed(WIFI_PORT,("+IPD,0," + std::to_string(ipdData.length()) + ":").c_str());
+  for(size_t pos=0;pos<ipdData.length();pos+=100)
+  {
+    HostSerialFeed(WIFI_PORT,ipdData.substr(pos,100).c_str());
+    HostRunLoops(5);
+  }
+  HostSerialFeed(WIFI_PORT,"ready\r\n");
+  HostRunLoops(5);
+  CHECK_EQ(wiFiReceiveBuff.GetOverflowCount() - overflowBefore,2);
+  CHECK_EQ(wiFiReceiveBuff.GetLinesCount() - linesBefore,1);
+
+  // отброшенные строки видны в статистике приёма
+  std::string answer = HostCommand("CTGET=STAT|UART");
+  CHECK(answer.find("|WIFI,") != std::string::npos);
+  CHECK(answer.find("," + std::to_string(wiFiReceiveBuff.GetOverflowCount()) + "|GSM,") != std::string::npos);
+
+  return HostTestResult();
+}
@@ -0,0 +1,90 @@
+// выносной Nextion: скратчпад пишется в дисплей, только когда на нём что-то устарело - изменились показания
+// датчика с экрана ожидания, настройки или состояние контроллера, - а не раз в секунду
+#include "HostTest.h"
+#include "ModuleController.h"
+#include "UniversalSensors.h"
+
+#define NOT_WRITTEN 0xEE // метка в скратчпаде: если осталась - клиент скратчпад не записывал
+
+static UniRawScratchpad scratchpad;
+
+static UniNextionScratchpad* Scratch()
+{
+  return (UniNextionScratchpad*) scratchpad.data;
+}
+
+// дисплей прислал скратчпад; true - клиент записал в него новое состояние
+static bool Exchange()
+{
+  Scratch()->dataCount = NOT_WRITTEN;
+  AbstractUniClient* client = UniFactory.GetClient(&scratchpad);
+  client->Update(&scratchpad,true,ssRadio);
+
+  if(Scratch()->dataCount == NOT_WRITTEN)
+    return false;
+
+  Scratch()->dataCount = 0; // дисплей хранит то, что ему записали
+  return true;
+}
+
+static void SetTemperature(AbstractModule* module, uint8_t idx, int8_t value)
+{
+  Temperature t(value,0);
+  module->State.UpdateState(StateTemperature,idx,(void*)&t);
+}
+
+int main()
+{
+  HostBoot();
+  HostRunLoops(1000); // датчики сняли первые показания
+
+  memset(&scratchpad,0,sizeof(scratchpad));
+  scratchpad.head.packet_type = uniNextionClient;
+
+  AbstractModule* stateModule = MainController->GetModuleByID("STATE");
+  CHECK(stateModule != NULL);
+  CHECK(stateModule->State.GetState(StateTemperature,0) != NULL);
+  CHECK(stateModule->State.GetState(StateTemperature,1) != NULL);
+
+  // первый обмен - дисплей ещё ничего не показывает
+  CHECK(Exchange());
+  CHECK_EQ(Scratch()->openTemperature,MainController->GetSettings()->GetOpenTemp());
+
+  // ничего не менялось - не пишем, сколько бы времени ни прошло
+  CHECK(!Exchange());
+  HostRunLoops(1000);
+  CHECK(!Exchange());
+
+  // изменились показания датчика с экрана ожидания - пишем один раз (модуль сам перечитает датчик
+  // только при своём обновлении, а loop мы дальше не крутим)
+  SetTemperature(stateModule,0,25);
+  CHECK(Exchange());
+  CHECK_EQ(Scratch()->data[0].sensorType,StateTemperature);
+  CHECK(!Exchange());
+
+  // датчик, которого нет на экране ожидания, записи не вызывает
+  SetTemperature(stateModule,1,30);
+  CHECK(!Exchange());
+
+  // настройки поменяли с другого места - пишем
+  uint8_t openTemp = MainController->GetSettings()->GetOpenTemp();
+  MainController->GetSettings()->SetOpenTemp(openTemp + 1);
+  CHECK(Exchange());
+  CHECK_EQ(Scratch()->openTemperature,openTemp + 1);
+  CHECK(!Exchange());
+  MainController->GetSettings()->SetOpenTemp(openTemp);
+  CHECK(Exchange());
+
+  // дисплей перезапустился и потерял записанное - пишем заново
+  Scratch()->openTemperature = 0;
+  Scratch()->closeTemperature = 0;
+  CHECK(Exchange());
+
+  // нажали кнопку на дисплее - пишем
+  bitWrite(Scratch()->nextionStatus2,4,1); // температура открытия +1
+  CHECK(Exchange());
+  CHECK_EQ(Scratch()->openTemperature,openTemp + 1);
+  CHECK(!Exchange());
+
+  return HostTestResult();
+}
@@ -0,0 +1,57 @@
+// универсальные датчики регистрируются, только если под них нашлись состояния в пуле: при исчерпанном пуле
+// регистрация не проходит, счётчики выданных индексов не врут, датчик влажности не остаётся без пары состояний
+#include "HostTest.h"
+#include "ModuleController.h"
+#include "UniversalSensors.h"
+
+class FillerModule : public AbstractModule
+{
+  public:
+    FillerModule() : AbstractModule("FILL") {}
+
+    void Setup() {}
+    void Update(uint16_t dt) { UNUSED(dt); }
+    bool ExecCommand(const Command& command, bool wantAnswer) { UNUSED(command); UNUSED(wantAnswer); return false; }
+};
+
+int main()
+{
+  HostBoot();
+
+  FillerModule filler;
+  MainController->RegisterModule(&filler);
+
+  // занимаем весь пул состояний, оставляем одно место
+  uint8_t filled = 0;
+  while(filled < 255 && filler.State.AddState(StateTemperature,filled))
+    filled++;
+  CHECK(filled > 2);
+  filler.State.RemoveState(StateTemperature,--filled);
+
+  // датчику влажности нужно два состояния - не регистрируется и занятое было место отдаёт
+  uint8_t humidity = UniDispatcher.GetUniSensorsCount(uniHumidity);
+  uint8_t used = OneState::GetPoolUsed();
+  CHECK(!UniDispatcher.AddUniSensor(uniHumidity,humidity));
+  CHECK_EQ(UniDispatcher.GetUniSensorsCount(uniHumidity),humidity);
+  CHECK_EQ(OneState::GetPoolUsed(),used);
+
+  // датчику температуры места хватает
+  uint8_t temperature = UniDispatcher.GetUniSensorsCount(uniTemp);
+  CHECK(UniDispatcher.AddUniSensor(uniTemp,temperature));
+  CHECK_EQ(UniDispatcher.GetUniSensorsCount(uniTemp),temperature + 1);
+
+  // пул исчерпан - следующий датчик не регистрируется, выданных индексов столько же
+  CHECK(!UniDispatcher.AddUniSensor(uniTemp,temperature + 2));
+  CHECK_EQ(UniDispatcher.GetUniSensorsCount(uniTemp),temperature + 1);
+
+  // места хватает на один из двух нужных датчиков: выдан только он, регистрация не проходит
+  filler.State.RemoveState(StateTemperature,--filled);
+  CHECK(!UniDispatcher.AddUniSensor(uniTemp,temperature + 2));
+  CHECK_EQ(UniDispatcher.GetUniSensorsCount(uniTemp),temperature + 2);
+
+  UniSensorState states;
+  CHECK(UniDispatcher.GetRegisteredStates(uniTemp,temperature + 1,states));
+  CHECK(states.State1 != NULL);
+
+  return HostTestResult();
+}
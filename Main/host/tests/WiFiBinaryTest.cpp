@@ -0,0 +1,153 @@
+// команды клиентов Wi-Fi: текстовые и бинарные (BIN_OP_STATES) через пакеты +IPD.
+// ESP8266 изображается здесь же: отвечает OK на AT-команды и забирает данные после CIPSEND.
+#include "HostTest.h"
+#include "ModuleController.h"
+#include "BinaryProtocol.h"
+
+#define WIFI_PORT 2
+
+static std::string espInput; // что прошивка отправила в ESP и ещё не разобрано
+static size_t espDataLeft = 0; // сколько байт данных пакета ещё ждём после CIPSEND
+static std::string espSent; // данные, отправленные клиентам
+
+static void EspFeed(const std::string& data)
+{
+  HostSerialFeed(WIFI_PORT,(const uint8_t*) data.data(),data.length());
+}
+
+static void EspPump()
+{
+  espInput += HostSerialTakeOutput(WIFI_PORT);
+
+  while(!espInput.empty())
+  {
+    if(espDataLeft)
+    {
+      size_t n = espDataLeft < espInput.length() ? espDataLeft : espInput.length();
+      espSent += espInput.substr(0,n);
+      espInput.erase(0,n);
+      espDataLeft -= n;
+      if(!espDataLeft)
+        EspFeed("\r\nSEND OK\r\n");
+      continue;
+    }
+
+    size_t eol = espInput.find("\r\n");
+    if(eol == std::string::npos)
+      break;
+
+    std::string line = espInput.substr(0,eol);
+    espInput.erase(0,eol+2);
+
+    if(line == "AT+RST")
+      EspFeed("\r\nOK\r\n\r\nready\r\n");
+    else
+    if(line.find("AT+CIPSEND") == 0)
+    {
+      espDataLeft = atoi(line.c_str() + line.rfind(',') + 1);
+      EspFeed("\r\nOK\r\n> ");
+    }
+    else
+    if(line.find("AT") == 0)
+      EspFeed("\r\nOK\r\n");
+  } // while
+}
+
+static void RunWithEsp(unsigned long loops)
+{
+  for(unsigned long i=0;i<loops;i++)
+  {
+    HostRunLoops(1);
+    EspPump();
+  }
+}
+
+// отправляет данные от клиента 0 и возвращает всё, что ему ушло в ответ
+static std::string ClientRequest(const std::string& data)
+{
+  espSent.clear();
+  EspFeed("0,CONNECT\r\n");
+  RunWithEsp(10);
+
+  char header[32];
+  sprintf(header,"\r\n+IPD,0,%u:",(unsigned) data.length());
+  EspFeed(std::string(header) + data);
+  RunWithEsp(200);
+
+  return espSent;
+}
+
+static uint8_t CRC(const std::string& data, size_t from, size_t to)
+{
+  uint8_t crc = 0;
+  for(size_t i=from;i<to;i++)
+    crc = BinaryCRC8(crc,(uint8_t) data[i]);
+  return crc;
+}
+
+int main()
+{
+  HostBoot();
+  RunWithEsp(500); // модуль Wi-Fi настраивает ESP
+
+  // текстовая команда, как раньше
+  CHECK(ClientRequest("CTGET=0|PING\r\n").find("PONG") != std::string::npos);
+
+  // бинарная: показания датчиков модуля STATE, маска 0x0D - температура, освещённость, влажность.
+  // Байт маски совпадает с '\r' - пакет +IPD должен приниматься как есть
+  uint8_t moduleIdx = 0xFF;
+  for(size_t i=0;i<MainController->GetModulesCount();i++)
+    if(!strcmp(MainController->GetModule(i)->GetID(),"STATE"))
+      moduleIdx = (uint8_t) i;
+  CHECK(moduleIdx != 0xFF);
+
+  std::string request;
+  request += (char) BIN_FRAME_START;
+  request += (char) 4; // код операции, модуль, аргумент
+  request += (char) BIN_OP_STATES;
+  request += (char) moduleIdx;
+  request += (char) BIN_ARG_UINT8;
+  request += (char) 0x0D;
+  request += (char) CRC(request,1,request.length());
+
+  std::string expected;
+  ModuleState& states = MainController->GetModule(moduleIdx)->State;
+  uint8_t cnt = states.GetStateCount(StateTemperature);
+  CHECK(cnt > 0);
+  for(uint8_t i=0;i<cnt;i++)
+  {
+    OneState* os = states.GetStateByOrder(StateTemperature,i);
+    uint8_t raw[4];
+    uint8_t rawLen = os->GetRawData(raw);
+    expected += (char) StateTemperature;
+    expected += (char) os->GetIndex();
+    expected += (char) rawLen;
+    expected.append((const char*) raw,rawLen);
+  }
+
+  std::string answer = ClientRequest(request);
+  CHECK_EQ(answer.length(),expected.length() + 5);
+  if(answer.length() == expected.length() + 5)
+  {
+    CHECK_EQ((uint8_t) answer[0],BIN_FRAME_START);
+    CHECK_EQ((uint8_t) answer[1],expected.length() + 2);
+    CHECK_EQ((uint8_t) answer[2],BIN_OP_STATES);
+    CHECK_EQ((uint8_t) answer[3],BIN_STATUS_OK);
+    CHECK(answer.substr(4,expected.length()) == expected);
+    CHECK_EQ((uint8_t) answer[answer.length()-1],CRC(answer,1,answer.length()-1));
+  }
+
+  // нет такого датчика - ошибка без данных
+  request.erase(request.length()-1);
+  request[1] = 6;
+  request += (char) BIN_ARG_UINT8;
+  request += (char) 77;
+  request += (char) CRC(request,1,request.length());
+
+  answer = ClientRequest(request);
+  CHECK_EQ(answer.length(),5);
+  if(answer.length() == 5)
+    CHECK_EQ((uint8_t) answer[3],BIN_STATUS_ERROR);
+
+  return HostTestResult();
+}
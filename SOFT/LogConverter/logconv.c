@@ -0,0 +1,276 @@
+/*
+ * Перевод двоичного лога контроллера (LOG_BINARY_FORMAT, файлы logs/YYYYMMDD.BIN) в CSV -
+ * в том же виде, в каком контроллер пишет текстовый лог YYYYMMDD.LOG:
+ *   HH:MM,MODULE_NAME,SENSOR_TYPE,SENSOR_IDX,SENSOR_DATA\r\n
+ *
+ * Сборка:   cc -O2 -o logconv logconv.c   (из этой папки - нужен ../../Main/LogSeriesCodec.h)
+ * Запуск:   logconv [-i] [-t] [-H] 20170315.BIN > 20170315.LOG
+ *   -i  - вместо имени модуля писать его индекс (как LOG_CNANGE_NAME_TO_IDX)
+ *   -t  - вместо названия типа датчика писать его индекс (как LOG_CHANGE_TYPE_TO_IDX)
+ *   -H  - добавить две строки заголовка (как ADD_LOG_HEADER)
+ * Без имени файла читается стандартный ввод.
+ *
+ * Формат файла описан в Main/LogModule.h, сжатого лога (версия 2) - в Main/LogSeriesCodec.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define LOG_SERIES_MAX 254 /* 255 у декодера означает "таблицы ещё нет" */
+#include "../../Main/LogSeriesCodec.h"
+
+#define LOG_BINARY_SIGNATURE "GHLB"
+#define LOG_BINARY_VERSION 1
+#define LOG_BINARY_RECORD_SIZE 9
+
+/* ModuleStates из Main/AbstractModule.h */
+#define StateTemperature 1
+#define StateLuminosity 4
+#define StateHumidity 8
+#define StateWaterFlowIncremental 32
+#define StateSoilMoisture 64
+#define StatePH 128
+
+#define NEWLINE "\r\n"
+
+typedef struct
+{
+  int present;
+  unsigned char states;
+  char name[256];
+} module_info;
+
+static module_info modules[256];
+
+/* порядок и названия - как в текстовом логе (Main/Globals.h, LOG_*_TYPE) */
+static const struct { unsigned char type; const char* name; } types[] =
+{
+  { StateTemperature, "RT" },
+  { StateLuminosity, "RL" },
+  { StateHumidity, "RH" },
+  { StateWaterFlowIncremental, "WF" },
+  { StateSoilMoisture, "SM" },
+  { StatePH, "PH" },
+};
+#define TYPES_COUNT (sizeof(types)/sizeof(types[0]))
+
+static int nameToIdx = 0, typeToIdx = 0;
+
+static int read_bytes(FILE* f, unsigned char* buf, size_t len)
+{
+  return fread(buf,1,len,f) == len;
+}
+
+static const char* type_name(unsigned char type)
+{
+  size_t i;
+  for(i=0;i<TYPES_COUNT;i++)
+    if(types[i].type == type)
+      return types[i].name;
+
+  return NULL;
+}
+
+/* печатает одну строку лога; value - для температуры и подобных в сотых долях */
+static void print_sample(unsigned minuteOfDay, unsigned char moduleIdx, unsigned char type, unsigned char sensorIdx, long value)
+{
+  const char* tName = type_name(type);
+
+  printf("%02u:%02u,",minuteOfDay/60,minuteOfDay%60);
+
+  if(nameToIdx || !modules[moduleIdx].present)
+    printf("%u,",(unsigned) moduleIdx);
+  else
+    printf("%s,",modules[moduleIdx].name);
+
+  if(typeToIdx || !tName)
+    printf("%u,",(unsigned) type);
+  else
+    printf("%s,",tName);
+
+  printf("%u,",(unsigned) sensorIdx);
+
+  switch(type)
+  {
+    case StateLuminosity:
+      printf("%ld",value);
+    break;
+
+    case StateWaterFlowIncremental:
+      printf("%lu",(unsigned long) (uint32_t) value);
+    break;
+
+    default:
+      /* Value,Fract - в тексте есть запятая, поэтому контроллер обрамляет значение кавычками */
+      printf("\"%d,%02u\"",(int) (value/100),(unsigned) (value < 0 ? -(value % 100) : value % 100));
+    break;
+  }
+
+  fputs(NEWLINE,stdout);
+}
+
+static int file_read_byte(void* ctx)
+{
+  return fgetc((FILE*) ctx);
+}
+
+static void series_sink(void* ctx, uint16_t minuteOfDay, const LogSeries* s, uint8_t present)
+{
+  (void) ctx;
+  if(present)
+    print_sample(minuteOfDay,s->ModuleIndex,s->Type,s->SensorIndex,s->Last);
+}
+
+static void write_header_lines(FILE* out, int moduleCount, const unsigned char* order)
+{
+  unsigned char statesFound = 0;
+  int i, written = 0;
+  size_t j;
+
+  for(i=0;i<moduleCount;i++)
+  {
+    module_info* m = &modules[order[i]];
+    statesFound |= m->states;
+    fprintf(out,"%s%s=%u",written ? "," : "",m->name,(unsigned) order[i]);
+    written = 1;
+  }
+  if(written)
+    fputs(NEWLINE,out);
+
+  written = 0;
+  for(j=0;j<TYPES_COUNT;j++)
+  {
+    if(!(statesFound & types[j].type))
+      continue;
+
+    fprintf(out,"%s%s=%u",written ? "," : "",types[j].name,(unsigned) types[j].type);
+    written = 1;
+  }
+  if(written)
+    fputs(NEWLINE,out);
+}
+
+int main(int argc, char** argv)
+{
+  int addHeader = 0;
+  const char* fileName = NULL;
+  FILE* f = stdin;
+  unsigned char hdr[11], rec[LOG_BINARY_RECORD_SIZE], order[256];
+  int i, moduleCount;
+  unsigned long records = 0;
+
+  for(i=1;i<argc;i++)
+  {
+    if(!strcmp(argv[i],"-i"))
+      nameToIdx = 1;
+    else if(!strcmp(argv[i],"-t"))
+      typeToIdx = 1;
+    else if(!strcmp(argv[i],"-H"))
+      addHeader = 1;
+    else if(argv[i][0] == '-' && argv[i][1])
+    {
+      fprintf(stderr,"usage: %s [-i] [-t] [-H] [file.BIN]\n",argv[0]);
+      return 2;
+    }
+    else
+      fileName = argv[i];
+  }
+
+  if(fileName && strcmp(fileName,"-"))
+  {
+    f = fopen(fileName,"rb");
+    if(!f)
+    {
+      perror(fileName);
+      return 1;
+    }
+  }
+
+  /* сигнатура, версия, размер записи, год, месяц, день, кол-во модулей */
+  if(!read_bytes(f,hdr,sizeof(hdr)) || memcmp(hdr,LOG_BINARY_SIGNATURE,4))
+  {
+    fprintf(stderr,"not a binary log file\n");
+    return 1;
+  }
+  if(!(hdr[4] == LOG_BINARY_VERSION && hdr[5] == LOG_BINARY_RECORD_SIZE) && hdr[4] != LOG_SERIES_VERSION)
+  {
+    fprintf(stderr,"unsupported log version %u (record size %u)\n",(unsigned) hdr[4],(unsigned) hdr[5]);
+    return 1;
+  }
+
+  moduleCount = hdr[10];
+  for(i=0;i<moduleCount;i++)
+  {
+    unsigned char m[3];
+    module_info* info;
+
+    if(!read_bytes(f,m,3))
+    {
+      fprintf(stderr,"truncated module table\n");
+      return 1;
+    }
+
+    info = &modules[m[0]];
+    if(!read_bytes(f,(unsigned char*) info->name,m[2]))
+    {
+      fprintf(stderr,"truncated module table\n");
+      return 1;
+    }
+    info->name[m[2]] = 0;
+    info->states = m[1];
+    info->present = 1;
+    order[i] = m[0];
+  }
+
+  if(addHeader)
+    write_header_lines(stdout,moduleCount,order);
+
+  if(hdr[4] == LOG_SERIES_VERSION) /* сжатый лог - кадрами */
+  {
+    LogSeriesTable table;
+    uint16_t minuteOfDay;
+    int result;
+
+    LogSeriesReset(&table);
+    while((result = LogDecodeFrame(&table,file_read_byte,f,&minuteOfDay,series_sink,NULL)) > 0)
+      records++;
+
+    if(result < 0)
+      fprintf(stderr,"frame %lu: broken data, stopped\n",records + 1);
+  }
+  else
+  while(read_bytes(f,rec,LOG_BINARY_RECORD_SIZE))
+  {
+    unsigned minuteOfDay = rec[0] | (rec[1] << 8);
+    unsigned char type = rec[3];
+    unsigned long raw = (unsigned long) rec[5] | ((unsigned long) rec[6] << 8) | ((unsigned long) rec[7] << 16) | ((unsigned long) rec[8] << 24);
+    long value;
+
+    records++;
+
+    if(!type_name(type))
+    {
+      fprintf(stderr,"record %lu: unknown state type %u, skipped\n",records,(unsigned) type);
+      continue;
+    }
+
+    if(type == StateLuminosity || type == StateWaterFlowIncremental)
+      value = (long) (int32_t) raw;
+    else
+    {
+      /* Value и Fract - в сотые доли */
+      int deg = (signed char) (raw & 0xFF);
+      long fract = (long) ((raw >> 8) & 0xFF);
+      value = deg*100L + (deg < 0 ? -fract : fract);
+    }
+
+    print_sample(minuteOfDay,rec[2],type,rec[4],value);
+  }
+
+  if(f != stdin)
+    fclose(f);
+
+  return 0;
+}